@@ -0,0 +1,2 @@
+# -*- coding: utf-8 -*-
+""" Performance benchmarks for the FinDer library bindings."""
@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Heap allocations per FinDer update: Finder.process on a synthetic event,
+and the accessors around it, comparing the by-value getters and setters
+with the reference getters and the const reference setters. With
+--reloads, the resident memory across repeated Finder.Init calls.
+
+Run from the pyfinder folder after building the bindings:
+python3 benchmarks/bench_allocations.py --config /path/to/finder.config
+"""
+import argparse
+import os
+import numpy as np
+from pylibfinder.FiniteFault import (Allocation_Counter, Coordinate, Coordinate_List,
+                                     Finder, PGA_Data, PGA_Data_List)
+
+
+def synthetic_stations(rng, n_stations):
+    """ Station locations around a source at 46N/8E """
+    lat = 46.0 + rng.uniform(-1.5, 1.5, n_stations)
+    lon = 8.0 + rng.uniform(-2.0, 2.0, n_stations)
+    return lat, lon
+
+
+def pga_list(lat, lon, timestamp, amplitude, rng):
+    """ One update worth of PGA values, in cm/s/s """
+    pga = PGA_Data_List()
+    dist = np.hypot(lat - 46.0, (lon - 8.0) * np.cos(np.radians(46.0))) * 111.19
+    log10pga = amplitude - 1.5 * np.log10(dist + 10.0) + rng.normal(0.0, 0.1, len(lat))
+    for n in range(len(lat)):
+        pga.push_back(PGA_Data(name="S{:04d}".format(n), network="XX", channel="HGZ",
+                               location_code="00", location=Coordinate(lat[n], lon[n]),
+                               value=10.0 ** log10pga[n], timestamp=timestamp))
+    return pga
+
+
+def count(call, repeat):
+    """ Mean allocations and bytes of one call """
+    counter = Allocation_Counter()
+    counter.start()
+    for _ in range(repeat):
+        call()
+    counter.stop()
+    return counter.get_allocations() / repeat, counter.get_bytes() / repeat
+
+
+def resident_mb():
+    """ Resident set size of this process """
+    with open("/proc/self/statm") as statm:
+        pages = int(statm.read().split()[1])
+    return pages * os.sysconf("SC_PAGE_SIZE") / 1048576.0
+
+
+def report(label, allocations, nbytes):
+    print("{:34s}: {:10.1f} allocations {:12.0f} bytes".format(label, allocations, nbytes))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--config", required=True, help="FinDer configuration file")
+    parser.add_argument("--stations", type=int, default=200)
+    parser.add_argument("--updates", type=int, default=20)
+    parser.add_argument("--repeat", type=int, default=100,
+                        help="Calls per accessor measurement")
+    parser.add_argument("--reloads", type=int, default=0,
+                        help="Finder.Init calls to watch the resident memory over")
+    parser.add_argument("--share-templates", action="store_true",
+                        help="Share the template pixels between copies of the parameters")
+    args = parser.parse_args()
+
+    rng = np.random.default_rng(0)
+    lat, lon = synthetic_stations(rng, args.stations)
+    coords = Coordinate_List()
+    for n in range(args.stations):
+        coords.push_back(Coordinate(lat[n], lon[n]))
+    Finder.Init(args.config, coords, share_templates=args.share_templates)
+    if args.reloads > 0:
+        rss = [resident_mb()]
+        for _ in range(args.reloads):
+            Finder.Init(args.config, coords, share_templates=args.share_templates)
+            rss.append(resident_mb())
+        print("Resident memory over {:d} reloads: first {:.1f} MB, last {:.1f} MB, "
+              "max {:.1f} MB".format(args.reloads, rss[0], rss[-1], max(rss)))
+
+    t0 = 1.7e9
+    pga = pga_list(lat, lon, t0, 2.5, rng)
+    finder = Finder(Coordinate(46.0, 8.0), pga, 1, int(t0))
+
+    # process() with the amplitude growing as a larger event would
+    process = []
+    for update in range(args.updates):
+        pga = pga_list(lat, lon, t0 + update, 2.5 + 0.05 * update, rng)
+        counter = Allocation_Counter()
+        with counter:
+            finder.process(t0 + update, pga)
+        process.append((counter.get_allocations(), counter.get_bytes()))
+    process = np.array(process, dtype=float)
+
+    print("{:d} stations, {:d} updates".format(args.stations, args.updates))
+    report("process", process[:, 0].mean(), process[:, 1].mean())
+    for name in ("finder_rupture_list", "finder_azimuth_list", "finder_length_list",
+                 "pga_data_list"):
+        report("get_" + name, *count(getattr(finder, "get_" + name), args.repeat))
+        report("get_" + name + "_ref", *count(getattr(finder, "get_" + name + "_ref"),
+                                              args.repeat))
+    report("set_pga_data_list", *count(lambda: finder.set_pga_data_list(pga), args.repeat))
+
+
+if __name__ == '__main__':
+    main()
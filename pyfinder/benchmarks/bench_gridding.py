@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Per-update latency of the FinDer data image gridding, comparing the
+temp file path (GMT surface through the files in temp/) with the
+in-memory path (GMT virtual files) and the native tension spline.
+
+Run from the pyfinder folder after building the bindings:
+python3 benchmarks/bench_gridding.py --stations 200 --updates 50
+"""
+import argparse
+import time
+import numpy as np
+from pylibfinder.FiniteFault import ImageParams, Image_Gridder, Gridding_Mode
+
+
+def synthetic_update(rng, n_stations):
+    """ One update worth of stations around a source at 46N/8E """
+    lat = 46.0 + rng.uniform(-1.5, 1.5, n_stations)
+    lon = 8.0 + rng.uniform(-2.0, 2.0, n_stations)
+    dist = np.hypot(lat - 46.0, (lon - 8.0) * np.cos(np.radians(46.0))) * 111.19
+    log10pga = 2.5 - 1.5 * np.log10(dist + 10.0) + rng.normal(0.0, 0.1, n_stations)
+    return list(lat), list(lon), list(log10pga)
+
+
+def time_mode(mode, params, updates, thresholds):
+    """ Returns the per-update latencies in milliseconds """
+    gridder = Image_Gridder(mode=mode)
+    latencies = []
+    for lat, lon, log10pga in updates:
+        start = time.perf_counter()
+        gridder.grid_and_threshold(lat, lon, log10pga, params, thresholds)
+        latencies.append((time.perf_counter() - start) * 1000.0)
+    return np.array(latencies)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--stations", type=int, default=200)
+    parser.add_argument("--updates", type=int, default=50)
+    parser.add_argument("--resolution", type=float, default=0.02,
+                        help="Image resolution in degrees")
+    args = parser.parse_args()
+
+    rng = np.random.default_rng(0)
+    params = ImageParams(minLat=44.0, minLon=5.5, dLat=args.resolution, dLon=args.resolution,
+                         NLat=int(4.0 / args.resolution) + 1,
+                         NLon=int(5.0 / args.resolution) + 1)
+    thresholds = list(np.log10([2.0, 5.0, 10.0, 20.0, 40.0, 80.0, 160.0]))
+    updates = [synthetic_update(rng, args.stations) for _ in range(args.updates)]
+
+    print("Image {:d} x {:d}, {:d} stations, {:d} updates".format(
+        params.NLat, params.NLon, args.stations, args.updates))
+    for mode in (Gridding_Mode.GMT_FILES, Gridding_Mode.GMT_MEMORY, Gridding_Mode.NATIVE):
+        lat_ms = time_mode(mode, params, updates, thresholds)
+        print("{:12s}: p50 {:8.2f} ms  p99 {:8.2f} ms  mean {:8.2f} ms".format(
+            mode.name, np.percentile(lat_ms, 50), np.percentile(lat_ms, 99), lat_ms.mean()))
+
+
+if __name__ == '__main__':
+    main()
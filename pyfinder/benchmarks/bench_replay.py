@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+End-to-end FinDer latency: recorded or synthetic PGA updates replayed
+through Finder.Scan_Data, Finder creation and Finder.process, with the
+real time checks off (offline_notime_test). Reports the p50/p99 latency
+per update, the throughput, the peak resident memory and the heap
+allocations of each scenario.
+
+The canonical scenarios, to catch performance regressions:
+  m4_point     M4-like point source, 300 stations
+  m7_rupture   M7-like rupture growing to 150 km along N45E, 600 stations
+  dense_quiet  2000 stations of noise below the trigger level
+
+A recording is an .npz with times (U), lat (S), lon (S) and pga (U x S)
+in cm/s/s; --save writes the synthetic scenarios in that format.
+
+Run from the pyfinder folder after building the bindings:
+python3 benchmarks/bench_replay.py --config /path/to/finder.config
+python3 benchmarks/bench_replay.py --config finder.config --replay event.npz
+"""
+import argparse
+import numpy as np
+from pylibfinder.FiniteFault import (Coordinate, Coordinate_List, Finder_Engine,
+                                     Finder_Replay, Sncl_Table, pga_data_list_from_arrays)
+
+T0 = 1.7e9
+SOURCE = (46.0, 8.0)
+
+
+def stations(rng, n_stations):
+    """ Station locations around the source """
+    return (SOURCE[0] + rng.uniform(-1.5, 1.5, n_stations),
+            SOURCE[1] + rng.uniform(-2.0, 2.0, n_stations))
+
+
+def distance_km(lat, lon, lat0, lon0):
+    return np.hypot(lat - lat0, (lon - lon0) * np.cos(np.radians(SOURCE[0]))) * 111.19
+
+
+def m4_point(rng):
+    lat, lon = stations(rng, 300)
+    dist = distance_km(lat, lon, *SOURCE)
+    times = T0 + np.arange(30.0)
+    # the S wave passes at 3.5 km/s, the PGA holds its peak afterwards
+    pga = np.empty((len(times), len(lat)))
+    for u, t in enumerate(times - T0):
+        arrived = dist < 3.5 * t
+        log10pga = np.where(arrived, 2.0 - 1.5 * np.log10(dist + 10.0), -1.0)
+        pga[u] = 10.0 ** (log10pga + rng.normal(0.0, 0.1, len(lat)))
+    return times, lat, lon, pga
+
+
+def m7_rupture(rng):
+    lat, lon = stations(rng, 600)
+    times = T0 + np.arange(60.0)
+    strike = np.radians(45.0)
+    # km east and north of the source
+    east = (lon - SOURCE[1]) * np.cos(np.radians(SOURCE[0])) * 111.19
+    north = (lat - SOURCE[0]) * 111.19
+    along = east * np.sin(strike) + north * np.cos(strike)
+    across = -east * np.cos(strike) + north * np.sin(strike)
+    pga = np.empty((len(times), len(lat)))
+    peak = np.full(len(lat), 0.1)
+    for u, t in enumerate(times - T0):
+        # unilateral rupture at 2.5 km/s, up to 150 km
+        length = min(2.5 * t, 150.0)
+        dist = np.hypot(along - np.clip(along, 0.0, length), across)
+        arrived = np.hypot(along, across) < 3.5 * t
+        log10pga = 3.2 - 1.5 * np.log10(dist + 10.0) + rng.normal(0.0, 0.1, len(lat))
+        peak = np.where(arrived, np.maximum(peak, 10.0 ** log10pga), peak)
+        pga[u] = peak
+    return times, lat, lon, pga
+
+
+def dense_quiet(rng):
+    lat, lon = stations(rng, 2000)
+    times = T0 + np.arange(60.0)
+    pga = 10.0 ** rng.normal(-1.0, 0.2, (len(times), len(lat)))
+    return times, lat, lon, pga
+
+
+SCENARIOS = {"m4_point": m4_point, "m7_rupture": m7_rupture, "dense_quiet": dense_quiet}
+
+
+def load(path):
+    data = np.load(path)
+    return data["times"], data["lat"], data["lon"], data["pga"]
+
+
+def updates(times, lat, lon, pga):
+    """ (timestamp, PGA_Data_List) per update """
+    table = Sncl_Table()
+    index = table.intern_many(["XX"] * len(lat), ["S{:04d}".format(n) for n in range(len(lat))],
+                              ["HGZ"] * len(lat), ["00"] * len(lat))
+    steps = []
+    for u, t in enumerate(times):
+        steps.append((float(t), pga_data_list_from_arrays(table, lat, lon, pga[u],
+                                                           np.full(len(lat), t), index)))
+    return steps
+
+
+def station_list(lat, lon):
+    coords = Coordinate_List()
+    for n in range(len(lat)):
+        coords.push_back(Coordinate(lat[n], lon[n]))
+    return coords
+
+
+def report(name, stats):
+    print("{:12s}: {:4d} updates {:3d} events  p50 {:8.2f} ms  p99 {:8.2f} ms  "
+          "{:7.1f} updates/s {:6.2f} events/s  peak RSS {:7.1f} MB  "
+          "{:8.0f} allocations/update".format(
+              name, stats.updates, stats.events, stats.latency_ms(50.0), stats.latency_ms(99.0),
+              stats.updates_per_second(), stats.events_per_second(),
+              stats.peak_rss_kb / 1024.0, stats.allocations / max(stats.updates, 1)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--config", required=True, help="FinDer configuration file")
+    parser.add_argument("--scenario", action="append", choices=sorted(SCENARIOS),
+                        help="Synthetic scenario, all by default")
+    parser.add_argument("--replay", action="append", default=[], help="Recording to replay")
+    parser.add_argument("--save", help="Folder to write the synthetic scenarios to")
+    parser.add_argument("--hold-time", type=int, default=0, help="hold_time of the finders")
+    args = parser.parse_args()
+
+    runs = []
+    if args.replay:
+        runs += [(path, load(path)) for path in args.replay]
+    if args.scenario or not args.replay:
+        for name in args.scenario or sorted(SCENARIOS):
+            runs.append((name, SCENARIOS[name](np.random.default_rng(0))))
+
+    for name, (times, lat, lon, pga) in runs:
+        if args.save and name in SCENARIOS:
+            np.savez("{}/{}.npz".format(args.save, name), times=times, lat=lat, lon=lon, pga=pga)
+        # a fresh configuration per run, over the stations of the recording
+        engine = Finder_Engine()
+        engine.load(args.config, station_list(lat, lon))
+        replay = Finder_Replay(engine, hold_time=args.hold_time)
+        report(name, replay.run(updates(times, lat, lon, pga)))
+        replay.clear()
+
+
+if __name__ == '__main__':
+    main()
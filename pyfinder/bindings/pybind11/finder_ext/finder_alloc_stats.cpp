@@ -0,0 +1,72 @@
+//
+//      Heap allocation counting for the benchmarks
+//
+
+#include <cstdlib>
+#include <new>
+
+#include "finder_alloc_stats.h"
+
+namespace FiniteFault {
+
+namespace {
+    std::atomic<int> active_counters(0);
+    std::atomic<size_t> allocation_count(0);
+    std::atomic<size_t> allocation_bytes(0);
+}
+
+void Allocation_Counter::start() {
+    if (running) return;
+    active_counters.fetch_add(1);
+    start_count = allocation_count.load();
+    start_bytes = allocation_bytes.load();
+    running = true;
+}
+
+void Allocation_Counter::stop() {
+    if (!running) return;
+    allocations = allocation_count.load() - start_count;
+    bytes = allocation_bytes.load() - start_bytes;
+    active_counters.fetch_sub(1);
+    running = false;
+}
+
+size_t Allocation_Counter::get_allocations() const {
+    return running ? allocation_count.load() - start_count : allocations;
+}
+
+size_t Allocation_Counter::get_bytes() const {
+    return running ? allocation_bytes.load() - start_bytes : bytes;
+}
+
+size_t Allocation_Counter::total_allocations() { return allocation_count.load(); }
+
+size_t Allocation_Counter::total_bytes() { return allocation_bytes.load(); }
+
+}; // end of FiniteFault namespace
+
+// The array, nothrow and sized forms of the standard library forward to these two
+void* operator new(std::size_t size) {
+    if (FiniteFault::active_counters.load(std::memory_order_relaxed) > 0) {
+        FiniteFault::allocation_count.fetch_add(1, std::memory_order_relaxed);
+        FiniteFault::allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+    void* p = std::malloc(size == 0 ? 1 : size);
+    while (p == NULL) {
+        std::new_handler handler = std::get_new_handler();
+        if (handler == NULL) throw std::bad_alloc();
+        handler();
+        p = std::malloc(size == 0 ? 1 : size);
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+// end of file: finder_alloc_stats.cpp
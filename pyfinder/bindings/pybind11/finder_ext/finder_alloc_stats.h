@@ -0,0 +1,53 @@
+//
+//      Heap allocation counting for the benchmarks
+//
+//      The extension replaces the global operator new and delete. A Python extension is the
+//      first object in its own link map, so libFinder's allocations resolve to the same
+//      operators and are counted as well. Counting is off unless an Allocation_Counter is
+//      running; then every allocation adds to two relaxed atomic counters.
+//
+
+#ifndef __finder_alloc_stats_h__
+#define __finder_alloc_stats_h__
+
+#include <atomic>
+#include <cstddef>
+
+namespace FiniteFault {
+
+/** \class Allocation_Counter
+ * \brief Counts the operator new calls and bytes of all threads between start and stop.
+ * */
+class Allocation_Counter {
+  public:
+    Allocation_Counter() : running(false), start_count(0), start_bytes(0), allocations(0),
+        bytes(0) {}
+    ~Allocation_Counter() { if (running) stop(); }
+
+    void start();
+    void stop();
+    bool is_running() const { return running; }
+    // allocations and bytes of the last start/stop interval, or so far if still running
+    size_t get_allocations() const;
+    size_t get_bytes() const;
+
+    // counters since the process started, only advancing while some counter runs
+    static size_t total_allocations();
+    static size_t total_bytes();
+
+  private:
+    Allocation_Counter(const Allocation_Counter&);
+    Allocation_Counter& operator=(const Allocation_Counter&);
+
+    bool running; /**< between start and stop */
+    size_t start_count; /**< total_allocations at start */
+    size_t start_bytes; /**< total_bytes at start */
+    size_t allocations; /**< allocations of the last interval */
+    size_t bytes; /**< bytes of the last interval */
+}; // class Allocation_Counter
+
+}; // end of FiniteFault namespace
+
+#endif // __finder_alloc_stats_h__
+
+// end of file: finder_alloc_stats.h
@@ -0,0 +1,126 @@
+//
+//      Bit-packed binary templates and data images
+//
+
+#include "finder_bitmatch.h"
+#include "finder_scratch.h"
+
+namespace FiniteFault {
+
+namespace {
+    // rows of a 0/1 image packed into n_words words each, out[r * n_words + w]
+    void pack_rows(const cv::Mat& image, const size_t n_words, std::vector<uint64_t>& out) {
+        out.assign(image.rows * n_words, 0);
+        for (int r = 0; r < image.rows; r++) {
+            const uchar* row = image.ptr<uchar>(r);
+            uint64_t* packed = &out[r * n_words];
+            for (int c = 0; c < image.cols; c++) {
+                if (row[c] != 0) packed[c >> 6] |= (uint64_t) 1 << (c & 63);
+            }
+        }
+    }
+
+    cv::Mat to_binary(const cv::Mat& image) {
+        cv::Mat binary;
+        cv::compare(image, 0, binary, CMP_NE);
+        return binary;
+    }
+}
+
+Bit_Template::Bit_Template(const cv::Mat& templ) : rows(templ.rows), cols(templ.cols),
+        transposed(templ.rows > templ.cols), packed_rows(0), n_words(0), count(0) {
+    if (templ.empty()) return;
+    // pack along the longer side and keep it contiguous over the shorter one
+    cv::Mat packed = to_binary(templ);
+    if (transposed) packed = packed.t();
+    packed_rows = packed.rows;
+    n_words = (packed.cols + 63) / 64;
+    std::vector<uint64_t> row_major;
+    pack_rows(packed, n_words, row_major);
+    words.resize(row_major.size());
+    for (int u = 0; u < packed_rows; u++) {
+        for (size_t w = 0; w < n_words; w++) {
+            words[w * packed_rows + u] = row_major[u * n_words + w];
+        }
+    }
+    count = cv::countNonZero(packed);
+}
+
+cv::Mat Bit_Template::unpack() const {
+    const int packed_cols = transposed ? rows : cols;
+    cv::Mat packed = cv::Mat::zeros(packed_rows, packed_cols, CV_8U);
+    for (int u = 0; u < packed_rows; u++) {
+        for (int c = 0; c < packed_cols; c++) {
+            if ((words[(c >> 6) * packed_rows + u] >> (c & 63)) & 1) packed.at<uchar>(u, c) = 1;
+        }
+    }
+    return transposed ? cv::Mat(packed.t()) : packed;
+}
+
+void Bit_Image::Packed::assign(const cv::Mat& image) {
+    rows = image.rows;
+    cols = image.cols;
+    // one spare word, so that the higher word of a funnel shift is never past the row
+    n_words = cols / 64 + 2;
+    words.assign(n_words * rows, 0);
+    for (int r = 0; r < rows; r++) {
+        const uchar* row = image.ptr<uchar>(r);
+        for (int c = 0; c < cols; c++) {
+            if (row[c] != 0) words[(c >> 6) * rows + r] |= (uint64_t) 1 << (c & 63);
+        }
+    }
+}
+
+void Bit_Image::assign(const cv::Mat& image) {
+    // into the buffers of the previous image, which keep their size between timesteps
+    cv::compare(image, 0, binary, CMP_NE);
+    cv::transpose(binary, transposed);
+    normal.assign(binary);
+    flipped.assign(transposed);
+}
+
+bool Bit_Image::correlate(const Bit_Template& templ, const cv::Rect& placements,
+        cv::Mat& corr) const {
+    // placements in the orientation the template was packed in
+    const Packed& image = templ.transposed ? flipped : normal;
+    const cv::Rect packed = templ.transposed ?
+        cv::Rect(placements.y, placements.x, placements.height, placements.width) : placements;
+    const int packed_cols = templ.transposed ? templ.rows : templ.cols;
+    if (packed.x < 0 || packed.y < 0 || packed.x + packed.width - 1 + packed_cols > image.cols ||
+            packed.y + packed.height - 1 + templ.packed_rows > image.rows) {
+        return false;
+    }
+
+    corr.create(placements.height, placements.width, CV_32F);
+    corr.setTo(Scalar(0));
+    // the image rows read by the placements down one column
+    const int span = packed.height - 1 + templ.packed_rows;
+    uint64_t* shifted = reinterpret_cast<uint64_t*>(
+        Scratch_Arena::local().view(SCRATCH_SHIFTED, 1, span, CV_64F).data);
+    for (int x = 0; x < packed.width; x++) {
+        const int px = packed.x + x;
+        const size_t s = px & 63, base = px >> 6;
+        for (size_t w = 0; w < templ.n_words; w++) {
+            // pixels px + 64w.. of each row: the funnel shift of words base + w and base + w + 1
+            const uint64_t* column = image.column(base + w) + packed.y;
+            if (s > 0) {
+                const uint64_t* next = image.column(base + w + 1) + packed.y;
+                for (int r = 0; r < span; r++) {
+                    shifted[r] = (column[r] >> s) | (next[r] << (64 - s));
+                }
+                column = shifted;
+            }
+            const uint64_t* t = &templ.words[w * templ.packed_rows];
+            for (int y = 0; y < packed.height; y++) {
+                const float overlap = (float) and_popcount(column + y, t, templ.packed_rows);
+                if (templ.transposed) corr.at<float>(x, y) += overlap;
+                else corr.at<float>(y, x) += overlap;
+            }
+        }
+    }
+    return true;
+}
+
+}; // end of FiniteFault namespace
+
+// end of file: finder_bitmatch.cpp
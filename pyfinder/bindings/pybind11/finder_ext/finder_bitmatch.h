@@ -0,0 +1,98 @@
+//
+//      Bit-packed binary templates and data images
+//
+//      With type_of_run "bin" templates and thresholded images only hold 0/1, yet a cv::Mat spends
+//      a byte (or a float) per pixel and cv::matchTemplate a multiply-add per pixel pair. Here 64
+//      pixels go into one word and the overlap of a template with the image is and_popcount over
+//      the packed words. Templates are packed along their longer side (rotated templates are long
+//      and narrow), so a template takes close to 1/8 of its CV_8U size. The image is packed once
+//      per orientation, 2 bits per pixel in all. A placement at a bit offset within a word
+//      funnel-shifts two neighbouring words of each image row, once per image column and word
+//      for all the placements down that column, and then reads whole words.
+//
+
+#ifndef __finder_bitmatch_h__
+#define __finder_bitmatch_h__
+
+#include <cstdint>
+#include <vector>
+
+#include "../finder_headers/finder_opencv.h"
+#include "finder_popcount.h"
+
+namespace FiniteFault {
+
+/** \class Bit_Template
+ * \brief 0/1 template packed 64 pixels per word, column-word-major so that each word column
+ * is contiguous over the template rows.
+ * */
+class Bit_Template {
+  public:
+    Bit_Template() : rows(0), cols(0), transposed(false), packed_rows(0), n_words(0), count(0) {}
+    explicit Bit_Template(const cv::Mat& templ);
+
+    int get_rows() const { return rows; }
+    int get_cols() const { return cols; }
+    size_t get_count() const { return count; }
+    bool empty() const { return count == 0; }
+    size_t get_words() const { return words.size(); }
+    size_t memory_bytes() const { return words.size() * sizeof(uint64_t); }
+    // 0/1 CV_8U copy of the template
+    cv::Mat unpack() const;
+
+  private:
+    friend class Bit_Image;
+
+    int rows; /**< template rows */
+    int cols; /**< template columns */
+    bool transposed; /**< packed along the rows, because the template is taller than wide */
+    int packed_rows; /**< rows of the packed orientation */
+    size_t n_words; /**< words per packed row */
+    size_t count; /**< pixels set */
+    std::vector<uint64_t> words; /**< words[w * packed_rows + u]: packed row u, pixels 64w.. */
+}; // class Bit_Template
+
+/** \class Bit_Image
+ * \brief 0/1 image packed for correlation with Bit_Template, in both orientations, 2 bits per
+ * pixel in total.
+ * */
+class Bit_Image {
+  public:
+    Bit_Image() {}
+    explicit Bit_Image(const cv::Mat& image) { assign(image); }
+
+    void assign(const cv::Mat& image);
+    bool empty() const { return normal.rows == 0; }
+    size_t memory_bytes() const {
+        return (normal.words.size() + flipped.words.size()) * sizeof(uint64_t);
+    }
+
+    // corr(r, c), CV_32F of the placements size, is the overlap of templ with its top left
+    // corner at image pixel (placements.y + r, placements.x + c). False if the template does
+    // not fit the image at every placement.
+    bool correlate(const Bit_Template& templ, const cv::Rect& placements, cv::Mat& corr) const;
+
+  private:
+    /** One orientation of the image */
+    struct Packed {
+        Packed() : rows(0), cols(0), n_words(0) {}
+        void assign(const cv::Mat& image);
+        // word w of every row, pixels 64w..
+        const uint64_t* column(size_t w) const { return &words[w * rows]; }
+        int rows; /**< image rows */
+        int cols; /**< image columns */
+        size_t n_words; /**< words per row, one spare for the funnel shift */
+        std::vector<uint64_t> words; /**< words[w * rows + r] */
+    };
+
+    Packed normal; /**< image as is, for templates packed along their columns */
+    Packed flipped; /**< transposed image, for templates packed along their rows */
+    cv::Mat binary; /**< 0/255 image of the last assign, kept for the next one */
+    cv::Mat transposed; /**< binary transposed */
+}; // class Bit_Image
+
+}; // end of FiniteFault namespace
+
+#endif // __finder_bitmatch_h__
+
+// end of file: finder_bitmatch.h
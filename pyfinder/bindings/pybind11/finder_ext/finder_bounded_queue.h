@@ -0,0 +1,109 @@
+//
+//      Bounded lock-free queue
+//
+//      A fixed ring of cells, each with a sequence number that says whether the cell is free
+//      for the producer at a position or filled for the consumer at it. A producer claims the
+//      next position with one compare-and-swap, fills the cell and publishes it through the
+//      sequence number, a consumer does the same in reverse. Neither side ever waits: try_push
+//      fails on a full queue and try_pop on an empty one, and the caller decides what then.
+//      Any number of threads may push and pop.
+//
+
+#ifndef __finder_bounded_queue_h__
+#define __finder_bounded_queue_h__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace FiniteFault {
+
+/** \class Bounded_Queue
+ * \brief Fixed-capacity multi-producer multi-consumer queue without locks. Each cell carries a
+ * sequence number that tells producers and consumers whose turn it is.
+ * */
+template <typename T>
+class Bounded_Queue {
+  public:
+    // capacity is rounded up to a power of two
+    explicit Bounded_Queue(const size_t capacity) : enqueue_pos(0), dequeue_pos(0) {
+        size_t size = 2;
+        while (size < capacity) size *= 2;
+        mask = size - 1;
+        cells.reset(new Cell[size]);
+        for (size_t n = 0; n < size; n++) cells[n].sequence.store(n, std::memory_order_relaxed);
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+    // false if the queue is full, value is then left as it was
+    bool try_push(T& value) {
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells[pos & mask];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = (intptr_t) sequence - (intptr_t) pos;
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // false if the queue is empty
+    bool try_pop(T& value) {
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells[pos & mask];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = (intptr_t) sequence - (intptr_t) (pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(cell->value);
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+  private:
+    Bounded_Queue(const Bounded_Queue&);
+    Bounded_Queue& operator=(const Bounded_Queue&);
+
+    struct Cell {
+        std::atomic<size_t> sequence; /**< position this cell is ready for */
+        T value; /**< payload */
+    };
+
+    std::unique_ptr<Cell[]> cells; /**< ring of capacity() cells */
+    size_t mask; /**< capacity() - 1 */
+    // producers and consumers each on their own cache line, without over-aligning the type
+    char pad_enqueue[64]; /**< unused */
+    std::atomic<size_t> enqueue_pos; /**< next position to push to */
+    char pad_dequeue[64]; /**< unused */
+    std::atomic<size_t> dequeue_pos; /**< next position to pop from */
+}; // class Bounded_Queue
+
+}; // end of FiniteFault namespace
+
+#endif // __finder_bounded_queue_h__
+
+// end of file: finder_bounded_queue.h
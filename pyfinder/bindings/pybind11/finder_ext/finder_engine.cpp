@@ -0,0 +1,215 @@
+//
+//      FinDer configurations living side by side in one process
+//
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+
+#include "../finder_headers/finder_globals.h"
+#include "../finder_headers/finder_util.h"
+#include "finder_engine.h"
+#include "finder_state_lock.h"
+
+namespace FiniteFault {
+
+namespace {
+    std::mutex& finders_lock() {
+        static std::mutex lock;
+        return lock;
+    }
+
+    // engine of each Finder made by create_finder
+    std::unordered_map<const Finder*, Finder_Engine*>& finder_engines() {
+        static std::unordered_map<const Finder*, Finder_Engine*> engines;
+        return engines;
+    }
+}
+
+Finder_Engine::Finder_Engine() : loaded(false), finder_config(), new_mask(false) {
+    // the statics this state stands in for start zeroed
+    finder_parameters.mask_data = Mask_Data();
+}
+
+Finder_Engine::~Finder_Engine() {
+    if (this == &get_default()) return;
+    // take the state back from the statics if this engine is active, it is freed with us
+    Finder_State_Lock lock(Finder_State_Lock::EXCLUSIVE, &get_default());
+}
+
+bool Finder_Engine::load(const std::string& config_file,
+        const Coordinate_List& station_coord_list, const std::string& template_store) {
+    std::shared_ptr<Template_Store> store;
+    if (!template_store.empty()) {
+        store = Template_Store::for_path(template_store);
+        if (!store) {
+            LOGE << "Finder_Engine: cannot map template store " << template_store << ELL;
+            return false;
+        }
+    }
+
+    Finder_State_Lock lock(Finder_State_Lock::EXCLUSIVE, this);
+    // Init reads the masks anew, with the arrays it allocated
+    release_mask();
+    this->config_file = config_file;
+    {
+        // Init computes the mask through TEMP_DIR. It also reads all template files, which
+        // the library offers no way to skip: with a store, those copies are only dropped
+        // below, so the load takes as long as without one.
+        Temp_Files_Lock temp_files;
+        Finder::Init(this->config_file.c_str(), station_coord_list);
+    }
+    Finder::get_finder_config()->set_config_file(this->config_file.c_str());
+    if (store && !store->load(*Finder::get_finder_parameters())) {
+        LOGE << "Finder_Engine: template store " << template_store << " does not match the "
+            << "generic templates of " << config_file << ELL;
+        loaded = false;
+        return false;
+    }
+    this->template_store = store;
+
+    std::shared_ptr<Template_Cache> cache(new Template_Cache());
+    if (cache->build(*Finder::get_finder_parameters(),
+            Finder::get_finder_config()->resize_fraction)) {
+        template_cache = cache;
+    } else {
+        template_cache.reset();
+    }
+    station_index.build(station_coord_list);
+    loaded = true;
+    LOGI << "Finder_Engine: loaded " << config_file << ELL;
+    return true;
+}
+
+std::vector<Finder_Parameters*> Finder_Engine::active_template_sets() {
+    std::vector<Finder_Parameters*> sets(1, &Finder::Finder_parameters);
+    for (size_t n = 0; n < Finder::Finder_parameters_list.size(); n++) {
+        sets.push_back(&Finder::Finder_parameters_list[n]);
+    }
+    return sets;
+}
+
+bool Finder_Engine::attach_mask(const std::string& path) {
+    Finder_State_Lock lock(Finder_State_Lock::EXCLUSIVE, this);
+    const Mask_Data& mask_data = Finder::Finder_parameters.mask_data;
+    if (mask_data.nMask == 0 || mask_data.msklat == NULL || mask_data.msklon == NULL) {
+        LOGE << "Finder_Engine: " << config_file << " has no mask to attach" << ELL;
+        return false;
+    }
+    release_mask();
+    const double radius_km = Finder::Finder_config.mask_station_distance;
+    Coordinate_List stations;
+    for (size_t n = 0; n < station_index.size(); n++) {
+        stations.push_back(Coordinate(station_index.get_lat(n), station_index.get_lon(n)));
+    }
+
+    std::shared_ptr<Mask_Store> store;
+    if (!path.empty() && is_file_exist(path.c_str())) {
+        store = Mask_Store::open(path);
+        if (store && (!store->same_grid(mask_data) || store->get_radius_km() != radius_km)) {
+            LOGI << "Finder_Engine: " << path << " is a mask of other points, rebuilding" << ELL;
+            store.reset();
+        }
+    }
+    bool changed = !store;
+    if (store) {
+        // catch up with the stations added or removed since the file was saved
+        changed = store->get_N_stations() != stations.size() || store->update(stations) > 0;
+    } else {
+        store = Mask_Store::build(mask_data, stations, radius_km);
+    }
+    // the store puts a point inside while a station is within mask_station_distance; where
+    // the mask of the library says otherwise, the library values are kept
+    const size_t differ = store->differ(mask_data.mskval);
+    if (differ > 0) {
+        LOGE << "Finder_Engine: " << differ << " of " << store->size() << " points of the "
+            << "station mask differ from " << mask_data.mask_file << ", not attached" << ELL;
+        return false;
+    }
+    if (!path.empty() && changed && !store->save(path)) return false;
+
+    const std::vector<Finder_Parameters*> sets = active_template_sets();
+    size_t attached = 0;
+    for (size_t n = 0; n < sets.size(); n++) attached += store->attach(*sets[n]);
+    mask_store = store;
+    mask_path = path;
+    LOGI << "Finder_Engine: " << attached << " of " << sets.size() << " template sets share a "
+        << store->size() << " point mask" << ELL;
+    return true;
+}
+
+size_t Finder_Engine::update_stations(const Coordinate_List& station_coord_list) {
+    Finder_State_Lock lock(Finder_State_Lock::EXCLUSIVE, this);
+    station_index.build(station_coord_list);
+    if (!mask_store) return 0;
+    const size_t changed = mask_store->update(station_coord_list);
+    if (!mask_path.empty()) mask_store->save(mask_path);
+    return changed;
+}
+
+void Finder_Engine::release_mask() {
+    if (!mask_store) return;
+    const std::vector<Finder_Parameters*> sets = active_template_sets();
+    for (size_t n = 0; n < sets.size(); n++) mask_store->detach(*sets[n]);
+    mask_store.reset();
+    mask_path.clear();
+}
+
+bool Finder_Engine::set_offline_notime_test(const bool on) {
+    Finder_State_Lock lock(Finder_State_Lock::EXCLUSIVE, this);
+    const std::vector<Finder_Parameters*> sets = active_template_sets();
+    const bool previous = sets.empty() ? false : sets[0]->offline_notime_test;
+    for (size_t n = 0; n < sets.size(); n++) sets[n]->offline_notime_test = on;
+    return previous;
+}
+
+Finder* Finder_Engine::create_finder(const Coordinate& epicenter,
+        const PGA_Data_List& pga_data_list, const long event_id, const long hold_time) {
+    Finder* finder;
+    {
+        Finder_State_Lock lock(Finder_State_Lock::SHARED, this);
+        finder = new Finder(epicenter, pga_data_list, event_id, hold_time);
+    }
+    std::lock_guard<std::mutex> lk(finders_lock());
+    finder_engines()[finder] = this;
+    return finder;
+}
+
+void Finder_Engine::destroy_finder(Finder* finder) {
+    if (finder == NULL) return;
+    Finder_Engine& engine = of(finder);
+    {
+        std::lock_guard<std::mutex> lk(finders_lock());
+        finder_engines().erase(finder);
+    }
+    Finder_State_Lock lock(Finder_State_Lock::SHARED, &engine);
+    delete finder;
+}
+
+Finder_Engine& Finder_Engine::of(const Finder* finder) {
+    std::lock_guard<std::mutex> lk(finders_lock());
+    std::unordered_map<const Finder*, Finder_Engine*>::const_iterator it =
+        finder_engines().find(finder);
+    return it != finder_engines().end() ? *it->second : get_default();
+}
+
+Finder_Engine& Finder_Engine::get_default() {
+    static Finder_Engine engine;
+    return engine;
+}
+
+void Finder_Engine::swap_state() {
+    // moves and buffer swaps only, the template sets keep their addresses
+    std::swap(finder_config, Finder::Finder_config);
+    std::swap(finder_parameters, Finder::Finder_parameters);
+    std::swap(templates, Finder::Templates);
+    finder_parameters_list.swap(Finder::Finder_parameters_list);
+    templates_list.swap(Finder::Templates_list);
+    std::swap(finder_config_info, Finder::Finder_config_info);
+    template_id_list.swap(Finder::Template_id_list);
+    std::swap(new_mask, Finder::New_mask);
+}
+
+}; // end of FiniteFault namespace
+
+// end of file: finder_engine.cpp
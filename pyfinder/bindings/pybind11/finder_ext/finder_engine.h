@@ -0,0 +1,124 @@
+//
+//      FinDer configurations living side by side in one process
+//
+//      The library keeps its configuration and template sets in statics of Finder (Finder_config,
+//      Finder_parameters, Templates, Finder_parameters_list, Templates_list, Template_id_list,
+//      Finder_config_info and New_mask), which Finder::Init fills. A Finder_Engine owns one such
+//      state. It is swapped into the statics while a call on one of its Finders runs. The swap
+//      exchanges vector buffers and object members only: nothing is copied, and the template sets
+//      stay at their addresses, where the Finder objects of the engine point to.
+//
+//      Finder_State_Lock does the switching. Calls for the active engine share the state, while a
+//      call for another engine waits for them to drain and then activates its own. The state
+//      Finder::Init fills when called directly is the default engine. Engines that map their
+//      generic templates from the same Template_Store share those pages. attach_mask gives all
+//      template sets of an engine one Mask_Store, which update_stations keeps current.
+//
+
+#ifndef __finder_engine_h__
+#define __finder_engine_h__
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../finder_headers/finder.h"
+#include "../finder_headers/finder_config.h"
+#include "../finder_headers/finder_parameters.h"
+#include "finder_mask_store.h"
+#include "finder_station_index.h"
+#include "finder_template_cache.h"
+#include "finder_template_store.h"
+
+namespace FiniteFault {
+
+/** \class Finder_Engine
+ * \brief Configuration, template sets and mask of one FinDer setup, shared by the Finder
+ * objects created through it.
+ * */
+class Finder_Engine {
+  public:
+    Finder_Engine();
+    ~Finder_Engine();
+
+    // Finder::Init into this engine. With template_store, the generic templates are mapped
+    // from that store instead of the copies read by Init. Init, inside the library, still
+    // reads every template file, so the store saves memory across engines and processes, not
+    // startup time.
+    bool load(const std::string& config_file, const Coordinate_List& station_coord_list,
+        const std::string& template_store = "");
+
+    bool is_loaded() const { return loaded; }
+    const std::string& get_config_file() const { return config_file; }
+    // rotated templates of the generic set, built by load; NULL if that failed
+    std::shared_ptr<const Template_Cache> get_template_cache() const { return template_cache; }
+    // grid over the stations given to load, or to index_stations for the default engine
+    const Station_Index& get_station_index() const { return station_index; }
+    void index_stations(const Coordinate_List& station_coord_list) {
+        station_index.build(station_coord_list);
+    }
+
+    // point the masks of all template sets at one Mask_Store over the indexed stations. It is
+    // mapped from path if that holds a mask of the same points, otherwise built and, with a
+    // path, saved there. False, with the library mask kept, if the two masks disagree on a
+    // point.
+    bool attach_mask(const std::string& path = "");
+    // new station list: index it and update the shared mask where stations came or went, then
+    // save it to the path given to attach_mask. Returns the mask points that changed.
+    size_t update_stations(const Coordinate_List& station_coord_list);
+    std::shared_ptr<const Mask_Store> get_mask_store() const { return mask_store; }
+    // give the template sets their own masks back; with the state of this engine active, e.g.
+    // before Finder::Init reloads the masks
+    void release_mask();
+
+    // Finder_Parameters::offline_notime_test of all template sets, to process recorded data
+    // without the real time checks; returns the previous setting of the generic set
+    bool set_offline_notime_test(const bool on);
+
+    // a Finder of this engine; it must be destroyed with destroy_finder
+    Finder* create_finder(const Coordinate& epicenter, const PGA_Data_List& pga_data_list,
+        const long event_id, const long hold_time);
+    // destroy a Finder with the state of its engine active
+    static void destroy_finder(Finder* finder);
+    // engine of a Finder, the default engine for a Finder not made by create_finder
+    static Finder_Engine& of(const Finder* finder);
+
+    // engine of the state filled by calling Finder::Init directly
+    static Finder_Engine& get_default();
+
+  private:
+    friend class Finder_State_Lock;
+    friend class Finder_Snapshot;
+
+    Finder_Engine(const Finder_Engine&);
+    Finder_Engine& operator=(const Finder_Engine&);
+
+    // exchange the state held here with the Finder statics
+    void swap_state();
+    // generic and fault-specific template sets in the Finder statics
+    static std::vector<Finder_Parameters*> active_template_sets();
+
+    bool loaded; /**< load succeeded */
+    std::string config_file; /**< Finder_config.config_file points here while active */
+    std::shared_ptr<const Template_Cache> template_cache; /**< rotated generic templates */
+    std::shared_ptr<Template_Store> template_store; /**< mapped generic templates, if any */
+    Station_Index station_index; /**< stations of the mask */
+    std::shared_ptr<Mask_Store> mask_store; /**< mask shared by the template sets, if any */
+    std::string mask_path; /**< file mask_store is saved to, if any */
+
+    // Finder statics while another engine is active
+    Finder_Config finder_config; /**< Finder::Finder_config */
+    Finder_Parameters finder_parameters; /**< Finder::Finder_parameters */
+    Matrix2d templates; /**< Finder::Templates */
+    std::vector<Finder_Parameters> finder_parameters_list; /**< Finder::Finder_parameters_list */
+    std::vector<Matrix2d> templates_list; /**< Finder::Templates_list */
+    Finder_Config_Info finder_config_info; /**< Finder::Finder_config_info */
+    Template_ID_List template_id_list; /**< Finder::Template_id_list */
+    bool new_mask; /**< Finder::New_mask */
+}; // class Finder_Engine
+
+}; // end of FiniteFault namespace
+
+#endif // __finder_engine_h__
+
+// end of file: finder_engine.h
@@ -0,0 +1,484 @@
+//
+//      Batch geodesy kernels
+//
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#include "../finder_headers/finder_util.h"
+#include "finder_geodesy.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FINDER_GEODESY_X86
+#endif
+
+namespace FiniteFault {
+
+namespace {
+
+const double DEG2RAD = M_PI / 180.;
+const double PIO2 = M_PI / 2.;
+const double PIO4 = M_PI / 4.;
+
+// Cephes asin, a + a z P(z) / Q(z) with z = a^2 for |a| <= 0.625
+const double ASIN_P[6] = { 4.253011369004428248960E-3, -6.019598008014123785661E-1,
+    5.444622390564711410273E0, -1.626247967210700244449E1, 1.956261983317594739197E1,
+    -8.198089802484824371615E0 };
+const double ASIN_Q[5] = { -1.474091372988853791896E1, 7.049610280856842141659E1,
+    -1.471791292232726029859E2, 1.395105614657485689735E2, -4.918853881490881290097E1 };
+// Cephes atan, x + x z P(z) / Q(z) with z = x^2 for |x| <= 0.66
+const double ATAN_P[5] = { -8.750608600031904122785E-1, -1.615753718733365076637E1,
+    -7.500855792314704667340E1, -1.228866684490136173410E2, -6.485021904942025371773E1 };
+const double ATAN_Q[5] = { 2.485846490142306297962E1, 1.650270098316988542046E2,
+    4.328810604912902668951E2, 4.853903996359136964868E2, 1.945506571482613964144E2 };
+
+// How the library functions measure, found by calibrate()
+struct Spherical_Model {
+    bool distance_ok; /**< dist_deg2km is the great circle on a sphere of radius */
+    double radius; /**< km */
+    bool azimuth_ok; /**< loc2az is the forward azimuth, scaled and wrapped as below */
+    double azimuth_scale; /**< loc2az units per radian */
+    bool azimuth_wrap; /**< loc2az is in [0, full turn) rather than (-half, half] */
+    bool linear_ok; /**< lat2km and friends are the linear factors below */
+    double km_per_lat; /**< lat2km(1) */
+    double lat_per_km; /**< km2lat(1) */
+    double km_per_lon; /**< lon2km(1, 0) */
+    double lon_per_km; /**< km2lon(1, 0) */
+};
+
+bool close(const double a, const double b, const double tolerance) {
+    return std::fabs(a - b) <= tolerance * std::max(1., std::fabs(b));
+}
+
+double haversine(const double lat1, const double lon1, const double lat2, const double lon2) {
+    const double s_lat = std::sin((lat2 - lat1) * DEG2RAD / 2.);
+    const double s_lon = std::sin((lon2 - lon1) * DEG2RAD / 2.);
+    const double a = s_lat * s_lat +
+        std::cos(lat1 * DEG2RAD) * std::cos(lat2 * DEG2RAD) * s_lon * s_lon;
+    return 2. * std::asin(std::min(1., std::sqrt(a)));
+}
+
+double forward_azimuth(const double lat1, const double lon1, const double lat2,
+        const double lon2) {
+    const double dlon = (lon2 - lon1) * DEG2RAD;
+    return std::atan2(std::sin(dlon) * std::cos(lat2 * DEG2RAD),
+        std::cos(lat1 * DEG2RAD) * std::sin(lat2 * DEG2RAD) -
+        std::sin(lat1 * DEG2RAD) * std::cos(lat2 * DEG2RAD) * std::cos(dlon));
+}
+
+Spherical_Model calibrate() {
+    // pairs from metres to nearly antipodal, across the antimeridian and near a pole
+    const double pairs[][4] = { { 46., 8., 46.00001, 8.00001 }, { 46., 8., 47.5, 9.2 },
+        { 10., 20., -30., 100. }, { 0., 0., 0.5, 179.9 }, { 60., -170., 61., 175. },
+        { -89.5, 30., -88., -150. }, { 35., 139., 34., 135. } };
+    const size_t N_pairs = sizeof(pairs) / sizeof(pairs[0]);
+    Spherical_Model model;
+
+    model.radius = dist_deg2km(0., 0., 0., 1.) / DEG2RAD;
+    model.distance_ok = model.radius > 0.;
+    for (size_t n = 0; n < N_pairs && model.distance_ok; n++) {
+        const double* p = pairs[n];
+        // 1 mm, or rounding over long arcs
+        model.distance_ok = std::fabs(dist_deg2km(p[0], p[1], p[2], p[3]) -
+            model.radius * haversine(p[0], p[1], p[2], p[3])) <=
+            1e-6 + 1e-12 * model.radius * M_PI;
+    }
+
+    const double east = loc2az(0., 0., 0., 1.);
+    model.azimuth_scale = east / PIO2;
+    model.azimuth_wrap = loc2az(0., 0., 0., -1.) > 0.;
+    model.azimuth_ok = model.azimuth_scale > 0.;
+    for (size_t n = 0; n < N_pairs && model.azimuth_ok; n++) {
+        const double* p = pairs[n];
+        double az = forward_azimuth(p[0], p[1], p[2], p[3]);
+        if (model.azimuth_wrap && az < 0.) az += 2. * M_PI;
+        model.azimuth_ok = close(loc2az(p[0], p[1], p[2], p[3]), az * model.azimuth_scale, 1e-9);
+    }
+
+    model.km_per_lat = lat2km(1.);
+    model.lat_per_km = km2lat(1.);
+    model.km_per_lon = lon2km(1., 0.);
+    model.lon_per_km = km2lon(1., 0.);
+    model.linear_ok = true;
+    const double samples[] = { 0.37, 12.5, -3. };
+    const double avlats[] = { 0., 45., -60. };
+    for (size_t n = 0; n < 3 && model.linear_ok; n++) {
+        const double x = samples[n], c = std::cos(avlats[n] * DEG2RAD);
+        model.linear_ok = close(lat2km(x), model.km_per_lat * x, 1e-12) &&
+            close(km2lat(x), model.lat_per_km * x, 1e-12) &&
+            close(lon2km(x, avlats[n]), model.km_per_lon * x * c, 1e-12) &&
+            close(km2lon(x, avlats[n]), model.lon_per_km * x / c, 1e-12);
+    }
+    return model;
+}
+
+const Spherical_Model& spherical_model() {
+    static const Spherical_Model model(calibrate());
+    return model;
+}
+
+// origin terms shared by the kernels
+struct Origin {
+    double lat, lon;
+    double x, y, z;
+    double sin_lat, cos_lat, sin_lon, cos_lon;
+
+    Origin(const double lat, const double lon) : lat(lat), lon(lon) {
+        sin_lat = std::sin(lat * DEG2RAD);
+        cos_lat = std::cos(lat * DEG2RAD);
+        sin_lon = std::sin(lon * DEG2RAD);
+        cos_lon = std::cos(lon * DEG2RAD);
+        x = cos_lat * cos_lon;
+        y = cos_lat * sin_lon;
+        z = sin_lat;
+    }
+};
+
+typedef void (*Distance_Fn)(const Origin&, const Geo_Points&, double*, const size_t,
+    const size_t);
+typedef void (*Azimuth_Fn)(const Origin&, const Geo_Points&, double*);
+
+struct Geodesy_Kernel {
+    const char* name;
+    Distance_Fn distance;
+    Azimuth_Fn azimuth;
+    bool (*supported)();
+};
+
+void distance_library(const Origin& o, const Geo_Points& p, double* out, const size_t begin,
+        const size_t end) {
+    for (size_t n = begin; n < end; n++) {
+        out[n - begin] = dist_deg2km(o.lat, o.lon, p.lat[n], p.lon[n]);
+    }
+}
+
+void azimuth_library(const Origin& o, const Geo_Points& p, double* out) {
+    for (size_t n = 0; n < p.size(); n++) out[n] = loc2az(o.lat, o.lon, p.lat[n], p.lon[n]);
+}
+
+// asin of a in [0, 1], reduced to [0, 0.5] by asin(a) = pi/2 - 2 asin(sqrt((1 - a) / 2))
+inline double asin_unit(const double a) {
+    const bool big = a > 0.5;
+    const double t = big ? std::sqrt((1. - a) * 0.5) : a;
+    const double z = t * t;
+    const double p = ((((ASIN_P[0] * z + ASIN_P[1]) * z + ASIN_P[2]) * z + ASIN_P[3]) * z +
+        ASIN_P[4]) * z + ASIN_P[5];
+    const double q = ((((z + ASIN_Q[0]) * z + ASIN_Q[1]) * z + ASIN_Q[2]) * z + ASIN_Q[3]) * z +
+        ASIN_Q[4];
+    const double r = t + t * z * p / q;
+    return big ? PIO2 - 2. * r : r;
+}
+
+// atan2 in (-pi, pi], from atan of min/max in [0, 1] reduced to [-0.2, 0.66]
+inline double atan2_poly(const double y, const double x) {
+    const double ay = std::fabs(y), ax = std::fabs(x);
+    const double hi = std::max(ay, ax), lo = std::min(ay, ax);
+    const double a = hi > 0. ? lo / hi : 0.;
+    const bool big = a > 0.66;
+    const double t = big ? (a - 1.) / (a + 1.) : a;
+    const double z = t * t;
+    const double p = (((ATAN_P[0] * z + ATAN_P[1]) * z + ATAN_P[2]) * z + ATAN_P[3]) * z +
+        ATAN_P[4];
+    const double q = ((((z + ATAN_Q[0]) * z + ATAN_Q[1]) * z + ATAN_Q[2]) * z + ATAN_Q[3]) * z +
+        ATAN_Q[4];
+    double r = (big ? PIO4 : 0.) + t + t * z * p / q;
+    if (ay > ax) r = PIO2 - r;
+    if (x < 0.) r = M_PI - r;
+    return y < 0. ? -r : r;
+}
+
+void distance_generic(const Origin& o, const Geo_Points& p, double* out, const size_t begin,
+        const size_t end) {
+    const double radius2 = 2. * spherical_model().radius;
+    const double* x = p.x.data();
+    const double* y = p.y.data();
+    const double* z = p.z.data();
+    for (size_t n = begin; n < end; n++) {
+        const double dx = x[n] - o.x, dy = y[n] - o.y, dz = z[n] - o.z;
+        // half the chord is the sine of half the arc
+        const double h = std::min(1., 0.5 * std::sqrt(dx * dx + dy * dy + dz * dz));
+        out[n - begin] = radius2 * asin_unit(h);
+    }
+}
+
+void azimuth_generic(const Origin& o, const Geo_Points& p, double* out) {
+    const Spherical_Model& model = spherical_model();
+    const double full = 2. * M_PI * model.azimuth_scale;
+    for (size_t n = 0; n < p.size(); n++) {
+        const double sin_dlon = p.sin_lon[n] * o.cos_lon - p.cos_lon[n] * o.sin_lon;
+        const double cos_dlon = p.cos_lon[n] * o.cos_lon + p.sin_lon[n] * o.sin_lon;
+        const double az = model.azimuth_scale * atan2_poly(sin_dlon * p.cos_lat[n],
+            o.cos_lat * p.sin_lat[n] - o.sin_lat * p.cos_lat[n] * cos_dlon);
+        out[n] = model.azimuth_wrap && az < 0. ? az + full : az;
+    }
+}
+
+bool always() { return true; }
+
+#ifdef FINDER_GEODESY_X86
+__attribute__((target("avx2,fma")))
+inline __m256d horner_avx2(const __m256d z, const double* c, const size_t n, const bool monic) {
+    __m256d r = monic ? _mm256_add_pd(z, _mm256_set1_pd(c[0])) : _mm256_set1_pd(c[0]);
+    for (size_t k = 1; k < n; k++) r = _mm256_fmadd_pd(r, z, _mm256_set1_pd(c[k]));
+    return r;
+}
+
+__attribute__((target("avx2,fma")))
+inline __m256d asin_unit_avx2(const __m256d a) {
+    const __m256d half = _mm256_set1_pd(0.5);
+    const __m256d big = _mm256_cmp_pd(a, half, _CMP_GT_OQ);
+    const __m256d t = _mm256_blendv_pd(a,
+        _mm256_sqrt_pd(_mm256_mul_pd(_mm256_sub_pd(_mm256_set1_pd(1.), a), half)), big);
+    const __m256d z = _mm256_mul_pd(t, t);
+    const __m256d pq = _mm256_div_pd(horner_avx2(z, ASIN_P, 6, false),
+        horner_avx2(z, ASIN_Q, 5, true));
+    const __m256d r = _mm256_fmadd_pd(_mm256_mul_pd(t, z), pq, t);
+    return _mm256_blendv_pd(r,
+        _mm256_fnmadd_pd(_mm256_set1_pd(2.), r, _mm256_set1_pd(PIO2)), big);
+}
+
+__attribute__((target("avx2,fma")))
+inline __m256d atan2_avx2(const __m256d y, const __m256d x) {
+    const __m256d sign = _mm256_set1_pd(-0.);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d ay = _mm256_andnot_pd(sign, y), ax = _mm256_andnot_pd(sign, x);
+    const __m256d hi = _mm256_max_pd(ay, ax), lo = _mm256_min_pd(ay, ax);
+    // 0 / 0 where both are zero, masked to atan2(0, 0) = 0
+    const __m256d a = _mm256_and_pd(_mm256_div_pd(lo, hi), _mm256_cmp_pd(hi, zero, _CMP_GT_OQ));
+    const __m256d one = _mm256_set1_pd(1.);
+    const __m256d big = _mm256_cmp_pd(a, _mm256_set1_pd(0.66), _CMP_GT_OQ);
+    const __m256d t = _mm256_blendv_pd(a,
+        _mm256_div_pd(_mm256_sub_pd(a, one), _mm256_add_pd(a, one)), big);
+    const __m256d z = _mm256_mul_pd(t, t);
+    const __m256d pq = _mm256_div_pd(horner_avx2(z, ATAN_P, 5, false),
+        horner_avx2(z, ATAN_Q, 5, true));
+    __m256d r = _mm256_add_pd(_mm256_and_pd(big, _mm256_set1_pd(PIO4)),
+        _mm256_fmadd_pd(_mm256_mul_pd(t, z), pq, t));
+    r = _mm256_blendv_pd(r, _mm256_sub_pd(_mm256_set1_pd(PIO2), r),
+        _mm256_cmp_pd(ay, ax, _CMP_GT_OQ));
+    r = _mm256_blendv_pd(r, _mm256_sub_pd(_mm256_set1_pd(M_PI), r),
+        _mm256_cmp_pd(x, zero, _CMP_LT_OQ));
+    return _mm256_or_pd(r, _mm256_and_pd(sign, _mm256_cmp_pd(y, zero, _CMP_LT_OQ)));
+}
+
+__attribute__((target("avx2,fma")))
+void distance_avx2(const Origin& o, const Geo_Points& p, double* out, const size_t begin,
+        const size_t end) {
+    const __m256d ox = _mm256_set1_pd(o.x), oy = _mm256_set1_pd(o.y), oz = _mm256_set1_pd(o.z);
+    const __m256d half = _mm256_set1_pd(0.5), one = _mm256_set1_pd(1.);
+    const __m256d radius2 = _mm256_set1_pd(2. * spherical_model().radius);
+    const double* x = p.x.data();
+    const double* y = p.y.data();
+    const double* z = p.z.data();
+    size_t n = begin;
+    for (; n + 4 <= end; n += 4) {
+        const __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x + n), ox);
+        const __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y + n), oy);
+        const __m256d dz = _mm256_sub_pd(_mm256_loadu_pd(z + n), oz);
+        const __m256d c2 = _mm256_fmadd_pd(dz, dz, _mm256_fmadd_pd(dy, dy, _mm256_mul_pd(dx, dx)));
+        const __m256d h = _mm256_min_pd(one, _mm256_mul_pd(half, _mm256_sqrt_pd(c2)));
+        _mm256_storeu_pd(out + (n - begin), _mm256_mul_pd(radius2, asin_unit_avx2(h)));
+    }
+    if (n < end) distance_generic(o, p, out + (n - begin), n, end);
+}
+
+__attribute__((target("avx2,fma")))
+void azimuth_avx2(const Origin& o, const Geo_Points& p, double* out) {
+    const Spherical_Model& model = spherical_model();
+    const __m256d o_sin_lat = _mm256_set1_pd(o.sin_lat), o_cos_lat = _mm256_set1_pd(o.cos_lat);
+    const __m256d o_sin_lon = _mm256_set1_pd(o.sin_lon), o_cos_lon = _mm256_set1_pd(o.cos_lon);
+    const __m256d scale = _mm256_set1_pd(model.azimuth_scale);
+    const __m256d full = _mm256_set1_pd(model.azimuth_wrap ? 2. * M_PI * model.azimuth_scale : 0.);
+    const size_t end = p.size();
+    size_t n = 0;
+    for (; n + 4 <= end; n += 4) {
+        const __m256d sin_lat = _mm256_loadu_pd(p.sin_lat.data() + n);
+        const __m256d cos_lat = _mm256_loadu_pd(p.cos_lat.data() + n);
+        const __m256d sin_lon = _mm256_loadu_pd(p.sin_lon.data() + n);
+        const __m256d cos_lon = _mm256_loadu_pd(p.cos_lon.data() + n);
+        const __m256d sin_dlon = _mm256_fmsub_pd(sin_lon, o_cos_lon,
+            _mm256_mul_pd(cos_lon, o_sin_lon));
+        const __m256d cos_dlon = _mm256_fmadd_pd(cos_lon, o_cos_lon,
+            _mm256_mul_pd(sin_lon, o_sin_lon));
+        const __m256d ay = _mm256_mul_pd(sin_dlon, cos_lat);
+        const __m256d ax = _mm256_fmsub_pd(o_cos_lat, sin_lat,
+            _mm256_mul_pd(o_sin_lat, _mm256_mul_pd(cos_lat, cos_dlon)));
+        const __m256d az = _mm256_mul_pd(scale, atan2_avx2(ay, ax));
+        // full is zero for the signed range
+        _mm256_storeu_pd(out + n, _mm256_add_pd(az,
+            _mm256_and_pd(full, _mm256_cmp_pd(az, _mm256_setzero_pd(), _CMP_LT_OQ))));
+    }
+    for (; n < end; n++) {
+        const double sin_dlon = p.sin_lon[n] * o.cos_lon - p.cos_lon[n] * o.sin_lon;
+        const double cos_dlon = p.cos_lon[n] * o.cos_lon + p.sin_lon[n] * o.sin_lon;
+        const double az = model.azimuth_scale * atan2_poly(sin_dlon * p.cos_lat[n],
+            o.cos_lat * p.sin_lat[n] - o.sin_lat * p.cos_lat[n] * cos_dlon);
+        out[n] = model.azimuth_wrap && az < 0. ? az + 2. * M_PI * model.azimuth_scale : az;
+    }
+}
+
+bool has_avx2() { return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"); }
+#endif // FINDER_GEODESY_X86
+
+// fastest first; the library loops are the reference and the fallback
+const Geodesy_Kernel kernels[] = {
+#ifdef FINDER_GEODESY_X86
+    { "avx2", distance_avx2, azimuth_avx2, has_avx2 },
+#endif
+    { "generic", distance_generic, azimuth_generic, always },
+    { "library", distance_library, azimuth_library, always }
+};
+const size_t N_kernels = sizeof(kernels) / sizeof(kernels[0]);
+
+// the spherical kernels stand in for the library only if calibrate() found it spherical
+bool usable(const Geodesy_Kernel& kernel) {
+    if (!kernel.supported()) return false;
+    if (kernel.distance == distance_library) return true;
+    const Spherical_Model& model = spherical_model();
+    return model.distance_ok && model.azimuth_ok;
+}
+
+const Geodesy_Kernel* best_kernel() {
+    for (size_t n = 0; n < N_kernels; n++) {
+        if (usable(kernels[n])) return &kernels[n];
+    }
+    return &kernels[N_kernels - 1];
+}
+
+std::atomic<const Geodesy_Kernel*>& current_kernel() {
+    static std::atomic<const Geodesy_Kernel*> kernel(best_kernel());
+    return kernel;
+}
+
+} // anonymous namespace
+
+void Geo_Points::assign(const double* lats, const double* lons, const size_t n) {
+    clear();
+    reserve(n);
+    for (size_t k = 0; k < n; k++) push_back(lats[k], lons[k]);
+}
+
+void Geo_Points::push_back(const double lat_deg, const double lon_deg) {
+    const double s_lat = std::sin(lat_deg * DEG2RAD), c_lat = std::cos(lat_deg * DEG2RAD);
+    const double s_lon = std::sin(lon_deg * DEG2RAD), c_lon = std::cos(lon_deg * DEG2RAD);
+    lat.push_back(lat_deg);
+    lon.push_back(lon_deg);
+    x.push_back(c_lat * c_lon);
+    y.push_back(c_lat * s_lon);
+    z.push_back(s_lat);
+    sin_lat.push_back(s_lat);
+    cos_lat.push_back(c_lat);
+    sin_lon.push_back(s_lon);
+    cos_lon.push_back(c_lon);
+}
+
+void Geo_Points::clear() {
+    lat.clear();
+    lon.clear();
+    x.clear();
+    y.clear();
+    z.clear();
+    sin_lat.clear();
+    cos_lat.clear();
+    sin_lon.clear();
+    cos_lon.clear();
+}
+
+void Geo_Points::reserve(const size_t n) {
+    lat.reserve(n);
+    lon.reserve(n);
+    x.reserve(n);
+    y.reserve(n);
+    z.reserve(n);
+    sin_lat.reserve(n);
+    cos_lat.reserve(n);
+    sin_lon.reserve(n);
+    cos_lon.reserve(n);
+}
+
+void distances_km(const double lat, const double lon, const Geo_Points& points, double* out,
+        const size_t begin, const size_t end) {
+    if (begin >= end) return;
+    current_kernel().load(std::memory_order_relaxed)->distance(Origin(lat, lon), points, out,
+        begin, end);
+}
+
+void distances_km(const Geo_Points& origins, const Geo_Points& points, double* out) {
+    const Geodesy_Kernel* kernel = current_kernel().load(std::memory_order_relaxed);
+    for (size_t i = 0; i < origins.size(); i++) {
+        kernel->distance(Origin(origins.lat[i], origins.lon[i]), points,
+            out + i * points.size(), 0, points.size());
+    }
+}
+
+void azimuths(const double lat, const double lon, const Geo_Points& points, double* out) {
+    current_kernel().load(std::memory_order_relaxed)->azimuth(Origin(lat, lon), points, out);
+}
+
+void lat2km(const double* length_lat, const size_t n, double* out) {
+    const Spherical_Model& model = spherical_model();
+    if (!model.linear_ok) {
+        for (size_t k = 0; k < n; k++) out[k] = lat2km(length_lat[k]);
+        return;
+    }
+    for (size_t k = 0; k < n; k++) out[k] = model.km_per_lat * length_lat[k];
+}
+
+void km2lat(const double* length_km, const size_t n, double* out) {
+    const Spherical_Model& model = spherical_model();
+    if (!model.linear_ok) {
+        for (size_t k = 0; k < n; k++) out[k] = km2lat(length_km[k]);
+        return;
+    }
+    for (size_t k = 0; k < n; k++) out[k] = model.lat_per_km * length_km[k];
+}
+
+void lon2km(const double* length_lon, const double* avlat, const size_t n, double* out) {
+    const Spherical_Model& model = spherical_model();
+    if (!model.linear_ok) {
+        for (size_t k = 0; k < n; k++) out[k] = lon2km(length_lon[k], avlat[k]);
+        return;
+    }
+    for (size_t k = 0; k < n; k++) {
+        out[k] = model.km_per_lon * length_lon[k] * std::cos(avlat[k] * DEG2RAD);
+    }
+}
+
+void km2lon(const double* length_km, const double* avlat, const size_t n, double* out) {
+    const Spherical_Model& model = spherical_model();
+    if (!model.linear_ok) {
+        for (size_t k = 0; k < n; k++) out[k] = km2lon(length_km[k], avlat[k]);
+        return;
+    }
+    for (size_t k = 0; k < n; k++) {
+        out[k] = model.lon_per_km * length_km[k] / std::cos(avlat[k] * DEG2RAD);
+    }
+}
+
+std::string get_geodesy_kernel() {
+    return current_kernel().load()->name;
+}
+
+std::vector<std::string> get_geodesy_kernels() {
+    std::vector<std::string> names;
+    for (size_t n = 0; n < N_kernels; n++) {
+        if (usable(kernels[n])) names.push_back(kernels[n].name);
+    }
+    return names;
+}
+
+bool set_geodesy_kernel(const std::string& name) {
+    for (size_t n = 0; n < N_kernels; n++) {
+        if (name == kernels[n].name && usable(kernels[n])) {
+            current_kernel().store(&kernels[n]);
+            return true;
+        }
+    }
+    return false;
+}
+
+}; // end of FiniteFault namespace
+
+// end of file: finder_geodesy.cpp
@@ -0,0 +1,82 @@
+//
+//      Batch geodesy kernels
+//
+//      dist_deg2km and loc2az in finder_util.h measure one pair of points per call, with four
+//      trig calls and an inverse trig call each. Station loops (one origin to N stations, N
+//      origins to M stations) call them N or N*M times, although the stations do not move. Here
+//      the trig terms of each point are computed once into Geo_Points: unit vectors and
+//      sin/cos of latitude and longitude. A distance is then the chord between two unit vectors
+//      and one arcsine, and an azimuth one arctangent. Both run as polynomials, four points at
+//      a time with AVX2 where the CPU has it.
+//
+//      The library functions are the reference. At first use their earth radius and azimuth
+//      range are measured, and the spherical formulas are checked against them. If they do
+//      not match to rounding, the batch calls loop over the library functions instead.
+//
+
+#ifndef __finder_geodesy_h__
+#define __finder_geodesy_h__
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace FiniteFault {
+
+/** \class Geo_Points
+ * \brief Points on the sphere with their trig terms precomputed, structure of arrays.
+ * */
+class Geo_Points {
+  public:
+    Geo_Points() {}
+    Geo_Points(const double* lat, const double* lon, const size_t n) { assign(lat, lon, n); }
+
+    void assign(const double* lat, const double* lon, const size_t n);
+    void push_back(const double lat, const double lon);
+    void clear();
+    void reserve(const size_t n);
+    size_t size() const { return lat.size(); }
+    bool empty() const { return lat.empty(); }
+
+    std::vector<double> lat; /**< latitude in degrees */
+    std::vector<double> lon; /**< longitude in degrees */
+    std::vector<double> x; /**< unit vector, towards 0N 0E */
+    std::vector<double> y; /**< unit vector, towards 0N 90E */
+    std::vector<double> z; /**< unit vector, towards the north pole */
+    std::vector<double> sin_lat; /**< sine of the latitude */
+    std::vector<double> cos_lat; /**< cosine of the latitude */
+    std::vector<double> sin_lon; /**< sine of the longitude */
+    std::vector<double> cos_lon; /**< cosine of the longitude */
+}; // class Geo_Points
+
+// out[n - begin] = dist_deg2km(lat, lon, points[n]) for n in [begin, end)
+void distances_km(const double lat, const double lon, const Geo_Points& points,
+    double* out, const size_t begin, const size_t end);
+inline void distances_km(const double lat, const double lon, const Geo_Points& points,
+        double* out) {
+    distances_km(lat, lon, points, out, 0, points.size());
+}
+// out[i * points.size() + n] = dist_deg2km(origins[i], points[n])
+void distances_km(const Geo_Points& origins, const Geo_Points& points, double* out);
+
+// out[n] = loc2az(lat, lon, points[n]), the azimuth from the origin to each point
+void azimuths(const double lat, const double lon, const Geo_Points& points, double* out);
+
+// out[n] = lat2km(length_lat[n]), km2lat(length_km[n]) and the longitude versions at avlat
+void lat2km(const double* length_lat, const size_t n, double* out);
+void km2lat(const double* length_km, const size_t n, double* out);
+void lon2km(const double* length_lon, const double* avlat, const size_t n, double* out);
+void km2lon(const double* length_km, const double* avlat, const size_t n, double* out);
+
+// kernel used by the batch calls: "avx2", "generic" or "library" (scalar finder_util calls)
+std::string get_geodesy_kernel();
+// kernels this CPU supports, fastest first
+std::vector<std::string> get_geodesy_kernels();
+// switch to another kernel, e.g. for testing; false if it is not available
+bool set_geodesy_kernel(const std::string& name);
+
+}; // end of FiniteFault namespace
+
+#endif // __finder_geodesy_h__
+
+// end of file: finder_geodesy.h
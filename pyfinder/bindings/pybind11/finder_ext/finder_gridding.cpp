@@ -0,0 +1,242 @@
+//
+//      In-memory gridding of PGA observations into FinDer data images
+//
+
+#include <sys/stat.h>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+#include "finder_gridding.h"
+#include "finder_state_lock.h"
+#include "finder_timing.h"
+
+namespace FiniteFault {
+
+/** number of image nodes between two padding points along the image border */
+const size_t PAD_STEP = 5;
+
+Gridding_Mode gridding_mode_from_option(const std::string& gmt_api_option) {
+    if (gmt_api_option == GriddingModeString[GRIDDING_GMT_MEMORY]) {
+        return GRIDDING_GMT_MEMORY;
+    }
+    if (gmt_api_option == GriddingModeString[GRIDDING_NATIVE]) {
+        return GRIDDING_NATIVE;
+    }
+    return GRIDDING_GMT_FILES;
+}
+
+Image_Gridder::Image_Gridder(const double tension, const double min_log10PGA,
+        const Gridding_Mode mode) : mode(mode), tension(tension), min_log10PGA(min_log10PGA),
+        gmt_api(NULL), spline(tension) {}
+
+Image_Gridder::Image_Gridder(const Finder_Config& finder_config) :
+        mode(gridding_mode_from_option(finder_config.gmt_api_option)),
+        tension(finder_config.tension), min_log10PGA(finder_config.min_log10PGA),
+        gmt_api(NULL), spline(finder_config.tension) {}
+
+Image_Gridder::~Image_Gridder() {
+    if (gmt_api != NULL) {
+        GMT_Destroy_Session(gmt_api);
+        gmt_api = NULL;
+    }
+}
+
+bool Image_Gridder::open_session() {
+    if (gmt_api != NULL) return true;
+    // NOEXIT so that a GMT error is reported back instead of terminating the process
+    gmt_api = GMT_Create_Session("pyfinder", GMT_PAD_DEFAULT,
+        GMT_SESSION_NOEXIT | GMT_SESSION_EXTERNAL, NULL);
+    if (gmt_api == NULL) {
+        LOGE << "Image_Gridder: could not create a GMT session" << ELL;
+        return false;
+    }
+    return true;
+}
+
+std::string Image_Gridder::surface_region(const ImageParams& imgparams) const {
+    // gridline registration, so the max is chosen to give exactly NLat x NLon nodes
+    char buf[BLEN];
+    snprintf(buf, BLEN, "-R%.6f/%.6f/%.6f/%.6f -I%.6f/%.6f -T%.3f -Vq",
+        imgparams.minLon, imgparams.minLon + (imgparams.NLon - 1) * imgparams.dLon,
+        imgparams.minLat, imgparams.minLat + (imgparams.NLat - 1) * imgparams.dLat,
+        imgparams.dLon, imgparams.dLat, tension);
+    return std::string(buf);
+}
+
+void Image_Gridder::pad_data(const ImageParams& imgparams, std::vector<double>& lat,
+        std::vector<double>& lon, std::vector<double>& log10PGA) const {
+    const double maxLon = imgparams.minLon + (imgparams.NLon - 1) * imgparams.dLon;
+    const double maxLat = imgparams.minLat + (imgparams.NLat - 1) * imgparams.dLat;
+    for (size_t c = 0; c < imgparams.NLon; c += PAD_STEP) {
+        const double x = imgparams.minLon + c * imgparams.dLon;
+        lon.push_back(x); lat.push_back(imgparams.minLat); log10PGA.push_back(min_log10PGA);
+        lon.push_back(x); lat.push_back(maxLat); log10PGA.push_back(min_log10PGA);
+    }
+    for (size_t r = 0; r < imgparams.NLat; r += PAD_STEP) {
+        const double y = imgparams.minLat + r * imgparams.dLat;
+        lon.push_back(imgparams.minLon); lat.push_back(y); log10PGA.push_back(min_log10PGA);
+        lon.push_back(maxLon); lat.push_back(y); log10PGA.push_back(min_log10PGA);
+    }
+    // the far corner is not necessarily hit by the strides above
+    lon.push_back(maxLon); lat.push_back(maxLat); log10PGA.push_back(min_log10PGA);
+}
+
+bool Image_Gridder::grid(const std::vector<double>& lat, const std::vector<double>& lon,
+        const std::vector<double>& log10PGA, const ImageParams& imgparams, cv::Mat& raw_img) {
+    Stage_Timer timer(STAGE_GRIDDING);
+    if (lat.size() != lon.size() || lat.size() != log10PGA.size()) {
+        LOGE << "Image_Gridder: lat, lon and log10PGA must have the same length" << ELL;
+        return false;
+    }
+    if (lat.empty() || imgparams.NLat < 2 || imgparams.NLon < 2) {
+        return false;
+    }
+
+    // observations plus the padded border
+    std::vector<double> plat(lat), plon(lon), pval(log10PGA);
+    pad_data(imgparams, plat, plon, pval);
+
+    switch (mode) {
+        case GRIDDING_GMT_MEMORY:
+            return grid_gmt_memory(plat, plon, pval, imgparams, raw_img);
+        case GRIDDING_NATIVE:
+            return grid_native(plat, plon, pval, imgparams, raw_img);
+        case GRIDDING_GMT_FILES:
+        default:
+            return grid_gmt_files(plat, plon, pval, imgparams, raw_img);
+    }
+}
+
+bool Image_Gridder::grid_gmt_memory(const std::vector<double>& lat,
+        const std::vector<double>& lon, const std::vector<double>& log10PGA,
+        const ImageParams& imgparams, cv::Mat& raw_img) {
+    if (!open_session()) return false;
+
+    // wrap the input columns in a GMT vector container without copying them
+    uint64_t dim[4] = {3, lat.size(), GMT_DOUBLE, 0};
+    struct GMT_VECTOR* V = (struct GMT_VECTOR*) GMT_Create_Data(gmt_api, GMT_IS_VECTOR,
+        GMT_IS_POINT, GMT_CONTAINER_ONLY, dim, NULL, NULL, 0, 0, NULL);
+    if (V == NULL) return false;
+    GMT_Put_Vector(gmt_api, V, GMT_X, GMT_DOUBLE, (void*) &lon[0]);
+    GMT_Put_Vector(gmt_api, V, GMT_Y, GMT_DOUBLE, (void*) &lat[0]);
+    GMT_Put_Vector(gmt_api, V, GMT_Z, GMT_DOUBLE, (void*) &log10PGA[0]);
+
+    char input[GMT_VF_LEN], output[GMT_VF_LEN];
+    GMT_Open_VirtualFile(gmt_api, GMT_IS_DATASET|GMT_VIA_VECTOR, GMT_IS_POINT,
+        GMT_IN|GMT_IS_REFERENCE, V, input);
+    GMT_Open_VirtualFile(gmt_api, GMT_IS_GRID, GMT_IS_SURFACE, GMT_OUT|GMT_IS_REFERENCE,
+        NULL, output);
+
+    const std::string args = std::string(input) + " " + surface_region(imgparams) + " -G" +
+        std::string(output);
+    const int status = GMT_Call_Module(gmt_api, "surface", GMT_MODULE_CMD, (void*) args.c_str());
+
+    struct GMT_GRID* G = NULL;
+    if (status == GMT_NOERROR) {
+        G = (struct GMT_GRID*) GMT_Read_VirtualFile(gmt_api, output);
+    }
+    GMT_Close_VirtualFile(gmt_api, input);
+    GMT_Close_VirtualFile(gmt_api, output);
+
+    bool ok = (G != NULL && G->header->n_rows == imgparams.NLat &&
+        G->header->n_columns == imgparams.NLon);
+    if (ok) {
+        raw_img.create(imgparams.NLat, imgparams.NLon, CV_32F);
+        // GMT rows run north to south, image rows south to north
+        for (size_t rr = 0; rr < imgparams.NLat; rr++) {
+            float* row = raw_img.ptr<float>(imgparams.NLat - 1 - rr);
+            for (size_t c = 0; c < imgparams.NLon; c++) {
+                row[c] = G->data[GMT_Get_Index(gmt_api, G->header, rr, c)];
+            }
+        }
+    } else {
+        LOGE << "Image_Gridder: GMT surface failed with status " << status << ELL;
+    }
+
+    if (G != NULL) GMT_Destroy_Data(gmt_api, &G);
+    GMT_Destroy_Data(gmt_api, &V);
+    return ok;
+}
+
+bool Image_Gridder::grid_gmt_files(const std::vector<double>& lat,
+        const std::vector<double>& lon, const std::vector<double>& log10PGA,
+        const ImageParams& imgparams, cv::Mat& raw_img) {
+    if (!open_session()) return false;
+    // the files libFinder grids through during process
+    Temp_Files_Lock temp_files;
+    mkdir(TEMP_DIR.c_str(), 0755);
+
+    std::ofstream padded(PADDED_DATA_FILE.c_str());
+    if (!padded.is_open()) {
+        LOGE << "Image_Gridder: could not open " << PADDED_DATA_FILE << ELL;
+        return false;
+    }
+    padded << std::setprecision(8);
+    for (size_t n = 0; n < lat.size(); n++) {
+        padded << lon[n] << " " << lat[n] << " " << log10PGA[n] << "\n";
+    }
+    padded.close();
+
+    std::string args = PADDED_DATA_FILE + " " + surface_region(imgparams) + " -G" +
+        RAW_GRIDDED_DATA_NC;
+    if (GMT_Call_Module(gmt_api, "surface", GMT_MODULE_CMD, (void*) args.c_str()) !=
+            GMT_NOERROR) {
+        LOGE << "Image_Gridder: GMT surface failed on " << PADDED_DATA_FILE << ELL;
+        return false;
+    }
+    args = RAW_GRIDDED_DATA_NC + " ->" + GMT_IMAGE_FILE;
+    if (GMT_Call_Module(gmt_api, "grd2xyz", GMT_MODULE_CMD, (void*) args.c_str()) !=
+            GMT_NOERROR) {
+        LOGE << "Image_Gridder: GMT grd2xyz failed on " << RAW_GRIDDED_DATA_NC << ELL;
+        return false;
+    }
+
+    std::ifstream image(GMT_IMAGE_FILE.c_str());
+    if (!image.is_open()) {
+        LOGE << "Image_Gridder: could not open " << GMT_IMAGE_FILE << ELL;
+        return false;
+    }
+    raw_img.create(imgparams.NLat, imgparams.NLon, CV_32F);
+    raw_img.setTo(Scalar(min_log10PGA));
+    double x, y, z;
+    size_t count = 0;
+    while (image >> x >> y >> z) {
+        const long c = lround((x - imgparams.minLon) / imgparams.dLon);
+        const long r = lround((y - imgparams.minLat) / imgparams.dLat);
+        if (r < 0 || c < 0 || r >= (long) imgparams.NLat || c >= (long) imgparams.NLon) continue;
+        raw_img.at<float>(r, c) = z;
+        count++;
+    }
+    return count == imgparams.NLat * imgparams.NLon;
+}
+
+bool Image_Gridder::grid_native(const std::vector<double>& lat,
+        const std::vector<double>& lon, const std::vector<double>& log10PGA,
+        const ImageParams& imgparams, cv::Mat& raw_img) {
+    // the spline writes straight into the image rows, same layout as the GMT paths
+    raw_img.create(imgparams.NLat, imgparams.NLon, CV_32F);
+    if (!spline.solve(lon, lat, log10PGA, imgparams.minLon, imgparams.minLat, imgparams.dLon,
+            imgparams.dLat, imgparams.NLon, imgparams.NLat, raw_img.ptr<float>(0))) {
+        LOGE << "Image_Gridder: native gridding found no data inside the image" << ELL;
+        return false;
+    }
+    return true;
+}
+
+void Image_Gridder::threshold(const cv::Mat& raw_img, const std::vector<double>& log10_thresh,
+        std::vector<cv::Mat>& img_list, std::vector<double>& image_sum) {
+    Stage_Timer timer(STAGE_THRESHOLD);
+    img_list.resize(log10_thresh.size());
+    image_sum.resize(log10_thresh.size());
+    for (size_t i = 0; i < log10_thresh.size(); i++) {
+        // compare() gives 255 for true, scale to 0/1 so that pixel sums are pixel counts
+        cv::compare(raw_img, log10_thresh[i], img_list[i], CMP_GE);
+        img_list[i] &= Scalar(1);
+        image_sum[i] = cv::countNonZero(img_list[i]);
+    }
+}
+
+}; // end of FiniteFault namespace
+
+// end of file: finder_gridding.cpp
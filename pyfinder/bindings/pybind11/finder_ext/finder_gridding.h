@@ -0,0 +1,93 @@
+//
+//      In-memory gridding of PGA observations into FinDer data images
+//
+//      The library path (Finder_Event_Process::gmtImage / prepImage) writes the padded data,
+//      the gridded netCDF and the xyz image to the files in TEMP_DIR on every timestep. The
+//      gridders here keep the data in memory: GMT surface is driven through virtual files of
+//      a persistent GMT session, or replaced by the native tension spline of finder_spline.h,
+//      and the result is handed back as cv::Mat images.
+//
+
+#ifndef __finder_gridding_h__
+#define __finder_gridding_h__
+
+#include <string>
+#include <vector>
+
+#include "../finder_headers/finder_event_process.h" // ImageParams, Finder_Config
+#include "finder_spline.h"
+
+namespace FiniteFault {
+
+/** Gridding backend, selected through Finder_Config::gmt_api_option
+ * */
+enum Gridding_Mode {
+    GRIDDING_GMT_FILES, /**< GMT surface through the temp files of finder_globals.h (legacy) */
+    GRIDDING_GMT_MEMORY, /**< GMT surface through virtual files, no disk I/O */
+    GRIDDING_NATIVE /**< built-in tension spline, no GMT in the hot path */
+};
+
+const std::string GriddingModeString[] = { "files", "memory", "native" };
+
+/** Map the gmt_api_option config value onto a gridding backend. "memory" selects the
+ * in-memory GMT path and "native" the built-in tension spline, every other value ("yes",
+ * "no", "") keeps the file based path.
+ * */
+Gridding_Mode gridding_mode_from_option(const std::string& gmt_api_option);
+
+/** \class Image_Gridder
+ * \brief Grids log10(PGA) observations onto the GENERIC image extent and thresholds the result
+ * at each PGA level. One instance owns one GMT session, which is reused across timesteps, so an
+ * instance must not be shared between threads.
+ *
+ * Image layout: row r holds latitude minLat + r*dLat and column c longitude minLon + c*dLon.
+ * Raw images are CV_32F log10(PGA), thresholded images are CV_8U with values 0/1.
+ * */
+class Image_Gridder {
+  public:
+    Image_Gridder(const double tension = TENSION, const double min_log10PGA = MIN_LOG10PGA,
+        const Gridding_Mode mode = GRIDDING_GMT_MEMORY);
+    explicit Image_Gridder(const Finder_Config& finder_config);
+    ~Image_Gridder();
+
+    Gridding_Mode get_mode() const { return mode; }
+    double get_tension() const { return tension; }
+    double get_min_log10PGA() const { return min_log10PGA; }
+
+    // interpolate the observations onto the imgparams grid
+    bool grid(const std::vector<double>& lat, const std::vector<double>& lon,
+        const std::vector<double>& log10PGA, const ImageParams& imgparams, cv::Mat& raw_img);
+
+    // threshold a raw image at each log10 PGA level and count the pixels above each level
+    static void threshold(const cv::Mat& raw_img, const std::vector<double>& log10_thresh,
+        std::vector<cv::Mat>& img_list, std::vector<double>& image_sum);
+
+    // pad the observations with min_log10PGA values along the image border
+    void pad_data(const ImageParams& imgparams, std::vector<double>& lat,
+        std::vector<double>& lon, std::vector<double>& log10PGA) const;
+
+  private:
+    Image_Gridder(const Image_Gridder&);
+    Image_Gridder& operator=(const Image_Gridder&);
+
+    bool open_session();
+    std::string surface_region(const ImageParams& imgparams) const;
+    bool grid_gmt_memory(const std::vector<double>& lat, const std::vector<double>& lon,
+        const std::vector<double>& log10PGA, const ImageParams& imgparams, cv::Mat& raw_img);
+    bool grid_gmt_files(const std::vector<double>& lat, const std::vector<double>& lon,
+        const std::vector<double>& log10PGA, const ImageParams& imgparams, cv::Mat& raw_img);
+    bool grid_native(const std::vector<double>& lat, const std::vector<double>& lon,
+        const std::vector<double>& log10PGA, const ImageParams& imgparams, cv::Mat& raw_img);
+
+    Gridding_Mode mode; /**< gridding backend */
+    double tension; /**< tension factor for gmt surface interpolation */
+    double min_log10PGA; /**< log10(PGA) value used for the padded border */
+    void* gmt_api; /**< persistent GMT session, created on first use */
+    Tension_Spline spline; /**< native gridder for GRIDDING_NATIVE */
+}; // class Image_Gridder
+
+}; // end of FiniteFault namespace
+
+#endif // __finder_gridding_h__
+
+// end of file: finder_gridding.h
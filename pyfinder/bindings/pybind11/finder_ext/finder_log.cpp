@@ -0,0 +1,230 @@
+//
+//      Level-filtered logging behind the LOG* macros
+//
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#include "finder_log.h"
+#include "finder_bounded_queue.h"
+#ifdef ENABLE_SCLOG
+#include "../finder_headers/plog2sclog_wrapper.h" // sclogwrap::sclog
+#endif
+
+namespace FiniteFault {
+
+namespace {
+#ifdef ENABLE_SCLOG
+    // SeisComP filters by its own verbosity, every level is handed to it
+    const Log_Level DEFAULT_LEVEL = LOG_VERBOSE;
+    const Log::Sink DEFAULT_SINK = &sclogwrap::sclog;
+#else
+    const Log_Level DEFAULT_LEVEL = LOG_INFO;
+    const Log::Sink DEFAULT_SINK = NULL;
+#endif
+}
+
+std::atomic<int> Log::runtime_level(DEFAULT_LEVEL);
+const size_t Log::MAX_MESSAGE;
+
+namespace {
+    // a message producer that finds the delivery thread awake does not notify it, the thread
+    // looks at the queue again after this at the latest
+    const std::chrono::milliseconds IDLE_WAIT(10);
+
+    /** A message on the queue, fixed-size so that queueing does not allocate */
+    struct Log_Message {
+        int level; /**< Log_Level */
+        size_t length; /**< bytes of text used */
+        char text[Log::MAX_MESSAGE]; /**< message, not terminated */
+    };
+
+    /** Delivery thread and its queue, kept for the whole process once created */
+    struct Async_Log {
+        explicit Async_Log(const size_t capacity) : queue(capacity), running(false),
+            stopping(false), idle(false), queued(0), delivered(0) {}
+        Bounded_Queue<Log_Message> queue; /**< messages waiting for the sink */
+        std::thread thread; /**< delivery thread */
+        std::atomic<bool> running; /**< producers queue, rather than write themselves */
+        std::atomic<bool> stopping; /**< stop_async was called */
+        std::atomic<bool> idle; /**< the delivery thread waits for work */
+        std::atomic<size_t> queued; /**< messages put on the queue */
+        std::atomic<size_t> delivered; /**< messages handed to the sink */
+        std::mutex lock; /**< for the condition variables */
+        std::condition_variable wake; /**< new work or stopping */
+        std::condition_variable drained; /**< delivered caught up with queued */
+    };
+
+    // constant-initialised, so set before any static constructor logs
+    std::atomic<Log::Sink> sink(DEFAULT_SINK);
+    std::atomic<size_t> dropped(0), truncated(0);
+    std::mutex async_lock; /**< serialises start_async and stop_async */
+    // never deleted: a producer may still hold it while stop_async runs
+    std::atomic<Async_Log*> async_log(NULL);
+
+    void deliver(const Log_Level level, const char* message, const size_t length) {
+        const Log::Sink s = sink.load(std::memory_order_acquire);
+        if (s != NULL) {
+            s(level, message, length);
+            return;
+        }
+        // the message and its newline under one lock, so that lines of threads do not mix
+        flockfile(stdout);
+        fwrite(message, 1, length, stdout);
+        fputc('\n', stdout);
+        funlockfile(stdout);
+        fflush(stdout);
+    }
+
+    void run(Async_Log* a) {
+        Log_Message message;
+        for (;;) {
+            const bool last = a->stopping.load(std::memory_order_acquire);
+            size_t n = 0;
+            while (a->queue.try_pop(message)) {
+                deliver((Log_Level) message.level, message.text, message.length);
+                n++;
+            }
+            if (n > 0) {
+                std::lock_guard<std::mutex> lk(a->lock);
+                a->delivered.fetch_add(n);
+                a->drained.notify_all();
+                continue;
+            }
+            if (last) break;
+            std::unique_lock<std::mutex> lk(a->lock);
+            a->idle.store(true, std::memory_order_release);
+            a->wake.wait_for(lk, IDLE_WAIT);
+            a->idle.store(false, std::memory_order_release);
+        }
+        std::lock_guard<std::mutex> lk(a->lock);
+        a->drained.notify_all();
+    }
+
+    /** Formatting buffer of one thread */
+    struct Thread_Log {
+        Thread_Log() : stream(&buffer), in_use(false) {}
+        Log_Buffer buffer; /**< reused by every statement of the thread */
+        std::ostream stream; /**< over buffer */
+        bool in_use; /**< a statement is formatting into it */
+    };
+
+    Thread_Log& thread_log() {
+        thread_local Thread_Log log;
+        return log;
+    }
+}
+
+void Log::set_sink(const Sink s) {
+    sink.store(s, std::memory_order_release);
+}
+
+void Log::start_async(const size_t capacity) {
+    std::lock_guard<std::mutex> lk(async_lock);
+    Async_Log* a = async_log.load();
+    if (a == NULL) {
+        a = new Async_Log(capacity);
+        async_log.store(a);
+    }
+    if (a->running.load()) return;
+    a->stopping.store(false);
+    a->thread = std::thread(run, a);
+    a->running.store(true, std::memory_order_release);
+}
+
+void Log::stop_async() {
+    std::lock_guard<std::mutex> lk(async_lock);
+    Async_Log* a = async_log.load();
+    if (a == NULL || !a->running.load()) return;
+    // from here on producers deliver themselves, the thread writes what was queued
+    a->running.store(false, std::memory_order_release);
+    a->stopping.store(true, std::memory_order_release);
+    a->wake.notify_one();
+    a->thread.join();
+}
+
+bool Log::is_async() {
+    Async_Log* a = async_log.load(std::memory_order_acquire);
+    return a != NULL && a->running.load(std::memory_order_acquire);
+}
+
+void Log::flush() {
+    Async_Log* a = async_log.load(std::memory_order_acquire);
+    if (a != NULL && a->running.load(std::memory_order_acquire)) {
+        const size_t target = a->queued.load(std::memory_order_acquire);
+        std::unique_lock<std::mutex> lk(a->lock);
+        a->drained.wait(lk, [a, target]() {
+            return a->delivered.load() >= target || !a->running.load();
+        });
+    }
+    fflush(stdout);
+}
+
+void Log::write(const Log_Level level, const char* message, const size_t length) {
+    Async_Log* a = async_log.load(std::memory_order_acquire);
+    if (a == NULL || !a->running.load(std::memory_order_acquire)) {
+        deliver(level, message, length);
+        return;
+    }
+    Log_Message m;
+    m.level = (int) level;
+    m.length = length < MAX_MESSAGE ? length : MAX_MESSAGE;
+    if (m.length < length) truncated.fetch_add(1, std::memory_order_relaxed);
+    std::memcpy(m.text, message, m.length);
+    if (!a->queue.try_push(m)) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    a->queued.fetch_add(1, std::memory_order_release);
+    if (a->idle.load(std::memory_order_acquire)) a->wake.notify_one();
+}
+
+size_t Log::get_dropped() {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+size_t Log::get_truncated() {
+    return truncated.load(std::memory_order_relaxed);
+}
+
+Log_Record::Log_Record(const Log_Level level) : level(level), nested(false) {
+    Thread_Log& log = thread_log();
+    if (log.in_use) {
+        // an operand of the statement logs itself, it must not clobber the outer message
+        nested = true;
+        buffer = new Log_Buffer();
+        stream = new std::ostream(buffer);
+        return;
+    }
+    log.in_use = true;
+    buffer = &log.buffer;
+    stream = &log.stream;
+    buffer->text.clear();
+    // manipulators of the previous statement do not carry over
+    stream->clear();
+    stream->flags(std::ios_base::dec | std::ios_base::skipws);
+    stream->precision(6);
+    stream->width(0);
+    stream->fill(' ');
+}
+
+Log_Record::~Log_Record() {
+    std::string& text = buffer->text;
+    size_t length = text.size();
+    while (length > 0 && (text[length - 1] == '\n' || text[length - 1] == '\r')) length--;
+    if (length > 0) Log::write(level, text.data(), length);
+    if (nested) {
+        delete stream;
+        delete buffer;
+    } else {
+        thread_log().in_use = false;
+    }
+}
+
+}; // end of FiniteFault namespace
+
+// end of file: finder_log.cpp
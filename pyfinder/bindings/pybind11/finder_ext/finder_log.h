@@ -0,0 +1,146 @@
+//
+//      Level-filtered logging behind the LOG* macros
+//
+//      Without ENABLE_PLOG and ENABLE_SCLOG, the LOG* macros of finder_globals.h were std::cout,
+//      so every LOGV and LOGD statement formatted its operands and wrote them, whatever the
+//      debug level. They now expand to
+//
+//          for (bool on = Log::enabled(level); on; on = false) Log_Record(level) << ...
+//
+//      which, unlike an if, is safe inside an unbraced if-else. A statement above the runtime
+//      level (set_level) evaluates none of its operands, and one above FINDER_LOG_MAX_LEVEL is
+//      removed by the compiler. An enabled statement formats into one buffer per thread that
+//      keeps its capacity, and its text goes to the sink as one message when the statement ends.
+//      The sink is stdout, or the function set with set_sink. Under ENABLE_SCLOG it starts as
+//      SeisComP logging, and the runtime level as VERBOSE, so that the SeisComP verbosity
+//      filters as it did before; otherwise the level starts as INFO. With start_async the
+//      messages are handed through a bounded queue to a thread that calls the sink, so that a
+//      slow sink does not hold up the processing; a message that finds the queue full is
+//      dropped and counted.
+//
+//      The prebuilt libFinder keeps the logging it was compiled with. This covers the pyfinder
+//      code and the inline library code compiled with it.
+//
+
+#ifndef __finder_log_h__
+#define __finder_log_h__
+
+#include <atomic>
+#include <cstddef>
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+// statements above this level are compiled out
+#ifndef FINDER_LOG_MAX_LEVEL
+#define FINDER_LOG_MAX_LEVEL 5
+#endif
+
+namespace FiniteFault {
+
+/** Log levels, most severe first */
+enum Log_Level {
+    LOG_FATAL = 0, /**< LOGF */
+    LOG_ERROR = 1, /**< LOGE */
+    LOG_WARNING = 2, /**< LOGW */
+    LOG_INFO = 3, /**< LOGI and LOGN */
+    LOG_DEBUG = 4, /**< LOGD */
+    LOG_VERBOSE = 5 /**< LOGV, DEBUG_TRACE */
+};
+
+/** \class Log
+ * \brief Runtime level, sink and asynchronous delivery of the log messages.
+ * */
+class Log {
+  public:
+    typedef void (*Sink)(const Log_Level level, const char* message, const size_t length);
+
+    static bool enabled(const Log_Level level) {
+        return level <= FINDER_LOG_MAX_LEVEL &&
+            (int) level <= runtime_level.load(std::memory_order_relaxed);
+    }
+    // messages above level are neither formatted nor written
+    static void set_level(const Log_Level level) { runtime_level.store((int) level); }
+    static Log_Level get_level() { return (Log_Level) runtime_level.load(); }
+
+    // function receiving the messages, NULL for stdout; initially SeisComP logging under
+    // ENABLE_SCLOG
+    static void set_sink(const Sink sink);
+    // deliver the messages from a background thread, through a queue of capacity messages
+    static void start_async(const size_t capacity = 4096);
+    // deliver what is queued and go back to writing from the logging thread
+    static void stop_async();
+    static bool is_async();
+    // wait until the messages queued so far are delivered
+    static void flush();
+
+    // hand a message to the sink, or to the queue when async
+    static void write(const Log_Level level, const char* message, const size_t length);
+    // messages dropped on a full queue, and messages cut to MAX_MESSAGE bytes on it
+    static size_t get_dropped();
+    static size_t get_truncated();
+
+    static const size_t MAX_MESSAGE = 1000; /**< longest message the queue carries */
+
+  private:
+    static std::atomic<int> runtime_level; /**< most verbose level written */
+}; // class Log
+
+/** \class Log_Buffer
+ * \brief Stream buffer appending to a string that keeps its capacity between messages.
+ * */
+class Log_Buffer : public std::streambuf {
+  public:
+    Log_Buffer() { text.reserve(256); }
+    std::string text; /**< message so far */
+
+  protected:
+    int_type overflow(int_type c) {
+        if (c != traits_type::eof()) text.push_back((char) c);
+        return c;
+    }
+    std::streamsize xsputn(const char* s, std::streamsize n) {
+        text.append(s, (size_t) n);
+        return n;
+    }
+}; // class Log_Buffer
+
+/** \class Log_Record
+ * \brief One log statement: formats into the buffer of the thread and writes the message when
+ * the statement ends.
+ * */
+class Log_Record {
+  public:
+    explicit Log_Record(const Log_Level level);
+    ~Log_Record();
+
+    template <typename T>
+    Log_Record& operator<<(const T& data) {
+        *stream << data;
+        return *this;
+    }
+    // std::endl ends a line of the message, the message itself ends with the statement
+    Log_Record& operator<<(std::ostream& (*manipulator)(std::ostream&)) {
+        *stream << manipulator;
+        return *this;
+    }
+
+  private:
+    Log_Record(const Log_Record&);
+    Log_Record& operator=(const Log_Record&);
+
+    Log_Level level; /**< level of the statement */
+    Log_Buffer* buffer; /**< buffer of the thread, or own when nested */
+    std::ostream* stream; /**< stream over buffer */
+    bool nested; /**< an operand logged while the thread buffer was in use */
+}; // class Log_Record
+
+}; // end of FiniteFault namespace
+
+#define FINDER_LOG(level) \
+    for (bool finder_log_on = FiniteFault::Log::enabled(level); finder_log_on; \
+        finder_log_on = false) FiniteFault::Log_Record(level)
+
+#endif // __finder_log_h__
+
+// end of file: finder_log.h
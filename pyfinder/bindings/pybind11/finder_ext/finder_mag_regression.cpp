@@ -0,0 +1,196 @@
+//
+//      Magnitude regression over a batched GMPE
+//
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "finder_mag_regression.h"
+
+namespace FiniteFault {
+
+namespace {
+    const size_t MAX_NEWTON_STEPS = 50; /**< Newton steps before giving up on the tolerance */
+    const double MAG_TOLERANCE = 1e-10; /**< magnitude change that ends the refinement */
+
+    // a[0] + a[1] t + ... + a[4] t^4 and its first two derivatives
+    inline double quartic(const double* a, const double t) {
+        return (((a[4] * t + a[3]) * t + a[2]) * t + a[1]) * t + a[0];
+    }
+    inline double quartic_slope(const double* a, const double t) {
+        return ((4. * a[4] * t + 3. * a[3]) * t + 2. * a[2]) * t + a[1];
+    }
+    inline double quartic_curvature(const double* a, const double t) {
+        return (12. * a[4] * t + 6. * a[3]) * t + 2. * a[2];
+    }
+}
+
+void GMPE_Batch::assign(const double* dist_km, const uint8_t* is_s, const size_t n,
+        const GMPE_Coefficients& p, const GMPE_Coefficients& s) {
+    alpha.resize(n);
+    beta.resize(n);
+    gamma.resize(n);
+    // the only logarithm and square root of a station, whatever the number of magnitudes
+    for (size_t i = 0; i < n; i++) {
+        const GMPE_Coefficients& c = is_s[i] ? s : p;
+        const double R = std::sqrt(dist_km[i] * dist_km[i] + c.h * c.h);
+        const double log_R = std::log10(R);
+        alpha[i] = c.c0 + c.c3 * log_R + c.c5 * R;
+        beta[i] = c.c1 + c.c4 * log_R;
+        gamma[i] = c.c2;
+    }
+}
+
+void GMPE_Batch::assign(const double lat, const double lon, const double depth,
+        const Geo_Points& points, const uint8_t* is_s, const GMPE_Coefficients& p,
+        const GMPE_Coefficients& s) {
+    std::vector<double> dist(points.size());
+    if (!dist.empty()) distances_km(lat, lon, points, &dist[0]);
+    for (size_t i = 0; i < dist.size(); i++) dist[i] = std::sqrt(dist[i] * dist[i] + depth * depth);
+    assign(dist.empty() ? NULL : &dist[0], is_s, dist.size(), p, s);
+}
+
+void GMPE_Batch::evaluate(const double mag, double* out) const {
+    const double* a = alpha.data();
+    const double* b = beta.data();
+    const double* g = gamma.data();
+    const size_t n = size();
+    for (size_t i = 0; i < n; i++) out[i] = a[i] + (b[i] + g[i] * mag) * mag;
+}
+
+void GMPE_Batch::evaluate(const double* mags, const size_t N_mags, double* out) const {
+    for (size_t k = 0; k < N_mags; k++) evaluate(mags[k], out + k * size());
+}
+
+Mag_Regression_Result Mag_Regression::regress(const double* dist_km, const double* log10_pga,
+        const uint8_t* is_s, const size_t n) {
+    return regress(dist_km, log10_pga, is_s, n, false);
+}
+
+Mag_Regression_Result Mag_Regression::regress_s_only(const double* dist_km,
+        const double* log10_pga, const uint8_t* is_s, const size_t n) {
+    return regress(dist_km, log10_pga, is_s, n, true);
+}
+
+Mag_Regression_Result Mag_Regression::regress(const double* dist_km, const double* log10_pga,
+        const uint8_t* is_s, const size_t n, const bool s_only) {
+    batch.assign(dist_km, is_s, n, p, s);
+
+    // which phases take part depends on the number of usable S amplitudes
+    size_t valid_p = 0, valid_s = 0;
+    weight.assign(n, 0.);
+    for (size_t i = 0; i < n; i++) {
+        if (!std::isfinite(log10_pga[i]) || !std::isfinite(batch.alpha[i]) ||
+                !std::isfinite(batch.beta[i])) {
+            continue;
+        }
+        weight[i] = 1.;
+        if (is_s[i]) valid_s++;
+        else valid_p++;
+    }
+    const bool use_s = valid_s >= (s_only ? std::max(params.min_s_stations, (size_t) 1) :
+        params.min_s_stations);
+    const bool use_p = !s_only && !(use_s && valid_s > params.s_only_thresh);
+    N_P = use_p ? valid_p : 0;
+    N_S = use_s ? valid_s : 0;
+
+    // sum_n w (y - alpha - beta M - gamma M^2)^2 as a polynomial in t = M - center, centred so
+    // that the powers of t stay small
+    center = 0.5 * (params.min_mag + params.max_mag);
+    double sums[6] = { 0., 0., 0., 0., 0., 0. };
+    weight_sum = 0.;
+    for (size_t i = 0; i < n; i++) {
+        if (weight[i] == 0.) continue;
+        const double w = is_s[i] ? (use_s ? params.s_weight : 0.) : (use_p ? 1. : 0.);
+        weight[i] = w;
+        if (w == 0.) continue;
+        const double g = batch.gamma[i];
+        const double b = batch.beta[i] + 2. * g * center;
+        const double u = log10_pga[i] - batch.alpha[i] - (batch.beta[i] + g * center) * center;
+        sums[0] += w * u * u;
+        sums[1] += w * u * b;
+        sums[2] += w * b * b;
+        sums[3] += w * u * g;
+        sums[4] += w * b * g;
+        sums[5] += w * g * g;
+        weight_sum += w;
+    }
+    if (weight_sum > 0.) {
+        misfit_poly[0] = sums[0] / weight_sum;
+        misfit_poly[1] = -2. * sums[1] / weight_sum;
+        misfit_poly[2] = (sums[2] - 2. * sums[3]) / weight_sum;
+        misfit_poly[3] = 2. * sums[4] / weight_sum;
+        misfit_poly[4] = sums[5] / weight_sum;
+    } else {
+        misfit_poly.assign(5, 0.);
+    }
+    return minimise();
+}
+
+Mag_Regression_Result Mag_Regression::minimise() const {
+    Mag_Regression_Result result;
+    result.magnitude = result.grid_magnitude = result.misfit =
+        std::numeric_limits<double>::quiet_NaN();
+    result.N_P = N_P;
+    result.N_S = N_S;
+    result.iterations = 0;
+    if (weight_sum <= 0. || !(params.max_mag >= params.min_mag)) return result;
+
+    // the grid sweep of mag_regression, each point a polynomial evaluation
+    const double* a = misfit_poly.data();
+    const double t_min = params.min_mag - center, t_max = params.max_mag - center;
+    const double step = params.mag_step > 0. ? params.mag_step : t_max - t_min;
+    const size_t N_grid = (step > 0.) ? (size_t) ((t_max - t_min) / step + 1e-9) + 1 : 1;
+    double t_best = t_min, f_best = quartic(a, t_min);
+    for (size_t k = 1; k < N_grid; k++) {
+        const double t = t_min + k * step;
+        const double f = quartic(a, t);
+        if (f < f_best) {
+            f_best = f;
+            t_best = t;
+        }
+    }
+    result.grid_magnitude = center + t_best;
+
+    // the minimum lies within a step of the best grid point, where the slope changes sign
+    double lo = std::max(t_min, t_best - step), hi = std::min(t_max, t_best + step);
+    double t = t_best;
+    if (quartic_slope(a, lo) < 0. && quartic_slope(a, hi) > 0.) {
+        // Newton's method on the slope, bisecting whenever a step leaves the bracket
+        while (result.iterations < MAX_NEWTON_STEPS && hi - lo > MAG_TOLERANCE) {
+            result.iterations++;
+            const double slope = quartic_slope(a, t);
+            if (slope == 0.) break;
+            if (slope < 0.) lo = t;
+            else hi = t;
+            const double curvature = quartic_curvature(a, t);
+            double next = (curvature > 0.) ? t - slope / curvature : 0.5 * (lo + hi);
+            if (!(next > lo && next < hi)) next = 0.5 * (lo + hi);
+            const double change = std::fabs(next - t);
+            t = next;
+            if (change < MAG_TOLERANCE) break;
+        }
+    } else {
+        // no interior minimum in the bracket: the minimum is on the edge of the range
+        if (quartic(a, lo) < quartic(a, t)) t = lo;
+        if (quartic(a, hi) < quartic(a, t)) t = hi;
+    }
+    if (quartic(a, t) > f_best) t = t_best;
+    result.magnitude = center + t;
+    result.misfit = std::max(0., quartic(a, t));
+    return result;
+}
+
+double Mag_Regression::misfit(const double mag) const {
+    if (weight_sum <= 0.) return std::numeric_limits<double>::quiet_NaN();
+    return std::max(0., quartic(misfit_poly.data(), mag - center));
+}
+
+void Mag_Regression::misfit(const double* mags, const size_t N_mags, double* out) const {
+    for (size_t k = 0; k < N_mags; k++) out[k] = misfit(mags[k]);
+}
+
+}; // end of FiniteFault namespace
+
+// end of file: finder_mag_regression.cpp
@@ -0,0 +1,141 @@
+//
+//      Magnitude regression over a batched GMPE
+//
+//      Finder_Event_Process::mag_regression sweeps MR_MINMAG..MR_MAXMAG in MR_MAGSTEP steps and
+//      calls computeGMPE(mag, dist, phase) for every station at every step, so the distance
+//      and log terms of a station are evaluated once per magnitude. Here the GMPE has the form
+//
+//          log10 PGA = c0 + c1 M + c2 M^2 + (c3 + c4 M) log10 R + c5 R,    R = sqrt(d^2 + h^2)
+//
+//      with one coefficient set per phase. The terms of a station that do not depend on M are
+//      computed once, leaving log10 PGA = alpha + beta M + gamma M^2 per station. The weighted
+//      squared misfit of all stations is then a quartic in M, whose five coefficients are
+//      summed in one pass over the stations. Evaluating it at a magnitude no longer touches the
+//      stations: the grid sweep is a loop over the grid alone, and Newton's method on the
+//      derivative refines the best grid point to the exact minimum.
+//
+//      computeGMPE and its coefficients are inside the prebuilt libFinder. The coefficients are
+//      therefore given by the caller, as are the MR_* parameters, which are private members of
+//      Finder_Event_Process.
+//
+
+#ifndef __finder_mag_regression_h__
+#define __finder_mag_regression_h__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "finder_geodesy.h"
+
+namespace FiniteFault {
+
+/** Coefficients of one phase of the GMPE, see above */
+struct GMPE_Coefficients {
+    GMPE_Coefficients() : c0(0.), c1(0.), c2(0.), c3(0.), c4(0.), c5(0.), h(0.) {}
+    double c0; /**< constant */
+    double c1; /**< magnitude */
+    double c2; /**< magnitude squared */
+    double c3; /**< log10 distance */
+    double c4; /**< magnitude times log10 distance */
+    double c5; /**< distance, anelastic attenuation */
+    double h; /**< saturation depth in km added to the distance */
+};
+
+/** Magnitude regression parameters, the MR_* members of Finder_Event_Process */
+struct Mag_Regression_Params {
+    Mag_Regression_Params() : s_weight(1.), min_s_stations(1), min_mag(1.), max_mag(9.),
+        mag_step(0.1), s_only_thresh(10) {}
+    double s_weight; /**< misfit weight of an S amplitude relative to a P amplitude */
+    size_t min_s_stations; /**< S amplitudes are used from this many S stations on */
+    double min_mag; /**< smallest magnitude */
+    double max_mag; /**< largest magnitude */
+    double mag_step; /**< step of the grid that brackets the minimum */
+    size_t s_only_thresh; /**< above this many S stations, only S amplitudes are used */
+};
+
+/** Outcome of a magnitude regression */
+struct Mag_Regression_Result {
+    double magnitude; /**< refined magnitude, NaN without usable stations */
+    double grid_magnitude; /**< best magnitude on the mag_step grid */
+    double misfit; /**< weighted mean squared log10 residual at magnitude */
+    size_t N_P; /**< P amplitudes used */
+    size_t N_S; /**< S amplitudes used */
+    size_t iterations; /**< Newton steps of the refinement */
+};
+
+/** \class GMPE_Batch
+ * \brief GMPE of a set of stations with the magnitude-free terms precomputed.
+ * */
+class GMPE_Batch {
+  public:
+    GMPE_Batch() {}
+
+    // stations at dist_km, is_s[n] != 0 for S amplitudes
+    void assign(const double* dist_km, const uint8_t* is_s, const size_t n,
+        const GMPE_Coefficients& p, const GMPE_Coefficients& s);
+    // the same with the hypocentral distances from (lat, lon, depth) to points
+    void assign(const double lat, const double lon, const double depth, const Geo_Points& points,
+        const uint8_t* is_s, const GMPE_Coefficients& p, const GMPE_Coefficients& s);
+    size_t size() const { return alpha.size(); }
+
+    // out[n] = log10 PGA of station n at mag
+    void evaluate(const double mag, double* out) const;
+    // out[i * size() + n] = log10 PGA of station n at mags[i]
+    void evaluate(const double* mags, const size_t N_mags, double* out) const;
+
+    std::vector<double> alpha; /**< c0 + c3 log10 R + c5 R */
+    std::vector<double> beta; /**< c1 + c4 log10 R */
+    std::vector<double> gamma; /**< c2 */
+}; // class GMPE_Batch
+
+/** \class Mag_Regression
+ * \brief Magnitude that minimises the weighted misfit of observed and GMPE log10 PGA.
+ * */
+class Mag_Regression {
+  public:
+    Mag_Regression(const GMPE_Coefficients& p, const GMPE_Coefficients& s,
+        const Mag_Regression_Params& params = Mag_Regression_Params())
+        : p(p), s(s), params(params), misfit_poly(5, 0.), center(0.), weight_sum(0.), N_P(0),
+        N_S(0) {}
+
+    // mag_regression: P and S amplitudes, S from min_s_stations on and alone above
+    // s_only_thresh. Observations with a non-finite log10_pga or distance are skipped.
+    Mag_Regression_Result regress(const double* dist_km, const double* log10_pga,
+        const uint8_t* is_s, const size_t n);
+    // mag_regression_Sonly: the S amplitudes alone
+    Mag_Regression_Result regress_s_only(const double* dist_km, const double* log10_pga,
+        const uint8_t* is_s, const size_t n);
+
+    // misfit of the last regression at mag, and at each of mags into out
+    double misfit(const double mag) const;
+    void misfit(const double* mags, const size_t N_mags, double* out) const;
+
+    const GMPE_Batch& get_batch() const { return batch; }
+    const Mag_Regression_Params& get_params() const { return params; }
+
+  private:
+    Mag_Regression(const Mag_Regression&);
+    Mag_Regression& operator=(const Mag_Regression&);
+
+    Mag_Regression_Result regress(const double* dist_km, const double* log10_pga,
+        const uint8_t* is_s, const size_t n, const bool s_only);
+    Mag_Regression_Result minimise() const;
+
+    GMPE_Coefficients p; /**< P coefficients */
+    GMPE_Coefficients s; /**< S coefficients */
+    Mag_Regression_Params params; /**< regression parameters */
+    GMPE_Batch batch; /**< stations of the last regression */
+    std::vector<double> weight; /**< misfit weight per station, 0 if unused */
+    std::vector<double> misfit_poly; /**< quartic in M - center, constant term first */
+    double center; /**< magnitude the quartic is expanded around */
+    double weight_sum; /**< sum of weight */
+    size_t N_P; /**< P amplitudes with a weight */
+    size_t N_S; /**< S amplitudes with a weight */
+}; // class Mag_Regression
+
+}; // end of FiniteFault namespace
+
+#endif // __finder_mag_regression_h__
+
+// end of file: finder_mag_regression.h
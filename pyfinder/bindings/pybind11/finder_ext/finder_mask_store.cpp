@@ -0,0 +1,288 @@
+//
+//      Incrementally updated station mask in a memory-mappable file
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+#include "finder_mask_store.h"
+#include "finder_timing.h"
+#include "../finder_headers/finder_globals.h" // logging macros
+
+namespace FiniteFault {
+
+namespace {
+    // stations are matched between lists by their coordinates to a micro degree
+    typedef std::pair<long long, long long> Station_Key;
+    typedef std::map<Station_Key, int> Station_Counts;
+
+    Station_Key station_key(const double slat, const double slon) {
+        return Station_Key(std::llround(slat * 1e6), std::llround(slon * 1e6));
+    }
+
+    size_t align_up(const size_t value, const size_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    size_t points_offset() {
+        return align_up(sizeof(Mask_Header), MASK_ALIGNMENT);
+    }
+
+    // the count array follows the three double arrays, the station coordinates follow it
+    size_t stations_offset(const size_t N_points) {
+        return align_up(points_offset() + N_points * (3 * sizeof(double) + sizeof(uint32_t)),
+            sizeof(double));
+    }
+}
+
+Mask_Store::~Mask_Store() {
+    if (mapped != NULL) munmap(mapped, mapped_bytes);
+}
+
+void Mask_Store::allocate(const size_t n) {
+    N_points = n;
+    // same layout as the file from points_offset, 8 byte words
+    owned.assign((stations_offset(n) - points_offset()) / sizeof(uint64_t) + 1, 0);
+    char* base = reinterpret_cast<char*>(&owned[0]);
+    lat = reinterpret_cast<double*>(base);
+    lon = lat + n;
+    value = lon + n;
+    count = reinterpret_cast<uint32_t*>(value + n);
+}
+
+std::shared_ptr<Mask_Store> Mask_Store::build(const std::vector<double>& lat,
+        const std::vector<double>& lon, const Coordinate_List& stations, const double radius_km) {
+    std::shared_ptr<Mask_Store> store(new Mask_Store());
+    const size_t n = std::min(lat.size(), lon.size());
+    store->allocate(n);
+    store->radius_km = radius_km;
+    std::copy(lat.begin(), lat.begin() + n, store->lat);
+    std::copy(lon.begin(), lon.begin() + n, store->lon);
+    // no stations counted yet: all points outside, then count the list in
+    store->update(stations);
+    return store;
+}
+
+std::shared_ptr<Mask_Store> Mask_Store::build(const Mask_Data& mask_data,
+        const Coordinate_List& stations, const double radius_km) {
+    const size_t n = (mask_data.msklat == NULL || mask_data.msklon == NULL) ? 0 : mask_data.nMask;
+    const std::vector<double> lat(mask_data.msklat, mask_data.msklat + n);
+    const std::vector<double> lon(mask_data.msklon, mask_data.msklon + n);
+    std::shared_ptr<Mask_Store> store = build(lat, lon, stations, radius_km);
+    LOGI << "Mask_Store: " << store->get_inside() << " of " << n << " mask points within " <<
+        radius_km << " km of a station" << ELL;
+    return store;
+}
+
+size_t Mask_Store::count_station(const double slat, const double slon, const int delta) {
+    std::vector<size_t> points;
+    point_index.within(slat, slon, radius_km, points);
+    size_t changed = 0;
+    for (size_t m = 0; m < points.size(); m++) {
+        const size_t k = points[m];
+        if (delta < 0 && count[k] == 0) continue;
+        const bool was_inside = count[k] > 0;
+        count[k] = (uint32_t) ((int64_t) count[k] + delta);
+        if (was_inside != (count[k] > 0)) {
+            value[k] = count[k] > 0 ? 1. : 0.;
+            changed++;
+        }
+    }
+    return changed;
+}
+
+size_t Mask_Store::update(const Coordinate_List& stations) {
+    Stage_Timer timer(STAGE_MASK_UPDATE);
+    if (point_index.size() != N_points) {
+        point_index.build(std::vector<double>(lat, lat + N_points),
+            std::vector<double>(lon, lon + N_points), std::max(radius_km, 1.));
+    }
+
+    // stations in the new list but not counted (positive) and counted but gone (negative)
+    Station_Counts difference;
+    for (size_t n = 0; n < station_lat.size(); n++) {
+        difference[station_key(station_lat[n], station_lon[n])]--;
+    }
+    std::vector<double> new_lat(stations.size()), new_lon(stations.size());
+    for (size_t n = 0; n < stations.size(); n++) {
+        new_lat[n] = stations[n].get_lat();
+        new_lon[n] = stations[n].get_lon();
+        difference[station_key(new_lat[n], new_lon[n])]++;
+    }
+    size_t changed = 0, added = 0, removed = 0;
+    for (Station_Counts::const_iterator it = difference.begin(); it != difference.end(); ++it) {
+        if (it->second == 0) continue;
+        const double slat = it->first.first * 1e-6, slon = it->first.second * 1e-6;
+        for (int c = 0; c < std::abs(it->second); c++) {
+            changed += count_station(slat, slon, it->second > 0 ? 1 : -1);
+        }
+        (it->second > 0 ? added : removed) += std::abs(it->second);
+    }
+    station_lat.swap(new_lat);
+    station_lon.swap(new_lon);
+    if (added + removed > 0) {
+        LOGD << "Mask_Store: " << added << " stations added, " << removed << " removed, " <<
+            changed << " mask points changed" << ELL;
+    }
+    return changed;
+}
+
+size_t Mask_Store::get_inside() const {
+    size_t inside = 0;
+    for (size_t k = 0; k < N_points; k++) inside += count[k] > 0;
+    return inside;
+}
+
+bool Mask_Store::same_grid(const Mask_Data& mask_data) const {
+    if (mask_data.nMask != N_points) return false;
+    if (mask_data.msklat == lat && mask_data.msklon == lon) return true;
+    if (N_points > 0 && (mask_data.msklat == NULL || mask_data.msklon == NULL)) return false;
+    return std::equal(lat, lat + N_points, mask_data.msklat) &&
+        std::equal(lon, lon + N_points, mask_data.msklon);
+}
+
+size_t Mask_Store::differ(const double* values) const {
+    if (values == NULL) return 0;
+    size_t differ = 0;
+    for (size_t k = 0; k < N_points; k++) differ += (values[k] > 0.) != (value[k] > 0.);
+    return differ;
+}
+
+bool Mask_Store::attach(Finder_Parameters& finder_parameters) {
+    Mask_Data& mask_data = finder_parameters.mask_data;
+    if (mask_data.mskval == value) return true;
+    if (!same_grid(mask_data)) {
+        LOGE << "Mask_Store: the mask of " << finder_parameters.name << " has other points" << ELL;
+        return false;
+    }
+    replaced.push_back(mask_data);
+    mask_data.msklat = lat;
+    mask_data.msklon = lon;
+    mask_data.mskval = value;
+    return true;
+}
+
+bool Mask_Store::detach(Finder_Parameters& finder_parameters) {
+    Mask_Data& mask_data = finder_parameters.mask_data;
+    if (mask_data.mskval != value || replaced.empty()) return false;
+    // any of the replaced arrays will do, they are all over these points
+    const Mask_Data own = replaced.back();
+    replaced.pop_back();
+    if (own.mskval != NULL) std::copy(value, value + N_points, own.mskval);
+    mask_data.msklat = own.msklat;
+    mask_data.msklon = own.msklon;
+    mask_data.mskval = own.mskval;
+    return true;
+}
+
+bool Mask_Store::save(const std::string& path) const {
+    Mask_Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MASK_MAGIC, sizeof(header.magic));
+    header.version = MASK_VERSION;
+    header.header_bytes = sizeof(Mask_Header);
+    header.N_points = N_points;
+    header.N_stations = station_lat.size();
+    header.points_offset = points_offset();
+    header.stations_offset = stations_offset(N_points);
+    header.file_bytes = header.stations_offset + 2 * station_lat.size() * sizeof(double);
+    header.radius_km = radius_km;
+
+    // a process mapping the old file keeps its pages, the rename swaps the directory entry
+    const std::string temp = path + ".tmp";
+    FILE* out = fopen(temp.c_str(), "wb");
+    if (out == NULL) {
+        LOGE << "Mask_Store: cannot write " << temp << ELL;
+        return false;
+    }
+    std::vector<char> pad(header.points_offset - sizeof(header), 0);
+    std::vector<char> gap(header.stations_offset - header.points_offset -
+        N_points * (3 * sizeof(double) + sizeof(uint32_t)), 0);
+    bool status = fwrite(&header, sizeof(header), 1, out) == 1 &&
+        (pad.empty() || fwrite(&pad[0], 1, pad.size(), out) == pad.size());
+    const double* arrays[3] = { lat, lon, value };
+    for (size_t a = 0; status && a < 3; a++) {
+        status = fwrite(arrays[a], sizeof(double), N_points, out) == N_points;
+    }
+    status = status && fwrite(count, sizeof(uint32_t), N_points, out) == N_points &&
+        (gap.empty() || fwrite(&gap[0], 1, gap.size(), out) == gap.size()) &&
+        (station_lat.empty() || (fwrite(&station_lat[0], sizeof(double), station_lat.size(), out) ==
+            station_lat.size() && fwrite(&station_lon[0], sizeof(double), station_lon.size(),
+            out) == station_lon.size()));
+    status = (fclose(out) == 0) && status;
+    if (!status || std::rename(temp.c_str(), path.c_str()) != 0) {
+        LOGE << "Mask_Store: writing " << path << " failed" << ELL;
+        std::remove(temp.c_str());
+        return false;
+    }
+    LOGI << "Mask_Store: saved " << N_points << " mask points over " << station_lat.size() <<
+        " stations to " << path << ELL;
+    return true;
+}
+
+bool Mask_Store::map(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        LOGE << "Mask_Store: cannot open " << path << ELL;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(Mask_Header)) {
+        LOGE << "Mask_Store: " << path << " is too short for a mask file" << ELL;
+        ::close(fd);
+        return false;
+    }
+    // private and writable: updates copy the touched pages, the file is never modified
+    void* addr = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        LOGE << "Mask_Store: cannot map " << path << ELL;
+        return false;
+    }
+    mapped = addr;
+    mapped_bytes = st.st_size;
+
+    const Mask_Header* header = static_cast<const Mask_Header*>(mapped);
+    if (std::memcmp(header->magic, MASK_MAGIC, sizeof(MASK_MAGIC)) != 0 ||
+            header->version != MASK_VERSION || header->header_bytes != sizeof(Mask_Header) ||
+            header->file_bytes > mapped_bytes || header->points_offset != points_offset() ||
+            // the counts are bounded by the file before the offsets are computed from them
+            header->N_points > mapped_bytes / (3 * sizeof(double) + sizeof(uint32_t)) ||
+            header->N_stations > mapped_bytes / (2 * sizeof(double)) ||
+            header->stations_offset != stations_offset(header->N_points) ||
+            header->stations_offset + 2 * header->N_stations * sizeof(double) >
+                header->file_bytes) {
+        LOGE << "Mask_Store: " << path << " is not a version " << MASK_VERSION <<
+            " mask file" << ELL;
+        return false;
+    }
+    char* base = static_cast<char*>(mapped);
+    N_points = header->N_points;
+    radius_km = header->radius_km;
+    lat = reinterpret_cast<double*>(base + header->points_offset);
+    lon = lat + N_points;
+    value = lon + N_points;
+    count = reinterpret_cast<uint32_t*>(value + N_points);
+    const double* stations = reinterpret_cast<const double*>(base + header->stations_offset);
+    station_lat.assign(stations, stations + header->N_stations);
+    station_lon.assign(stations + header->N_stations, stations + 2 * header->N_stations);
+    return true;
+}
+
+std::shared_ptr<Mask_Store> Mask_Store::open(const std::string& path) {
+    std::shared_ptr<Mask_Store> store(new Mask_Store());
+    if (!store->map(path)) return std::shared_ptr<Mask_Store>();
+    return store;
+}
+
+}; // end of FiniteFault namespace
+
+// end of file: finder_mask_store.cpp
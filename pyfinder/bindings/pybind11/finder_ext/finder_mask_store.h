@@ -0,0 +1,129 @@
+//
+//      Incrementally updated station mask in a memory-mappable file
+//
+//      Finder::Create_New_Mask and calculate_and_save_mask recompute the whole mask from the
+//      full station list and write it to CALCULATED_MASK as netCDF. A new one is computed when
+//      the file is older than DAYS, and each Finder_Parameters then holds its own Mask_Data
+//      arrays. A Mask_Store keeps the mask points together with, for each point, the number of
+//      stations within mask_station_distance. A point is inside the mask (value 1) while that
+//      count is non-zero. A change of the station list then only revisits the points within
+//      mask_station_distance of the stations that came or went, found with a Station_Index
+//      over the mask points. attach points the Mask_Data of several template sets at the one
+//      copy in the store.
+//
+//      Layout, native byte order:
+//          Mask_Header
+//          double lat[N_points], double lon[N_points], double value[N_points], from
+//          points_offset (MASK_ALIGNMENT aligned)
+//          uint32_t count[N_points]
+//          double station_lat[N_stations], double station_lon[N_stations], from stations_offset
+//
+//      Opening maps the file privately, like a Template_Store: updates stay in this process
+//      until save writes a new file, which replaces the old one atomically.
+//
+
+#ifndef __finder_mask_store_h__
+#define __finder_mask_store_h__
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../finder_headers/finder_parameters.h"
+#include "finder_station_index.h"
+
+namespace FiniteFault {
+
+const char MASK_MAGIC[8] = { 'F', 'D', 'R', 'M', 'A', 'S', 'K', '1' }; /**< file signature */
+const uint32_t MASK_VERSION = 1; /**< format version */
+const size_t MASK_ALIGNMENT = 64; /**< alignment of the point arrays, in bytes */
+
+/** Fixed-size head of a mask file */
+struct Mask_Header {
+    char magic[8]; /**< MASK_MAGIC */
+    uint32_t version; /**< MASK_VERSION */
+    uint32_t header_bytes; /**< sizeof(Mask_Header), guards against layout changes */
+    uint64_t N_points; /**< mask points */
+    uint64_t N_stations; /**< stations the counts were taken over */
+    uint64_t points_offset; /**< start of the point arrays */
+    uint64_t stations_offset; /**< start of the station coordinates */
+    uint64_t file_bytes; /**< total file size */
+    double radius_km; /**< mask_station_distance the counts were taken with */
+};
+
+/** \class Mask_Store
+ * \brief Mask points with their station counts, updated by station list differences.
+ * */
+class Mask_Store {
+  public:
+    ~Mask_Store();
+
+    // mask over the points lat/lon: stations within radius_km of each point
+    static std::shared_ptr<Mask_Store> build(const std::vector<double>& lat,
+        const std::vector<double>& lon, const Coordinate_List& stations, const double radius_km);
+    // mask over the points of mask_data
+    static std::shared_ptr<Mask_Store> build(const Mask_Data& mask_data,
+        const Coordinate_List& stations, const double radius_km);
+    // map a mask file, NULL if it cannot be read or is not a valid mask file
+    static std::shared_ptr<Mask_Store> open(const std::string& path);
+    // write the mask, through a temporary file renamed over path
+    bool save(const std::string& path) const;
+
+    // count in the stations not yet counted and count out those no longer in the list;
+    // returns the points whose value changed
+    size_t update(const Coordinate_List& stations);
+
+    size_t size() const { return N_points; }
+    size_t get_N_stations() const { return station_lat.size(); }
+    double get_radius_km() const { return radius_km; }
+    size_t get_inside() const;
+    const double* get_lat() const { return lat; }
+    const double* get_lon() const { return lon; }
+    const double* get_values() const { return value; }
+    const uint32_t* get_counts() const { return count; }
+    // true if mask_data is over the same points
+    bool same_grid(const Mask_Data& mask_data) const;
+    // points inside here but outside in values, one per point, or the other way round; 0 for
+    // NULL
+    size_t differ(const double* values) const;
+
+    // point the Mask_Data of finder_parameters at the arrays of this store. The arrays it held
+    // are kept here until detach hands them back. The store must outlive finder_parameters or
+    // be detached from it first.
+    bool attach(Finder_Parameters& finder_parameters);
+    // give finder_parameters its own arrays again, filled with the current values
+    bool detach(Finder_Parameters& finder_parameters);
+    size_t get_attached() const { return replaced.size(); }
+
+  private:
+    Mask_Store() : N_points(0), radius_km(0.), lat(NULL), lon(NULL), value(NULL), count(NULL),
+        mapped(NULL), mapped_bytes(0) {}
+    Mask_Store(const Mask_Store&);
+    Mask_Store& operator=(const Mask_Store&);
+
+    bool map(const std::string& path);
+    void allocate(const size_t n);
+    // add delta to the counts of the points within radius_km of a station
+    size_t count_station(const double slat, const double slon, const int delta);
+
+    size_t N_points; /**< mask points */
+    double radius_km; /**< mask_station_distance */
+    double* lat; /**< point latitudes */
+    double* lon; /**< point longitudes */
+    double* value; /**< 1 inside the mask, 0 outside */
+    uint32_t* count; /**< stations within radius_km of each point */
+    std::vector<double> station_lat; /**< stations counted, in list order */
+    std::vector<double> station_lon; /**< stations counted, in list order */
+    std::vector<uint64_t> owned; /**< point arrays of a built store */
+    void* mapped; /**< mapping returned by mmap, for an opened store */
+    size_t mapped_bytes; /**< length of the mapping */
+    Station_Index point_index; /**< grid over the points, built on the first update */
+    std::vector<Mask_Data> replaced; /**< arrays of the attached Finder_Parameters */
+}; // class Mask_Store
+
+}; // end of FiniteFault namespace
+
+#endif // __finder_mask_store_h__
+
+// end of file: finder_mask_store.h
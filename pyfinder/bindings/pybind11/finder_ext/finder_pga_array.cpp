@@ -0,0 +1,154 @@
+//
+//      PGA observations as contiguous columns keyed by interned station index
+//
+
+#include <algorithm>
+#include <cmath>
+
+#include "finder_pga_array.h"
+
+namespace FiniteFault {
+
+void PGA_Array::clear() {
+    station.clear();
+    lat.clear();
+    lon.clear();
+    value.clear();
+    timestamp.clear();
+    flags.clear();
+}
+
+void PGA_Array::reserve(const size_t n) {
+    station.reserve(n);
+    lat.reserve(n);
+    lon.reserve(n);
+    value.reserve(n);
+    timestamp.reserve(n);
+    flags.reserve(n);
+}
+
+void PGA_Array::push_back(const int64_t s, const double slat, const double slon,
+        const double svalue, const double stimestamp, const uint8_t sflags) {
+    station.push_back(s);
+    lat.push_back(slat);
+    lon.push_back(slon);
+    value.push_back(svalue);
+    timestamp.push_back(stimestamp);
+    flags.push_back(sflags);
+}
+
+void PGA_Array::from_list(const PGA_Data_List& pga_data_list, Sncl_Table& table) {
+    clear();
+    reserve(pga_data_list.size());
+    for (size_t n = 0; n < pga_data_list.size(); n++) {
+        const PGA_Data& pga = pga_data_list[n];
+        const Coordinate location = pga.get_location();
+        push_back((int64_t) table.intern(pga.get_network(), pga.get_name(), pga.get_channel(),
+            pga.get_location_code()), location.get_lat(), location.get_lon(), pga.get_value(),
+            pga.get_timestamp(), (pga.get_include() ? PGA_INCLUDE : 0) |
+            (pga.get_trigger_flag() ? PGA_TRIGGER : 0));
+    }
+}
+
+bool PGA_Array::to_list(const Sncl_Table& table, PGA_Data_List& pga_data_list,
+        std::string& error) const {
+    if (!fill_pga_data_list(table, columns(), pga_data_list, error)) return false;
+    for (size_t n = 0; n < size(); n++) {
+        pga_data_list[n].set_include((flags[n] & PGA_INCLUDE) != 0);
+        pga_data_list[n].set_trigger_flag((flags[n] & PGA_TRIGGER) != 0);
+    }
+    return true;
+}
+
+PGA_Columns PGA_Array::columns() const {
+    PGA_Columns view;
+    view.size = size();
+    if (empty()) return view;
+    view.lat = Strided_Column<double>(&lat[0], sizeof(double));
+    view.lon = Strided_Column<double>(&lon[0], sizeof(double));
+    view.value = Strided_Column<double>(&value[0], sizeof(double));
+    view.timestamp = Strided_Column<double>(&timestamp[0], sizeof(double));
+    view.station = Strided_Column<int64_t>(&station[0], sizeof(int64_t));
+    return view;
+}
+
+size_t PGA_Array::keep(const std::vector<char>& keep) {
+    size_t kept = 0;
+    for (size_t n = 0; n < size(); n++) {
+        if (n >= keep.size() || !keep[n]) continue;
+        station[kept] = station[n];
+        lat[kept] = lat[n];
+        lon[kept] = lon[n];
+        value[kept] = value[n];
+        timestamp[kept] = timestamp[n];
+        flags[kept] = flags[n];
+        kept++;
+    }
+    station.resize(kept);
+    lat.resize(kept);
+    lon.resize(kept);
+    value.resize(kept);
+    timestamp.resize(kept);
+    flags.resize(kept);
+    return kept;
+}
+
+size_t PGA_Array::keep_above(const double min_value) {
+    std::vector<char> mask(size());
+    for (size_t n = 0; n < size(); n++) mask[n] = value[n] >= min_value;
+    return keep(mask);
+}
+
+size_t PGA_Array::keep_window(const double t_min, const double t_max) {
+    std::vector<char> mask(size());
+    for (size_t n = 0; n < size(); n++) {
+        mask[n] = timestamp[n] >= t_min && timestamp[n] <= t_max;
+    }
+    return keep(mask);
+}
+
+size_t PGA_Array::keep_latest() {
+    // indices are dense, a vector replaces the SNCL map
+    int64_t max_station = -1;
+    for (size_t n = 0; n < size(); n++) max_station = std::max(max_station, station[n]);
+    std::vector<size_t> newest((size_t) (max_station + 1), size());
+    for (size_t n = 0; n < size(); n++) {
+        if (station[n] < 0) continue;
+        size_t& best = newest[(size_t) station[n]];
+        if (best == size() || timestamp[n] > timestamp[best]) best = n;
+    }
+    std::vector<char> mask(size(), 0);
+    for (size_t s = 0; s < newest.size(); s++) {
+        if (newest[s] < size()) mask[newest[s]] = 1;
+    }
+    return keep(mask);
+}
+
+size_t PGA_Array::count_above(const double min_value) const {
+    size_t above = 0;
+    for (size_t n = 0; n < size(); n++) {
+        above += (flags[n] & PGA_INCLUDE) && value[n] >= min_value;
+    }
+    return above;
+}
+
+double PGA_Array::percentile(const double pc) const {
+    std::vector<double> included;
+    included.reserve(size());
+    for (size_t n = 0; n < size(); n++) {
+        if ((flags[n] & PGA_INCLUDE) && !std::isnan(value[n])) included.push_back(value[n]);
+    }
+    if (included.empty()) return NAN;
+    // linear between the closest ranks, as numpy.percentile
+    const double rank = std::min(std::max(pc, 0.), 100.) / 100. * (included.size() - 1);
+    const size_t below = (size_t) std::floor(rank);
+    std::nth_element(included.begin(), included.begin() + below, included.end());
+    const double low = included[below];
+    if (below + 1 >= included.size()) return low;
+    const double high = *std::min_element(included.begin() + below + 1, included.end());
+    return low + (rank - below) * (high - low);
+}
+
+}; // end of FiniteFault namespace
+
+// end of file: finder_pga_array.cpp
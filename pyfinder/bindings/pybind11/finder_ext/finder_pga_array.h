@@ -0,0 +1,73 @@
+//
+//      PGA observations as contiguous columns keyed by interned station index
+//
+//      A PGA_Data holds four std::string codes, a Coordinate and an event id list of its own,
+//      so filtering a PGA_Data_List by amplitude, time or station compares strings and chases
+//      a pointer per observation. A PGA_Array keeps the same observations as contiguous
+//      lat/lon/value/timestamp/flags columns, the station being its Sncl_Table index. The
+//      filters run over these columns, and duplicates of a station are found by index, not by
+//      a map of SNCL strings. from_list and to_list convert to and from the PGA_Data_List the
+//      library takes, which remains the interface to Finder::process and Scan_Data.
+//
+
+#ifndef __finder_pga_array_h__
+#define __finder_pga_array_h__
+
+#include <cstdint>
+#include <vector>
+
+#include "finder_pga_ingest.h"
+
+namespace FiniteFault {
+
+const uint8_t PGA_INCLUDE = 1; /**< flag: good station, PGA_Data::include */
+const uint8_t PGA_TRIGGER = 2; /**< flag: counted as a trigger, PGA_Data::trigger_flag */
+
+/** \class PGA_Array
+ * \brief Struct-of-arrays PGA observations over an Sncl_Table.
+ * */
+class PGA_Array {
+  public:
+    PGA_Array() {}
+
+    size_t size() const { return value.size(); }
+    bool empty() const { return value.empty(); }
+    void clear();
+    void reserve(const size_t n);
+    void push_back(const int64_t station, const double lat, const double lon, const double value,
+        const double timestamp, const uint8_t flags = PGA_INCLUDE);
+
+    // the observations of pga_data_list, their codes interned into table
+    void from_list(const PGA_Data_List& pga_data_list, Sncl_Table& table);
+    // the observations as a PGA_Data_List, with include and trigger_flag from the flags. False,
+    // with the list untouched, if a station is not in table.
+    bool to_list(const Sncl_Table& table, PGA_Data_List& pga_data_list, std::string& error) const;
+    // view over the columns, valid until the array changes
+    PGA_Columns columns() const;
+
+    // keep the observations with keep[n] set, in order; returns the number kept
+    size_t keep(const std::vector<char>& keep);
+    // keep the observations of at least min_value
+    size_t keep_above(const double min_value);
+    // keep the observations with t_min <= timestamp <= t_max
+    size_t keep_window(const double t_min, const double t_max);
+    // keep the newest observation of each station, the first of equal timestamps
+    size_t keep_latest();
+    // observations of at least min_value among those flagged include
+    size_t count_above(const double min_value) const;
+    // value at percentile pc of the observations flagged include, NAN if none
+    double percentile(const double pc) const;
+
+    std::vector<int64_t> station; /**< Sncl_Table index */
+    std::vector<double> lat; /**< station latitude */
+    std::vector<double> lon; /**< station longitude */
+    std::vector<double> value; /**< PGA in cm/s/s */
+    std::vector<double> timestamp; /**< time of the PGA value */
+    std::vector<uint8_t> flags; /**< PGA_INCLUDE, PGA_TRIGGER */
+}; // class PGA_Array
+
+}; // end of FiniteFault namespace
+
+#endif // __finder_pga_array_h__
+
+// end of file: finder_pga_array.h
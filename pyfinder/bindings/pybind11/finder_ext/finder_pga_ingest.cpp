@@ -0,0 +1,252 @@
+//
+//      Bulk construction of PGA_Data_List from column arrays
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <sstream>
+
+#include "finder_pga_ingest.h"
+#include "finder_timing.h"
+
+namespace FiniteFault {
+
+std::string Sncl_Table::key(const std::string& network, const std::string& station,
+        const std::string& channel, const std::string& location) {
+    std::string k;
+    k.reserve(network.size() + station.size() + channel.size() + location.size() + 3);
+    k.append(network).append(1, '.').append(station).append(1, '.').append(location)
+        .append(1, '.').append(channel);
+    return k;
+}
+
+size_t Sncl_Table::intern(const std::string& network, const std::string& station,
+        const std::string& channel, const std::string& location) {
+    const std::string k = key(network, station, channel, location);
+    std::unordered_map<std::string, size_t>::const_iterator it = index.find(k);
+    if (it != index.end()) return it->second;
+    const size_t n = size();
+    this->network.push_back(network);
+    this->station.push_back(station);
+    this->channel.push_back(channel);
+    this->location.push_back(location);
+    index[k] = n;
+    return n;
+}
+
+size_t Sncl_Table::find(const std::string& network, const std::string& station,
+        const std::string& channel, const std::string& location) const {
+    std::unordered_map<std::string, size_t>::const_iterator it =
+        index.find(key(network, station, channel, location));
+    return (it == index.end()) ? size() : it->second;
+}
+
+void Sncl_Table::clear() {
+    network.clear();
+    station.clear();
+    channel.clear();
+    location.clear();
+    index.clear();
+}
+
+std::string Sncl_Table::get_sncl(size_t n) const {
+    return key(network[n], station[n], channel[n], location[n]);
+}
+
+PGA_Columns::PGA_Columns(const PGA_Record* records, const size_t n) : size(n),
+        lat(&records->lat, sizeof(PGA_Record)), lon(&records->lon, sizeof(PGA_Record)),
+        value(&records->value, sizeof(PGA_Record)),
+        timestamp(&records->timestamp, sizeof(PGA_Record)),
+        station(&records->station, sizeof(PGA_Record)) {}
+
+namespace {
+    const size_t NO_ENTRY = (size_t) -1; /**< station not in the list */
+
+    bool check_stations(const Sncl_Table& table, const PGA_Columns& columns, std::string& error) {
+        for (size_t n = 0; n < columns.size; n++) {
+            const int64_t s = columns.station[n];
+            if (s < 0 || (size_t) s >= table.size()) {
+                std::ostringstream os;
+                os << "station index " << s << " of observation " << n << " is not in the " <<
+                    table.size() << " station table";
+                error = os.str();
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+bool fill_pga_data_list(const Sncl_Table& table, const PGA_Columns& columns,
+        PGA_Data_List& pga_data_list, std::string& error) {
+    Stage_Timer timer(STAGE_INGEST);
+    if (!check_stations(table, columns, error)) return false;
+    // clear keeps the capacity, short codes fit the strings' inline buffers
+    pga_data_list.clear();
+    pga_data_list.reserve(columns.size);
+    for (size_t n = 0; n < columns.size; n++) {
+        const size_t s = (size_t) columns.station[n];
+        pga_data_list.push_back(PGA_Data(table.get_station(s), table.get_network(s),
+            table.get_channel(s), table.get_location(s),
+            Coordinate(columns.lat[n], columns.lon[n]), columns.value[n],
+            columns.timestamp[n]));
+    }
+    return true;
+}
+
+PGA_Stream::PGA_Stream(const Sncl_Table& table, const size_t depth, const double max_age,
+        const double peak_window) : table(table), depth(std::max<size_t>(depth, 1)),
+        max_age(max_age), peak_window(peak_window), latest(-INFINITY) {}
+
+void PGA_Stream::grow(const size_t n) {
+    if (n <= count.size()) return;
+    values.resize(n * depth, 0.);
+    times.resize(n * depth, 0.);
+    count.resize(n, 0);
+    lat.resize(n, NAN);
+    lon.resize(n, NAN);
+    entry.resize(n, NO_ENTRY);
+    marked.resize(n, 0);
+}
+
+void PGA_Stream::reserve(const size_t n) {
+    std::lock_guard<std::mutex> guard(lock);
+    grow(n);
+}
+
+bool PGA_Stream::push(const PGA_Columns& deltas, std::string& error) {
+    Stage_Timer timer(STAGE_INGEST);
+    if (!check_stations(table, deltas, error)) return false;
+    std::lock_guard<std::mutex> guard(lock);
+    for (size_t n = 0; n < deltas.size; n++) {
+        const size_t s = (size_t) deltas.station[n];
+        // stations interned after the last reserve
+        if (s >= count.size()) grow(std::max(s + 1, count.size() * 2));
+        const size_t slot = s * depth + count[s] % depth;
+        values[slot] = deltas.value[n];
+        times[slot] = deltas.timestamp[n];
+        count[s]++;
+        lat[s] = deltas.lat[n];
+        lon[s] = deltas.lon[n];
+        latest = std::max(latest, deltas.timestamp[n]);
+        if (!marked[s]) {
+            marked[s] = 1;
+            pending.push_back(s);
+        }
+    }
+    return true;
+}
+
+double PGA_Stream::reported(const size_t s) const {
+    const size_t last = s * depth + (count[s] - 1) % depth;
+    if (peak_window <= 0.) return values[last];
+    return peak_unlocked(s, times[last] - peak_window);
+}
+
+double PGA_Stream::peak(const size_t s, const double since) const {
+    std::lock_guard<std::mutex> guard(lock);
+    return peak_unlocked(s, since);
+}
+
+double PGA_Stream::peak_unlocked(const size_t s, const double since) const {
+    if (s >= count.size()) return NAN;
+    const size_t kept = (size_t) std::min<uint64_t>(count[s], depth);
+    double best = NAN;
+    for (size_t k = 0; k < kept; k++) {
+        const size_t slot = s * depth + k;
+        if (times[slot] >= since && !(values[slot] <= best)) best = values[slot];
+    }
+    return best;
+}
+
+void PGA_Stream::expire(const double oldest) {
+    for (size_t n = 0; n < current.size(); ) {
+        if (current[n].get_timestamp() >= oldest) {
+            n++;
+            continue;
+        }
+        // the last entry takes the place of the expired one
+        entry[current_station[n]] = NO_ENTRY;
+        if (n + 1 < current.size()) {
+            current[n] = current.back();
+            current_station[n] = current_station.back();
+            entry[current_station[n]] = n;
+        }
+        current.pop_back();
+        current_station.pop_back();
+    }
+}
+
+size_t PGA_Stream::snapshot(PGA_Data_List& pga_data_list, const double now) {
+    std::lock_guard<std::mutex> guard(lock);
+    const size_t updated = pending.size();
+    for (size_t p = 0; p < pending.size(); p++) {
+        const size_t s = pending[p];
+        marked[s] = 0;
+        const double value = reported(s);
+        const double timestamp = times[s * depth + (count[s] - 1) % depth];
+        const size_t n = entry[s];
+        if (n != NO_ENTRY && current[n].get_location().get_lat() == lat[s] &&
+                current[n].get_location().get_lon() == lon[s]) {
+            current[n].update_value(value, timestamp);
+            continue;
+        }
+        const PGA_Data data(table.get_station(s), table.get_network(s), table.get_channel(s),
+            table.get_location(s), Coordinate(lat[s], lon[s]), value, timestamp);
+        if (n != NO_ENTRY) {
+            current[n] = data;
+        } else {
+            entry[s] = current.size();
+            current.push_back(data);
+            current_station.push_back(s);
+        }
+    }
+    pending.clear();
+    if (max_age > 0.) expire((std::isnan(now) ? latest : now) - max_age);
+    pga_data_list = current;
+    return updated;
+}
+
+void PGA_Stream::clear() {
+    std::lock_guard<std::mutex> guard(lock);
+    std::fill(count.begin(), count.end(), 0);
+    std::fill(entry.begin(), entry.end(), NO_ENTRY);
+    std::fill(marked.begin(), marked.end(), 0);
+    pending.clear();
+    current.clear();
+    current_station.clear();
+    latest = -INFINITY;
+}
+
+size_t PGA_Stream::get_stations() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return count.size();
+}
+
+size_t PGA_Stream::get_active() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return current.size();
+}
+
+size_t PGA_Stream::get_pending() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return pending.size();
+}
+
+void PGA_Stream::get_samples(const size_t s, std::vector<double>& timestamps,
+        std::vector<double>& out) const {
+    std::lock_guard<std::mutex> guard(lock);
+    timestamps.clear();
+    out.clear();
+    if (s >= count.size()) return;
+    const uint64_t kept = std::min<uint64_t>(count[s], depth);
+    for (uint64_t k = count[s] - kept; k < count[s]; k++) {
+        timestamps.push_back(times[s * depth + k % depth]);
+        out.push_back(values[s * depth + k % depth]);
+    }
+}
+
+}; // end of FiniteFault namespace
+
+// end of file: finder_pga_ingest.cpp
@@ -0,0 +1,183 @@
+//
+//      Bulk construction of PGA_Data_List from column arrays
+//
+//      Finder::process and Finder::Scan_Data take a PGA_Data_List, one PGA_Data per station with
+//      its network, station, channel and location codes as strings. Building it from Python
+//      means a PGA_Data object and four strings per station and update. Here the codes are
+//      interned once in an Sncl_Table and every update only passes numeric columns (lat, lon,
+//      value, timestamp, station index), read in place from the caller's buffers.
+//
+//      A PGA_Stream takes only the stations whose amplitude changed. Each sample goes into a
+//      ring of the station's last depth samples, preallocated per interned index, and the
+//      station is marked. snapshot then updates the stream's own list for the marked stations
+//      only, with PGA_Data::update_value, and copies it out under the same lock, so a snapshot
+//      never mixes two pushes. The per-tick cost follows the stations that reported, and the
+//      copy the stations that are active, not the size of the network.
+//
+
+#ifndef __finder_pga_ingest_h__
+#define __finder_pga_ingest_h__
+
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../finder_headers/finite_fault.h"
+
+namespace FiniteFault {
+
+/** \class Sncl_Table
+ * \brief Interned station codes, one index per network.station.location.channel.
+ * */
+class Sncl_Table {
+  public:
+    Sncl_Table() {}
+
+    // index of the code, added if it is new
+    size_t intern(const std::string& network, const std::string& station,
+        const std::string& channel, const std::string& location);
+    // index of the code, or size() if unknown
+    size_t find(const std::string& network, const std::string& station,
+        const std::string& channel, const std::string& location) const;
+
+    size_t size() const { return network.size(); }
+    void clear();
+
+    const std::string& get_network(size_t n) const { return network[n]; }
+    const std::string& get_station(size_t n) const { return station[n]; }
+    const std::string& get_channel(size_t n) const { return channel[n]; }
+    const std::string& get_location(size_t n) const { return location[n]; }
+    // "NET.STA.LOC.CHA"
+    std::string get_sncl(size_t n) const;
+
+  private:
+    static std::string key(const std::string& network, const std::string& station,
+        const std::string& channel, const std::string& location);
+
+    std::vector<std::string> network; /**< network code of each index */
+    std::vector<std::string> station; /**< station code of each index */
+    std::vector<std::string> channel; /**< channel code of each index */
+    std::vector<std::string> location; /**< location code of each index */
+    std::unordered_map<std::string, size_t> index; /**< SNCL key to index */
+}; // class Sncl_Table
+
+/** Column of n values, stride bytes apart, e.g. one field of a NumPy structured array
+ * */
+template <typename T>
+struct Strided_Column {
+    Strided_Column() : data(NULL), stride(sizeof(T)) {}
+    Strided_Column(const void* data, const ptrdiff_t stride) :
+        data(static_cast<const char*>(data)), stride(stride) {}
+    T operator[](const size_t n) const {
+        T value;
+        std::memcpy(&value, data + n * stride, sizeof(T));
+        return value;
+    }
+    const char* data; /**< first value */
+    ptrdiff_t stride; /**< bytes from one value to the next */
+};
+
+/** One observation per row, the layout of the structured array accepted by the bindings
+ * */
+struct PGA_Record {
+    double lat; /**< station latitude */
+    double lon; /**< station longitude */
+    double value; /**< PGA in cm/s/s */
+    double timestamp; /**< time of the PGA value */
+    int64_t station; /**< index into the Sncl_Table */
+};
+
+/** Observations as columns
+ * */
+struct PGA_Columns {
+    PGA_Columns() : size(0) {}
+    // columns of n contiguous records
+    PGA_Columns(const PGA_Record* records, const size_t n);
+
+    size_t size; /**< number of observations */
+    Strided_Column<double> lat; /**< station latitude */
+    Strided_Column<double> lon; /**< station longitude */
+    Strided_Column<double> value; /**< PGA in cm/s/s */
+    Strided_Column<double> timestamp; /**< time of the PGA value */
+    Strided_Column<int64_t> station; /**< index into the Sncl_Table */
+};
+
+// Replace the contents of pga_data_list with the observations, keeping its capacity. False,
+// with the list untouched, if a station index is not in the table.
+bool fill_pga_data_list(const Sncl_Table& table, const PGA_Columns& columns,
+    PGA_Data_List& pga_data_list, std::string& error);
+
+const size_t PGA_STREAM_DEPTH = 32; /**< default samples kept per station */
+
+/** \class PGA_Stream
+ * \brief Latest PGA per station from delta updates, with a sample ring per station.
+ * */
+class PGA_Stream {
+  public:
+    // stations are indices of table, which must outlive the stream. A station drops out of
+    // the snapshot when its last sample is older than max_age seconds (0: never). With
+    // peak_window, a station reports the peak of its samples in that many seconds before its
+    // last one instead of its last value.
+    explicit PGA_Stream(const Sncl_Table& table, const size_t depth = PGA_STREAM_DEPTH,
+        const double max_age = 0., const double peak_window = 0.);
+
+    // preallocate the rings of the first n stations
+    void reserve(const size_t n);
+    // add the samples of the stations that changed. False, with nothing added, if a station
+    // index is not in the table.
+    bool push(const PGA_Columns& deltas, std::string& error);
+    // the stations reporting, as of the pushes so far; now is the time max_age counts back
+    // from, NAN for the latest sample of all. Returns the stations updated since the last
+    // snapshot.
+    size_t snapshot(PGA_Data_List& pga_data_list, const double now = NAN);
+    void clear();
+
+    size_t get_depth() const { return depth; }
+    double get_max_age() const { return max_age; }
+    double get_peak_window() const { return peak_window; }
+    size_t get_stations() const;
+    size_t get_active() const;
+    size_t get_pending() const;
+    // samples of a station kept in its ring, oldest first
+    void get_samples(const size_t station, std::vector<double>& timestamps,
+        std::vector<double>& values) const;
+    // peak of a station's samples at or after since, NAN if none
+    double peak(const size_t station, const double since) const;
+
+  private:
+    PGA_Stream(const PGA_Stream&);
+    PGA_Stream& operator=(const PGA_Stream&);
+
+    void grow(const size_t n);
+    // the value the station reports, per peak_window; the callers hold lock
+    double reported(const size_t station) const;
+    double peak_unlocked(const size_t station, const double since) const;
+    // drop the entries of the list whose last sample is before oldest
+    void expire(const double oldest);
+
+    const Sncl_Table& table; /**< station codes */
+    size_t depth; /**< samples per ring */
+    double max_age; /**< age at which a station drops out, 0 for never */
+    double peak_window; /**< seconds the reported peak looks back, 0 for the last value */
+    mutable std::mutex lock; /**< between the pushing and the snapshot threads */
+    std::vector<double> values; /**< ring of station s from s * depth */
+    std::vector<double> times; /**< sample times, as values */
+    std::vector<uint64_t> count; /**< samples pushed per station */
+    std::vector<double> lat; /**< station latitude */
+    std::vector<double> lon; /**< station longitude */
+    std::vector<size_t> entry; /**< position of the station in current, or -1 */
+    std::vector<char> marked; /**< station is in pending */
+    std::vector<size_t> pending; /**< stations pushed since the last snapshot */
+    PGA_Data_List current; /**< one entry per active station */
+    std::vector<size_t> current_station; /**< station of each entry of current */
+    double latest; /**< time of the newest sample */
+}; // class PGA_Stream
+
+}; // end of FiniteFault namespace
+
+#endif // __finder_pga_ingest_h__
+
+// end of file: finder_pga_ingest.h
@@ -0,0 +1,177 @@
+//
+//      Popcount kernels for the bit-packed binary template matching
+//
+
+#include <atomic>
+
+#include "finder_popcount.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FINDER_POPCOUNT_X86
+#endif
+#if defined(__aarch64__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define FINDER_POPCOUNT_NEON
+#endif
+
+namespace FiniteFault {
+
+namespace {
+
+typedef size_t (*And_Popcount_Fn)(const uint64_t*, const uint64_t*, const size_t);
+
+struct Popcount_Kernel {
+    const char* name;
+    And_Popcount_Fn fn;
+    bool (*supported)();
+};
+
+size_t and_popcount_generic(const uint64_t* a, const uint64_t* b, const size_t n) {
+    size_t total = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t v = a[i] & b[i];
+        // SWAR bit count, no popcount instruction needed
+        v = v - ((v >> 1) & 0x5555555555555555ULL);
+        v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+        v = (v + (v >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+        total += (v * 0x0101010101010101ULL) >> 56;
+    }
+    return total;
+}
+
+bool always() { return true; }
+
+#ifdef FINDER_POPCOUNT_X86
+__attribute__((target("popcnt")))
+size_t and_popcount_popcnt(const uint64_t* a, const uint64_t* b, const size_t n) {
+    size_t total = 0;
+    for (size_t i = 0; i < n; i++) total += __builtin_popcountll(a[i] & b[i]);
+    return total;
+}
+
+__attribute__((target("avx2,popcnt")))
+size_t and_popcount_avx2(const uint64_t* a, const uint64_t* b, const size_t n) {
+    // bit count of each nibble, looked up with a byte shuffle
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0f);
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256i v = _mm256_and_si256(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+        const __m256i lo = _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, low));
+        const __m256i hi = _mm256_shuffle_epi8(lookup,
+            _mm256_and_si256(_mm256_srli_epi16(v, 4), low));
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_add_epi8(lo, hi),
+            _mm256_setzero_si256()));
+    }
+    uint64_t lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+    size_t total = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    for (; i < n; i++) total += __builtin_popcountll(a[i] & b[i]);
+    return total;
+}
+
+__attribute__((target("avx512f,avx512vpopcntdq")))
+size_t and_popcount_avx512(const uint64_t* a, const uint64_t* b, const size_t n) {
+    __m512i acc = _mm512_setzero_si512();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m512i v = _mm512_and_si512(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+        acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(v));
+    }
+    if (i < n) {
+        // masked loads for the tail, template columns are rarely a multiple of 8 words
+        const __mmask8 mask = (__mmask8) ((1u << (n - i)) - 1);
+        const __m512i v = _mm512_and_si512(_mm512_maskz_loadu_epi64(mask, a + i),
+            _mm512_maskz_loadu_epi64(mask, b + i));
+        acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(v));
+    }
+    uint64_t lanes[8];
+    _mm512_storeu_si512(lanes, acc);
+    size_t total = 0;
+    for (size_t l = 0; l < 8; l++) total += lanes[l];
+    return total;
+}
+
+bool has_popcnt() { return __builtin_cpu_supports("popcnt"); }
+bool has_avx2() { return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"); }
+bool has_avx512() {
+    return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq");
+}
+#endif // FINDER_POPCOUNT_X86
+
+#ifdef FINDER_POPCOUNT_NEON
+size_t and_popcount_neon(const uint64_t* a, const uint64_t* b, const size_t n) {
+    uint64x2_t acc = vdupq_n_u64(0);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        const uint8x16_t v = vreinterpretq_u8_u64(vandq_u64(vld1q_u64(a + i), vld1q_u64(b + i)));
+        acc = vpadalq_u32(acc, vpaddlq_u16(vpaddlq_u8(vcntq_u8(v))));
+    }
+    size_t total = vgetq_lane_u64(acc, 0) + vgetq_lane_u64(acc, 1);
+    for (; i < n; i++) total += __builtin_popcountll(a[i] & b[i]);
+    return total;
+}
+#endif // FINDER_POPCOUNT_NEON
+
+// fastest first
+const Popcount_Kernel kernels[] = {
+#ifdef FINDER_POPCOUNT_X86
+    { "avx512", and_popcount_avx512, has_avx512 },
+    { "avx2", and_popcount_avx2, has_avx2 },
+    { "popcnt", and_popcount_popcnt, has_popcnt },
+#endif
+#ifdef FINDER_POPCOUNT_NEON
+    { "neon", and_popcount_neon, always },
+#endif
+    { "generic", and_popcount_generic, always }
+};
+const size_t N_kernels = sizeof(kernels) / sizeof(kernels[0]);
+
+const Popcount_Kernel* best_kernel() {
+    for (size_t n = 0; n < N_kernels; n++) {
+        if (kernels[n].supported()) return &kernels[n];
+    }
+    return &kernels[N_kernels - 1];
+}
+
+std::atomic<const Popcount_Kernel*>& current_kernel() {
+    static std::atomic<const Popcount_Kernel*> kernel(best_kernel());
+    return kernel;
+}
+
+} // anonymous namespace
+
+size_t and_popcount(const uint64_t* a, const uint64_t* b, const size_t n) {
+    return current_kernel().load(std::memory_order_relaxed)->fn(a, b, n);
+}
+
+std::string get_popcount_kernel() {
+    return current_kernel().load()->name;
+}
+
+std::vector<std::string> get_popcount_kernels() {
+    std::vector<std::string> names;
+    for (size_t n = 0; n < N_kernels; n++) {
+        if (kernels[n].supported()) names.push_back(kernels[n].name);
+    }
+    return names;
+}
+
+bool set_popcount_kernel(const std::string& name) {
+    for (size_t n = 0; n < N_kernels; n++) {
+        if (name == kernels[n].name && kernels[n].supported()) {
+            current_kernel().store(&kernels[n]);
+            return true;
+        }
+    }
+    return false;
+}
+
+}; // end of FiniteFault namespace
+
+// end of file: finder_popcount.cpp
@@ -0,0 +1,34 @@
+//
+//      Popcount kernels for the bit-packed binary template matching
+//
+//      and_popcount(a, b, n) counts the bits set in both a and b over n 64 bit words, which is the
+//      overlap of a bit-packed template column with an image column. The kernel is picked once at
+//      start up from what the CPU supports: AVX-512 VPOPCNTDQ, AVX2 (nibble lookup), NEON or the
+//      scalar popcount instruction, with a portable fallback.
+//
+
+#ifndef __finder_popcount_h__
+#define __finder_popcount_h__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace FiniteFault {
+
+// number of bits set in a[i] & b[i] for i in [0, n)
+size_t and_popcount(const uint64_t* a, const uint64_t* b, const size_t n);
+
+// name of the kernel used by and_popcount
+std::string get_popcount_kernel();
+// kernels this CPU can run, fastest first
+std::vector<std::string> get_popcount_kernels();
+// switch to another supported kernel, e.g. for testing; false if it is not available
+bool set_popcount_kernel(const std::string& name);
+
+}; // end of FiniteFault namespace
+
+#endif // __finder_popcount_h__
+
+// end of file: finder_popcount.h
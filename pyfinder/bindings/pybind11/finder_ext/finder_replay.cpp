@@ -0,0 +1,99 @@
+//
+//      Offline replay of recorded PGA updates through the FinDer pipeline
+//
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <sys/resource.h>
+
+#include "finder_replay.h"
+#include "finder_alloc_stats.h"
+#include "finder_state_lock.h"
+#include "finder_timing.h"
+#include "../finder_headers/finder_globals.h" // logging macros
+
+namespace FiniteFault {
+
+double Replay_Stats::latency_ms(const double pc) const {
+    if (latency_ns.empty()) return 0.;
+    std::vector<uint64_t> sorted(latency_ns);
+    std::sort(sorted.begin(), sorted.end());
+    // nearest rank
+    const double rank = std::ceil(std::min(std::max(pc, 0.), 100.) / 100. * sorted.size());
+    const size_t n = rank < 1. ? 0 : (size_t) rank - 1;
+    return sorted[std::min(n, sorted.size() - 1)] * 1e-6;
+}
+
+bool Finder_Replay::step(const Replay_Update& update, Replay_Stats& stats) {
+    try {
+        PGA_Data_List pga_data_list(update.pga_data_list);
+        Coordinate_List epicenters;
+        {
+            Finder_State_Lock lock(Finder_State_Lock::SHARED, &engine);
+            Finder_List flist;
+            flist.assign(finders.begin(), finders.end());
+            Temp_Files_Lock temp_files;
+            Stage_Timer timer(STAGE_SCAN);
+            epicenters = Finder::Scan_Data(pga_data_list, flist, true);
+        }
+        for (size_t n = 0; n < epicenters.size(); n++) {
+            finders.push_back(engine.create_finder(epicenters[n], pga_data_list, next_event_id++,
+                hold_time));
+            stats.events++;
+        }
+        const bool processed = scheduler.process_all(update.timestamp, pga_data_list, finders);
+        stats.finder_updates += finders.size() - scheduler.get_failed();
+        if (!processed) return false;
+    } catch (const std::exception& e) {
+        LOGE << "Finder_Replay: update at " << update.timestamp << " failed: " << e.what() << ELL;
+        return false;
+    }
+    // events the library let go
+    size_t kept = 0;
+    for (size_t n = 0; n < finders.size(); n++) {
+        if (finders[n]->get_finder_flags().get_hold_object()) {
+            finders[kept++] = finders[n];
+        } else {
+            Finder_Engine::destroy_finder(finders[n]);
+        }
+    }
+    finders.resize(kept);
+    return true;
+}
+
+bool Finder_Replay::run(const std::vector<Replay_Update>& updates, Replay_Stats& stats) {
+    stats = Replay_Stats();
+    stats.latency_ns.reserve(updates.size());
+    const bool notime = engine.set_offline_notime_test(true);
+    Allocation_Counter counter;
+    counter.start();
+    bool status = true;
+    const uint64_t start_ns = Stage_Timing::now_ns();
+    for (size_t u = 0; u < updates.size() && status; u++) {
+        const uint64_t update_ns = Stage_Timing::now_ns();
+        status = step(updates[u], stats);
+        stats.latency_ns.push_back(Stage_Timing::now_ns() - update_ns);
+        stats.updates++;
+    }
+    stats.wall_seconds = (Stage_Timing::now_ns() - start_ns) * 1e-9;
+    counter.stop();
+    engine.set_offline_notime_test(notime);
+    stats.allocations = counter.get_allocations();
+    stats.bytes = counter.get_bytes();
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) stats.peak_rss_kb = usage.ru_maxrss;
+
+    LOGI << "Finder_Replay: " << stats.updates << " updates, " << stats.events << " events, p50 " <<
+        stats.latency_ms(50.) << " ms, p99 " << stats.latency_ms(99.) << " ms" << ELL;
+    return status;
+}
+
+void Finder_Replay::clear() {
+    for (size_t n = 0; n < finders.size(); n++) Finder_Engine::destroy_finder(finders[n]);
+    finders.clear();
+}
+
+}; // end of FiniteFault namespace
+
+// end of file: finder_replay.cpp
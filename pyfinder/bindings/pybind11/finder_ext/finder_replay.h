@@ -0,0 +1,91 @@
+//
+//      Offline replay of recorded PGA updates through the FinDer pipeline
+//
+//      A Finder_Replay drives the library as a real-time client does, one update after the
+//      other. Finder::Scan_Data looks for new events among the active finders. A new Finder is
+//      created for each epicentre found, and Event_Scheduler::process_all then runs
+//      Finder::process for every active finder on its own copy of the update. Finders whose
+//      hold_object flag dropped are destroyed. The template sets run with offline_notime_test,
+//      so recorded data replays as fast as it is processed. The latency of an update covers
+//      all of this. The allocation counts are taken with an Allocation_Counter over the whole
+//      replay.
+//
+
+#ifndef __finder_replay_h__
+#define __finder_replay_h__
+
+#include <cstdint>
+#include <vector>
+
+#include "finder_engine.h"
+#include "finder_scheduler.h"
+
+namespace FiniteFault {
+
+/** One recorded update
+ * */
+struct Replay_Update {
+    double timestamp; /**< time the update is processed at */
+    PGA_Data_List pga_data_list; /**< PGA of all stations at timestamp */
+};
+
+/** Result of a replay
+ * */
+struct Replay_Stats {
+    Replay_Stats() : updates(0), events(0), finder_updates(0), wall_seconds(0.),
+        allocations(0), bytes(0), peak_rss_kb(0) {}
+
+    // latency not exceeded by pc percent of the updates, in ms
+    double latency_ms(const double pc) const;
+    double updates_per_second() const { return wall_seconds > 0. ? updates / wall_seconds : 0.; }
+    double events_per_second() const { return wall_seconds > 0. ? events / wall_seconds : 0.; }
+
+    size_t updates; /**< updates replayed */
+    size_t events; /**< Finder objects created */
+    size_t finder_updates; /**< Finder::process calls */
+    std::vector<uint64_t> latency_ns; /**< per update, scan, creation and processing */
+    double wall_seconds; /**< whole replay */
+    size_t allocations; /**< operator new calls of the whole replay */
+    size_t bytes; /**< bytes allocated by the whole replay */
+    long peak_rss_kb; /**< peak resident memory of the process after the replay */
+}; // struct Replay_Stats
+
+/** \class Finder_Replay
+ * \brief Replays recorded updates through Scan_Data, Finder creation and process.
+ * */
+class Finder_Replay {
+  public:
+    explicit Finder_Replay(Finder_Engine& engine = Finder_Engine::get_default(),
+        const long hold_time = 0) : engine(engine), hold_time(hold_time), next_event_id(1) {}
+    ~Finder_Replay() { clear(); }
+
+    // replay the updates in order, on top of the finders of earlier runs
+    bool run(const std::vector<Replay_Update>& updates, Replay_Stats& stats);
+    // destroy the active finders
+    void clear();
+
+    // enqueue the solution of every finder update to writer, NULL for none
+    void set_writer(Result_Writer* writer) { scheduler.set_writer(writer); }
+
+    size_t get_active() const { return finders.size(); }
+    const std::vector<Finder*>& get_finders() const { return finders; }
+
+  private:
+    Finder_Replay(const Finder_Replay&);
+    Finder_Replay& operator=(const Finder_Replay&);
+
+    // one update, returns false if the library threw
+    bool step(const Replay_Update& update, Replay_Stats& stats);
+
+    Finder_Engine& engine; /**< configuration the finders are created with */
+    long hold_time; /**< hold_time of the new finders */
+    long next_event_id; /**< event id of the next Finder */
+    std::vector<Finder*> finders; /**< active finders, made by engine.create_finder */
+    Event_Scheduler scheduler; /**< processes the finders of an update */
+}; // class Finder_Replay
+
+}; // end of FiniteFault namespace
+
+#endif // __finder_replay_h__
+
+// end of file: finder_replay.h
@@ -0,0 +1,202 @@
+//
+//      Result output off the processing path
+//
+
+#include <chrono>
+#include <cinttypes>
+#include <cstring>
+
+#include "finder_result_writer.h"
+#include "../finder_headers/finder_globals.h" // logging macros
+
+namespace FiniteFault {
+
+namespace {
+    // a producer that finds the writer awake does not notify it, so a wakeup can be missed
+    // between the writer's last look at the queue and its wait; it then looks again after this
+    const std::chrono::milliseconds IDLE_WAIT(10);
+}
+
+void Result_Snapshot::take(const Finder& finder, const double timestamp, Result_Snapshot& out) {
+    const Finder_Rupture_List& rupture = finder.get_finder_rupture_list_ref();
+    Result_Record& r = out.record;
+    std::memset(&r, 0, sizeof(r));
+    r.timestamp = timestamp;
+    r.event_id = finder.get_event_id();
+    r.version = finder.get_version();
+    r.mag = finder.get_mag();
+    r.mag_FD = finder.get_mag_FD();
+    r.mag_reg = finder.get_mag_reg();
+    r.mag_uncer = finder.get_mag_uncer();
+    r.epicenter_lat = finder.get_epicenter().get_lat();
+    r.epicenter_lon = finder.get_epicenter().get_lon();
+    r.depth = finder.get_depth();
+    r.origin_time = finder.get_origin_time();
+    r.likelihood = finder.get_likelihood_estimate();
+    r.rupture_length = finder.get_rupture_length();
+    r.rupture_azimuth = finder.get_rupture_azimuth();
+    r.Nstat_used = finder.get_Nstat_used();
+    r.N_rupture = rupture.size();
+    out.rupture.resize(3 * rupture.size());
+    for (size_t n = 0; n < rupture.size(); n++) {
+        out.rupture[3 * n] = rupture[n].get_lat();
+        out.rupture[3 * n + 1] = rupture[n].get_lon();
+        out.rupture[3 * n + 2] = rupture[n].get_depth();
+    }
+}
+
+bool read_results(const std::string& path, std::vector<Result_Snapshot>& out) {
+    out.clear();
+    FILE* in = fopen(path.c_str(), "rb");
+    if (in == NULL) return false;
+    const long file_bytes = (fseek(in, 0, SEEK_END) == 0) ? ftell(in) : -1;
+    rewind(in);
+    Result_File_Header header;
+    bool status = file_bytes >= 0 && fread(&header, sizeof(header), 1, in) == 1 &&
+        std::memcmp(header.magic, RESULT_MAGIC, sizeof(RESULT_MAGIC)) == 0 &&
+        header.version == RESULT_VERSION && header.record_bytes == sizeof(Result_Record);
+    uint64_t offset = sizeof(header);
+    while (status && offset < (uint64_t) file_bytes) {
+        Result_Snapshot snapshot;
+        status = fread(&snapshot.record, sizeof(Result_Record), 1, in) == 1;
+        // a corrupt count must not reach the allocation
+        const uint64_t points = status ? snapshot.record.N_rupture : 0;
+        offset += sizeof(Result_Record);
+        status = status && points <= ((uint64_t) file_bytes - offset) / (3 * sizeof(double));
+        if (status) {
+            snapshot.rupture.resize(3 * points);
+            status = snapshot.rupture.empty() || fread(&snapshot.rupture[0], sizeof(double),
+                snapshot.rupture.size(), in) == snapshot.rupture.size();
+            offset += snapshot.rupture.size() * sizeof(double);
+            out.push_back(std::move(snapshot));
+        }
+    }
+    fclose(in);
+    if (!status) {
+        LOGE << "read_results: " << path << " is not a version " << RESULT_VERSION <<
+            " result file" << ELL;
+    }
+    return status;
+}
+
+Result_Writer::Result_Writer(const std::string& path, const Result_Format format,
+        const size_t capacity) : path(path), format(format), file(NULL), queue(capacity),
+        enqueued(0), written(0), failed(0), dropped(0), idle(false), stopping(false),
+        pending(0), finished(false) {
+    file = fopen(path.c_str(), format == RESULT_BINARY ? "wb" : "w");
+    if (file == NULL) {
+        LOGE << "Result_Writer: cannot write " << path << ELL;
+        stopping.store(true);
+        finished.store(true);
+        return;
+    }
+    if (format == RESULT_BINARY) {
+        Result_File_Header header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, RESULT_MAGIC, sizeof(header.magic));
+        header.version = RESULT_VERSION;
+        header.record_bytes = sizeof(Result_Record);
+        if (fwrite(&header, sizeof(header), 1, file) != 1) {
+            LOGE << "Result_Writer: writing " << path << " failed" << ELL;
+        }
+    }
+    thread = std::thread(&Result_Writer::run, this);
+}
+
+bool Result_Writer::enqueue(Result_Snapshot& snapshot) {
+    // announced before the stopping check, so that the writer's last pass waits for the push
+    pending.fetch_add(1);
+    if (stopping.load() || !queue.try_push(snapshot)) {
+        pending.fetch_sub(1);
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    enqueued.fetch_add(1, std::memory_order_release);
+    pending.fetch_sub(1);
+    if (idle.load(std::memory_order_acquire)) wake.notify_one();
+    return true;
+}
+
+bool Result_Writer::enqueue(const Finder& finder, const double timestamp) {
+    Result_Snapshot snapshot;
+    Result_Snapshot::take(finder, timestamp, snapshot);
+    return enqueue(snapshot);
+}
+
+void Result_Writer::run() {
+    Result_Snapshot snapshot;
+    for (;;) {
+        // read before draining, so that what was enqueued before close is still written;
+        // an enqueue that passed the stopping check before close is waited for
+        const bool last = stopping.load() && pending.load() == 0;
+        size_t batch_written = 0, batch_failed = 0;
+        while (queue.try_pop(snapshot)) {
+            if (write(snapshot)) batch_written++;
+            else batch_failed++;
+        }
+        if (batch_written + batch_failed > 0) {
+            // what is written survives a crash of the process; flush returns after this
+            fflush(file);
+            std::lock_guard<std::mutex> lk(lock);
+            written.fetch_add(batch_written);
+            failed.fetch_add(batch_failed);
+            drained.notify_all();
+            continue;
+        }
+        if (last) break;
+        std::unique_lock<std::mutex> lk(lock);
+        idle.store(true, std::memory_order_release);
+        wake.wait_for(lk, IDLE_WAIT);
+        idle.store(false, std::memory_order_release);
+    }
+    fflush(file);
+    std::lock_guard<std::mutex> lk(lock);
+    finished.store(true);
+    drained.notify_all();
+}
+
+bool Result_Writer::write(const Result_Snapshot& snapshot) {
+    const Result_Record& r = snapshot.record;
+    if (format == RESULT_BINARY) {
+        return fwrite(&r, sizeof(r), 1, file) == 1 && (snapshot.rupture.empty() ||
+            fwrite(&snapshot.rupture[0], sizeof(double), snapshot.rupture.size(), file) ==
+            snapshot.rupture.size());
+    }
+    bool status = fprintf(file, "# %.3f event %" PRId64 " version %" PRIu64 " mag %.2f "
+        "mag_FD %.2f mag_reg %.2f mag_uncer %.2f epicenter %.3f/%.3f depth %.1f "
+        "origin_time %.3f likelihood %.4f length %.2f azimuth %.1f Nstat %" PRIu64 " "
+        "N %" PRIu64 "\n", r.timestamp, r.event_id, r.version, r.mag, r.mag_FD, r.mag_reg,
+        r.mag_uncer, r.epicenter_lat, r.epicenter_lon, r.depth, r.origin_time, r.likelihood,
+        r.rupture_length, r.rupture_azimuth, r.Nstat_used, r.N_rupture) > 0;
+    // the precision of Finder_Rupture's operator<<
+    for (size_t n = 0; n + 2 < snapshot.rupture.size() && status; n += 3) {
+        status = fprintf(file, "%.3f %.3f %.3f\n", snapshot.rupture[n], snapshot.rupture[n + 1],
+            snapshot.rupture[n + 2]) > 0;
+    }
+    return status;
+}
+
+void Result_Writer::flush() {
+    const size_t target = enqueued.load(std::memory_order_acquire);
+    std::unique_lock<std::mutex> lk(lock);
+    drained.wait(lk, [this, target]() {
+        return written.load() + failed.load() >= target || finished.load();
+    });
+}
+
+void Result_Writer::close() {
+    std::lock_guard<std::mutex> lk(close_lock);
+    stopping.store(true, std::memory_order_release);
+    if (thread.joinable()) {
+        wake.notify_one();
+        thread.join();
+    }
+    if (file != NULL) {
+        if (fclose(file) != 0) LOGE << "Result_Writer: closing " << path << " failed" << ELL;
+        file = NULL;
+    }
+}
+
+}; // end of FiniteFault namespace
+
+// end of file: finder_result_writer.cpp
@@ -0,0 +1,145 @@
+//
+//      Result output off the processing path
+//
+//      With debug output enabled, writeRuptureFile (RUPTURE_DATA), Template_Match::writeDebugFiles
+//      and writeThreshFiles format and write their files synchronously inside Finder::process, so
+//      forensic logging in production costs alert latency. These writes are inside the prebuilt
+//      libFinder. A Result_Writer records the same solutions with the library debug output left
+//      off: after Finder::process the solve path copies the solution into a Result_Snapshot and
+//      enqueues it, and a writer thread of its own formats and writes it. The queue is bounded
+//      and lock-free. When it is full the snapshot is dropped and counted, the solve path never
+//      waits for the disk.
+//
+//      Text output has one header line per snapshot, followed by one lat lon depth line per
+//      rupture point. Binary output, native byte order:
+//          Result_File_Header
+//          per snapshot: Result_Record, double rupture[3 * N_rupture] (lat, lon, depth)
+//
+
+#ifndef __finder_result_writer_h__
+#define __finder_result_writer_h__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../finder_headers/finder.h"
+#include "finder_bounded_queue.h"
+
+namespace FiniteFault {
+
+const char RESULT_MAGIC[8] = { 'F', 'D', 'R', 'R', 'E', 'S', 'L', '1' }; /**< file signature */
+const uint32_t RESULT_VERSION = 1; /**< format version */
+
+/** Fixed-size head of a binary result file */
+struct Result_File_Header {
+    char magic[8]; /**< RESULT_MAGIC */
+    uint32_t version; /**< RESULT_VERSION */
+    uint32_t record_bytes; /**< sizeof(Result_Record), guards against layout changes */
+};
+
+/** Solution of one Finder after one process call, fixed-size part */
+struct Result_Record {
+    double timestamp; /**< time of the update */
+    int64_t event_id; /**< Finder event id */
+    uint64_t version; /**< Finder version after the update */
+    double mag; /**< magnitude */
+    double mag_FD; /**< magnitude from the rupture length */
+    double mag_reg; /**< magnitude from the amplitude regression */
+    double mag_uncer; /**< magnitude uncertainty */
+    double epicenter_lat; /**< epicentre latitude */
+    double epicenter_lon; /**< epicentre longitude */
+    double depth; /**< depth in km */
+    double origin_time; /**< origin time */
+    double likelihood; /**< likelihood estimate of the best template */
+    double rupture_length; /**< rupture length in km */
+    double rupture_azimuth; /**< rupture strike */
+    uint64_t Nstat_used; /**< stations used */
+    uint64_t N_rupture; /**< points of the rupture trace */
+};
+
+/** Copy of a solution that outlives the Finder, for writing later */
+struct Result_Snapshot {
+    // the solution of finder after it processed the update at timestamp
+    static void take(const Finder& finder, const double timestamp, Result_Snapshot& out);
+
+    Result_Record record; /**< scalar part */
+    std::vector<double> rupture; /**< lat, lon, depth of each rupture point */
+};
+
+// snapshots of a binary result file, false if it is not one
+bool read_results(const std::string& path, std::vector<Result_Snapshot>& out);
+
+/** Output formats of a Result_Writer */
+enum Result_Format {
+    RESULT_TEXT, /**< formatted lines */
+    RESULT_BINARY /**< Result_Record and rupture points as stored in memory */
+};
+
+/** \class Result_Writer
+ * \brief Writes result snapshots to a file from a thread of its own.
+ * */
+class Result_Writer {
+  public:
+    // opens path, truncating it, and starts the writer thread
+    Result_Writer(const std::string& path, const Result_Format format = RESULT_TEXT,
+        const size_t capacity = 1024);
+    ~Result_Writer() { close(); }
+
+    bool is_open() const { return file != NULL; }
+
+    // hand a snapshot to the writer thread, snapshot is moved from. False, and the snapshot
+    // counted as dropped, if the queue is full or the writer closed. Never blocks.
+    bool enqueue(Result_Snapshot& snapshot);
+    // take and enqueue the solution of finder
+    bool enqueue(const Finder& finder, const double timestamp);
+
+    // wait until everything enqueued so far is written and flushed
+    void flush();
+    // write what is queued, stop the thread and close the file
+    void close();
+
+    const std::string& get_path() const { return path; }
+    Result_Format get_format() const { return format; }
+    size_t get_capacity() const { return queue.capacity(); }
+    size_t get_enqueued() const { return enqueued.load(std::memory_order_relaxed); }
+    size_t get_written() const { return written.load(std::memory_order_relaxed); }
+    size_t get_failed() const { return failed.load(std::memory_order_relaxed); }
+    size_t get_dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+  private:
+    Result_Writer(const Result_Writer&);
+    Result_Writer& operator=(const Result_Writer&);
+
+    void run();
+    bool write(const Result_Snapshot& snapshot);
+
+    std::string path; /**< output file */
+    Result_Format format; /**< output format */
+    FILE* file; /**< open output file, NULL once closed */
+    Bounded_Queue<Result_Snapshot> queue; /**< snapshots waiting for the writer thread */
+    std::atomic<size_t> enqueued; /**< snapshots accepted */
+    std::atomic<size_t> written; /**< snapshots written */
+    std::atomic<size_t> failed; /**< snapshots taken off the queue whose write failed */
+    std::atomic<size_t> dropped; /**< snapshots refused */
+    std::atomic<bool> idle; /**< the writer thread waits for work */
+    std::atomic<bool> stopping; /**< close was called */
+    std::atomic<size_t> pending; /**< enqueue calls past the stopping check, not yet pushed */
+    std::atomic<bool> finished; /**< the writer thread ended */
+    std::mutex lock; /**< for the condition variables */
+    std::condition_variable wake; /**< new work or stopping */
+    std::condition_variable drained; /**< written and failed caught up with enqueued */
+    std::mutex close_lock; /**< serialises close */
+    std::thread thread; /**< writer thread */
+}; // class Result_Writer
+
+}; // end of FiniteFault namespace
+
+#endif // __finder_result_writer_h__
+
+// end of file: finder_result_writer.h
@@ -0,0 +1,104 @@
+//
+//      Scheduling of the active Finder objects on one update
+//
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <limits>
+
+#include "finder_scheduler.h"
+#include "finder_engine.h"
+#include "finder_result_writer.h"
+#include "finder_state_lock.h"
+#include "finder_timing.h"
+#include "../finder_headers/finder_globals.h" // logging macros
+
+namespace FiniteFault {
+
+namespace {
+    // what priority_order sorts on
+    struct Priority_Key {
+        bool busy; /**< in use by another thread, sorted last */
+        double mag; /**< magnitude, -infinity without a solution yet */
+        long expiry; /**< last message time plus hold time, when the event is let go */
+        long start_time; /**< creation time */
+    };
+
+    // the key of finder, read under a claim on it
+    void read_priority_key(const Finder* finder, Priority_Key& key) {
+        Object_Claim claim(finder);
+        key.busy = !claim.claimed();
+        key.mag = -std::numeric_limits<double>::infinity();
+        key.expiry = std::numeric_limits<long>::max();
+        key.start_time = std::numeric_limits<long>::max();
+        if (key.busy) return;
+        // a Finder without a solution yet goes after those with one
+        if (!std::isnan(finder->get_mag())) key.mag = finder->get_mag();
+        key.expiry = finder->get_last_message_time() + finder->get_hold_time();
+        key.start_time = finder->get_start_time();
+    }
+}
+
+void Event_Scheduler::priority_order(const std::vector<Finder*>& finders,
+        std::vector<size_t>& order) {
+    std::vector<Priority_Key> keys(finders.size());
+    for (size_t n = 0; n < finders.size(); n++) read_priority_key(finders[n], keys[n]);
+    order.resize(finders.size());
+    for (size_t n = 0; n < order.size(); n++) order[n] = n;
+    std::sort(order.begin(), order.end(), [&keys](size_t a, size_t b) {
+        const Priority_Key& ka = keys[a];
+        const Priority_Key& kb = keys[b];
+        if (ka.busy != kb.busy) return kb.busy;
+        if (ka.mag != kb.mag) return ka.mag > kb.mag;
+        if (ka.expiry != kb.expiry) return ka.expiry < kb.expiry;
+        if (ka.start_time != kb.start_time) return ka.start_time < kb.start_time;
+        return a < b;
+    });
+}
+
+bool Event_Scheduler::process(Finder* finder, const double timestamp,
+        const PGA_Data_List& pga_data_list) const {
+    try {
+        Finder_State_Lock lock(Finder_State_Lock::SHARED, &Finder_Engine::of(finder));
+        Object_Claim claim(finder);
+        if (!claim.claimed()) {
+            LOGE << "Event_Scheduler: Finder " << finder->get_event_id() <<
+                " is in use by another thread" << ELL;
+            return false;
+        }
+        // Finder::process updates the list in place
+        PGA_Data_List finder_list(pga_data_list);
+        Temp_Files_Lock temp_files;
+        Stage_Timer timer(STAGE_PROCESS, finder->get_event_id());
+        if (step) step(finder, timestamp, finder_list);
+        else finder->process(timestamp, finder_list);
+        // copied while the claim is held, written by the writer thread
+        if (writer != NULL) writer->enqueue(*finder, timestamp);
+    } catch (const std::exception& e) {
+        LOGE << "Event_Scheduler: Finder " << finder->get_event_id() << " failed at " <<
+            timestamp << ": " << e.what() << ELL;
+        return false;
+    }
+    return true;
+}
+
+bool Event_Scheduler::process_all(const double timestamp, const PGA_Data_List& pga_data_list,
+        const std::vector<Finder*>& finders) {
+    priority_order(finders, order);
+    latency_ns.assign(finders.size(), 0);
+    failed = 0;
+    if (finders.empty()) return true;
+
+    const uint64_t start_ns = Stage_Timing::now_ns();
+    for (size_t k = 0; k < order.size(); k++) {
+        const size_t n = order[k];
+        if (!process(finders[n], timestamp, pga_data_list)) failed++;
+        latency_ns[n] = Stage_Timing::now_ns() - start_ns;
+    }
+    return failed == 0;
+}
+
+}; // end of FiniteFault namespace
+
+// end of file: finder_scheduler.cpp
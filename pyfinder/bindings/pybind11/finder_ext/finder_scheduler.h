@@ -0,0 +1,84 @@
+//
+//      Scheduling of the active Finder objects on one update
+//
+//      During an aftershock sequence many Finder objects are active at once and each update has
+//      to be processed by all of them. Event_Scheduler::process_all processes them on the
+//      calling thread, each on its own copy of the update, in order of urgency: largest
+//      magnitude first, then the one whose hold time runs out first (last message time plus
+//      hold time), then the oldest.
+//      However many small events are active, the largest waits for nothing but its own
+//      processing. Finder::process, its gridding and its template matching included, runs in
+//      libFinder, which solves through fixed files in TEMP_DIR (Temp_Files_Lock); so the
+//      finders are processed one after the other and not spread over the worker pool. Finders
+//      with overlapping grid extents do not share their gridding, each grids its own copy of
+//      the update.
+//
+
+#ifndef __finder_scheduler_h__
+#define __finder_scheduler_h__
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "../finder_headers/finder.h"
+
+namespace FiniteFault {
+
+class Result_Writer;
+
+/** \class Event_Scheduler
+ * \brief Processes one update with all active Finder objects, the most urgent first.
+ * */
+class Event_Scheduler {
+  public:
+    typedef std::function<void(Finder*, double, PGA_Data_List&)> Process_Step;
+
+    Event_Scheduler() : writer(NULL), failed(0) {}
+
+    // enqueue the solution of every finder processed to writer, NULL for none
+    void set_writer(Result_Writer* writer) { this->writer = writer; }
+    Result_Writer* get_writer() const { return writer; }
+
+    // run step(finder, timestamp, copy of the list) instead of Finder::process, e.g. to time
+    // the scheduling alone; empty for Finder::process. It runs with the state lock and the
+    // claim on the finder held and must not take either again.
+    void set_step(const Process_Step& step) { this->step = step; }
+
+    // Finder::process(timestamp, copy of pga_data_list) for each finder, under the state of its
+    // engine. False if a finder was in use by another thread or the library threw; the other
+    // finders are processed regardless.
+    bool process_all(const double timestamp, const PGA_Data_List& pga_data_list,
+        const std::vector<Finder*>& finders);
+
+    // indices of finders, most urgent first. Each finder is read under a claim; one in use
+    // by another thread goes last.
+    static void priority_order(const std::vector<Finder*>& finders, std::vector<size_t>& order);
+
+    // of the last process_all: the priority order, which is the processing order, the time
+    // from its start until each finder was done, in the order of finders, and the finders
+    // that failed
+    const std::vector<size_t>& get_order() const { return order; }
+    const std::vector<uint64_t>& get_latency_ns() const { return latency_ns; }
+    size_t get_failed() const { return failed; }
+
+  private:
+    Event_Scheduler(const Event_Scheduler&);
+    Event_Scheduler& operator=(const Event_Scheduler&);
+
+    // process finder, returns false if that failed
+    bool process(Finder* finder, const double timestamp,
+        const PGA_Data_List& pga_data_list) const;
+
+    Result_Writer* writer; /**< receives the solutions, may be NULL */
+    Process_Step step; /**< replaces Finder::process if set */
+    std::vector<size_t> order; /**< priority order of the last batch */
+    std::vector<uint64_t> latency_ns; /**< per finder of the last batch */
+    size_t failed; /**< finders of the last batch that failed */
+}; // class Event_Scheduler
+
+}; // end of FiniteFault namespace
+
+#endif // __finder_scheduler_h__
+
+// end of file: finder_scheduler.h
@@ -0,0 +1,47 @@
+//
+//      Per-thread scratch buffers kept sized across timesteps
+//
+
+#include <algorithm>
+
+#include "finder_scratch.h"
+
+namespace FiniteFault {
+
+std::atomic<size_t> Scratch_Arena::total_growths(0);
+
+cv::Mat Scratch_Arena::view(const Scratch_Slot slot, const int rows, const int cols,
+        const int type) {
+    cv::Mat& mat = backing[slot];
+    if (mat.type() != type || mat.rows < rows || mat.cols < cols) {
+        // grow to both the largest rows and the largest cols, so that alternating shapes settle
+        const int new_rows = mat.type() == type ? std::max(mat.rows, rows) : rows;
+        const int new_cols = mat.type() == type ? std::max(mat.cols, cols) : cols;
+        mat.create(new_rows, new_cols, type);
+        total_growths.fetch_add(1, std::memory_order_relaxed);
+    }
+    return mat(cv::Rect(0, 0, cols, rows));
+}
+
+std::vector<size_t>& Scratch_Arena::indices(const Scratch_Index slot) {
+    lists[slot].clear();
+    return lists[slot];
+}
+
+size_t Scratch_Arena::memory_bytes() const {
+    size_t bytes = 0;
+    for (size_t n = 0; n < N_SCRATCH_SLOTS; n++) {
+        bytes += backing[n].total() * backing[n].elemSize();
+    }
+    for (size_t n = 0; n < N_SCRATCH_INDICES; n++) bytes += lists[n].capacity() * sizeof(size_t);
+    return bytes;
+}
+
+Scratch_Arena& Scratch_Arena::local() {
+    thread_local Scratch_Arena arena;
+    return arena;
+}
+
+}; // end of FiniteFault namespace
+
+// end of file: finder_scratch.cpp
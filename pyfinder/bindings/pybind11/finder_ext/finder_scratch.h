@@ -0,0 +1,84 @@
+//
+//      Per-thread scratch buffers kept sized across timesteps
+//
+//      The correlation maps, spectrum products and index lists of the template search are
+//      temporaries of a single template, but they used to be created for every template on
+//      every timestep and freed again. A Scratch_Arena belongs to one thread and keeps them.
+//      view(slot, rows, cols, type) returns a header onto the slot's backing matrix. The
+//      backing matrix only grows, to the largest rows x cols asked for so far. A view has
+//      exactly the size asked for, so the create() that cv::matchTemplate, cv::mulSpectrums or
+//      copyTo make on it is a no-op. After the first timestep at a given image size no call
+//      allocates. Every reallocation of a backing matrix is counted in growths().
+//
+//      A slot is valid until the next view of the same slot on the same thread. Only leaf code
+//      may hold one: a thread waiting on the Worker_Pool runs other queued tasks, which may take
+//      the same slot.
+//
+
+#ifndef __finder_scratch_h__
+#define __finder_scratch_h__
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "../finder_headers/finder_opencv.h"
+
+namespace FiniteFault {
+
+/** Scratch slots, one per temporary that can be alive at the same time
+ * */
+enum Scratch_Slot {
+    SCRATCH_CORR, /**< correlation map of one template over its placements */
+    SCRATCH_COARSE, /**< correlation map on the coarse level */
+    SCRATCH_PRODUCT, /**< product of the image and template spectra */
+    SCRATCH_FULL, /**< inverse transform of the product */
+    SCRATCH_SHIFTED, /**< funnel-shifted image words of one Bit_Image column, as CV_64F */
+    N_SCRATCH_SLOTS
+};
+
+/** Index list slots
+ * */
+enum Scratch_Index {
+    SCRATCH_STRIKES, /**< strike search order */
+    SCRATCH_LENGTHS, /**< length search order */
+    N_SCRATCH_INDICES
+};
+
+/** \class Scratch_Arena
+ * \brief Matrices and index lists of one thread, reused across calls.
+ * */
+class Scratch_Arena {
+  public:
+    Scratch_Arena() {}
+
+    // rows x cols header of type onto the slot, the backing matrix growing if needed
+    cv::Mat view(const Scratch_Slot slot, const int rows, const int cols, const int type);
+    cv::Mat view(const Scratch_Slot slot, const cv::Size& size, const int type) {
+        return view(slot, size.height, size.width, type);
+    }
+    // empty index list, with its capacity kept
+    std::vector<size_t>& indices(const Scratch_Index slot);
+    // bytes held by the backing matrices and index lists
+    size_t memory_bytes() const;
+
+    // arena of the calling thread
+    static Scratch_Arena& local();
+    // reallocations of backing matrices over all threads since the process started
+    static size_t growths() { return total_growths.load(std::memory_order_relaxed); }
+
+  private:
+    Scratch_Arena(const Scratch_Arena&);
+    Scratch_Arena& operator=(const Scratch_Arena&);
+
+    cv::Mat backing[N_SCRATCH_SLOTS]; /**< largest matrix asked for per slot */
+    std::vector<size_t> lists[N_SCRATCH_INDICES]; /**< index lists */
+
+    static std::atomic<size_t> total_growths; /**< reallocations of all arenas */
+}; // class Scratch_Arena
+
+}; // end of FiniteFault namespace
+
+#endif // __finder_scratch_h__
+
+// end of file: finder_scratch.h
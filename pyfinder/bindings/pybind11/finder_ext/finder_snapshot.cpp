@@ -0,0 +1,729 @@
+//
+//      Snapshot and restore of the Finder objects of an engine
+//
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "finder_snapshot.h"
+#include "finder_state_lock.h"
+#include "../finder_headers/finder_globals.h" // logging macros
+#include "../finder_headers/finder_parameters.h"
+
+namespace FiniteFault {
+
+namespace {
+    /** Appends the fields of a snapshot to a byte buffer */
+    class Snapshot_Out {
+      public:
+        explicit Snapshot_Out(std::vector<char>& bytes) : bytes(bytes) {}
+
+        template <typename T>
+        void put(const T& value) {
+            const char* p = reinterpret_cast<const char*>(&value);
+            bytes.insert(bytes.end(), p, p + sizeof(T));
+        }
+        void put_count(const size_t count) { put((uint64_t) count); }
+        void put_string(const std::string& s) {
+            put_count(s.size());
+            bytes.insert(bytes.end(), s.begin(), s.end());
+        }
+        void put_doubles(const std::vector<double>& v) {
+            put_count(v.size());
+            for (size_t n = 0; n < v.size(); n++) put(v[n]);
+        }
+        void put_indices(const std::vector<size_t>& v) {
+            put_count(v.size());
+            for (size_t n = 0; n < v.size(); n++) put((uint64_t) v[n]);
+        }
+
+      private:
+        std::vector<char>& bytes; /**< buffer appended to */
+    };
+
+    /** Reads the fields of a snapshot from the mapping, never past its end */
+    class Snapshot_In {
+      public:
+        Snapshot_In(const char* begin, const char* end) : p(begin), end(end), ok(true) {}
+
+        bool good() const { return ok; }
+        const char* position() const { return p; }
+
+        template <typename T>
+        T get() {
+            T value = T();
+            if (!ok || (size_t) (end - p) < sizeof(T)) {
+                ok = false;
+                return value;
+            }
+            std::memcpy(&value, p, sizeof(T));
+            p += sizeof(T);
+            return value;
+        }
+        // a count of items of item_bytes each, zero and failed if they overrun the record
+        size_t get_count(const size_t item_bytes) {
+            const uint64_t count = get<uint64_t>();
+            if (ok && count > (uint64_t) (end - p) / item_bytes) ok = false;
+            return ok ? (size_t) count : 0;
+        }
+        std::string get_string() {
+            const size_t n = get_count(1);
+            std::string s(p, n);
+            p += n;
+            return s;
+        }
+        void get_doubles(std::vector<double>& v) {
+            v.resize(get_count(sizeof(double)));
+            for (size_t n = 0; n < v.size(); n++) v[n] = get<double>();
+        }
+        void get_indices(std::vector<size_t>& v) {
+            v.resize(get_count(sizeof(uint64_t)));
+            for (size_t n = 0; n < v.size(); n++) v[n] = (size_t) get<uint64_t>();
+        }
+
+      private:
+        const char* p; /**< next byte */
+        const char* end; /**< end of the record */
+        bool ok; /**< nothing overran so far */
+    };
+
+    bool same_value(const double a, const double b) {
+        return a == b || (std::isnan(a) && std::isnan(b));
+    }
+
+    // index of a template set among sets, -1 for NULL or one not found
+    int64_t set_index(const std::vector<Finder_Parameters*>& sets, const Finder_Parameters* set) {
+        for (size_t n = 0; n < sets.size(); n++) {
+            if (sets[n] == set) return (int64_t) n;
+        }
+        return -1;
+    }
+
+    // the lists of Finder_Internal hold pairs and triples of doubles
+    template <typename List>
+    void put_misfits(Snapshot_Out& out, const List& list) {
+        out.put_count(list.size());
+        for (size_t n = 0; n < list.size(); n++) {
+            out.put(list[n].get_value());
+            out.put(list[n].get_misf());
+        }
+    }
+
+    template <typename List>
+    void get_misfits(Snapshot_In& in, List& list) {
+        list.resize(in.get_count(2 * sizeof(double)));
+        for (size_t n = 0; n < list.size(); n++) {
+            const double value = in.get<double>();
+            list[n] = typename List::value_type(value, in.get<double>());
+        }
+    }
+
+    template <typename List>
+    void put_llks(Snapshot_Out& out, const List& list) {
+        out.put_count(list.size());
+        for (size_t n = 0; n < list.size(); n++) {
+            out.put(list[n].get_value());
+            out.put(list[n].get_llk());
+        }
+    }
+
+    template <typename List>
+    void get_llks(Snapshot_In& in, List& list) {
+        list.resize(in.get_count(2 * sizeof(double)));
+        for (size_t n = 0; n < list.size(); n++) {
+            const double value = in.get<double>();
+            list[n] = typename List::value_type(value, in.get<double>());
+        }
+    }
+
+    void put_pdf(Snapshot_Out& out, const LogLikelihood2D_List& list) {
+        out.put_count(list.size());
+        for (size_t n = 0; n < list.size(); n++) {
+            out.put(list[n].get_location().get_lat());
+            out.put(list[n].get_location().get_lon());
+            out.put(list[n].get_llk());
+        }
+    }
+
+    void get_pdf(Snapshot_In& in, LogLikelihood2D_List& list) {
+        list.resize(in.get_count(3 * sizeof(double)));
+        for (size_t n = 0; n < list.size(); n++) {
+            const double lat = in.get<double>();
+            const double lon = in.get<double>();
+            list[n] = LogLikelihood2D(lat, lon, in.get<double>());
+        }
+    }
+
+    void put_internal(Snapshot_Out& out, const Finder_Internal& f) {
+        out.put_string(f.get_template_id());
+        out.put((uint64_t) f.get_Nstat_used());
+        const double scalars[] = { f.get_mag(), f.get_mag_FD(), f.get_mag_reg(),
+            f.get_mag_uncer(), f.get_epicenter().get_lat(), f.get_epicenter().get_lon(),
+            f.get_epicenter_uncer().get_lat(), f.get_epicenter_uncer().get_lon(),
+            f.get_origin_time(), f.get_likelihood_estimate(), f.get_rupture_length(),
+            f.get_rupture_azimuth(), f.get_azimuth_uncer(), f.get_finder_centroid().get_lat(),
+            f.get_finder_centroid().get_lon(), f.get_finder_centroid_uncer().get_lat(),
+            f.get_finder_centroid_uncer().get_lon() };
+        for (size_t n = 0; n < sizeof(scalars) / sizeof(scalars[0]); n++) out.put(scalars[n]);
+        out.put_doubles(f.get_mag_uncer_vector());
+        out.put_count(f.get_misfit_size());
+        for (size_t n = 0; n < f.get_misfit_size(); n++) out.put(f.get_misfit(n));
+
+        const Finder_Rupture_List& rupture = f.get_finder_rupture_list_ref();
+        out.put_count(rupture.size());
+        for (size_t n = 0; n < rupture.size(); n++) {
+            out.put(rupture[n].get_lat());
+            out.put(rupture[n].get_lon());
+            out.put(rupture[n].get_depth());
+        }
+        put_misfits(out, f.get_finder_azimuth_list_ref());
+        put_misfits(out, f.get_finder_length_list_ref());
+        put_llks(out, f.get_finder_azimuth_llk_list_ref());
+        put_llks(out, f.get_finder_length_llk_list_ref());
+        put_pdf(out, f.get_centroid_lat_pdf_ref());
+        put_pdf(out, f.get_centroid_lon_pdf_ref());
+    }
+
+    void get_internal(Snapshot_In& in, Finder_Internal& f) {
+        f.set_template_id(in.get_string());
+        f.set_Nstat_used((size_t) in.get<uint64_t>());
+        double s[17];
+        for (size_t n = 0; n < 17; n++) s[n] = in.get<double>();
+        f.set_mag(s[0]);
+        f.set_mag_FD(s[1]);
+        f.set_mag_reg(s[2]);
+        f.set_mag_uncer(s[3]);
+        f.set_epicenter(s[4], s[5]);
+        f.set_epicenter_uncer(s[6], s[7]);
+        f.set_origin_time(s[8]);
+        f.set_likelihood_estimate(s[9]);
+        f.set_rupture_length(s[10]);
+        f.set_rupture_azimuth(s[11]);
+        f.set_azimuth_uncer(s[12]);
+        f.set_finder_centroid(s[13], s[14]);
+        f.set_finder_centroid_uncer(s[15], s[16]);
+        std::vector<double> values;
+        in.get_doubles(values);
+        f.set_mag_uncer_vector(values);
+        in.get_doubles(values);
+        f.resize_misfit(0, 0.);
+        f.resize_misfit(values.size(), 0.);
+        for (size_t n = 0; n < values.size(); n++) f.set_misfit(n, values[n]);
+
+        Finder_Rupture_List rupture;
+        rupture.resize(in.get_count(3 * sizeof(double)));
+        for (size_t n = 0; n < rupture.size(); n++) {
+            const double lat = in.get<double>();
+            const double lon = in.get<double>();
+            rupture[n] = Finder_Rupture(lat, lon, in.get<double>());
+        }
+        f.set_finder_rupture_list(std::move(rupture));
+        Finder_Azimuth_List azimuths;
+        get_misfits(in, azimuths);
+        f.set_finder_azimuth_list(std::move(azimuths));
+        Finder_Length_List lengths;
+        get_misfits(in, lengths);
+        f.set_finder_length_list(std::move(lengths));
+        Finder_Azimuth_LLK_List azimuth_llks;
+        get_llks(in, azimuth_llks);
+        f.set_finder_azimuth_llk_list(std::move(azimuth_llks));
+        Finder_Length_LLK_List length_llks;
+        get_llks(in, length_llks);
+        f.set_finder_length_llk_list(std::move(length_llks));
+        LogLikelihood2D_List pdf;
+        get_pdf(in, pdf);
+        f.set_centroid_lat_pdf(std::move(pdf));
+        pdf = LogLikelihood2D_List();
+        get_pdf(in, pdf);
+        f.set_centroid_lon_pdf(std::move(pdf));
+    }
+
+    void put_template(Snapshot_Out& out, const Finder_Data_Template& t,
+            const std::vector<Finder_Parameters*>& sets) {
+        out.put(set_index(sets, t.finder_parameters));
+        out.put((uint8_t) t.usedLastIter);
+        out.put((uint8_t) t.run_status);
+        out.put((uint64_t) t.min_ind_pgathresh);
+        out.put((uint64_t) t.min_ind_pgathresh_old);
+        out.put((int64_t) t.min_ind_length);
+        out.put_doubles(t.minVal_min);
+        out.put_indices(t.min_ind_strikes);
+        out.put_indices(t.min_ind_strikes_old);
+        out.put_indices(t.min_ind_lengths);
+        out.put_indices(t.min_ind_lengths_old);
+        put_internal(out, t);
+    }
+
+    // the set index is returned, the pointer is set by the caller
+    int64_t get_template(Snapshot_In& in, Finder_Data_Template& t) {
+        const int64_t set = in.get<int64_t>();
+        t.usedLastIter = in.get<uint8_t>() != 0;
+        t.run_status = in.get<uint8_t>() != 0;
+        t.min_ind_pgathresh = (size_t) in.get<uint64_t>();
+        t.min_ind_pgathresh_old = (size_t) in.get<uint64_t>();
+        t.min_ind_length = (int) in.get<int64_t>();
+        in.get_doubles(t.minVal_min);
+        in.get_indices(t.min_ind_strikes);
+        in.get_indices(t.min_ind_strikes_old);
+        in.get_indices(t.min_ind_lengths);
+        in.get_indices(t.min_ind_lengths_old);
+        get_internal(in, t);
+        return set;
+    }
+
+    void put_pga_list(Snapshot_Out& out, const PGA_Data_List& list) {
+        out.put_count(list.size());
+        for (size_t n = 0; n < list.size(); n++) {
+            const PGA_Data& d = list[n];
+            out.put_string(d.get_name());
+            out.put_string(d.get_network());
+            out.put_string(d.get_channel());
+            out.put_string(d.get_location_code());
+            out.put(d.get_location().get_lat());
+            out.put(d.get_location().get_lon());
+            out.put(d.get_value());
+            out.put(d.get_timestamp());
+            out.put((uint8_t) d.get_include());
+            out.put((uint8_t) d.get_trigger_flag());
+            const TemplateCollection<long>& ids = d.get_event_id_list_ref();
+            out.put_count(ids.size());
+            for (size_t k = 0; k < ids.size(); k++) out.put((int64_t) ids[k]);
+        }
+    }
+
+    // the smallest PGA_Data record: four empty strings, four doubles, two flags, no ids
+    const size_t MIN_PGA_BYTES = 5 * sizeof(uint64_t) + 4 * sizeof(double) + 2;
+
+    void get_pga_list(Snapshot_In& in, PGA_Data_List& list) {
+        list.clear();
+        const size_t count = in.get_count(MIN_PGA_BYTES);
+        list.reserve(count);
+        for (size_t n = 0; n < count && in.good(); n++) {
+            const std::string name = in.get_string();
+            const std::string network = in.get_string();
+            const std::string channel = in.get_string();
+            const std::string location_code = in.get_string();
+            const double lat = in.get<double>();
+            const double lon = in.get<double>();
+            const double value = in.get<double>();
+            const double timestamp = in.get<double>();
+            const bool include = in.get<uint8_t>() != 0;
+            PGA_Data d(name, network, channel, location_code, Coordinate(lat, lon), value,
+                timestamp, include);
+            d.set_trigger_flag(in.get<uint8_t>() != 0);
+            const size_t ids = in.get_count(sizeof(int64_t));
+            for (size_t k = 0; k < ids; k++) d.set_event_id_list((long) in.get<int64_t>());
+            list.push_back(d);
+        }
+    }
+
+    void put_finder(Snapshot_Out& out, const Finder& finder,
+            const std::vector<Finder_Parameters*>& sets) {
+        const Finder_Data& data = finder.f_data;
+        Snapshot_Finder head;
+        std::memset(&head, 0, sizeof(head));
+        head.event_id = data.get_event_id();
+        head.version = finder.get_version();
+        head.start_time = finder.get_start_time();
+        head.last_message_time = finder.get_last_message_time();
+        head.hold_time = finder.get_hold_time();
+        const Finder_Flags flags = finder.get_finder_flags();
+        head.flags[0] = flags.get_event_continue();
+        head.flags[1] = flags.get_hold_object();
+        head.flags[2] = flags.get_message();
+        head.flags[3] = flags.get_first_template_match();
+        head.multiple_objects = data.get_multiple_objects();
+        head.event_continue = data.get_event_continue();
+        head.object_center[0] = data.get_object_center().get_lat();
+        head.object_center[1] = data.get_object_center().get_lon();
+        head.origin_time_uncer = data.get_origin_time_uncer();
+        head.depth = data.get_depth();
+        head.depth_uncer = data.get_depth_uncer();
+        head.maxL_overtime = data.get_maxL_overtime();
+        head.finder_parameters = set_index(sets, data.finder_parameters);
+        head.sel_fdata_templ = -1;
+        for (size_t n = 0; n < data.templ_history_list.size(); n++) {
+            if (data.sel_fdata_templ == &data.templ_history_list[n]) head.sel_fdata_templ = n;
+        }
+        // record_bytes is filled in by save once the record is complete
+        out.put(head);
+
+        out.put_count(finder.fparam_list.size());
+        for (size_t n = 0; n < finder.fparam_list.size(); n++) {
+            out.put(set_index(sets, finder.fparam_list[n]));
+        }
+        put_internal(out, data);
+        put_internal(out, finder.f_data_prev);
+        out.put_count(data.templ_history_list.size());
+        for (size_t n = 0; n < data.templ_history_list.size(); n++) {
+            put_template(out, data.templ_history_list[n], sets);
+        }
+        put_pga_list(out, finder.get_pga_data_list_ref());
+        put_pga_list(out, finder.get_pga_above_min_thresh_ref());
+        put_pga_list(out, finder.get_rejected_stations_ref());
+    }
+
+    /** State of one Finder read from a record, before it is handed to a new Finder */
+    struct Finder_State {
+        Finder_State() : prev(), history() {}
+        Snapshot_Finder head; /**< fixed fields */
+        std::vector<int64_t> fparam_sets; /**< template sets of fparam_list */
+        Finder_Data data; /**< f_data, pointers not set */
+        Finder_Internal prev; /**< f_data_prev */
+        std::vector<Finder_Data_Template> history; /**< templ_history_list, pointers not set */
+        std::vector<int64_t> history_sets; /**< template set of each history entry */
+        PGA_Data_List pga_data_list; /**< Finder pga_data_list */
+        PGA_Data_List pga_above_min_thresh; /**< Finder pga_above_min_thresh */
+        PGA_Data_List rejected_stations; /**< Finder rejected_stations */
+    };
+
+    bool get_finder(Snapshot_In& in, Finder_State& state) {
+        state.head = in.get<Snapshot_Finder>();
+        Finder_Data& data = state.data;
+        data.set_event_id(state.head.event_id);
+        data.set_multiple_objects(state.head.multiple_objects != 0);
+        data.set_event_continue(state.head.event_continue != 0);
+        data.set_object_center(state.head.object_center[0], state.head.object_center[1]);
+        data.set_origin_time_uncer(state.head.origin_time_uncer);
+        data.set_depth(state.head.depth);
+        data.set_depth_uncer(state.head.depth_uncer);
+        data.set_maxL_overtime(state.head.maxL_overtime);
+
+        state.fparam_sets.resize(in.get_count(sizeof(int64_t)));
+        for (size_t n = 0; n < state.fparam_sets.size(); n++) {
+            state.fparam_sets[n] = in.get<int64_t>();
+        }
+        get_internal(in, data);
+        get_internal(in, state.prev);
+        // an entry takes more than its set index, flags and the indices of its head
+        const size_t entries = in.get_count(sizeof(int64_t) + 2 + 3 * sizeof(uint64_t));
+        state.history.assign(entries, Finder_Data_Template(NULL));
+        state.history_sets.resize(entries);
+        for (size_t n = 0; n < entries && in.good(); n++) {
+            state.history_sets[n] = get_template(in, state.history[n]);
+        }
+        get_pga_list(in, state.pga_data_list);
+        get_pga_list(in, state.pga_above_min_thresh);
+        get_pga_list(in, state.rejected_stations);
+        return in.good();
+    }
+
+    // template set of an index, false for one out of range; -1 is NULL
+    bool to_set(const std::vector<Finder_Parameters*>& sets, const int64_t index,
+            Finder_Parameters*& set) {
+        if (index < -1 || index >= (int64_t) sets.size()) return false;
+        set = index < 0 ? NULL : sets[index];
+        return true;
+    }
+
+    // empty, or one index below limit per PGA threshold
+    bool in_range(const std::vector<size_t>& indices, const size_t N_thresh, const size_t limit) {
+        if (indices.empty()) return true;
+        if (indices.size() != N_thresh) return false;
+        for (size_t i = 0; i < indices.size(); i++) {
+            if (indices[i] >= limit) return false;
+        }
+        return true;
+    }
+
+    // the indices of a history entry are those of a template, strike and threshold of its set;
+    // the library indexes the set with them without a check
+    bool in_range(const Finder_Data_Template& t) {
+        const Finder_Parameters* set = t.finder_parameters;
+        if (set == NULL) return true;
+        return t.min_ind_pgathresh < set->N_thresh && t.min_ind_pgathresh_old < set->N_thresh &&
+            t.min_ind_length >= 0 && (size_t) t.min_ind_length < set->N_templ &&
+            (t.minVal_min.empty() || t.minVal_min.size() == set->N_thresh) &&
+            in_range(t.min_ind_strikes, set->N_thresh, set->N_degrees) &&
+            in_range(t.min_ind_strikes_old, set->N_thresh, set->N_degrees) &&
+            in_range(t.min_ind_lengths, set->N_thresh, set->N_templ) &&
+            in_range(t.min_ind_lengths_old, set->N_thresh, set->N_templ);
+    }
+}
+
+Finder_Snapshot::~Finder_Snapshot() {
+    if (mapped != NULL) munmap(mapped, mapped_bytes);
+}
+
+bool Finder_Snapshot::save(const std::string& path, Finder_Engine& engine,
+        const std::vector<Finder*>& finders, const double timestamp, std::vector<long>* skipped) {
+    if (skipped != NULL) skipped->clear();
+    std::vector<char> bytes(sizeof(Snapshot_Header), 0);
+    Snapshot_Out out(bytes);
+    Finder_State_Lock lock(Finder_State_Lock::SHARED, &engine);
+    const std::vector<Finder_Parameters*> sets = Finder_Engine::active_template_sets();
+
+    const size_t engine_offset = bytes.size();
+    out.put_string(engine.config_file);
+    out.put_string(engine.template_store ? engine.template_store->get_path() : std::string());
+    out.put_string(engine.mask_path);
+    const Finder_Config_Info info = Finder::Get_finder_config_info();
+    out.put(info.dD);
+    out.put(info.minD);
+    out.put(info.maxD);
+    out.put(info.sigma);
+    const Template_ID_List ids = Finder::Get_template_id_list();
+    out.put_count(ids.size());
+    for (size_t n = 0; n < ids.size(); n++) out.put_string(ids[n].name);
+    out.put_count(sets.size());
+    for (size_t n = 0; n < sets.size(); n++) {
+        out.put((uint64_t) sets[n]->N_thresh);
+        out.put((uint64_t) sets[n]->N_degrees);
+        out.put((uint64_t) sets[n]->N_templ);
+    }
+    const Station_Index& stations = engine.station_index;
+    out.put_count(stations.size());
+    for (size_t n = 0; n < stations.size(); n++) {
+        out.put(stations.get_lat(n));
+        out.put(stations.get_lon(n));
+    }
+
+    const size_t finders_offset = bytes.size();
+    size_t saved = 0;
+    for (size_t n = 0; n < finders.size(); n++) {
+        const Finder* finder = finders[n];
+        if (&Finder_Engine::of(finder) != &engine) {
+            LOGE << "Finder_Snapshot: the finder of event " << finder->get_event_id() <<
+                " is of another engine" << ELL;
+            return false;
+        }
+        // the record of a Finder being processed would mix two timesteps; it is left for the
+        // next snapshot rather than waited for, which would hold up the caller for a solve
+        Object_Claim claim(finder);
+        if (!claim.claimed()) {
+            LOGW << "Finder_Snapshot: the finder of event " << finder->get_event_id() <<
+                " is being processed, not saved" << ELL;
+            if (skipped != NULL) skipped->push_back(finder->get_event_id());
+            continue;
+        }
+        const size_t record_offset = bytes.size();
+        put_finder(out, *finder, sets);
+        const uint64_t record_bytes = bytes.size() - record_offset;
+        std::memcpy(&bytes[record_offset], &record_bytes, sizeof(record_bytes));
+        saved++;
+    }
+
+    Snapshot_Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.header_bytes = sizeof(Snapshot_Header);
+    header.timestamp = timestamp;
+    header.N_finders = saved;
+    header.engine_offset = engine_offset;
+    header.finders_offset = finders_offset;
+    header.file_bytes = bytes.size();
+    std::memcpy(&bytes[0], &header, sizeof(header));
+
+    // a process mapping the old file keeps its pages, the rename swaps the directory entry
+    const std::string temp = path + ".tmp";
+    FILE* file = fopen(temp.c_str(), "wb");
+    if (file == NULL) {
+        LOGE << "Finder_Snapshot: cannot write " << temp << ELL;
+        return false;
+    }
+    bool status = fwrite(&bytes[0], 1, bytes.size(), file) == bytes.size();
+    status = (fclose(file) == 0) && status;
+    if (!status || std::rename(temp.c_str(), path.c_str()) != 0) {
+        LOGE << "Finder_Snapshot: writing " << path << " failed" << ELL;
+        std::remove(temp.c_str());
+        return false;
+    }
+    LOGD << "Finder_Snapshot: saved " << saved << " finders to " << path << " (" <<
+        bytes.size() << " bytes)" << ELL;
+    return true;
+}
+
+bool Finder_Snapshot::map(const std::string& path) {
+    this->path = path;
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        LOGE << "Finder_Snapshot: cannot open " << path << ELL;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(Snapshot_Header)) {
+        LOGE << "Finder_Snapshot: " << path << " is too short for a snapshot" << ELL;
+        ::close(fd);
+        return false;
+    }
+    void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        LOGE << "Finder_Snapshot: cannot map " << path << ELL;
+        return false;
+    }
+    mapped = addr;
+    mapped_bytes = st.st_size;
+    header = static_cast<const Snapshot_Header*>(mapped);
+
+    if (std::memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 ||
+            header->version != SNAPSHOT_VERSION ||
+            header->header_bytes != sizeof(Snapshot_Header) ||
+            header->file_bytes != mapped_bytes || header->engine_offset < sizeof(Snapshot_Header) ||
+            header->engine_offset > header->finders_offset ||
+            header->finders_offset > header->file_bytes) {
+        LOGE << "Finder_Snapshot: " << path << " is not a version " << SNAPSHOT_VERSION <<
+            " snapshot" << ELL;
+        return false;
+    }
+    const char* base = static_cast<const char*>(mapped);
+    Snapshot_In in(base + header->engine_offset, base + header->finders_offset);
+    config_file = in.get_string();
+    template_store = in.get_string();
+    mask_path = in.get_string();
+    config_info.dD = in.get<double>();
+    config_info.minD = in.get<double>();
+    config_info.maxD = in.get<double>();
+    config_info.sigma = in.get<double>();
+    template_id_list.resize(in.get_count(sizeof(uint64_t)));
+    for (size_t n = 0; n < template_id_list.size(); n++) {
+        template_id_list[n] = Template_ID(in.get_string());
+    }
+    set_shapes.resize(in.get_count(3 * sizeof(uint64_t)));
+    for (size_t n = 0; n < set_shapes.size(); n++) {
+        set_shapes[n].N_thresh = in.get<uint64_t>();
+        set_shapes[n].N_degrees = in.get<uint64_t>();
+        set_shapes[n].N_templ = in.get<uint64_t>();
+    }
+    const size_t N_stations = in.get_count(2 * sizeof(double));
+    for (size_t n = 0; n < N_stations; n++) {
+        const double lat = in.get<double>();
+        stations.push_back(Coordinate(lat, in.get<double>()));
+    }
+
+    // the records are only indexed here, restore reads them
+    size_t offset = header->finders_offset;
+    bool status = in.good();
+    for (uint64_t n = 0; status && n < header->N_finders; n++) {
+        Snapshot_Finder head;
+        status = offset + sizeof(head) <= mapped_bytes;
+        if (status) std::memcpy(&head, base + offset, sizeof(head));
+        status = status && head.record_bytes >= sizeof(head) &&
+            head.record_bytes <= mapped_bytes - offset;
+        if (status) {
+            Record_Span span = { (long) head.event_id, offset, (size_t) head.record_bytes };
+            records.push_back(span);
+            offset += head.record_bytes;
+        }
+    }
+    if (!status || offset != mapped_bytes) {
+        LOGE << "Finder_Snapshot: " << path << " is truncated or corrupt" << ELL;
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<Finder_Snapshot> Finder_Snapshot::open(const std::string& path) {
+    std::shared_ptr<Finder_Snapshot> snapshot(new Finder_Snapshot());
+    if (!snapshot->map(path)) return std::shared_ptr<Finder_Snapshot>();
+    return snapshot;
+}
+
+bool Finder_Snapshot::load_engine(Finder_Engine& engine) const {
+    if (!engine.load(config_file, stations, template_store)) return false;
+    if (!mask_path.empty() && !engine.attach_mask(mask_path)) return false;
+    if (!matches(engine)) {
+        LOGE << "Finder_Snapshot: " << config_file << " no longer gives the template sets of "
+            << path << ELL;
+        return false;
+    }
+    return true;
+}
+
+bool Finder_Snapshot::matches(Finder_Engine& engine) const {
+    Finder_State_Lock lock(Finder_State_Lock::SHARED, &engine);
+    const std::vector<Finder_Parameters*> sets = Finder_Engine::active_template_sets();
+    if (sets.size() != set_shapes.size()) return false;
+    for (size_t n = 0; n < sets.size(); n++) {
+        if (sets[n]->N_thresh != set_shapes[n].N_thresh ||
+                sets[n]->N_degrees != set_shapes[n].N_degrees ||
+                sets[n]->N_templ != set_shapes[n].N_templ) {
+            return false;
+        }
+    }
+    const Template_ID_List ids = Finder::Get_template_id_list();
+    if (ids.size() != template_id_list.size()) return false;
+    for (size_t n = 0; n < ids.size(); n++) {
+        if (ids[n].name != template_id_list[n].name) return false;
+    }
+    const Finder_Config_Info info = Finder::Get_finder_config_info();
+    return same_value(info.dD, config_info.dD) && same_value(info.minD, config_info.minD) &&
+        same_value(info.maxD, config_info.maxD) && same_value(info.sigma, config_info.sigma);
+}
+
+bool Finder_Snapshot::restore(Finder_Engine& engine, std::vector<Finder*>& out) const {
+    out.clear();
+    if (!matches(engine)) {
+        LOGE << "Finder_Snapshot: " << path << " was taken with other template sets than "
+            << "those of " << engine.get_config_file() << ELL;
+        return false;
+    }
+    std::vector<Finder_Parameters*> sets;
+    {
+        // the sets keep their addresses while other engines are active
+        Finder_State_Lock lock(Finder_State_Lock::SHARED, &engine);
+        sets = Finder_Engine::active_template_sets();
+    }
+
+    const char* base = static_cast<const char*>(mapped);
+    bool status = true;
+    for (size_t n = 0; status && n < records.size(); n++) {
+        Snapshot_In in(base + records[n].offset, base + records[n].offset + records[n].bytes);
+        Finder_State state;
+        status = get_finder(in, state) && in.position() == base + records[n].offset +
+            records[n].bytes;
+        std::vector<Finder_Parameters*> fparam_list(state.fparam_sets.size());
+        for (size_t k = 0; status && k < fparam_list.size(); k++) {
+            status = to_set(sets, state.fparam_sets[k], fparam_list[k]);
+        }
+        for (size_t k = 0; status && k < state.history.size(); k++) {
+            status = to_set(sets, state.history_sets[k], state.history[k].finder_parameters) &&
+                in_range(state.history[k]);
+        }
+        status = status && to_set(sets, state.head.finder_parameters,
+            state.data.finder_parameters) && state.head.sel_fdata_templ >= -1 &&
+            state.head.sel_fdata_templ < (int64_t) state.history.size();
+        if (!status) {
+            LOGE << "Finder_Snapshot: the record of event " << records[n].event_id << " in "
+                << path << " is corrupt" << ELL;
+            break;
+        }
+
+        // the constructor sets up what the snapshot does not hold, the rest is replaced
+        Finder* finder = engine.create_finder(state.data.get_epicenter(), state.pga_data_list,
+            state.head.event_id, state.head.hold_time);
+        out.push_back(finder);
+        finder->version = state.head.version;
+        finder->set_start_time(state.head.start_time);
+        finder->set_last_message_time(state.head.last_message_time);
+        finder->set_hold_time(state.head.hold_time);
+        finder->set_finder_flags(Finder_Flags(state.head.flags[0] != 0,
+            state.head.flags[1] != 0, state.head.flags[2] != 0, state.head.flags[3] != 0));
+        finder->fparam_list = fparam_list;
+        finder->f_data = std::move(state.data);
+        finder->f_data.templ_history_list = std::move(state.history);
+        finder->f_data.sel_fdata_templ = state.head.sel_fdata_templ < 0 ? NULL :
+            &finder->f_data.templ_history_list[state.head.sel_fdata_templ];
+        finder->f_data_prev = state.prev;
+        finder->set_pga_data_list(std::move(state.pga_data_list));
+        finder->set_pga_above_min_thresh(std::move(state.pga_above_min_thresh));
+        finder->set_rejected_stations(std::move(state.rejected_stations));
+    }
+    if (!status) {
+        for (size_t n = 0; n < out.size(); n++) Finder_Engine::destroy_finder(out[n]);
+        out.clear();
+        return false;
+    }
+    LOGI << "Finder_Snapshot: restored " << out.size() << " finders from " << path << ELL;
+    return true;
+}
+
+}; // end of FiniteFault namespace
+
+// end of file: finder_snapshot.cpp
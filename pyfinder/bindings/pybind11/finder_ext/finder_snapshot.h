@@ -0,0 +1,161 @@
+//
+//      Snapshot and restore of the Finder objects of an engine
+//
+//      A restarted FinDer process has lost its active Finder objects: the solution in f_data and
+//      the one last alerted in f_data_prev, the per-template-set matching history (the
+//      min_ind_*_old indices in templ_history_list), and the PGA, above-threshold and rejected
+//      station lists. It only picks up an event again after new triggers. Finder_Snapshot::save
+//      writes that state for a list of Finders of one engine, with what is needed to set the
+//      engine up again, to one compact file. The file is replaced atomically, so it can be saved
+//      after every update or every few seconds while the processing continues.
+//
+//      open maps a snapshot file and checks it. restore creates the Finders of the snapshot in
+//      an engine with the same configuration and template sets, and hands them their state. A
+//      standby process keeps its engine loaded, so that taking over costs the restore only. A
+//      cold start first calls load_engine, which loads the configuration of the snapshot with
+//      its Template_Store and station mask (Mask_Store), both mapped rather than read and
+//      rebuilt. The template sets themselves are not in the snapshot: Finder objects point into
+//      them, restore maps the recorded set indices back to the sets of the engine.
+//
+//      Layout, native byte order, no padding:
+//          Snapshot_Header
+//          engine section, from engine_offset: config file, template store and mask paths,
+//              Finder_Config_Info, template ids, N_thresh, N_degrees and N_templ of each
+//              template set, stations
+//          per Finder, from finders_offset: Snapshot_Finder, the fparam_list indices, f_data,
+//              f_data_prev and templ_history_list, then pga_data_list, pga_above_min_thresh
+//              and rejected_stations
+//      Counts are uint64_t ahead of their items, strings are counted bytes. The phase-scaled PGA
+//      list is not saved, process derives it from pga_data_list on every update.
+//
+
+#ifndef __finder_snapshot_h__
+#define __finder_snapshot_h__
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../finder_headers/finder.h"
+#include "finder_engine.h"
+
+namespace FiniteFault {
+
+const char SNAPSHOT_MAGIC[8] = { 'F', 'D', 'R', 'S', 'N', 'A', 'P', '1' }; /**< file signature */
+const uint32_t SNAPSHOT_VERSION = 2; /**< format version */
+
+/** Fixed-size head of a snapshot file */
+struct Snapshot_Header {
+    char magic[8]; /**< SNAPSHOT_MAGIC */
+    uint32_t version; /**< SNAPSHOT_VERSION */
+    uint32_t header_bytes; /**< sizeof(Snapshot_Header), guards against layout changes */
+    double timestamp; /**< processing time the snapshot was taken at */
+    uint64_t N_finders; /**< Finder records */
+    uint64_t engine_offset; /**< start of the engine section */
+    uint64_t finders_offset; /**< start of the first Finder record */
+    uint64_t file_bytes; /**< total file size */
+};
+
+/** Fixed-size head of one Finder record */
+struct Snapshot_Finder {
+    uint64_t record_bytes; /**< this head and what follows it up to the next record */
+    int64_t event_id; /**< Finder_Data event id */
+    uint64_t version; /**< Finder::version */
+    int64_t start_time; /**< Finder creation time */
+    int64_t last_message_time; /**< last message time */
+    int64_t hold_time; /**< hold time */
+    uint8_t flags[4]; /**< Finder_Flags event_continue, hold_object, message,
+        first_template_match */
+    uint8_t multiple_objects; /**< Finder_Data multiple_objects */
+    uint8_t event_continue; /**< Finder_Data event_continue */
+    uint8_t reserved[2]; /**< zero */
+    double object_center[2]; /**< Finder_Data object center lat, lon */
+    double origin_time_uncer; /**< Finder_Data origin time uncertainty */
+    double depth; /**< Finder_Data depth */
+    double depth_uncer; /**< Finder_Data depth uncertainty */
+    double maxL_overtime; /**< Finder_Data maximum rupture length */
+    int64_t finder_parameters; /**< template set of Finder_Data::finder_parameters, -1 none */
+    int64_t sel_fdata_templ; /**< templ_history_list entry selected, -1 none */
+};
+
+/** \class Finder_Snapshot
+ * \brief Mapped snapshot of the Finder objects of one engine.
+ * */
+class Finder_Snapshot {
+  public:
+    ~Finder_Snapshot();
+
+    // write the state of finders, which must all be of engine, through a temporary file
+    // renamed over path. A finder in use by another thread is left out, its event id added to
+    // skipped if given. False if a finder is of another engine or the file cannot be written.
+    static bool save(const std::string& path, Finder_Engine& engine,
+        const std::vector<Finder*>& finders, const double timestamp,
+        std::vector<long>* skipped = NULL);
+    // map a snapshot file, NULL if it cannot be read or is not a valid snapshot
+    static std::shared_ptr<Finder_Snapshot> open(const std::string& path);
+
+    const std::string& get_path() const { return path; }
+    double get_timestamp() const { return header->timestamp; }
+    size_t size() const { return records.size(); }
+    size_t get_file_bytes() const { return mapped_bytes; }
+    long get_event_id(const size_t n) const { return records[n].event_id; }
+
+    // the engine the snapshot was taken of
+    const std::string& get_config_file() const { return config_file; }
+    const std::string& get_template_store() const { return template_store; }
+    const std::string& get_mask_path() const { return mask_path; }
+    const Finder_Config_Info& get_config_info() const { return config_info; }
+    const Template_ID_List& get_template_id_list() const { return template_id_list; }
+    const Coordinate_List& get_stations() const { return stations; }
+
+    // Finder_Engine::load with the configuration, template store and stations of the
+    // snapshot, then attach_mask with its mask path
+    bool load_engine(Finder_Engine& engine) const;
+    // engine holds the configuration and template sets the snapshot was taken with
+    bool matches(Finder_Engine& engine) const;
+    // new Finders of engine with the state of the snapshot, in the order saved, to be
+    // destroyed with Finder_Engine::destroy_finder. Nothing is created if one fails.
+    bool restore(Finder_Engine& engine, std::vector<Finder*>& out) const;
+
+  private:
+    Finder_Snapshot() : header(NULL), mapped(NULL), mapped_bytes(0) {}
+    Finder_Snapshot(const Finder_Snapshot&);
+    Finder_Snapshot& operator=(const Finder_Snapshot&);
+
+    bool map(const std::string& path);
+
+    /** Position of one Finder record in the mapping */
+    struct Record_Span {
+        long event_id; /**< event id of the record */
+        size_t offset; /**< start of the Snapshot_Finder */
+        size_t bytes; /**< Snapshot_Finder::record_bytes */
+    };
+
+    /** Dimensions of one template set, which the indices of the records refer to */
+    struct Set_Shape {
+        uint64_t N_thresh; /**< PGA thresholds */
+        uint64_t N_degrees; /**< strike orientations */
+        uint64_t N_templ; /**< templates */
+    };
+
+    std::string path; /**< snapshot file */
+    const Snapshot_Header* header; /**< start of the mapping */
+    void* mapped; /**< mapping returned by mmap */
+    size_t mapped_bytes; /**< length of the mapping */
+    std::vector<Record_Span> records; /**< Finder records in the mapping */
+
+    std::string config_file; /**< engine configuration file */
+    std::string template_store; /**< Template_Store of the generic templates, if any */
+    std::string mask_path; /**< Mask_Store file of the engine, if any */
+    Finder_Config_Info config_info; /**< Finder::Get_finder_config_info of the engine */
+    Template_ID_List template_id_list; /**< Finder::Get_template_id_list of the engine */
+    std::vector<Set_Shape> set_shapes; /**< dimensions of each template set */
+    Coordinate_List stations; /**< stations of the engine */
+}; // class Finder_Snapshot
+
+}; // end of FiniteFault namespace
+
+#endif // __finder_snapshot_h__
+
+// end of file: finder_snapshot.h
@@ -0,0 +1,185 @@
+//
+//      Native continuous curvature gridding with tension
+//
+
+#include <algorithm>
+#include <cmath>
+
+#include "finder_spline.h"
+
+namespace FiniteFault {
+
+const size_t PAD = 2; /**< padding for the 13 point biharmonic stencil */
+const size_t MIN_LEVEL_NODES = 8; /**< coarsest pyramid level has at least this many nodes */
+const float JACOBI_DAMPING = 0.55f; /**< keeps the damped Jacobi sweep stable for 0<=T<=1 */
+
+Tension_Spline::Tension_Spline(const double tension, const size_t max_iterations,
+        const double convergence) : tension(tension), max_iterations(max_iterations),
+        convergence(convergence), iterations(0), aspect(1.) {}
+
+void Tension_Spline::constrain(Level& level, const std::vector<double>& x,
+        const std::vector<double>& y, const std::vector<double>& z, const double x0,
+        const double y0, const double dx, const double dy) const {
+    // average all data falling closest to the same node
+    std::vector<float> count(level.fixed.size(), 0.f);
+    std::fill(level.value.begin(), level.value.end(), 0.f);
+    const double ldx = dx * level.step, ldy = dy * level.step;
+    for (size_t n = 0; n < x.size(); n++) {
+        const long c = lround((x[n] - x0) / ldx);
+        const long r = lround((y[n] - y0) / ldy);
+        if (c < 0 || r < 0 || c >= (long) level.ncols || r >= (long) level.nrows) continue;
+        const size_t ind = (r + PAD) * level.stride + c + PAD;
+        level.value[ind] += z[n];
+        count[ind] += 1.f;
+    }
+    for (size_t ind = 0; ind < count.size(); ind++) {
+        level.fixed[ind] = count[ind] > 0.f ? 1.f : 0.f;
+        if (count[ind] > 0.f) {
+            level.value[ind] /= count[ind];
+            level.u[ind] = level.value[ind];
+        }
+    }
+}
+
+void Tension_Spline::prolong(const Level& coarse, Level& fine) const {
+    // bilinear interpolation, fine node 2k sits on coarse node k
+    for (size_t r = 0; r < fine.nrows; r++) {
+        const size_t r0 = r / 2, r1 = std::min(r0 + (r % 2), coarse.nrows - 1);
+        for (size_t c = 0; c < fine.ncols; c++) {
+            const size_t c0 = c / 2, c1 = std::min(c0 + (c % 2), coarse.ncols - 1);
+            const size_t s = coarse.stride;
+            const float v = 0.25f * (
+                coarse.u[(r0 + PAD) * s + c0 + PAD] + coarse.u[(r0 + PAD) * s + c1 + PAD] +
+                coarse.u[(r1 + PAD) * s + c0 + PAD] + coarse.u[(r1 + PAD) * s + c1 + PAD]);
+            fine.u[(r + PAD) * fine.stride + c + PAD] = v;
+        }
+    }
+}
+
+void Tension_Spline::fill_padding(std::vector<float>& u, const Level& level) const {
+    // replicate the edge nodes into the padding (zero slope across the border)
+    const size_t s = level.stride;
+    for (size_t r = PAD; r < level.nrows + PAD; r++) {
+        float* row = &u[r * s];
+        for (size_t p = 0; p < PAD; p++) {
+            row[p] = row[PAD];
+            row[level.ncols + PAD + p] = row[level.ncols + PAD - 1];
+        }
+    }
+    for (size_t p = 0; p < PAD; p++) {
+        std::copy(&u[PAD * s], &u[PAD * s] + s, &u[p * s]);
+        std::copy(&u[(level.nrows + PAD - 1) * s], &u[(level.nrows + PAD - 1) * s] + s,
+            &u[(level.nrows + PAD + p) * s]);
+    }
+}
+
+float Tension_Spline::sweep(Level& level) const {
+    // the stencil in units of dx: the y differences are weighted by e = (dx/dy)^2, as GMT
+    // surface does for its grid aspect ratio
+    const float T = (float) tension;
+    const float a = 1.f - T;
+    const float e = (float) aspect;
+    const float inv_diag = 1.f / (a * (6.f + 8.f * e + 6.f * e * e) + T * (2.f + 2.f * e));
+    const float wx = a * (4.f + 4.f * e) + T, wy = e * (a * (4.f + 4.f * e) + T);
+    const float wd = 2.f * a * e, wfx = a, wfy = a * e * e;
+    const size_t s = level.stride;
+    float max_change = 0.f;
+
+    fill_padding(level.u, level);
+    for (size_t r = PAD; r < level.nrows + PAD; r++) {
+        const float* um2 = &level.u[(r - 2) * s];
+        const float* um1 = &level.u[(r - 1) * s];
+        const float* u0 = &level.u[r * s];
+        const float* up1 = &level.u[(r + 1) * s];
+        const float* up2 = &level.u[(r + 2) * s];
+        const float* fixed = &level.fixed[r * s];
+        const float* value = &level.value[r * s];
+        float* out = &level.next[r * s];
+        for (size_t c = PAD; c < level.ncols + PAD; c++) {
+            const float sx = u0[c - 1] + u0[c + 1];
+            const float sy = um1[c] + up1[c];
+            const float sd = um1[c - 1] + um1[c + 1] + up1[c - 1] + up1[c + 1];
+            const float sfx = u0[c - 2] + u0[c + 2];
+            const float sfy = um2[c] + up2[c];
+            const float target = (wx * sx + wy * sy - wd * sd - wfx * sfx - wfy * sfy) *
+                inv_diag;
+            const float relaxed = u0[c] + JACOBI_DAMPING * (target - u0[c]);
+            const float result = fixed[c] * value[c] + (1.f - fixed[c]) * relaxed;
+            max_change = std::max(max_change, std::fabs(result - u0[c]));
+            out[c] = result;
+        }
+    }
+    level.u.swap(level.next);
+    return max_change;
+}
+
+void Tension_Spline::relax(Level& level) {
+    for (size_t it = 0; it < max_iterations; it++) {
+        iterations++;
+        if (sweep(level) < convergence) break;
+    }
+}
+
+bool Tension_Spline::solve(const std::vector<double>& x, const std::vector<double>& y,
+        const std::vector<double>& z, const double x0, const double y0, const double dx,
+        const double dy, const size_t ncols, const size_t nrows, float* out) {
+    iterations = 0;
+    if (x.empty() || x.size() != y.size() || x.size() != z.size() || ncols < 2 || nrows < 2 ||
+            !(dx > 0.) || !(dy > 0.)) {
+        return false;
+    }
+    // every level halves dx and dy alike, so they all share the finest aspect ratio
+    aspect = (dx / dy) * (dx / dy);
+
+    // build the pyramid, finest level first
+    std::vector<Level> levels;
+    size_t lrows = nrows, lcols = ncols, step = 1;
+    while (true) {
+        Level level;
+        level.nrows = lrows;
+        level.ncols = lcols;
+        level.stride = lcols + 2 * PAD;
+        level.step = step;
+        const size_t N = (lrows + 2 * PAD) * level.stride;
+        level.u.assign(N, 0.f);
+        level.next.assign(N, 0.f);
+        level.fixed.assign(N, 0.f);
+        level.value.assign(N, 0.f);
+        levels.push_back(level);
+        if (std::min(lrows, lcols) < 2 * MIN_LEVEL_NODES) break;
+        lrows = (lrows - 1) / 2 + 1;
+        lcols = (lcols - 1) / 2 + 1;
+        step *= 2;
+    }
+
+    // coarsest level starts from the data mean
+    double mean = 0.;
+    for (size_t n = 0; n < z.size(); n++) mean += z[n];
+    mean /= z.size();
+
+    for (size_t l = levels.size(); l-- > 0;) {
+        Level& level = levels[l];
+        if (l + 1 == levels.size()) {
+            std::fill(level.u.begin(), level.u.end(), (float) mean);
+        } else {
+            prolong(levels[l + 1], level);
+        }
+        constrain(level, x, y, z, x0, y0, dx, dy);
+        relax(level);
+    }
+
+    const Level& finest = levels[0];
+    bool has_data = false;
+    for (size_t ind = 0; ind < finest.fixed.size() && !has_data; ind++) {
+        has_data = finest.fixed[ind] > 0.f;
+    }
+    for (size_t r = 0; r < nrows; r++) {
+        std::copy(&finest.u[(r + PAD) * finest.stride + PAD],
+            &finest.u[(r + PAD) * finest.stride + PAD] + ncols, out + r * ncols);
+    }
+    return has_data;
+}
+
+}; // end of FiniteFault namespace
+
+// end of file: finder_spline.cpp
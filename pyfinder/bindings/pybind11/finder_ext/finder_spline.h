@@ -0,0 +1,68 @@
+//
+//      Native continuous curvature gridding with tension
+//
+//      Solves (1-T) del^4 u - T del^2 u = 0 on a regular grid with the data nodes held fixed,
+//      which is the equation GMT surface solves (Smith & Wessel, 1990, Geophysics 55, 293-305).
+//      On a grid with dx != dy the y differences are weighted by (dx/dy)^2, as in GMT surface.
+//      The solver runs coarse to fine over a grid pyramid and relaxes each level with damped
+//      Jacobi sweeps over padded, contiguous float rows so that the stencil loop vectorizes.
+//
+
+#ifndef __finder_spline_h__
+#define __finder_spline_h__
+
+#include <cstddef>
+#include <vector>
+
+#include "../finder_headers/finder_globals.h" // TENSION
+
+namespace FiniteFault {
+
+/** \class Tension_Spline
+ * \brief Grids scattered (x, y, z) values onto a regular grid with a tensioned minimum
+ * curvature surface. Output is row-major, row r at y0 + r*dy and column c at x0 + c*dx.
+ * */
+class Tension_Spline {
+  public:
+    Tension_Spline(const double tension = TENSION, const size_t max_iterations = 250,
+        const double convergence = 1.0e-4);
+
+    double get_tension() const { return tension; }
+    size_t get_iterations() const { return iterations; }
+
+    bool solve(const std::vector<double>& x, const std::vector<double>& y,
+        const std::vector<double>& z, const double x0, const double y0, const double dx,
+        const double dy, const size_t ncols, const size_t nrows, float* out);
+
+  private:
+    /** one level of the grid pyramid, padded by PAD nodes on each side */
+    struct Level {
+        size_t nrows, ncols; /**< unpadded grid size */
+        size_t stride; /**< padded row length */
+        size_t step; /**< node spacing in units of the finest grid */
+        std::vector<float> u; /**< current surface */
+        std::vector<float> next; /**< surface after the next sweep */
+        std::vector<float> fixed; /**< 1 at data nodes, 0 elsewhere */
+        std::vector<float> value; /**< data value at data nodes */
+    };
+
+    void constrain(Level& level, const std::vector<double>& x, const std::vector<double>& y,
+        const std::vector<double>& z, const double x0, const double y0, const double dx,
+        const double dy) const;
+    void prolong(const Level& coarse, Level& fine) const;
+    void fill_padding(std::vector<float>& u, const Level& level) const;
+    float sweep(Level& level) const;
+    void relax(Level& level);
+
+    double tension; /**< tension factor, 0 = minimum curvature, 1 = harmonic */
+    size_t max_iterations; /**< maximum Jacobi sweeps per level */
+    double convergence; /**< stop a level when no node moves by more than this */
+    size_t iterations; /**< total sweeps used by the last solve */
+    double aspect; /**< (dx/dy)^2 of the current solve */
+}; // class Tension_Spline
+
+}; // end of FiniteFault namespace
+
+#endif // __finder_spline_h__
+
+// end of file: finder_spline.h
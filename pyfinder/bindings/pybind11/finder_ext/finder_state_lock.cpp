@@ -0,0 +1,136 @@
+//
+//      Guards for running FinDer from several threads
+//
+
+#include <cassert>
+#include <condition_variable>
+#include <mutex>
+#include <unordered_set>
+
+#include "finder_engine.h"
+#include "finder_state_lock.h"
+
+namespace FiniteFault {
+
+namespace {
+    struct State {
+        State() : readers(0), writer(false), waiting_writers(0), active(NULL), pending(NULL) {}
+
+        std::mutex lock;
+        std::condition_variable changed;
+        size_t readers; /**< shared holders, all of the active engine */
+        bool writer; /**< an exclusive holder is in */
+        size_t waiting_writers; /**< exclusive lockers waiting, they go before new readers */
+        Finder_Engine* active; /**< engine whose state is in the Finder statics */
+        Finder_Engine* pending; /**< engine waiting for the readers of the active one to drain */
+
+        Finder_Engine* get_active() {
+            if (active == NULL) active = &Finder_Engine::get_default();
+            return active;
+        }
+    };
+
+    State& state() {
+        static State s;
+        return s;
+    }
+
+    // Finder_State_Locks held by this thread, at most one
+    thread_local size_t held_state_locks = 0;
+
+    std::mutex& temp_files_mutex() {
+        static std::mutex lock;
+        return lock;
+    }
+
+    std::mutex& claims_lock() {
+        static std::mutex lock;
+        return lock;
+    }
+
+    std::unordered_set<const void*>& claims() {
+        static std::unordered_set<const void*> objects;
+        return objects;
+    }
+}
+
+Finder_State_Lock::Finder_State_Lock(const Mode mode, Finder_Engine* engine) : mode(mode) {
+    assert(held_state_locks == 0 && "Finder_State_Lock is not reentrant");
+    held_state_locks++;
+    State& s = state();
+    std::unique_lock<std::mutex> lk(s.lock);
+    if (mode == EXCLUSIVE) {
+        s.waiting_writers++;
+        s.changed.wait(lk, [&s]() { return !s.writer && s.readers == 0; });
+        s.waiting_writers--;
+        s.writer = true;
+        if (engine != NULL) activate(engine);
+        return;
+    }
+
+    if (engine == NULL) engine = &Finder_Engine::get_default();
+    s.changed.wait(lk, [&s, engine]() {
+        if (s.writer || s.waiting_writers > 0) return false;
+        if (s.get_active() == engine) return s.pending == NULL || s.pending == engine;
+        if (s.readers == 0) return true;
+        // queue this engine for the next switch, readers of the active one wait behind it
+        if (s.pending == NULL) s.pending = engine;
+        return false;
+    });
+    activate(engine);
+    if (s.pending == engine) s.pending = NULL;
+    s.readers++;
+}
+
+void Finder_State_Lock::activate(Finder_Engine* engine) {
+    State& s = state();
+    Finder_Engine* current = s.get_active();
+    if (engine == current) return;
+    // the statics go back to the current engine, then take the state of the new one
+    current->swap_state();
+    engine->swap_state();
+    s.active = engine;
+}
+
+Finder_State_Lock::~Finder_State_Lock() {
+    held_state_locks--;
+    State& s = state();
+    {
+        std::lock_guard<std::mutex> lk(s.lock);
+        if (mode == EXCLUSIVE) s.writer = false;
+        else s.readers--;
+    }
+    s.changed.notify_all();
+}
+
+size_t Finder_State_Lock::get_readers() {
+    State& s = state();
+    std::lock_guard<std::mutex> lk(s.lock);
+    return s.readers;
+}
+
+const Finder_Engine* Finder_State_Lock::get_active() {
+    State& s = state();
+    std::lock_guard<std::mutex> lk(s.lock);
+    return s.get_active();
+}
+
+Object_Claim::Object_Claim(const void* object) : object(NULL) {
+    std::lock_guard<std::mutex> lk(claims_lock());
+    if (claims().insert(object).second) {
+        this->object = object;
+    }
+}
+
+Object_Claim::~Object_Claim() {
+    if (object == NULL) return;
+    std::lock_guard<std::mutex> lk(claims_lock());
+    claims().erase(object);
+}
+
+Temp_Files_Lock::Temp_Files_Lock() : lock(temp_files_mutex()) {
+}
+
+}; // end of FiniteFault namespace
+
+// end of file: finder_state_lock.cpp
@@ -0,0 +1,108 @@
+//
+//      Guards for running FinDer from several threads
+//
+//      Finder::Init fills the static state of the library: the configuration (Finder_config), the
+//      template sets (Finder_parameters, Finder_parameters_list, Templates, Templates_list) and the
+//      station mask. The bindings add the rotated template cache and the worker pool. After Init
+//      this state is only read: Finder objects keep pointers into Finder_parameters_list, and
+//      process, Scan_Data and Associate_Time read the configuration and templates. So any number
+//      of these calls can run at once, but none of them while Init replaces the state.
+//
+//      The bindings release the GIL around these calls. Finder_State_Lock is taken SHARED by
+//      the readers and EXCLUSIVE by Init and set_worker_threads, which wait for running solves to
+//      finish. Each lock names the Finder_Engine whose state it needs in the statics. Readers of
+//      the active engine share it, and a reader of another engine waits for them to drain before
+//      switching. Readers of the active engine that arrive later queue behind it, so each engine
+//      gets its turn. Objects are not protected by this lock: a Finder and the PGA_Data_List
+//      passed to its process call belong to one thread at a time, which Object_Claim checks.
+//
+//      Sharing the state does not make the solves independent: gmtImage, prepImage and
+//      writeRuptureFile of libFinder write and read back fixed files under TEMP_DIR (padded data,
+//      grids, rupture) on every Finder::process and Scan_Data, and so does the file backend of
+//      Image_Gridder. Temp_Files_Lock serialises these calls process-wide. It is taken after the
+//      Finder_State_Lock, never before. The file names are constants compiled into libFinder,
+//      relative to the working directory of the process, so they cannot be given a directory
+//      per engine or per thread from here: solves of different Finders run one at a time, and
+//      what runs meanwhile is the Python code and the calls that do not go through the files.
+//
+//      Neither lock is reentrant. A thread holding a Finder_State_Lock must not take another one,
+//      shared or exclusive: a waiting exclusive locker blocks new readers, so the second lock
+//      waits for the first. Debug builds assert this.
+//
+
+#ifndef __finder_state_lock_h__
+#define __finder_state_lock_h__
+
+#include <cstddef>
+#include <mutex>
+
+namespace FiniteFault {
+
+class Finder_Engine;
+
+/** \class Finder_State_Lock
+ * \brief Scoped lock on the static state of the FinDer library, shared by the calls that
+ * read it and exclusive for the ones that replace it, with the state of engine swapped in.
+ * */
+class Finder_State_Lock {
+  public:
+    enum Mode { SHARED, EXCLUSIVE };
+
+    // engine NULL is the default engine for SHARED, and keeps the active one for EXCLUSIVE
+    explicit Finder_State_Lock(const Mode mode = SHARED, Finder_Engine* engine = NULL);
+    ~Finder_State_Lock();
+
+    // calls holding the state lock in shared mode right now
+    static size_t get_readers();
+    // engine whose state is in the Finder statics
+    static const Finder_Engine* get_active();
+
+  private:
+    Finder_State_Lock(const Finder_State_Lock&);
+    Finder_State_Lock& operator=(const Finder_State_Lock&);
+
+    // swap the state of engine into the Finder statics, with the state lock held
+    static void activate(Finder_Engine* engine);
+
+    Mode mode; /**< how the lock is held */
+}; // class Finder_State_Lock
+
+/** \class Object_Claim
+ * \brief Marks an object as in use by the calling thread for the lifetime of the claim. A
+ * second claim on the same object from any thread fails instead of waiting.
+ * */
+class Object_Claim {
+  public:
+    explicit Object_Claim(const void* object);
+    ~Object_Claim();
+
+    // false if another claim on the object is alive
+    bool claimed() const { return object != NULL; }
+
+  private:
+    Object_Claim(const Object_Claim&);
+    Object_Claim& operator=(const Object_Claim&);
+
+    const void* object; /**< claimed object, NULL if the claim failed */
+}; // class Object_Claim
+
+/** \class Temp_Files_Lock
+ * \brief Scoped process-wide lock held by the calls that go through the fixed TEMP_DIR files.
+ * */
+class Temp_Files_Lock {
+  public:
+    Temp_Files_Lock();
+    ~Temp_Files_Lock() {}
+
+  private:
+    Temp_Files_Lock(const Temp_Files_Lock&);
+    Temp_Files_Lock& operator=(const Temp_Files_Lock&);
+
+    std::unique_lock<std::mutex> lock; /**< on the process-wide mutex */
+}; // class Temp_Files_Lock
+
+}; // end of FiniteFault namespace
+
+#endif // __finder_state_lock_h__
+
+// end of file: finder_state_lock.h
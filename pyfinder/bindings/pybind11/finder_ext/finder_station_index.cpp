@@ -0,0 +1,220 @@
+//
+//      Spatial index over station coordinates
+//
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "finder_station_index.h"
+
+namespace FiniteFault {
+
+namespace {
+    // lower bound of the km per degree of arc over the Earth's radii, so that the cell ranges
+    // of a query cover at least what dist_deg2km finds within its radius
+    const double MIN_KM_PER_DEG = 110.0;
+    // half the circumference, beyond which a radius covers every station
+    const double MAX_DISTANCE_KM = 20100.0;
+    const size_t NO_MEMBER = (size_t) -1;
+
+    size_t find_root(std::vector<size_t>& parent, size_t m) {
+        while (parent[m] != m) {
+            parent[m] = parent[parent[m]];
+            m = parent[m];
+        }
+        return m;
+    }
+}
+
+void Station_Index::build(const Coordinate_List& stations, const double cell_km) {
+    std::vector<double> lats(stations.size()), lons(stations.size());
+    for (size_t n = 0; n < stations.size(); n++) {
+        lats[n] = stations[n].get_lat();
+        lons[n] = stations[n].get_lon();
+    }
+    assign(lats, lons, cell_km);
+}
+
+void Station_Index::build(const PGA_Data_List& stations, const double cell_km) {
+    std::vector<double> lats(stations.size()), lons(stations.size());
+    for (size_t n = 0; n < stations.size(); n++) {
+        const Coordinate location = stations[n].get_location();
+        lats[n] = location.get_lat();
+        lons[n] = location.get_lon();
+    }
+    assign(lats, lons, cell_km);
+}
+
+void Station_Index::build(const std::vector<double>& lats, const std::vector<double>& lons,
+        const double cell_km) {
+    std::vector<double> lat_copy(lats), lon_copy(lons);
+    lon_copy.resize(lat_copy.size(), 0.);
+    assign(lat_copy, lon_copy, cell_km);
+}
+
+void Station_Index::clear() {
+    cell_deg = min_lat = min_lon = 0.;
+    n_lat = n_lon = 0;
+    lat.clear();
+    lon.clear();
+    cell_begin.clear();
+    cell_stations.clear();
+    cell_points.clear();
+}
+
+void Station_Index::assign(std::vector<double>& lats, std::vector<double>& lons,
+        const double cell_km) {
+    clear();
+    lat.swap(lats);
+    lon.swap(lons);
+    if (lat.empty()) return;
+
+    min_lat = *std::min_element(lat.begin(), lat.end());
+    min_lon = *std::min_element(lon.begin(), lon.end());
+    const double span_lat = *std::max_element(lat.begin(), lat.end()) - min_lat;
+    const double span_lon = *std::max_element(lon.begin(), lon.end()) - min_lon;
+    // coarser cells for sparse networks over a large area, the grid stays O(N)
+    const size_t max_cells = std::max((size_t) 1024, 4 * lat.size());
+    cell_deg = std::max(cell_km, 1e-3) / MIN_KM_PER_DEG;
+    for (;;) {
+        n_lat = (size_t) std::floor(span_lat / cell_deg) + 1;
+        n_lon = (size_t) std::floor(span_lon / cell_deg) + 1;
+        if (n_lat * n_lon <= max_cells) break;
+        cell_deg *= 2.;
+    }
+
+    // counting sort of the stations by cell
+    std::vector<size_t> cell_of(lat.size());
+    cell_begin.assign(n_lat * n_lon + 1, 0);
+    for (size_t n = 0; n < lat.size(); n++) {
+        const size_t r = std::min(n_lat - 1, (size_t) ((lat[n] - min_lat) / cell_deg));
+        const size_t c = std::min(n_lon - 1, (size_t) ((lon[n] - min_lon) / cell_deg));
+        cell_of[n] = r * n_lon + c;
+        cell_begin[cell_of[n] + 1]++;
+    }
+    for (size_t c = 0; c < n_lat * n_lon; c++) cell_begin[c + 1] += cell_begin[c];
+    cell_stations.resize(lat.size());
+    std::vector<size_t> fill(cell_begin.begin(), cell_begin.end() - 1);
+    for (size_t n = 0; n < lat.size(); n++) cell_stations[fill[cell_of[n]]++] = n;
+    cell_points.reserve(lat.size());
+    for (size_t e = 0; e < lat.size(); e++) {
+        cell_points.push_back(lat[cell_stations[e]], lon[cell_stations[e]]);
+    }
+}
+
+template <typename Fn>
+void Station_Index::for_candidates(const double qlat, const double qlon, const double radius_km,
+        Fn fn) const {
+    if (lat.empty() || radius_km < 0.) return;
+    const double dlat = std::min(radius_km, MAX_DISTANCE_KM) / MIN_KM_PER_DEG;
+    const double lat0 = qlat - dlat, lat1 = qlat + dlat;
+    if (lat1 < min_lat || lat0 > min_lat + n_lat * cell_deg) return;
+    const size_t r0 = lat0 <= min_lat ? 0 : (size_t) ((lat0 - min_lat) / cell_deg);
+    const size_t r1 = std::min(n_lat - 1, (size_t) ((std::max(lat1, min_lat) - min_lat) / cell_deg));
+
+    // longitudes within the radius on the sphere: sin(dlon) <= sin(arc) / cos(lat)
+    bool all_lon = std::fabs(qlat) + dlat >= 90. || dlat >= 90.;
+    double dlon = 180.;
+    if (!all_lon) {
+        const double s = std::sin(dlat * M_PI / 180.) / std::cos(qlat * M_PI / 180.);
+        if (s >= 1.) all_lon = true;
+        else dlon = std::asin(s) * 180. / M_PI;
+    }
+
+    // the longitude window, and its copies one turn east and west for the antimeridian. The
+    // cells c0..c1 of a row are contiguous in cell_stations, one kernel call measures them.
+    std::vector<double> distances;
+    const double shifts[3] = { 0., -360., 360. };
+    for (int s = 0; s < (all_lon ? 1 : 3); s++) {
+        size_t c0 = 0, c1 = n_lon - 1;
+        if (!all_lon) {
+            const double lon0 = qlon + shifts[s] - dlon, lon1 = qlon + shifts[s] + dlon;
+            if (lon1 < min_lon || lon0 > min_lon + n_lon * cell_deg) continue;
+            c0 = lon0 <= min_lon ? 0 : (size_t) ((lon0 - min_lon) / cell_deg);
+            c1 = std::min(n_lon - 1, (size_t) ((std::max(lon1, min_lon) - min_lon) / cell_deg));
+        }
+        for (size_t r = r0; r <= r1; r++) {
+            const size_t begin = cell_begin[r * n_lon + c0], end = cell_begin[r * n_lon + c1 + 1];
+            if (begin == end) continue;
+            distances.resize(end - begin);
+            distances_km(qlat, qlon, cell_points, &distances[0], begin, end);
+            for (size_t e = begin; e < end; e++) fn(e, distances[e - begin]);
+        }
+    }
+}
+
+void Station_Index::within(const double qlat, const double qlon, const double radius_km,
+        std::vector<size_t>& out) const {
+    out.clear();
+    for_candidates(qlat, qlon, radius_km, [&](const size_t e, const double d) {
+        if (d <= radius_km) out.push_back(cell_stations[e]);
+    });
+    std::sort(out.begin(), out.end());
+}
+
+void Station_Index::nearest(const double qlat, const double qlon, const size_t k,
+        const double max_km, std::vector<size_t>& out, const size_t exclude) const {
+    out.clear();
+    if (k == 0 || lat.empty()) return;
+    const double limit = std::min(max_km, MAX_DISTANCE_KM);
+    std::vector<std::pair<double, size_t> > found;
+    // grow the radius until it holds k stations, the k closest are then all inside it
+    double radius = std::min(limit, cell_deg * MIN_KM_PER_DEG);
+    for (;;) {
+        found.clear();
+        for_candidates(qlat, qlon, radius, [&](const size_t e, const double d) {
+            const size_t n = cell_stations[e];
+            if (n != exclude && d <= radius) found.push_back(std::make_pair(d, n));
+        });
+        if (found.size() >= k || radius >= limit) break;
+        radius = std::min(limit, 2. * radius);
+    }
+    const size_t n_out = std::min(k, found.size());
+    std::partial_sort(found.begin(), found.begin() + n_out, found.end());
+    for (size_t m = 0; m < n_out; m++) out.push_back(found[m].second);
+}
+
+size_t Station_Index::connected_groups(const std::vector<size_t>& members,
+        const double radius_km, std::vector<size_t>& labels) const {
+    labels.assign(members.size(), 0);
+    if (members.empty()) return 0;
+    std::vector<size_t> member_of(lat.size(), NO_MEMBER);
+    for (size_t m = 0; m < members.size(); m++) member_of[members[m]] = m;
+
+    std::vector<size_t> parent(members.size());
+    for (size_t m = 0; m < members.size(); m++) parent[m] = m;
+    for (size_t m = 0; m < members.size(); m++) {
+        const size_t n = members[m];
+        for_candidates(lat[n], lon[n], radius_km, [&](const size_t e, const double d) {
+            const size_t o = member_of[cell_stations[e]];
+            if (o == NO_MEMBER || o == m || d > radius_km) return;
+            const size_t a = find_root(parent, m), b = find_root(parent, o);
+            if (a != b) parent[std::max(a, b)] = std::min(a, b);
+        });
+    }
+
+    // number the groups by their first member
+    std::vector<size_t> group_of_root(members.size(), NO_MEMBER);
+    size_t n_groups = 0;
+    for (size_t m = 0; m < members.size(); m++) {
+        const size_t root = find_root(parent, m);
+        if (group_of_root[root] == NO_MEMBER) group_of_root[root] = n_groups++;
+        labels[m] = group_of_root[root];
+    }
+    return n_groups;
+}
+
+size_t Station_Index::largest_group(const std::vector<size_t>& members,
+        const double radius_km) const {
+    std::vector<size_t> labels;
+    const size_t n_groups = connected_groups(members, radius_km, labels);
+    std::vector<size_t> sizes(n_groups, 0);
+    size_t largest = 0;
+    for (size_t m = 0; m < labels.size(); m++) largest = std::max(largest, ++sizes[labels[m]]);
+    return largest;
+}
+
+}; // end of FiniteFault namespace
+
+// end of file: finder_station_index.cpp
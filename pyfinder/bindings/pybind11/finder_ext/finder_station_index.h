@@ -0,0 +1,89 @@
+//
+//      Spatial index over station coordinates
+//
+//      Noisy station removal, trigger association and the station connection checks ask for the
+//      stations near a point: within trigger_radius, the DEFAULT_NUM_NEIGHBORS closest within
+//      DEFAULT_MIN_RATIO_DIST, or all pairs closer than a radius. Scanning the whole list with
+//      dist_deg2km for every station is O(N^2) per update. For dense networks this takes most
+//      of the quiet time CPU. Station_Index buckets the stations on a lat/lon grid once, when
+//      the station list is set at Init. A query then only measures the stations of the cells
+//      its radius touches, and stays exact because the candidates are measured as dist_deg2km
+//      measures them. The stations are also kept in cell order as Geo_Points, so that the cells
+//      of one grid row are a contiguous span the batch distance kernel measures in one call.
+//
+
+#ifndef __finder_station_index_h__
+#define __finder_station_index_h__
+
+#include <cstddef>
+#include <vector>
+
+#include "../finder_headers/finite_fault.h"
+#include "finder_geodesy.h"
+
+namespace FiniteFault {
+
+const double STATION_INDEX_CELL_KM = 20.0; /**< default grid cell size, about the usual
+    neighbour and trigger distances */
+
+/** \class Station_Index
+ * \brief Uniform lat/lon grid of station indices for radius, nearest neighbour and connected
+ * group queries.
+ * */
+class Station_Index {
+  public:
+    Station_Index() : cell_deg(0.), min_lat(0.), min_lon(0.), n_lat(0), n_lon(0) {}
+
+    // index the stations in list order, on cells of about cell_km
+    void build(const Coordinate_List& stations, const double cell_km = STATION_INDEX_CELL_KM);
+    void build(const PGA_Data_List& stations, const double cell_km = STATION_INDEX_CELL_KM);
+    // any points given as coordinate arrays, e.g. the points of a mask
+    void build(const std::vector<double>& lats, const std::vector<double>& lons,
+        const double cell_km = STATION_INDEX_CELL_KM);
+    void clear();
+
+    size_t size() const { return lat.size(); }
+    bool empty() const { return lat.empty(); }
+    double get_lat(size_t n) const { return lat[n]; }
+    double get_lon(size_t n) const { return lon[n]; }
+    size_t get_cells() const { return n_lat * n_lon; }
+
+    // stations within radius_km of (qlat, qlon), in index order
+    void within(const double qlat, const double qlon, const double radius_km,
+        std::vector<size_t>& out) const;
+    // up to k stations closest to (qlat, qlon) within max_km, closest first; exclude is left
+    // out, e.g. the station the query is about
+    void nearest(const double qlat, const double qlon, const size_t k, const double max_km,
+        std::vector<size_t>& out, const size_t exclude = (size_t) -1) const;
+    // groups of members linked by hops of at most radius_km; labels[m] is the group of
+    // members[m], groups are numbered from 0 in order of first member. Returns the group count.
+    size_t connected_groups(const std::vector<size_t>& members, const double radius_km,
+        std::vector<size_t>& labels) const;
+    // size of the largest connected group of members
+    size_t largest_group(const std::vector<size_t>& members, const double radius_km) const;
+
+  private:
+    void assign(std::vector<double>& lats, std::vector<double>& lons, const double cell_km);
+    // call fn(e, d) for each entry e of cell_stations in the cells the radius around
+    // (qlat, qlon) touches, with d its distance in km
+    template <typename Fn>
+    void for_candidates(const double qlat, const double qlon, const double radius_km,
+        Fn fn) const;
+
+    double cell_deg; /**< cell size in degrees of latitude and longitude */
+    double min_lat; /**< latitude of the first cell row */
+    double min_lon; /**< longitude of the first cell column */
+    size_t n_lat; /**< cell rows */
+    size_t n_lon; /**< cell columns */
+    std::vector<double> lat; /**< station latitudes */
+    std::vector<double> lon; /**< station longitudes */
+    std::vector<size_t> cell_begin; /**< first entry of cell c in cell_stations, n_cells + 1 */
+    std::vector<size_t> cell_stations; /**< station indices grouped by cell */
+    Geo_Points cell_points; /**< station coordinates in cell_stations order */
+}; // class Station_Index
+
+}; // end of FiniteFault namespace
+
+#endif // __finder_station_index_h__
+
+// end of file: finder_station_index.h
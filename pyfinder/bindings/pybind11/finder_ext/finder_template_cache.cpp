@@ -0,0 +1,177 @@
+//
+//      Cache of rotated and resized FinDer templates
+//
+
+#include <algorithm>
+#include <cmath>
+
+#include "finder_template_cache.h"
+#include "../finder_headers/finder_globals.h" // logging macros
+
+namespace FiniteFault {
+
+namespace {
+    std::mutex registry_lock;
+    std::map<std::pair<const Finder_Parameters*, double>,
+        std::shared_ptr<const Template_Cache> > registry;
+}
+
+void rotate_template(const cv::Mat& src, cv::Mat& dst, const double degrees) {
+    if (std::fmod(degrees, 360.) == 0.) {
+        src.copyTo(dst);
+        return;
+    }
+    // image rows run south to north, so a positive OpenCV angle is a clockwise strike
+    const cv::Point2f center((src.cols - 1) / 2.f, (src.rows - 1) / 2.f);
+    cv::Mat rot = cv::getRotationMatrix2D(center, degrees, 1.0);
+    const double c = std::fabs(std::cos(degrees * M_PI / 180.));
+    const double s = std::fabs(std::sin(degrees * M_PI / 180.));
+    // the tolerance keeps right angles from growing the box by a pixel
+    const int cols = (int) std::ceil(src.cols * c + src.rows * s - 1e-6);
+    const int rows = (int) std::ceil(src.cols * s + src.rows * c - 1e-6);
+    rot.at<double>(0, 2) += (cols - 1) / 2.0 - center.x;
+    rot.at<double>(1, 2) += (rows - 1) / 2.0 - center.y;
+    // nearest neighbour keeps the template binary
+    cv::warpAffine(src, dst, rot, cv::Size(cols, rows), INTER_NEAREST, BORDER_CONSTANT,
+        Scalar(0));
+}
+
+bool Template_Cache::build(const Finder_Parameters& finder_parameters,
+        const double resize_fraction, Worker_Pool& pool) {
+    if (finder_parameters.N_thresh == 0 || finder_parameters.N_templ == 0 ||
+            finder_parameters.templates.size() <
+            finder_parameters.N_thresh * finder_parameters.N_templ) {
+        LOGE << "Template_Cache: no templates loaded for " << finder_parameters.name << ELL;
+        return false;
+    }
+    // Mat headers only, the pixels stay with Finder_Parameters::templates
+    std::vector<std::vector<cv::Mat> > templates(finder_parameters.N_thresh);
+    for (size_t i = 0; i < finder_parameters.N_thresh; i++) {
+        for (size_t k = 0; k < finder_parameters.N_templ; k++) {
+            templates[i].push_back(finder_parameters.templates(i, k));
+        }
+    }
+    const std::vector<double> degrees(finder_parameters.degrees.begin(),
+        finder_parameters.degrees.begin() + std::min(finder_parameters.N_degrees,
+        finder_parameters.degrees.size()));
+    if (!build(templates, degrees, resize_fraction, pool)) return false;
+    LOGD << "Template_Cache: " << finder_parameters.name << " cached " <<
+        N_thresh * N_degrees * N_templ << " rotated templates, " << memory_bytes() / 1048576 <<
+        " MB" << ELL;
+    return true;
+}
+
+bool Template_Cache::build(const std::vector<std::vector<cv::Mat> >& templates,
+        const std::vector<double>& degrees, const double resize_fraction, Worker_Pool& pool) {
+    N_thresh = templates.size();
+    N_degrees = degrees.size();
+    N_templ = (N_thresh > 0) ? templates[0].size() : 0;
+    this->resize_fraction = resize_fraction;
+    for (size_t i = 0; i < N_thresh; i++) {
+        if (templates[i].size() != N_templ) N_templ = 0;
+    }
+    if (N_thresh == 0 || N_degrees == 0 || N_templ == 0 || resize_fraction <= 0.) {
+        N_templ = 0;
+        return false;
+    }
+    rotated = vector3d<cv::Mat>(N_thresh, N_degrees, N_templ);
+    footprints = std::make_shared<Footprint_Table>();
+    footprints->reset(N_thresh, degrees, N_templ, resize_fraction);
+    bits = vector3d<Bit_Template>(N_thresh, N_degrees, N_templ);
+
+    // every (threshold, template) source rotated to every strike
+    pool.parallel_for(0, N_thresh * N_templ, [&](size_t n) {
+        const size_t i = n / N_templ, k = n % N_templ;
+        cv::Mat binary;
+        if (!templates[i][k].empty()) {
+            cv::compare(templates[i][k], 0, binary, CMP_GT);
+            binary &= Scalar(1);
+        }
+        for (size_t j = 0; j < N_degrees; j++) {
+            cv::Mat& dst = rotated(i, j, k);
+            if (binary.empty()) continue;
+            rotate_template(binary, dst, degrees[j]);
+            if (resize_fraction != 1.) {
+                cv::resize(dst, dst, cv::Size(), resize_fraction, resize_fraction,
+                    INTER_NEAREST);
+            }
+            footprints->set(i, j, k, measure_footprint(dst));
+            bits(i, j, k) = Bit_Template(dst);
+            if (!keep_pixels) dst.release();
+        }
+    });
+
+    max_rows = 0;
+    max_cols = 0;
+    max_words = 0;
+    for (size_t i = 0; i < N_thresh; i++) {
+        for (size_t j = 0; j < N_degrees; j++) {
+            for (size_t k = 0; k < N_templ; k++) {
+                max_rows = std::max(max_rows, (size_t) bits(i, j, k).get_rows());
+                max_cols = std::max(max_cols, (size_t) bits(i, j, k).get_cols());
+                max_words = std::max(max_words, bits(i, j, k).get_words());
+            }
+        }
+    }
+    return true;
+}
+
+size_t Template_Cache::memory_bytes() const {
+    size_t bytes = 0;
+    for (size_t i = 0; i < N_thresh; i++) {
+        for (size_t j = 0; j < N_degrees; j++) {
+            for (size_t k = 0; k < N_templ; k++) {
+                const cv::Mat& m = rotated(i, j, k);
+                bytes += m.total() * m.elemSize() + bits(i, j, k).memory_bytes();
+            }
+        }
+    }
+    return bytes;
+}
+
+size_t Template_Cache::bits_memory_bytes() const {
+    size_t bytes = 0;
+    for (size_t i = 0; i < N_thresh; i++) {
+        for (size_t j = 0; j < N_degrees; j++) {
+            for (size_t k = 0; k < N_templ; k++) {
+                bytes += bits(i, j, k).memory_bytes();
+            }
+        }
+    }
+    return bytes;
+}
+
+const cv::Mat& Template_Cache::get_pixels(size_t i, size_t j, size_t k, cv::Mat& scratch) const {
+    if (keep_pixels) return rotated(i, j, k);
+    scratch = bits(i, j, k).unpack();
+    return scratch;
+}
+
+std::shared_ptr<const Template_Cache> Template_Cache::for_parameters(
+        const Finder_Parameters* finder_parameters, const double resize_fraction) {
+    const std::pair<const Finder_Parameters*, double> key(finder_parameters, resize_fraction);
+    {
+        std::lock_guard<std::mutex> lk(registry_lock);
+        std::map<std::pair<const Finder_Parameters*, double>,
+            std::shared_ptr<const Template_Cache> >::const_iterator it = registry.find(key);
+        if (it != registry.end()) return it->second;
+    }
+    // build outside the lock, the build itself runs on the pool
+    std::shared_ptr<Template_Cache> cache(new Template_Cache());
+    // not registered, the next call tries again, e.g. after the templates are loaded
+    if (!cache->build(*finder_parameters, resize_fraction)) {
+        return std::shared_ptr<const Template_Cache>();
+    }
+    std::lock_guard<std::mutex> lk(registry_lock);
+    // another thread may have built the same set meanwhile, keep the first one
+    return registry.insert(std::make_pair(key, cache)).first->second;
+}
+
+void Template_Cache::clear_all() {
+    std::lock_guard<std::mutex> lk(registry_lock);
+    registry.clear();
+}
+
+}; // end of FiniteFault namespace
+
+// end of file: finder_template_cache.cpp
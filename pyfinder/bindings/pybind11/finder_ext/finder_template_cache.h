@@ -0,0 +1,105 @@
+//
+//      Cache of rotated and resized FinDer templates
+//
+//      Template_Match::rotation_template_match rotates every template for every strike in
+//      Finder_Parameters::degrees, at every PGA threshold and every timestep. The templates do
+//      not change after Finder_Parameters::load_templates, so the cache rotates (and resizes by
+//      resize_fraction) each of them once and keeps the results for the lifetime of the set.
+//      Every rotated template is also kept bit-packed; a cache built without pixels keeps only
+//      that, at close to 1/8 of the memory. The footprints of the rotated templates are
+//      measured on the way, see Footprint_Table.
+//
+
+#ifndef __finder_template_cache_h__
+#define __finder_template_cache_h__
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../finder_headers/finder_parameters.h"
+#include "finder_bitmatch.h"
+#include "finder_template_footprints.h"
+#include "finder_worker_pool.h"
+
+namespace FiniteFault {
+
+// rotate a binary template clockwise by degrees (strike) into an enlarged bounding box
+void rotate_template(const cv::Mat& src, cv::Mat& dst, const double degrees);
+
+/** \class Template_Cache
+ * \brief Pre-rotated, pre-resized binary templates of one template set, indexed by
+ * (PGA threshold i, strike j, template k) like Template_Match::minVal_all.
+ *
+ * The source template for (i, k) is Finder_Parameters::templates(i, k), the template of
+ * length index k thresholded at log10_thresh[i]. Cached templates are CV_8U with values 0/1.
+ * */
+class Template_Cache {
+  public:
+    Template_Cache() : N_thresh(0), N_degrees(0), N_templ(0), resize_fraction(1.),
+        max_rows(0), max_cols(0), max_words(0), keep_pixels(true),
+        footprints(std::make_shared<Footprint_Table>()) {}
+
+    // keep the CV_8U templates next to the bit-packed ones, applies to the next build
+    void set_keep_pixels(const bool keep) { keep_pixels = keep; }
+    bool has_pixels() const { return keep_pixels; }
+
+    // rotate and resize all templates of a set, spread over the pool
+    bool build(const Finder_Parameters& finder_parameters, const double resize_fraction,
+        Worker_Pool& pool = *Worker_Pool::instance());
+    // same from templates[i][k] (PGA threshold i, template k) and the strikes to test
+    bool build(const std::vector<std::vector<cv::Mat> >& templates,
+        const std::vector<double>& degrees, const double resize_fraction,
+        Worker_Pool& pool = *Worker_Pool::instance());
+
+    bool empty() const { return N_templ == 0; }
+    size_t get_N_thresh() const { return N_thresh; }
+    size_t get_N_degrees() const { return N_degrees; }
+    size_t get_N_templ() const { return N_templ; }
+    double get_resize_fraction() const { return resize_fraction; }
+    size_t get_max_rows() const { return max_rows; }
+    size_t get_max_cols() const { return max_cols; }
+    size_t get_max_words() const { return max_words; }
+
+    // CV_8U template, empty if the cache was built without pixels
+    const cv::Mat& get(size_t i, size_t j, size_t k) const { return rotated(i, j, k); }
+    const Bit_Template& get_bits(size_t i, size_t j, size_t k) const { return bits(i, j, k); }
+    // the CV_8U template, unpacked into scratch if the cache holds no pixels
+    const cv::Mat& get_pixels(size_t i, size_t j, size_t k, cv::Mat& scratch) const;
+    int get_rows(size_t i, size_t j, size_t k) const { return bits(i, j, k).get_rows(); }
+    int get_cols(size_t i, size_t j, size_t k) const { return bits(i, j, k).get_cols(); }
+    size_t get_pixel_count(size_t i, size_t j, size_t k) const {
+        return footprints->get_pixel_count(i, j, k);
+    }
+    // bounding boxes and pixel counts of the rotated templates
+    std::shared_ptr<const Footprint_Table> get_footprints() const { return footprints; }
+    size_t memory_bytes() const;
+    size_t bits_memory_bytes() const;
+
+    // cache of a template set, built on first use and shared by all users of the set; NULL
+    // if it cannot be built, in which case nothing is registered
+    static std::shared_ptr<const Template_Cache> for_parameters(
+        const Finder_Parameters* finder_parameters, const double resize_fraction);
+    // drop all cached sets, e.g. when Finder::Init reloads the templates
+    static void clear_all();
+
+  private:
+    size_t N_thresh; /**< number of PGA thresholds */
+    size_t N_degrees; /**< number of strikes */
+    size_t N_templ; /**< number of templates */
+    double resize_fraction; /**< resize applied after rotation */
+    size_t max_rows; /**< largest rotated template height, for image padding */
+    size_t max_cols; /**< largest rotated template width, for image padding */
+    size_t max_words; /**< largest bit-packed template, in words */
+    bool keep_pixels; /**< rotated holds the CV_8U templates */
+    vector3d<cv::Mat> rotated; /**< rotated templates for each PGA, strike and template */
+    std::shared_ptr<Footprint_Table> footprints; /**< footprint of each rotated template */
+    vector3d<Bit_Template> bits; /**< bit-packed rotated templates */
+}; // class Template_Cache
+
+}; // end of FiniteFault namespace
+
+#endif // __finder_template_cache_h__
+
+// end of file: finder_template_cache.h
@@ -0,0 +1,210 @@
+//
+//      Footprints of the rotated and resized FinDer templates
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <mutex>
+
+#include "finder_template_footprints.h"
+#include "finder_template_cache.h" // rotate_template
+#include "finder_template_store.h"
+#include "../finder_headers/finder_globals.h" // logging macros
+
+namespace FiniteFault {
+
+namespace {
+    std::mutex registry_lock;
+    std::map<std::pair<std::string, double>, std::shared_ptr<const Footprint_Table> > registry;
+}
+
+Template_Footprint measure_footprint(const cv::Mat& rotated) {
+    Template_Footprint footprint;
+    std::memset(&footprint, 0, sizeof(footprint));
+    footprint.rows = rotated.rows;
+    footprint.cols = rotated.cols;
+    if (rotated.empty()) return footprint;
+    int x0 = rotated.cols, y0 = rotated.rows, x1 = -1, y1 = -1;
+    for (int y = 0; y < rotated.rows; y++) {
+        const uchar* row = rotated.ptr<uchar>(y);
+        for (int x = 0; x < rotated.cols; x++) {
+            if (row[x] == 0) continue;
+            footprint.pixel_count++;
+            x0 = std::min(x0, x);
+            x1 = std::max(x1, x);
+            y0 = std::min(y0, y);
+            y1 = std::max(y1, y);
+        }
+    }
+    if (footprint.pixel_count == 0) return footprint;
+    footprint.x = x0;
+    footprint.y = y0;
+    footprint.width = x1 - x0 + 1;
+    footprint.height = y1 - y0 + 1;
+    return footprint;
+}
+
+void Footprint_Table::reset(const size_t N_thresh, const std::vector<double>& degrees,
+        const size_t N_templ, const double resize_fraction) {
+    this->N_thresh = N_thresh;
+    this->N_degrees = degrees.size();
+    this->N_templ = N_templ;
+    this->resize_fraction = resize_fraction;
+    this->degrees = degrees;
+    Template_Footprint none;
+    std::memset(&none, 0, sizeof(none));
+    entries.assign(N_thresh * N_degrees * N_templ, none);
+}
+
+bool Footprint_Table::build(const std::vector<std::vector<cv::Mat> >& templates,
+        const std::vector<double>& degrees, const double resize_fraction, Worker_Pool& pool) {
+    const size_t N_thresh = templates.size();
+    const size_t N_templ = (N_thresh > 0) ? templates[0].size() : 0;
+    for (size_t i = 0; i < N_thresh; i++) {
+        if (templates[i].size() != N_templ) {
+            LOGE << "Footprint_Table: threshold " << i << " has " << templates[i].size() <<
+                " templates, expected " << N_templ << ELL;
+            return false;
+        }
+    }
+    if (N_thresh == 0 || N_templ == 0 || degrees.empty() || resize_fraction <= 0.) {
+        reset(0, std::vector<double>(), 0, 1.);
+        return false;
+    }
+    reset(N_thresh, degrees, N_templ, resize_fraction);
+
+    // the same rotation and resize as Template_Cache::build, without keeping the results
+    pool.parallel_for(0, N_thresh * N_templ, [&](size_t n) {
+        const size_t i = n / N_templ, k = n % N_templ;
+        if (templates[i][k].empty()) return;
+        cv::Mat binary, rotated;
+        cv::compare(templates[i][k], 0, binary, CMP_GT);
+        binary &= Scalar(1);
+        for (size_t j = 0; j < N_degrees; j++) {
+            rotate_template(binary, rotated, degrees[j]);
+            if (resize_fraction != 1.) {
+                cv::resize(rotated, rotated, cv::Size(), resize_fraction, resize_fraction,
+                    INTER_NEAREST);
+            }
+            set(i, j, k, measure_footprint(rotated));
+        }
+    });
+    return true;
+}
+
+bool Footprint_Table::matches(const size_t N_thresh, const size_t N_templ,
+        const std::vector<double>& degrees, const double resize_fraction) const {
+    return this->N_thresh == N_thresh && this->N_templ == N_templ &&
+        this->degrees == degrees && this->resize_fraction == resize_fraction;
+}
+
+bool Footprint_Table::save(const std::string& path) const {
+    Footprint_Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, FOOTPRINT_MAGIC, sizeof(header.magic));
+    header.version = FOOTPRINT_VERSION;
+    header.header_bytes = sizeof(Footprint_Header);
+    header.N_thresh = N_thresh;
+    header.N_degrees = N_degrees;
+    header.N_templ = N_templ;
+    header.resize_fraction = resize_fraction;
+
+    // readers of the old file see either it or the new one, the rename swaps the entry
+    const std::string temp = path + ".tmp";
+    FILE* out = fopen(temp.c_str(), "wb");
+    if (out == NULL) {
+        LOGE << "Footprint_Table: cannot write " << temp << ELL;
+        return false;
+    }
+    bool status = fwrite(&header, sizeof(header), 1, out) == 1 &&
+        (degrees.empty() || fwrite(&degrees[0], sizeof(double), N_degrees, out) == N_degrees) &&
+        (entries.empty() || fwrite(&entries[0], sizeof(Template_Footprint), entries.size(),
+        out) == entries.size());
+    status = (fclose(out) == 0) && status;
+    if (!status || std::rename(temp.c_str(), path.c_str()) != 0) {
+        LOGE << "Footprint_Table: writing " << path << " failed" << ELL;
+        std::remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool Footprint_Table::load(const std::string& path) {
+    FILE* in = fopen(path.c_str(), "rb");
+    if (in == NULL) return false;
+    const long file_bytes = (fseek(in, 0, SEEK_END) == 0) ? ftell(in) : -1;
+    rewind(in);
+    Footprint_Header header;
+    bool status = fread(&header, sizeof(header), 1, in) == 1 &&
+        std::memcmp(header.magic, FOOTPRINT_MAGIC, sizeof(FOOTPRINT_MAGIC)) == 0 &&
+        header.version == FOOTPRINT_VERSION && header.header_bytes == sizeof(Footprint_Header);
+    // sizes from a corrupt header must not reach the allocations below
+    status = status && file_bytes >= 0 && header.N_degrees <= (uint64_t) file_bytes &&
+        sizeof(header) + header.N_degrees * sizeof(double) + header.N_thresh *
+        header.N_degrees * header.N_templ * sizeof(Template_Footprint) == (uint64_t) file_bytes;
+    if (status) {
+        std::vector<double> file_degrees(header.N_degrees);
+        status = file_degrees.empty() || fread(&file_degrees[0], sizeof(double),
+            file_degrees.size(), in) == file_degrees.size();
+        if (status) {
+            reset(header.N_thresh, file_degrees, header.N_templ, header.resize_fraction);
+            status = entries.empty() || fread(&entries[0], sizeof(Template_Footprint),
+                entries.size(), in) == entries.size();
+        }
+    }
+    fclose(in);
+    if (!status) {
+        LOGE << "Footprint_Table: " << path << " is not a version " << FOOTPRINT_VERSION <<
+            " footprint table" << ELL;
+        reset(0, std::vector<double>(), 0, 1.);
+    }
+    return status;
+}
+
+size_t Footprint_Table::closest_length(size_t i, const double pixels) const {
+    size_t best = 0;
+    double best_distance = std::numeric_limits<double>::infinity();
+    for (size_t k = 0; k < N_templ && i < N_thresh; k++) {
+        double sum = 0.;
+        for (size_t j = 0; j < N_degrees; j++) sum += (double) get_pixel_count(i, j, k);
+        const double distance = std::fabs(sum / N_degrees - pixels);
+        if (distance < best_distance) {
+            best_distance = distance;
+            best = k;
+        }
+    }
+    return best;
+}
+
+std::shared_ptr<const Footprint_Table> Footprint_Table::for_store(const Template_Store& store,
+        const double resize_fraction) {
+    const std::pair<std::string, double> key(store.get_path(), resize_fraction);
+    std::lock_guard<std::mutex> lk(registry_lock);
+    std::map<std::pair<std::string, double>,
+        std::shared_ptr<const Footprint_Table> >::const_iterator it = registry.find(key);
+    if (it != registry.end()) return it->second;
+
+    std::shared_ptr<Footprint_Table> table(new Footprint_Table());
+    const std::string path = side_path(store.get_path());
+    if (!table->load(path) || !table->matches(store.get_N_thresh(), store.get_N_templ(),
+            store.get_degrees(), resize_fraction)) {
+        if (!table->build(store.get_templates(), store.get_degrees(), resize_fraction)) {
+            return std::shared_ptr<const Footprint_Table>();
+        }
+        // a read-only store folder only costs the next process the measuring
+        if (table->save(path)) {
+            LOGI << "Footprint_Table: saved the footprints of " << store.get_path() << " to " <<
+                path << ELL;
+        }
+    }
+    registry[key] = table;
+    return table;
+}
+
+}; // end of FiniteFault namespace
+
+// end of file: finder_template_footprints.cpp
@@ -0,0 +1,128 @@
+//
+//      Footprints of the rotated and resized FinDer templates
+//
+//      Finder_Parameters::template_sum_all holds the pixel counts of the unrotated templates.
+//      After rotate_template and resize_fraction, a template has a different bounding box and,
+//      through the nearest neighbour sampling, a slightly different count. A Footprint_Table
+//      keeps both for every (PGA threshold i, strike j, template k): the size of the rotated
+//      template, the box of its set pixels inside it, and its pixel count. Sizing the image
+//      padding, the pixel count bounds of Template_Search and the starting length guess are
+//      then lookups into this table.
+//
+//      Template_Cache fills one while it rotates the templates. Without a cache, for_store
+//      measures the templates of a Template_Store once per process. The result is saved next
+//      to the store file, so the next process only reads it.
+//
+//      Layout, native byte order:
+//          Footprint_Header
+//          double degrees[N_degrees]
+//          Template_Footprint[N_thresh * N_degrees * N_templ], in (i, j, k) order
+//
+
+#ifndef __finder_template_footprints_h__
+#define __finder_template_footprints_h__
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../finder_headers/finder_opencv.h"
+#include "finder_worker_pool.h"
+
+namespace FiniteFault {
+
+class Template_Store;
+
+const char FOOTPRINT_MAGIC[8] = { 'F', 'D', 'R', 'F', 'O', 'O', 'T', '1' }; /**< file signature */
+const uint32_t FOOTPRINT_VERSION = 1; /**< format version */
+
+/** Fixed-size head of a footprint file */
+struct Footprint_Header {
+    char magic[8]; /**< FOOTPRINT_MAGIC */
+    uint32_t version; /**< FOOTPRINT_VERSION */
+    uint32_t header_bytes; /**< sizeof(Footprint_Header), guards against layout changes */
+    uint64_t N_thresh; /**< number of PGA thresholds */
+    uint64_t N_degrees; /**< number of strikes */
+    uint64_t N_templ; /**< number of templates */
+    double resize_fraction; /**< resize applied after rotation */
+};
+
+/** Shape of one rotated, resized template */
+struct Template_Footprint {
+    uint32_t rows; /**< rows of the rotated template */
+    uint32_t cols; /**< columns of the rotated template */
+    uint32_t x; /**< first column with a pixel set */
+    uint32_t y; /**< first row with a pixel set */
+    uint32_t width; /**< columns from x to the last one with a pixel set, 0 if none is */
+    uint32_t height; /**< rows from y to the last one with a pixel set, 0 if none is */
+    uint64_t pixel_count; /**< pixels set */
+};
+
+// footprint of a rotated 0/1 template
+Template_Footprint measure_footprint(const cv::Mat& rotated);
+
+/** \class Footprint_Table
+ * \brief Bounding boxes and pixel counts of the rotated templates of one template set,
+ * indexed by (PGA threshold i, strike j, template k) like Template_Cache.
+ * */
+class Footprint_Table {
+  public:
+    Footprint_Table() : N_thresh(0), N_degrees(0), N_templ(0), resize_fraction(1.) {}
+
+    // all footprints empty, to be filled with set
+    void reset(const size_t N_thresh, const std::vector<double>& degrees, const size_t N_templ,
+        const double resize_fraction);
+    void set(size_t i, size_t j, size_t k, const Template_Footprint& footprint) {
+        entries[(i * N_degrees + j) * N_templ + k] = footprint;
+    }
+    // rotate and resize templates[i][k] to every strike and measure them, the rotated
+    // templates are not kept
+    bool build(const std::vector<std::vector<cv::Mat> >& templates,
+        const std::vector<double>& degrees, const double resize_fraction,
+        Worker_Pool& pool = *Worker_Pool::instance());
+
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+    // true if the table was made for these templates, strikes and resize_fraction
+    bool matches(const size_t N_thresh, const size_t N_templ, const std::vector<double>& degrees,
+        const double resize_fraction) const;
+
+    bool empty() const { return entries.empty(); }
+    size_t get_N_thresh() const { return N_thresh; }
+    size_t get_N_degrees() const { return N_degrees; }
+    size_t get_N_templ() const { return N_templ; }
+    double get_resize_fraction() const { return resize_fraction; }
+    const std::vector<double>& get_degrees() const { return degrees; }
+    const Template_Footprint& get(size_t i, size_t j, size_t k) const {
+        return entries[(i * N_degrees + j) * N_templ + k];
+    }
+    size_t get_pixel_count(size_t i, size_t j, size_t k) const {
+        return get(i, j, k).pixel_count;
+    }
+    // template at threshold i whose pixel count, averaged over the strikes, is closest to
+    // pixels: the length whose rupture covers about as much as the thresholded image
+    size_t closest_length(size_t i, const double pixels) const;
+
+    // footprints of the templates of store at resize_fraction, read from
+    // side_path(store path) or measured and saved there, once per process
+    static std::shared_ptr<const Footprint_Table> for_store(const Template_Store& store,
+        const double resize_fraction);
+    static std::string side_path(const std::string& store_path) {
+        return store_path + ".footprints";
+    }
+
+  private:
+    size_t N_thresh; /**< number of PGA thresholds */
+    size_t N_degrees; /**< number of strikes */
+    size_t N_templ; /**< number of templates */
+    double resize_fraction; /**< resize applied after rotation */
+    std::vector<double> degrees; /**< strikes the templates were rotated to */
+    std::vector<Template_Footprint> entries; /**< footprints in (i, j, k) order */
+}; // class Footprint_Table
+
+}; // end of FiniteFault namespace
+
+#endif // __finder_template_footprints_h__
+
+// end of file: finder_template_footprints.h
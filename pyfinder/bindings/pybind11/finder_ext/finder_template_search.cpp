@@ -0,0 +1,547 @@
+//
+//      Strike-parallel template search over the rotated template cache
+//
+
+#include <algorithm>
+#include <cmath>
+
+#include "finder_template_search.h"
+#include "finder_scratch.h"
+#include "finder_timing.h"
+#include "../finder_headers/finder_globals.h" // logging macros
+
+namespace FiniteFault {
+
+const double DFT_COST = 3.0; /**< cost of one DFT per pixel and log2(pixels), in multiply-adds */
+const double BIT_COST = 2.0; /**< cost of the and + popcount of one word, in multiply-adds */
+
+namespace {
+    // misfit of a template of templ_sum pixels if it covered as much of the image as it could
+    double count_misfit(const double image_sum, const double templ_sum) {
+        return std::fabs(image_sum - templ_sum) / (image_sum + templ_sum);
+    }
+}
+
+Template_Search::Template_Search(std::shared_ptr<const Template_Cache> cache,
+        const ImageParams& imgparams, const std::shared_ptr<Worker_Pool>& pool) :
+        cache(cache), imgparams(imgparams), pool(pool), match_mode(MATCH_AUTO),
+        spectrum_budget(SPECTRUM_BUDGET), spectrum_bytes(0), fft_matches(0), direct_matches(0),
+        bit_matches(0), incremental(false), restart_pc(INCREMENTAL_RESTART_PC), incremental_levels(0),
+        full_levels(0), rescored_templates(0), hierarchical(false), coarse_factor(COARSE_FACTOR),
+        prune_margin(PRUNE_MARGIN), coarse_matches(0), pruned_templates(0), count_bound(false),
+        minVal_min(1.0), count_pruned(0) {
+    const size_t N_thresh = cache->get_N_thresh();
+    const size_t N_degrees = cache->get_N_degrees();
+    const size_t N_templ = cache->get_N_templ();
+    minVal_all = vector3d<double>(N_thresh, N_degrees, N_templ, 1.0);
+    minLoc_lat = vector3d<double>(N_thresh, N_degrees, N_templ, 0.0);
+    minLoc_lon = vector3d<double>(N_thresh, N_degrees, N_templ, 0.0);
+    minCalc_all = vector3d<size_t>(N_thresh, N_degrees, N_templ, 0);
+    spectra = vector3d<cv::Mat>(N_thresh, N_degrees, N_templ);
+    best_overlap = vector3d<double>(N_thresh, N_degrees, N_templ, 0.0);
+    best_centre = vector3d<cv::Point>(N_thresh, N_degrees, N_templ);
+    coarse_templates = vector3d<cv::Mat>(N_thresh, N_degrees, N_templ);
+    levels.resize(N_thresh);
+    prev_binary.resize(N_thresh);
+    prev_sum.assign(N_thresh, 0.);
+    hint.assign(N_thresh, std::make_pair((size_t) 0, (size_t) 0));
+    // half the largest template on each side, so that its centre reaches every image pixel
+    pad_rows = (int) cache->get_max_rows() / 2 + 1;
+    pad_cols = (int) cache->get_max_cols() / 2 + 1;
+}
+
+bool Template_Search::prefer_fft(const cv::Size& image_size, const cv::Size& dft_size,
+        double placement_cost, bool spectrum_cached) {
+    const double direct = (double) image_size.area() * placement_cost;
+    const double n = (double) dft_size.area();
+    // inverse transform, plus the forward transform of the template if it is not cached yet
+    const double transforms = spectrum_cached ? 1. : 2.;
+    return direct > DFT_COST * transforms * n * std::log2(std::max(n, 2.)) + n;
+}
+
+double Template_Search::bit_cost(size_t words) {
+    return BIT_COST * words;
+}
+
+void Template_Search::prepImage(const cv::Mat& image, Level& level) const {
+    // every output keeps its buffer as long as the image size does not change
+    const double resize_fraction = cache->get_resize_fraction();
+    cv::Mat& binary = resize_fraction != 1. ? level.thresholded : level.binary;
+    cv::compare(image, 0, binary, CMP_GT);
+    binary &= Scalar(1);
+    if (resize_fraction != 1.) {
+        cv::resize(level.thresholded, level.binary, cv::Size(), resize_fraction,
+            resize_fraction, INTER_NEAREST);
+    }
+    level.size = level.binary.size();
+    level.image_sum = cv::countNonZero(level.binary);
+    level.incremental = false;
+    level.use_spectrum = false;
+    cv::copyMakeBorder(level.binary, level.padded, pad_rows, pad_rows, pad_cols, pad_cols,
+        BORDER_CONSTANT, Scalar(0));
+    level.use_bits = match_mode == MATCH_AUTO || match_mode == MATCH_BITS;
+    if (level.use_bits) level.bits.assign(level.padded);
+}
+
+bool Template_Search::use_fft(const Level& level, size_t j, size_t k) const {
+    if (match_mode != MATCH_AUTO) return match_mode == MATCH_FFT;
+    return prefer_fft(level.size, dft_size, bit_cost(cache->get_bits(level.i, j, k).get_words()),
+        !spectra(level.i, j, k).empty());
+}
+
+void Template_Search::correlate_window(const Level& level, size_t j, size_t k,
+        const cv::Rect& centres, cv::Mat& corr) {
+    const int rows = cache->get_rows(level.i, j, k), cols = cache->get_cols(level.i, j, k);
+    // top left corner, in the padded image, of the template centred on the first centre
+    const int x = pad_cols - cols / 2 + centres.x, y = pad_rows - rows / 2 + centres.y;
+    corr = Scratch_Arena::local().view(SCRATCH_CORR, centres.size(), CV_32F);
+    if (level.use_bits && level.bits.correlate(cache->get_bits(level.i, j, k),
+            cv::Rect(x, y, centres.width, centres.height), corr)) {
+        bit_matches.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    cv::Mat scratch;
+    const cv::Mat& templ = cache->get_pixels(level.i, j, k, scratch);
+    cv::matchTemplate(level.padded(cv::Rect(x, y, centres.width + cols - 1,
+        centres.height + rows - 1)), templ, corr, TM_CCORR);
+    direct_matches.fetch_add(1, std::memory_order_relaxed);
+}
+
+const cv::Mat& Template_Search::template_spectrum(size_t i, size_t j, size_t k,
+        cv::Mat& scratch) {
+    cv::Mat& spectrum = spectra(i, j, k);
+    if (!spectrum.empty()) return spectrum;
+
+    cv::Mat pixels;
+    const cv::Mat& templ = cache->get_pixels(i, j, k, pixels);
+    cv::Mat templ32 = cv::Mat::zeros(dft_size, CV_32F);
+    templ.convertTo(templ32(cv::Rect(0, 0, templ.cols, templ.rows)), CV_32F);
+    cv::dft(templ32, scratch, 0, templ.rows);
+
+    // keep it for the next timestep if the budget allows, each cell has a single writer
+    const size_t bytes = scratch.total() * scratch.elemSize();
+    if (spectrum_bytes.fetch_add(bytes) + bytes <= spectrum_budget) {
+        spectrum = scratch;
+        return spectrum;
+    }
+    spectrum_bytes.fetch_sub(bytes);
+    return scratch;
+}
+
+void Template_Search::correlate_fft(const Level& level, size_t j, size_t k, cv::Mat& corr) {
+    const int rows = cache->get_rows(level.i, j, k), cols = cache->get_cols(level.i, j, k);
+    Scratch_Arena& arena = Scratch_Arena::local();
+    cv::Mat scratch;
+    const cv::Mat& spectrum = template_spectrum(level.i, j, k, scratch);
+    cv::Mat product = arena.view(SCRATCH_PRODUCT, level.spectrum.size(), level.spectrum.type());
+    cv::Mat full = arena.view(SCRATCH_FULL, dft_size, CV_32F);
+    corr = arena.view(SCRATCH_CORR, level.size, CV_32F);
+    // conjugated template spectrum turns the convolution into a correlation
+    cv::mulSpectrums(level.spectrum, spectrum, product, 0, true);
+    cv::idft(product, full, DFT_SCALE | DFT_REAL_OUTPUT);
+    // full(y, x) correlates the template with its top left corner at padded (y, x)
+    full(cv::Rect(pad_cols - cols / 2, pad_rows - rows / 2, level.size.width,
+        level.size.height)).copyTo(corr);
+}
+
+void Template_Search::set_result(const Level& level, size_t j, size_t k, double overlap,
+        const cv::Point& centre) {
+    const size_t i = level.i;
+    const double resize_fraction = cache->get_resize_fraction();
+    const double templ_sum = (double) cache->get_pixel_count(i, j, k);
+    best_overlap(i, j, k) = overlap;
+    best_centre(i, j, k) = centre;
+    minVal_all(i, j, k) = (level.image_sum + templ_sum - 2. * overlap) /
+        (level.image_sum + templ_sum);
+    minLoc_lat(i, j, k) = imgparams.minLat + centre.y / resize_fraction * imgparams.dLat;
+    minLoc_lon(i, j, k) = imgparams.minLon + centre.x / resize_fraction * imgparams.dLon;
+}
+
+void Template_Search::match_changed(const Level& level, size_t j, size_t k, cv::Mat& corr) {
+    const size_t i = level.i;
+    const int rows = cache->get_rows(i, j, k), cols = cache->get_cols(i, j, k);
+    const int above = rows / 2, below = rows - 1 - rows / 2;
+    const int left = cols / 2, right = cols - 1 - cols / 2;
+
+    // the previous best may have lost pixels, then nothing of the old map can be trusted
+    const cv::Point& prev = best_centre(i, j, k);
+    const cv::Rect footprint(prev.x - left, prev.y - above, cols, rows);
+    if ((footprint & level.changed).area() > 0) {
+        correlate_window(level, j, k, cv::Rect(0, 0, level.size.width, level.size.height), corr);
+        rescored_templates.fetch_add(1, std::memory_order_relaxed);
+        double minCorr, maxCorr;
+        Point minLoc, maxLoc;
+        cv::minMaxLoc(corr, &minCorr, &maxCorr, &minLoc, &maxLoc);
+        set_result(level, j, k, std::floor(maxCorr + 0.5), maxLoc);
+        return;
+    }
+
+    // centres whose footprint touches the changed box, everything else kept its overlap
+    const cv::Rect window = cv::Rect(level.changed.x - right, level.changed.y - below,
+        level.changed.width + cols - 1, level.changed.height + rows - 1) &
+        cv::Rect(0, 0, level.size.width, level.size.height);
+    double overlap = best_overlap(i, j, k);
+    cv::Point centre = prev;
+    if (window.area() > 0) {
+        correlate_window(level, j, k, window, corr);
+        double minCorr, maxCorr;
+        Point minLoc, maxLoc;
+        cv::minMaxLoc(corr, &minCorr, &maxCorr, &minLoc, &maxLoc);
+        if (std::floor(maxCorr + 0.5) > overlap) {
+            overlap = std::floor(maxCorr + 0.5);
+            centre = cv::Point(window.x + maxLoc.x, window.y + maxLoc.y);
+        }
+    }
+    set_result(level, j, k, overlap, centre);
+}
+
+void Template_Search::match_strike(const Level& level, size_t j) {
+    const size_t i = level.i;
+    Scratch_Arena& arena = Scratch_Arena::local();
+    std::vector<size_t>& strikes = arena.indices(SCRATCH_STRIKES);
+    std::vector<size_t>& lengths = arena.indices(SCRATCH_LENGTHS);
+    search_order(i, strikes, lengths);
+    cv::Mat corr;
+    for (size_t n = 0; n < lengths.size(); n++) {
+        const size_t k = lengths[n];
+        const double templ_sum = (double) cache->get_pixel_count(i, j, k);
+        minCalc_all(i, j, k) = 1;
+        if (templ_sum == 0. || level.image_sum + templ_sum == 0.) {
+            best_overlap(i, j, k) = 0.;
+            minVal_all(i, j, k) = 1.0;
+            continue;
+        }
+        if (level.incremental) {
+            match_changed(level, j, k, corr);
+            continue;
+        }
+        if (prune_by_count(level, j, k)) continue;
+        score(level, j, k, corr);
+    }
+}
+
+bool Template_Search::prune_by_count(const Level& level, size_t j, size_t k) {
+    if (!count_bound) return false;
+    const size_t i = level.i;
+    const double bound = count_misfit(level.image_sum, (double) cache->get_pixel_count(i, j, k));
+    if (bound <= minVal_min.load() + prune_margin) return false;
+    minCalc_all(i, j, k) = 0;
+    minVal_all(i, j, k) = bound;
+    count_pruned.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void Template_Search::lower_best(double misfit) {
+    double current = minVal_min.load();
+    while (misfit < current && !minVal_min.compare_exchange_weak(current, misfit)) {}
+}
+
+void Template_Search::score(const Level& level, size_t j, size_t k, cv::Mat& corr) {
+    if (level.use_spectrum && use_fft(level, j, k)) {
+        correlate_fft(level, j, k, corr);
+        fft_matches.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        correlate_window(level, j, k, cv::Rect(0, 0, level.size.width, level.size.height), corr);
+    }
+    rescored_templates.fetch_add(1, std::memory_order_relaxed);
+    double minCorr, maxCorr;
+    Point minLoc, maxLoc;
+    cv::minMaxLoc(corr, &minCorr, &maxCorr, &minLoc, &maxLoc);
+    // the FFT sum carries rounding noise, the overlap is an integer pixel count
+    set_result(level, j, k, std::floor(maxCorr + 0.5), maxLoc);
+    lower_best(minVal_all(level.i, j, k));
+}
+
+void Template_Search::set_coarse_factor(const size_t factor) {
+    coarse_factor = std::max<size_t>(factor, 1);
+    coarse_templates = vector3d<cv::Mat>(cache->get_N_thresh(), cache->get_N_degrees(),
+        cache->get_N_templ());
+}
+
+void Template_Search::coarse_image(Level& level) const {
+    const int f = (int) coarse_factor;
+    const int rows = (level.padded.rows + f - 1) / f, cols = (level.padded.cols + f - 1) / f;
+    cv::Mat& blocks = level.blocks;
+    blocks.create(rows, cols, CV_32F);
+    blocks.setTo(Scalar(0));
+    for (int y = 0; y < level.padded.rows; y++) {
+        const uchar* pixel = level.padded.ptr<uchar>(y);
+        float* block = blocks.ptr<float>(y / f);
+        for (int x = 0; x < level.padded.cols; x++) {
+            if (pixel[x]) block[x / f] = 1.f;
+        }
+    }
+    // a template placed off the block grid reaches into the next block right and below
+    cv::Mat& coarse = level.coarse;
+    coarse.create(rows, cols, CV_32F);
+    for (int v = 0; v < rows; v++) {
+        const float* row0 = blocks.ptr<float>(v);
+        const float* row1 = blocks.ptr<float>(std::min(v + 1, rows - 1));
+        float* out = coarse.ptr<float>(v);
+        for (int u = 0; u < cols; u++) {
+            const int u1 = std::min(u + 1, cols - 1);
+            out[u] = std::max(std::max(row0[u], row0[u1]), std::max(row1[u], row1[u1]));
+        }
+    }
+}
+
+const cv::Mat& Template_Search::coarse_template(size_t i, size_t j, size_t k) {
+    cv::Mat& coarse = coarse_templates(i, j, k);
+    if (!coarse.empty()) return coarse;
+    cv::Mat scratch;
+    const cv::Mat& templ = cache->get_pixels(i, j, k, scratch);
+    const int f = (int) coarse_factor;
+    cv::Mat counts = cv::Mat::zeros((templ.rows + f - 1) / f, (templ.cols + f - 1) / f, CV_32F);
+    for (int y = 0; y < templ.rows; y++) {
+        const uchar* pixel = templ.ptr<uchar>(y);
+        float* block = counts.ptr<float>(y / f);
+        for (int x = 0; x < templ.cols; x++) {
+            if (pixel[x]) block[x / f] += 1.f;
+        }
+    }
+    // each cell has a single writer, the strike that owns it
+    coarse = counts;
+    return coarse;
+}
+
+void Template_Search::match_hierarchical(Level& level) {
+    const size_t i = level.i;
+    const size_t N_degrees = cache->get_N_degrees(), N_templ = cache->get_N_templ();
+    coarse_image(level);
+    const cv::Mat& coarse = level.coarse;
+
+    // misfit lower bound of each template, negative for those with nothing to match
+    std::vector<double>& bound = level.bound;
+    bound.assign(N_degrees * N_templ, -1.);
+    pool->parallel_for(0, N_degrees, [&](size_t j) {
+        for (size_t k = 0; k < N_templ; k++) {
+            const double templ_sum = (double) cache->get_pixel_count(i, j, k);
+            minCalc_all(i, j, k) = 1;
+            if (templ_sum == 0. || level.image_sum + templ_sum == 0.) {
+                best_overlap(i, j, k) = 0.;
+                minVal_all(i, j, k) = 1.0;
+                continue;
+            }
+            if (prune_by_count(level, j, k)) continue;
+            const cv::Mat& templ = coarse_template(i, j, k);
+            double overlap = std::min(templ_sum, level.image_sum);
+            if (templ.rows <= coarse.rows && templ.cols <= coarse.cols) {
+                cv::Mat corr = Scratch_Arena::local().view(SCRATCH_COARSE,
+                    coarse.rows - templ.rows + 1, coarse.cols - templ.cols + 1, CV_32F);
+                cv::matchTemplate(coarse, templ, corr, TM_CCORR);
+                double minCorr, maxCorr;
+                cv::minMaxLoc(corr, &minCorr, &maxCorr);
+                // one pixel of slack for the rounding of the float sums
+                overlap = std::min(overlap, maxCorr * (1. + 1e-6) + 1.);
+                coarse_matches.fetch_add(1, std::memory_order_relaxed);
+            }
+            bound[j * N_templ + k] = std::max(0., (level.image_sum + templ_sum - 2. * overlap) /
+                (level.image_sum + templ_sum));
+        }
+    });
+
+    std::vector<size_t>& order = level.order;
+    order.clear();
+    for (size_t n = 0; n < bound.size(); n++) {
+        if (bound[n] >= 0.) order.push_back(n);
+    }
+    // ties by index, as a stable sort would without its buffer
+    std::sort(order.begin(), order.end(), [&bound](size_t a, size_t b) {
+        return bound[a] < bound[b] || (bound[a] == bound[b] && a < b);
+    });
+    if (order.empty()) return;
+
+    // worker t scores order[t], order[t + stride], ..., so the lowest bounds go first on all
+    // of them; the best only falls, a template above it stays above it
+    std::atomic<double> best(2.);
+    std::vector<char>& scored = level.scored;
+    scored.assign(order.size(), 0);
+    const size_t stride = std::min(order.size(), std::max<size_t>(pool->size(), 1));
+    pool->parallel_for(0, stride, [&](size_t t) {
+        cv::Mat corr;
+        for (size_t n = t; n < order.size(); n += stride) {
+            const double reference = count_bound ? std::min(best.load(), minVal_min.load()) :
+                best.load();
+            if (bound[order[n]] > reference + prune_margin) break;
+            const size_t j = order[n] / N_templ, k = order[n] % N_templ;
+            score(level, j, k, corr);
+            scored[n] = 1;
+            double current = best.load();
+            const double misfit = minVal_all(i, j, k);
+            while (misfit < current && !best.compare_exchange_weak(current, misfit)) {}
+        }
+    });
+    for (size_t n = 0; n < order.size(); n++) {
+        if (scored[n]) continue;
+        const size_t j = order[n] / N_templ, k = order[n] % N_templ;
+        minCalc_all(i, j, k) = 0;
+        minVal_all(i, j, k) = bound[order[n]];
+        pruned_templates.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Template_Search::search_order(size_t i, std::vector<size_t>& strikes,
+        std::vector<size_t>& lengths) const {
+    const size_t N_degrees = cache->get_N_degrees(), N_templ = cache->get_N_templ();
+    const size_t j0 = std::min(hint[i].first, N_degrees - 1);
+    const size_t k0 = std::min(hint[i].second, N_templ - 1);
+    // strikes wrap around, lengths do not
+    strikes.clear();
+    strikes.push_back(j0);
+    for (size_t d = 1; strikes.size() < N_degrees; d++) {
+        strikes.push_back((j0 + d) % N_degrees);
+        if (strikes.size() < N_degrees) strikes.push_back((j0 + N_degrees - d) % N_degrees);
+    }
+    lengths.clear();
+    lengths.push_back(k0);
+    for (size_t d = 1; lengths.size() < N_templ; d++) {
+        if (k0 + d < N_templ) lengths.push_back(k0 + d);
+        if (d <= k0) lengths.push_back(k0 - d);
+    }
+}
+
+bool Template_Search::detect_changes(Level& level) {
+    const size_t i = level.i;
+    const cv::Mat& prev = prev_binary[i];
+    if (!incremental || hierarchical || count_bound || prev.empty() ||
+            prev.size() != level.binary.size()) {
+        return false;
+    }
+
+    cv::compare(prev, level.binary, level.diff, CMP_NE);
+    const double changed = cv::countNonZero(level.diff);
+    if (changed > restart_pc / 100. * std::max(prev_sum[i], 1.)) {
+        LOGD << "Template_Search: " << changed << " pixels changed at threshold " << i <<
+            ", full search" << ELL;
+        return false;
+    }
+    if (changed == 0.) {
+        level.changed = cv::Rect();
+    } else {
+        cv::findNonZero(level.diff, level.points);
+        level.changed = cv::boundingRect(level.points);
+    }
+    level.incremental = true;
+    return true;
+}
+
+bool Template_Search::rotation_template_match(size_t pga_threshold_index, const cv::Mat& image) {
+    if (cache->empty() || pga_threshold_index >= cache->get_N_thresh() || image.empty()) {
+        return false;
+    }
+    Stage_Timer timer(STAGE_SEARCH, (int64_t) pga_threshold_index);
+    Level& level = levels[pga_threshold_index];
+    level.i = pga_threshold_index;
+    prepImage(image, level);
+    const bool use_previous = detect_changes(level);
+
+    const cv::Size size(cv::getOptimalDFTSize(level.padded.cols),
+        cv::getOptimalDFTSize(level.padded.rows));
+    if (size != dft_size) {
+        // spectra are only valid at the transform size they were computed for
+        dft_size = size;
+        spectra = vector3d<cv::Mat>(cache->get_N_thresh(), cache->get_N_degrees(),
+            cache->get_N_templ());
+        spectrum_bytes.store(0);
+    }
+    if (use_previous) incremental_levels++;
+    else full_levels++;
+    // transform the image once if the largest template of the set goes through the FFT
+    const bool any_fft = !use_previous && (match_mode == MATCH_FFT ||
+        (match_mode == MATCH_AUTO && prefer_fft(level.size, dft_size,
+        bit_cost(cache->get_max_words()), true)));
+    if (any_fft) {
+        level.padded32.create(dft_size, CV_32F);
+        level.padded32.setTo(Scalar(0));
+        level.padded.convertTo(level.padded32(cv::Rect(0, 0, level.padded.cols,
+            level.padded.rows)), CV_32F);
+        cv::dft(level.padded32, level.spectrum, 0, level.padded.rows);
+        level.use_spectrum = true;
+    }
+
+    // unchanged images keep every overlap, only the misfit follows the new image_sum
+    if (use_previous && level.changed.area() == 0) {
+        for (size_t j = 0; j < cache->get_N_degrees(); j++) {
+            for (size_t k = 0; k < cache->get_N_templ(); k++) {
+                if (cache->get_pixel_count(pga_threshold_index, j, k) == 0) continue;
+                set_result(level, j, k, best_overlap(pga_threshold_index, j, k),
+                    best_centre(pga_threshold_index, j, k));
+            }
+        }
+    } else if (hierarchical) {
+        match_hierarchical(level);
+    } else {
+        search_order(pga_threshold_index, order_strikes, order_lengths);
+        pool->parallel_for(0, order_strikes.size(), [&](size_t n) {
+            match_strike(level, order_strikes[n]);
+        });
+    }
+    // a copy, level.binary is overwritten by the next call
+    level.binary.copyTo(prev_binary[pga_threshold_index]);
+    prev_sum[pga_threshold_index] = level.image_sum;
+    return true;
+}
+
+bool Template_Search::template_match_image(const std::vector<cv::Mat>& Image) {
+    if (Image.size() < cache->get_N_thresh()) {
+        LOGE << "Template_Search: " << Image.size() << " images for " << cache->get_N_thresh() <<
+            " PGA thresholds" << ELL;
+        return false;
+    }
+    minVal_min.store(1.0);
+    bool status = true;
+    for (size_t i = 0; i < cache->get_N_thresh(); i++) {
+        status = rotation_template_match(i, Image[i]) && status;
+    }
+    return status;
+}
+
+bool Template_Search::template_match_image(const std::vector<cv::Mat>& Image,
+        const Finder_Data_Template& previous) {
+    for (size_t i = 0; i < cache->get_N_thresh(); i++) {
+        if (i < previous.min_ind_strikes_old.size() && i < previous.min_ind_lengths_old.size()) {
+            hint[i] = std::make_pair(previous.min_ind_strikes_old[i],
+                previous.min_ind_lengths_old[i]);
+        }
+    }
+    return template_match_image(Image);
+}
+
+void Template_Search::reset() {
+    for (size_t i = 0; i < prev_binary.size(); i++) {
+        prev_binary[i].release();
+        prev_sum[i] = 0.;
+        hint[i] = std::make_pair((size_t) 0, (size_t) 0);
+    }
+    minVal_min.store(1.0);
+}
+
+size_t Template_Search::get_computed_cells() const {
+    size_t computed = 0;
+    for (size_t i = 0; i < cache->get_N_thresh(); i++) {
+        for (size_t j = 0; j < cache->get_N_degrees(); j++) {
+            for (size_t k = 0; k < cache->get_N_templ(); k++) computed += minCalc_all(i, j, k) != 0;
+        }
+    }
+    return computed;
+}
+
+size_t Template_Search::get_pruned_cells() const {
+    return cache->get_N_thresh() * cache->get_N_degrees() * cache->get_N_templ() -
+        get_computed_cells();
+}
+
+void Template_Search::update(Finder_Data_Template& finder_data_templ) const {
+    for (size_t i = 0; i < cache->get_N_thresh(); i++) {
+        for (size_t j = 0; j < cache->get_N_degrees(); j++) {
+            for (size_t k = 0; k < cache->get_N_templ(); k++) {
+                if (minCalc_all(i, j, k) == 0) continue;
+                finder_data_templ.checkMinAndUpdate(minVal_all(i, j, k), i, j, k);
+            }
+        }
+    }
+}
+
+}; // end of FiniteFault namespace
+
+// end of file: finder_template_search.cpp
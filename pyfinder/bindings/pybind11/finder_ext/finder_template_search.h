@@ -0,0 +1,272 @@
+//
+//      Strike-parallel template search over the rotated template cache
+//
+//      Counterpart of Template_Match::rotation_template_match that takes the rotated templates
+//      from a Template_Cache instead of rotating them on every call, pads the data image once per
+//      PGA threshold rather than once per template, and spreads the strikes over the worker pool.
+//      Each strike writes only its own (i, j, *) cells, so no locking is needed; the best misfit
+//      is folded into Finder_Data_Template afterwards in the library's (i, j, k) order.
+//
+//      Large templates are correlated in the frequency domain: the padded image is transformed
+//      once per PGA threshold and multiplied with the template spectra, which are kept for the
+//      next timestep as long as they fit the spectrum budget. cv::matchTemplate transforms the
+//      image again for every template, which dominates for long ruptures on large images.
+//
+//      Small and medium templates are correlated bit-packed (see Bit_Template), 64 pixels per
+//      and + popcount instead of 64 multiply-adds; the direct cv::matchTemplate path remains
+//      for comparison and for caches that hold the CV_8U templates.
+//
+//      Between timesteps usually only a few stations change. In incremental mode the search
+//      keeps each level's image and the best overlap and location of every template. It
+//      correlates only the placements whose footprint touches a changed pixel. A template is
+//      re-scored completely only when its previous best placement touches the change. The
+//      strikes and lengths closest to the previous best are searched first. If more pixels
+//      change than restart_pc percent of the previous image, the full search runs instead.
+//
+//      The hierarchical mode goes coarse to fine. The image is reduced to coarse_factor blocks,
+//      each set if any of its pixels is, and widened by one block to the right and below. Each
+//      template is reduced to its pixel count per block. The coarse correlation then bounds
+//      the overlap of the template at every placement from above, and its misfit from below,
+//      at a fraction of the full cost. Templates are scored at full resolution in order of
+//      that bound, until it exceeds the best misfit of the threshold by prune_margin. Every
+//      template within prune_margin of the best is scored exactly; the others keep their bound
+//      in minVal_all and minCalc_all 0. The incremental mode needs the best placement of every
+//      template, so it is not used in hierarchical mode.
+//
+//      The pixel counts alone bound the misfit too: a template of |T| pixels overlaps an image of
+//      |I| pixels in at most min(|I|, |T|), so its misfit is at least ||I| - |T|| / (|I| + |T|).
+//      With count_bound on, a template whose bound is above minVal_min, the best misfit so far
+//      over all thresholds, by more than prune_margin is not correlated. Its cell keeps the
+//      bound and minCalc_all 0, as in the hierarchical mode, and update leaves it out. The
+//      thresholds are searched in order, so the images of the later ones start from the best
+//      of the earlier ones.
+//
+//      The images of each threshold keep their buffers from one timestep to the next, and the
+//      per-template correlation maps and spectrum products come from the Scratch_Arena of the
+//      worker thread. After the first timestep at a given image size the search no longer
+//      allocates image buffers, except for template spectra over the budget and templates
+//      unpacked from a cache without CV_8U pixels.
+//
+
+#ifndef __finder_template_search_h__
+#define __finder_template_search_h__
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../finder_headers/finite_fault.h"
+#include "../finder_headers/finder_event_process.h" // ImageParams
+#include "finder_template_cache.h"
+
+namespace FiniteFault {
+
+/** Correlation backend of Template_Search
+ * */
+enum Match_Mode {
+    MATCH_AUTO, /**< per template, bits or FFT, whichever is estimated to be cheaper */
+    MATCH_DIRECT, /**< cv::matchTemplate for every template */
+    MATCH_FFT, /**< spectrum products against the transformed image for every template */
+    MATCH_BITS /**< and + popcount of the bit-packed template and image for every template */
+};
+
+const std::string MatchModeString[] = { "auto", "direct", "fft", "bits" };
+
+const size_t SPECTRUM_BUDGET = 512 * 1048576; /**< bytes of template spectra kept across calls */
+const double INCREMENTAL_RESTART_PC = 50.0; /**< default change, in % of the previous image, above
+                                            which the incremental search falls back to the full one */
+const size_t COARSE_FACTOR = 4; /**< default block size of the coarse level, in pixels */
+const double PRUNE_MARGIN = 0.1; /**< default misfit above the best within which the pruned
+                                    searches score every template */
+
+/** \class Template_Search
+ * \brief Binary template matching of one template set against the thresholded data images.
+ *
+ * The misfit of template T placed on image I is (|I| + |T| - 2 |I and T|) / (|I| + |T|), i.e.
+ * the fraction of mismatched pixels, so 0 is a perfect match and 1 no overlap. Locations are
+ * those of the template centre, in degrees. One instance serves one event at a time.
+ * */
+class Template_Search {
+  public:
+    Template_Search(std::shared_ptr<const Template_Cache> cache, const ImageParams& imgparams,
+        const std::shared_ptr<Worker_Pool>& pool = Worker_Pool::instance());
+
+    void set_match_mode(const Match_Mode mode) { match_mode = mode; }
+    Match_Mode get_match_mode() const { return match_mode; }
+    void set_spectrum_budget(const size_t bytes) { spectrum_budget = bytes; }
+    size_t get_spectrum_bytes() const { return spectrum_bytes.load(); }
+    size_t get_fft_matches() const { return fft_matches.load(); }
+    size_t get_direct_matches() const { return direct_matches.load(); }
+    size_t get_bit_matches() const { return bit_matches.load(); }
+
+    // reuse the previous timestep where the image did not change, see restart_pc. Switching
+    // this, hierarchical or count_bound forgets the previous timestep: its results were
+    // not produced, or not bounded, the same way.
+    void set_incremental(const bool on) { if (on != incremental) { incremental = on; reset(); } }
+    bool get_incremental() const { return incremental; }
+    void set_restart_pc(const double pc) { restart_pc = pc; }
+    double get_restart_pc() const { return restart_pc; }
+    size_t get_incremental_levels() const { return incremental_levels; }
+    size_t get_full_levels() const { return full_levels; }
+    size_t get_rescored_templates() const { return rescored_templates.load(); }
+    // forget the previous timestep, e.g. for a new event
+    void reset();
+
+    // bound every template on the coarse level first, score only those that can come within
+    // prune_margin of the best
+    void set_hierarchical(const bool on) {
+        if (on != hierarchical) { hierarchical = on; reset(); }
+    }
+    bool get_hierarchical() const { return hierarchical; }
+    void set_coarse_factor(const size_t factor);
+    size_t get_coarse_factor() const { return coarse_factor; }
+    void set_prune_margin(const double margin) { prune_margin = margin; }
+    double get_prune_margin() const { return prune_margin; }
+    size_t get_coarse_matches() const { return coarse_matches.load(); }
+    size_t get_pruned_templates() const { return pruned_templates.load(); }
+
+    // skip templates whose pixel count keeps them more than prune_margin above minVal_min
+    void set_count_bound(const bool on) { if (on != count_bound) { count_bound = on; reset(); } }
+    bool get_count_bound() const { return count_bound; }
+    size_t get_count_pruned() const { return count_pruned.load(); }
+    // best misfit of the current template_match_image call
+    double get_minVal_min() const { return minVal_min.load(); }
+    // cells with minCalc_all set, and not set, by the searches so far
+    size_t get_computed_cells() const;
+    size_t get_pruned_cells() const;
+
+    // true when correlating a template in the frequency domain is estimated to be cheaper than
+    // correlating it at every pixel of an image_size image, at placement_cost multiply-adds
+    // per placement (rows x cols for cv::matchTemplate)
+    static bool prefer_fft(const cv::Size& image_size, const cv::Size& dft_size,
+        double placement_cost, bool spectrum_cached);
+    // estimated cost of one bit-packed placement of a template of that many words
+    static double bit_cost(size_t words);
+
+    // match every template at every strike against the image thresholded at level i
+    bool rotation_template_match(size_t pga_threshold_index, const cv::Mat& image);
+
+    // match all PGA thresholds, Image[i] being the data image thresholded at log10_thresh[i]
+    bool template_match_image(const std::vector<cv::Mat>& Image);
+    // same, searching around the best strike and length of the previous iteration first
+    // (min_ind_strikes_old / min_ind_lengths_old)
+    bool template_match_image(const std::vector<cv::Mat>& Image,
+        const Finder_Data_Template& previous);
+
+    // fold the results into the per-threshold minima of the template set
+    void update(Finder_Data_Template& finder_data_templ) const;
+
+    const Template_Cache& get_cache() const { return *cache; }
+
+    vector3d<double> minVal_all; /**< minimum misfit for each PGA, strike and template */
+    vector3d<double> minLoc_lat; /**< best loc lat for each PGA, strike and template */
+    vector3d<double> minLoc_lon; /**< best loc lon for each PGA, strike and template */
+    vector3d<size_t> minCalc_all; /**< flag for computation completed at each PGA, strike and template */
+
+  private:
+    Template_Search(const Template_Search&);
+    Template_Search& operator=(const Template_Search&);
+
+    /** One thresholded data image prepared for matching, kept with its buffers across calls */
+    struct Level {
+        Level() : i(0), image_sum(0.), use_spectrum(false), use_bits(false), incremental(false) {}
+        size_t i; /**< PGA threshold index */
+        cv::Mat thresholded; /**< 0/1 image before resizing, unused at resize_fraction 1 */
+        cv::Mat binary; /**< resized 0/1 image */
+        cv::Mat padded; /**< binary with a zero border of pad_rows/pad_cols */
+        cv::Size size; /**< size of the resized image without the border */
+        double image_sum; /**< pixels set in the resized image */
+        cv::Mat padded32; /**< padded as CV_32F at dft_size */
+        cv::Mat spectrum; /**< DFT of the padded image */
+        bool use_spectrum; /**< spectrum is of this call, some template uses the FFT */
+        Bit_Image bits; /**< bit-packed padded image */
+        bool use_bits; /**< bits is of this call, in MATCH_AUTO or MATCH_BITS */
+        cv::Mat diff; /**< pixels changed since the previous timestep */
+        std::vector<cv::Point> points; /**< positions of the changed pixels */
+        cv::Rect changed; /**< bounding box of the pixels changed since the previous timestep */
+        bool incremental; /**< only re-score placements touching changed */
+        cv::Mat blocks; /**< block OR of padded, see coarse_image */
+        cv::Mat coarse; /**< blocks widened by one block to the right and below */
+        std::vector<double> bound; /**< coarse misfit bound per (strike, length) */
+        std::vector<size_t> order; /**< (strike, length) by increasing bound */
+        std::vector<char> scored; /**< order[n] was scored at full resolution */
+    };
+
+    // resized 0/1 image padded so that every template can be centred on every image pixel
+    void prepImage(const cv::Mat& image, Level& level) const;
+    void match_strike(const Level& level, size_t j);
+    // correlate a template over the whole image and keep its best placement
+    void score(const Level& level, size_t j, size_t k, cv::Mat& corr);
+    // keep the cell at its count bound if that is beyond minVal_min + prune_margin
+    bool prune_by_count(const Level& level, size_t j, size_t k);
+    // lower minVal_min to misfit
+    void lower_best(double misfit);
+    // coarse bounds first, then the templates that can come within prune_margin of the best
+    void match_hierarchical(Level& level);
+    // block OR of the padded image into level.coarse, widened by one block right and below
+    void coarse_image(Level& level) const;
+    // pixel count of template (i, j, k) per block, filled on first use
+    const cv::Mat& coarse_template(size_t i, size_t j, size_t k);
+    // best overlap of a template over the placements that touch the changed pixels
+    void match_changed(const Level& level, size_t j, size_t k, cv::Mat& corr);
+    void set_result(const Level& level, size_t j, size_t k, double overlap,
+        const cv::Point& centre);
+    bool detect_changes(Level& level);
+    // strike and length indices ordered by distance from the previous best
+    void search_order(size_t i, std::vector<size_t>& strikes, std::vector<size_t>& lengths) const;
+    bool use_fft(const Level& level, size_t j, size_t k) const;
+    // correlation map of template (i, j, k) centred on each pixel of the centres window of the
+    // image, bit-packed if the level has the bits, else with cv::matchTemplate
+    void correlate_window(const Level& level, size_t j, size_t k, const cv::Rect& centres,
+        cv::Mat& corr);
+    void correlate_fft(const Level& level, size_t j, size_t k, cv::Mat& corr);
+    const cv::Mat& template_spectrum(size_t i, size_t j, size_t k, cv::Mat& scratch);
+
+    std::shared_ptr<const Template_Cache> cache; /**< rotated templates of the set */
+    ImageParams imgparams; /**< extent of the data image */
+    std::shared_ptr<Worker_Pool> pool; /**< pool running the strikes, kept across configure */
+    Match_Mode match_mode; /**< correlation backend */
+    int pad_rows; /**< padding above and below the resized image */
+    int pad_cols; /**< padding left and right of the resized image */
+
+    cv::Size dft_size; /**< transform size of the padded image */
+    vector3d<cv::Mat> spectra; /**< template spectra at dft_size, filled on first use */
+    size_t spectrum_budget; /**< upper bound of spectrum_bytes */
+    std::atomic<size_t> spectrum_bytes; /**< memory held by spectra */
+    std::atomic<size_t> fft_matches; /**< templates correlated in the frequency domain */
+    std::atomic<size_t> direct_matches; /**< templates correlated with cv::matchTemplate */
+    std::atomic<size_t> bit_matches; /**< templates correlated bit-packed */
+
+    std::vector<Level> levels; /**< image of each PGA threshold, reused across calls */
+    std::vector<size_t> order_strikes; /**< strike order of rotation_template_match */
+    std::vector<size_t> order_lengths; /**< length order of rotation_template_match */
+
+    bool incremental; /**< reuse the previous timestep */
+    double restart_pc; /**< change in % of the previous image_sum that forces a full search */
+    std::vector<cv::Mat> prev_binary; /**< resized 0/1 image of the previous timestep per level */
+    std::vector<double> prev_sum; /**< pixels set in prev_binary */
+    std::vector<std::pair<size_t, size_t> > hint; /**< previous best (strike, length) per level */
+    vector3d<double> best_overlap; /**< overlap at the best placement of each template */
+    vector3d<cv::Point> best_centre; /**< best placement of each template, resized pixels */
+    size_t incremental_levels; /**< levels updated incrementally */
+    size_t full_levels; /**< levels searched completely */
+    std::atomic<size_t> rescored_templates; /**< templates correlated over the full image */
+
+    bool hierarchical; /**< coarse to fine search */
+    size_t coarse_factor; /**< block size of the coarse level */
+    double prune_margin; /**< misfit above the best within which every template is scored */
+    vector3d<cv::Mat> coarse_templates; /**< CV_32F pixel counts per block, per template */
+    std::atomic<size_t> coarse_matches; /**< templates bounded on the coarse level */
+    std::atomic<size_t> pruned_templates; /**< templates left out by their bound */
+
+    bool count_bound; /**< prune by the pixel count bound */
+    std::atomic<double> minVal_min; /**< best misfit over the thresholds searched so far */
+    std::atomic<size_t> count_pruned; /**< templates left out by their pixel count */
+}; // class Template_Search
+
+}; // end of FiniteFault namespace
+
+#endif // __finder_template_search_h__
+
+// end of file: finder_template_search.h
@@ -0,0 +1,279 @@
+//
+//      Memory-mapped binary store of FinDer template sets
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "finder_template_store.h"
+#include "../finder_headers/finder_globals.h" // logging macros
+
+namespace FiniteFault {
+
+namespace {
+    std::mutex registry_lock;
+    std::map<std::string, std::shared_ptr<Template_Store> > registry;
+
+    size_t align_up(const size_t value, const size_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    bool write_at(FILE* out, const size_t offset, const void* data, const size_t bytes) {
+        return fseek(out, (long) offset, SEEK_SET) == 0 && fwrite(data, 1, bytes, out) == bytes;
+    }
+}
+
+bool Template_Store::pack(const std::string& path, const std::string& name, const double dkm,
+        const std::vector<std::vector<cv::Mat> >& templates,
+        const std::vector<double>& log10_thresh, const std::vector<double>& degrees) {
+    const size_t N_thresh = templates.size();
+    const size_t N_templ = (N_thresh > 0) ? templates[0].size() : 0;
+    for (size_t i = 0; i < N_thresh; i++) {
+        if (templates[i].size() != N_templ) {
+            LOGE << "Template_Store: threshold " << i << " has " << templates[i].size() <<
+                " templates, expected " << N_templ << ELL;
+            return false;
+        }
+    }
+
+    Store_Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, STORE_MAGIC, sizeof(header.magic));
+    header.version = STORE_VERSION;
+    header.header_bytes = sizeof(Store_Header);
+    header.N_thresh = N_thresh;
+    header.N_templ = N_templ;
+    header.N_degrees = degrees.size();
+    header.dkm = dkm;
+    std::strncpy(header.name, name.c_str(), sizeof(header.name) - 1);
+
+    // entry table, then the thresholds and strikes, then the page aligned pixels
+    const size_t table_offset = sizeof(Store_Header);
+    const size_t values_offset = table_offset + N_thresh * N_templ * sizeof(Store_Entry);
+    size_t offset = align_up(values_offset + (N_thresh + degrees.size()) * sizeof(double),
+        STORE_PAGE);
+    header.data_offset = offset;
+
+    std::vector<Store_Entry> entries(N_thresh * N_templ);
+    std::vector<cv::Mat> mats(N_thresh * N_templ);
+    for (size_t i = 0; i < N_thresh; i++) {
+        for (size_t k = 0; k < N_templ; k++) {
+            const size_t n = i * N_templ + k;
+            // continuous copy, so that a template is one contiguous block in the file
+            templates[i][k].copyTo(mats[n]);
+            Store_Entry& entry = entries[n];
+            std::memset(&entry, 0, sizeof(entry));
+            entry.rows = mats[n].rows;
+            entry.cols = mats[n].cols;
+            entry.type = mats[n].empty() ? CV_8U : mats[n].type();
+            entry.step = mats[n].empty() ? 0 : mats[n].step[0];
+            entry.pixel_count = (mats[n].empty() || mats[n].channels() != 1) ? 0 :
+                cv::countNonZero(mats[n]);
+            entry.offset = offset;
+            offset = align_up(offset + entry.rows * entry.step, STORE_ALIGNMENT);
+        }
+    }
+    header.file_bytes = offset;
+
+    FILE* out = fopen(path.c_str(), "wb");
+    if (out == NULL) {
+        LOGE << "Template_Store: cannot write " << path << ELL;
+        return false;
+    }
+    std::vector<double> values(log10_thresh.begin(), log10_thresh.begin() +
+        std::min(N_thresh, log10_thresh.size()));
+    values.resize(N_thresh, 0.);
+    values.insert(values.end(), degrees.begin(), degrees.end());
+    bool status = write_at(out, 0, &header, sizeof(header)) &&
+        (entries.empty() || write_at(out, table_offset, &entries[0],
+            entries.size() * sizeof(Store_Entry))) &&
+        (values.empty() || write_at(out, values_offset, &values[0],
+            values.size() * sizeof(double)));
+    for (size_t n = 0; status && n < mats.size(); n++) {
+        if (mats[n].empty()) continue;
+        status = write_at(out, entries[n].offset, mats[n].data, entries[n].rows * entries[n].step);
+    }
+    // pad to the full length, so that the last template can be mapped
+    const char zero = 0;
+    status = status && fseek(out, 0, SEEK_END) == 0;
+    if (status && (size_t) ftell(out) < header.file_bytes) {
+        status = write_at(out, header.file_bytes - 1, &zero, 1);
+    }
+    status = (fclose(out) == 0) && status;
+    if (!status) {
+        LOGE << "Template_Store: writing " << path << " failed" << ELL;
+        std::remove(path.c_str());
+        return false;
+    }
+    LOGI << "Template_Store: packed " << N_thresh * N_templ << " templates of " << name <<
+        " into " << path << " (" << header.file_bytes / 1048576 << " MB)" << ELL;
+    return true;
+}
+
+bool Template_Store::pack(const std::string& path, const Finder_Parameters& finder_parameters) {
+    if (finder_parameters.templates.size() <
+            finder_parameters.N_thresh * finder_parameters.N_templ) {
+        LOGE << "Template_Store: no templates loaded for " << finder_parameters.name << ELL;
+        return false;
+    }
+    std::vector<std::vector<cv::Mat> > templates(finder_parameters.N_thresh);
+    for (size_t i = 0; i < finder_parameters.N_thresh; i++) {
+        for (size_t k = 0; k < finder_parameters.N_templ; k++) {
+            templates[i].push_back(finder_parameters.templates(i, k));
+        }
+    }
+    return pack(path, finder_parameters.name, finder_parameters.dkm, templates,
+        finder_parameters.log10_thresh, finder_parameters.degrees);
+}
+
+Template_Store::~Template_Store() {
+    mats.clear();
+}
+
+bool Template_Store::map(const std::string& path) {
+    this->path = path;
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        LOGE << "Template_Store: cannot open " << path << ELL;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(Store_Header)) {
+        LOGE << "Template_Store: " << path << " is too short for a template store" << ELL;
+        ::close(fd);
+        return false;
+    }
+    // private and writable: pages are shared until the library writes to a template
+    void* addr = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        LOGE << "Template_Store: cannot map " << path << ELL;
+        return false;
+    }
+    const size_t bytes = st.st_size;
+    mapped.reset(addr, [bytes](void* p) { munmap(p, bytes); });
+    mapped_bytes = bytes;
+    header = static_cast<const Store_Header*>(addr);
+
+    if (std::memcmp(header->magic, STORE_MAGIC, sizeof(STORE_MAGIC)) != 0 ||
+            header->version != STORE_VERSION || header->header_bytes != sizeof(Store_Header) ||
+            header->file_bytes > mapped_bytes || header->data_offset > header->file_bytes) {
+        LOGE << "Template_Store: " << path << " is not a version " << STORE_VERSION <<
+            " template store" << ELL;
+        return false;
+    }
+    // the counts are bounded by the file before any arithmetic on them
+    const size_t max_entries = mapped_bytes / sizeof(Store_Entry);
+    const size_t max_values = mapped_bytes / sizeof(double);
+    if ((header->N_thresh != 0 && header->N_templ > max_entries / header->N_thresh) ||
+            header->N_thresh > max_values || header->N_degrees > max_values) {
+        LOGE << "Template_Store: " << path << " has a corrupt entry table" << ELL;
+        return false;
+    }
+    const size_t N = header->N_thresh * header->N_templ;
+    const size_t values_offset = sizeof(Store_Header) + N * sizeof(Store_Entry);
+    if (values_offset + (header->N_thresh + header->N_degrees) * sizeof(double) >
+            header->data_offset) {
+        LOGE << "Template_Store: " << path << " has a corrupt entry table" << ELL;
+        return false;
+    }
+    const char* base = static_cast<const char*>(mapped.get());
+    entries = reinterpret_cast<const Store_Entry*>(base + sizeof(Store_Header));
+    const double* values = reinterpret_cast<const double*>(base + values_offset);
+    log10_thresh.assign(values, values + header->N_thresh);
+    degrees.assign(values + header->N_thresh, values + header->N_thresh + header->N_degrees);
+
+    mats.resize(N);
+    for (size_t n = 0; n < N; n++) {
+        const Store_Entry& entry = entries[n];
+        if (entry.rows == 0 || entry.cols == 0) continue;
+        if (entry.type != CV_MAT_TYPE(entry.type) ||
+                entry.step < (uint64_t) entry.cols * CV_ELEM_SIZE(entry.type)) {
+            LOGE << "Template_Store: template " << n << " of " << path <<
+                " has a corrupt shape" << ELL;
+            return false;
+        }
+        if (entry.offset < header->data_offset || entry.offset > mapped_bytes ||
+                entry.rows > (mapped_bytes - entry.offset) / entry.step) {
+            LOGE << "Template_Store: template " << n << " of " << path <<
+                " lies beyond the end of the file" << ELL;
+            return false;
+        }
+        // header only, the pixels stay in the mapping
+        mats[n] = cv::Mat(entry.rows, entry.cols, entry.type,
+            static_cast<char*>(mapped.get()) + entry.offset, entry.step);
+    }
+    return true;
+}
+
+std::shared_ptr<Template_Store> Template_Store::open(const std::string& path) {
+    std::shared_ptr<Template_Store> store(new Template_Store());
+    if (!store->map(path)) return std::shared_ptr<Template_Store>();
+    return store;
+}
+
+std::shared_ptr<Template_Store> Template_Store::for_path(const std::string& path) {
+    std::lock_guard<std::mutex> lk(registry_lock);
+    std::map<std::string, std::shared_ptr<Template_Store> >::iterator it = registry.find(path);
+    if (it != registry.end()) return it->second;
+    std::shared_ptr<Template_Store> store = open(path);
+    if (store) registry[path] = store;
+    return store;
+}
+
+std::vector<std::vector<cv::Mat> > Template_Store::get_templates() const {
+    std::vector<std::vector<cv::Mat> > templates(header->N_thresh);
+    for (size_t i = 0; i < header->N_thresh; i++) {
+        for (size_t k = 0; k < header->N_templ; k++) {
+            templates[i].push_back(get(i, k));
+        }
+    }
+    return templates;
+}
+
+bool Template_Store::load(Finder_Parameters& finder_parameters) const {
+    const size_t N_thresh = header->N_thresh, N_templ = header->N_templ;
+    if (finder_parameters.N_thresh != N_thresh || finder_parameters.N_templ != N_templ) {
+        LOGE << "Template_Store: " << path << " holds " << N_thresh << "x" << N_templ <<
+            " templates, " << finder_parameters.name << " expects " <<
+            finder_parameters.N_thresh << "x" << finder_parameters.N_templ << ELL;
+        return false;
+    }
+    for (size_t i = 0; i < N_thresh && i < finder_parameters.log10_thresh.size(); i++) {
+        if (finder_parameters.log10_thresh[i] != log10_thresh[i]) {
+            LOGE << "Template_Store: " << path << " was packed for other PGA thresholds" << ELL;
+            return false;
+        }
+    }
+
+    finder_parameters.templates.assign_size(N_thresh, N_templ);
+    finder_parameters.template_sum_all = vector2d<size_t>(N_thresh, N_templ, 0);
+    finder_parameters.rows_templ.assign(N_templ, 0);
+    finder_parameters.cols_templ.assign(N_templ, 0);
+    for (size_t i = 0; i < N_thresh; i++) {
+        for (size_t k = 0; k < N_templ; k++) {
+            finder_parameters.templates(i, k) = get(i, k);
+            finder_parameters.template_sum_all(i, k) = get_pixel_count(i, k);
+            finder_parameters.rows_templ[k] = std::max<size_t>(finder_parameters.rows_templ[k],
+                get(i, k).rows);
+            finder_parameters.cols_templ[k] = std::max<size_t>(finder_parameters.cols_templ[k],
+                get(i, k).cols);
+        }
+    }
+    // the stored templates are not modified after loading, copies of the parameters can
+    // share the mapped pixels, which the registry keeps mapped
+    finder_parameters.templates.share(mapped);
+    LOGD << "Template_Store: " << finder_parameters.name << " mapped from " << path << ELL;
+    return true;
+}
+
+}; // end of FiniteFault namespace
+
+// end of file: finder_template_store.cpp
@@ -0,0 +1,129 @@
+//
+//      Memory-mapped binary store of FinDer template sets
+//
+//      Finder_Parameters::load_templates reads every template file of a set into its own
+//      cv::Mat on every start. The store packs one template set into one file offline: a fixed
+//      header, one entry per (PGA threshold, template) and the pixel data, each template aligned
+//      to STORE_ALIGNMENT bytes. Loading maps the file and wraps cv::Mat headers around the
+//      mapped pages, so nothing is parsed or copied. All FinDer processes on a host that map the
+//      same file share its page cache. The mapping is private: a template written to by the
+//      library gets its own copy of the touched pages and the file is never modified. Within
+//      Finder_Engine::load, Finder::Init has read the template files before the store replaces
+//      them, so the store saves resident memory, not startup time.
+//
+//      map checks every count and offset of the file against its length before using it, so a
+//      truncated or corrupt store fails to open rather than pointing a template past the end.
+//
+//      Layout, native byte order:
+//          Store_Header
+//          Store_Entry[N_thresh * N_templ], in (i, k) order
+//          double log10_thresh[N_thresh], double degrees[N_degrees]
+//          pixel data, from data_offset (page aligned)
+//
+
+#ifndef __finder_template_store_h__
+#define __finder_template_store_h__
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../finder_headers/finder_parameters.h"
+
+namespace FiniteFault {
+
+const char STORE_MAGIC[8] = { 'F', 'D', 'R', 'T', 'M', 'P', 'L', '1' }; /**< file signature */
+const uint32_t STORE_VERSION = 1; /**< format version */
+const size_t STORE_ALIGNMENT = 64; /**< alignment of each template, in bytes */
+const size_t STORE_PAGE = 4096; /**< alignment of the pixel data */
+
+/** Fixed-size head of a store file */
+struct Store_Header {
+    char magic[8]; /**< STORE_MAGIC */
+    uint32_t version; /**< STORE_VERSION */
+    uint32_t header_bytes; /**< sizeof(Store_Header), guards against layout changes */
+    uint64_t N_thresh; /**< number of PGA thresholds */
+    uint64_t N_templ; /**< number of templates */
+    uint64_t N_degrees; /**< number of strikes */
+    uint64_t data_offset; /**< start of the pixel data */
+    uint64_t file_bytes; /**< total file size */
+    double dkm; /**< template resolution in km */
+    char name[64]; /**< template set name, zero terminated */
+};
+
+/** Position and shape of one template in a store file */
+struct Store_Entry {
+    uint32_t rows; /**< template rows */
+    uint32_t cols; /**< template columns */
+    int32_t type; /**< OpenCV type, e.g. CV_8U */
+    uint32_t reserved; /**< zero */
+    uint64_t offset; /**< start of the pixels in the file */
+    uint64_t step; /**< bytes per row */
+    uint64_t pixel_count; /**< non-zero pixels, template_sum_all */
+};
+
+/** \class Template_Store
+ * \brief Read-only view of a packed template set mapped into memory.
+ * */
+class Template_Store {
+  public:
+    ~Template_Store();
+
+    // write templates[i][k] (PGA threshold i, template k) into one store file
+    static bool pack(const std::string& path, const std::string& name, const double dkm,
+        const std::vector<std::vector<cv::Mat> >& templates,
+        const std::vector<double>& log10_thresh, const std::vector<double>& degrees);
+    // write the loaded templates of a set
+    static bool pack(const std::string& path, const Finder_Parameters& finder_parameters);
+
+    // map a store file, NULL if it cannot be read or is not a valid store
+    static std::shared_ptr<Template_Store> open(const std::string& path);
+    // store of a path mapped once per process and shared by all template sets using it
+    static std::shared_ptr<Template_Store> for_path(const std::string& path);
+
+    const std::string& get_path() const { return path; }
+    std::string get_name() const { return std::string(header->name); }
+    double get_dkm() const { return header->dkm; }
+    size_t get_N_thresh() const { return header->N_thresh; }
+    size_t get_N_templ() const { return header->N_templ; }
+    size_t get_N_degrees() const { return header->N_degrees; }
+    size_t get_file_bytes() const { return mapped_bytes; }
+    const std::vector<double>& get_log10_thresh() const { return log10_thresh; }
+    const std::vector<double>& get_degrees() const { return degrees; }
+
+    // template k at threshold i, a header over the mapped pages
+    const cv::Mat& get(size_t i, size_t k) const { return mats[i * header->N_templ + k]; }
+    size_t get_pixel_count(size_t i, size_t k) const {
+        return entries[i * header->N_templ + k].pixel_count;
+    }
+    // all templates as templates[i][k], sharing the mapped pages
+    std::vector<std::vector<cv::Mat> > get_templates() const;
+
+    // point Finder_Parameters::templates and template_sum_all at the mapped templates, in place
+    // of Finder_Parameters::load_templates. The templates are shared with the mapping as their
+    // owner, so it stays mapped while registered; the store must outlive finder_parameters.
+    bool load(Finder_Parameters& finder_parameters) const;
+
+  private:
+    Template_Store() : header(NULL), entries(NULL), mapped_bytes(0) {}
+    Template_Store(const Template_Store&);
+    Template_Store& operator=(const Template_Store&);
+
+    bool map(const std::string& path);
+
+    std::string path; /**< store file */
+    const Store_Header* header; /**< start of the mapping */
+    const Store_Entry* entries; /**< entry table in the mapping */
+    std::shared_ptr<void> mapped; /**< mapping returned by mmap, unmapped by its last holder */
+    size_t mapped_bytes; /**< length of the mapping */
+    std::vector<double> log10_thresh; /**< PGA thresholds the set was packed for */
+    std::vector<double> degrees; /**< strikes the set was packed for */
+    std::vector<cv::Mat> mats; /**< headers over the mapped templates, in (i, k) order */
+}; // class Template_Store
+
+}; // end of FiniteFault namespace
+
+#endif // __finder_template_store_h__
+
+// end of file: finder_template_store.h
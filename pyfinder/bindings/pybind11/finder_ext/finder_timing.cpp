@@ -0,0 +1,202 @@
+//
+//      Per-stage latency spans of the processing pipeline
+//
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+#include "finder_timing.h"
+#include "../finder_headers/finder_globals.h" // logging macros
+
+namespace FiniteFault {
+
+namespace {
+    // fields are atomics so that a reader racing the writer is well defined, seq tells it
+    // whether it read a whole span: 2n + 2 once span n is complete, odd while it is written
+    struct Ring_Slot {
+        std::atomic<uint64_t> seq;
+        std::atomic<uint64_t> start_ns;
+        std::atomic<uint64_t> duration_ns;
+        std::atomic<uint32_t> stage;
+        std::atomic<int64_t> tag;
+        Ring_Slot() : seq(0), start_ns(0), duration_ns(0), stage(0), tag(0) {}
+    };
+
+    // spans of one thread, written by that thread only
+    struct Timing_Ring {
+        explicit Timing_Ring(const uint32_t id) : id(id), head(0), first(0),
+            slots(TIMING_RING_SPANS) {}
+
+        void push(const uint64_t start_ns, const uint64_t duration_ns, const uint32_t stage,
+                const int64_t tag) {
+            const uint64_t n = head.load(std::memory_order_relaxed);
+            Ring_Slot& slot = slots[n % slots.size()];
+            slot.seq.store(2 * n + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            slot.start_ns.store(start_ns, std::memory_order_relaxed);
+            slot.duration_ns.store(duration_ns, std::memory_order_relaxed);
+            slot.stage.store(stage, std::memory_order_relaxed);
+            slot.tag.store(tag, std::memory_order_relaxed);
+            slot.seq.store(2 * n + 2, std::memory_order_release);
+            head.store(n + 1, std::memory_order_release);
+        }
+
+        void read(std::vector<Timing_Span>& spans) const {
+            const uint64_t end = head.load(std::memory_order_acquire);
+            uint64_t n = std::max(first.load(std::memory_order_relaxed),
+                end > slots.size() ? end - slots.size() : (uint64_t) 0);
+            for (; n < end; n++) {
+                const Ring_Slot& slot = slots[n % slots.size()];
+                if (slot.seq.load(std::memory_order_acquire) != 2 * n + 2) continue;
+                Timing_Span span;
+                span.start_ns = slot.start_ns.load(std::memory_order_relaxed);
+                span.duration_ns = slot.duration_ns.load(std::memory_order_relaxed);
+                span.stage = slot.stage.load(std::memory_order_relaxed);
+                span.tag = slot.tag.load(std::memory_order_relaxed);
+                span.thread = id;
+                std::atomic_thread_fence(std::memory_order_acquire);
+                // overwritten while being copied
+                if (slot.seq.load(std::memory_order_relaxed) != 2 * n + 2) continue;
+                spans.push_back(span);
+            }
+        }
+
+        const uint32_t id; /**< thread number */
+        std::atomic<uint64_t> head; /**< spans written so far */
+        std::atomic<uint64_t> first; /**< first span not cleared */
+        std::vector<Ring_Slot> slots; /**< span n is in slot n % size */
+    };
+
+    // rings outlive their threads, so that the spans of finished threads can still be read;
+    // never destroyed, threads may still record during exit
+    struct Ring_Registry {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<Timing_Ring> > rings;
+    };
+
+    Ring_Registry& registry() {
+        static Ring_Registry* instance = new Ring_Registry();
+        return *instance;
+    }
+
+    thread_local Timing_Ring* tl_ring = NULL; /**< ring of the current thread, if any */
+
+    Timing_Ring& thread_ring() {
+        if (tl_ring == NULL) {
+            Ring_Registry& reg = registry();
+            std::lock_guard<std::mutex> lock(reg.mutex);
+            reg.rings.emplace_back(new Timing_Ring((uint32_t) reg.rings.size()));
+            tl_ring = reg.rings.back().get();
+        }
+        return *tl_ring;
+    }
+
+    std::atomic<uint64_t> stage_count[N_TIMING_STAGES];
+    std::atomic<uint64_t> stage_total_ns[N_TIMING_STAGES];
+    std::atomic<uint64_t> stage_max_ns[N_TIMING_STAGES];
+    std::atomic<uint64_t> slow_ns(0); /**< log_slow_ms in ns */
+}
+
+std::atomic<bool> Stage_Timing::enabled(false);
+
+uint64_t Stage_Timing::now_ns() {
+    return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Stage_Timing::record(const Timing_Stage stage, const uint64_t start_ns, const int64_t tag) {
+    const uint64_t end_ns = now_ns();
+    const uint64_t duration_ns = end_ns > start_ns ? end_ns - start_ns : 0;
+    thread_ring().push(start_ns, duration_ns, stage, tag);
+
+    stage_count[stage].fetch_add(1, std::memory_order_relaxed);
+    stage_total_ns[stage].fetch_add(duration_ns, std::memory_order_relaxed);
+    uint64_t current = stage_max_ns[stage].load(std::memory_order_relaxed);
+    while (duration_ns > current && !stage_max_ns[stage].compare_exchange_weak(current,
+        duration_ns, std::memory_order_relaxed)) {}
+
+    const uint64_t slow = slow_ns.load(std::memory_order_relaxed);
+    if (slow > 0 && duration_ns > slow) {
+        LOGI << "Stage_Timing: " << TimingStageString[stage] << " took " << duration_ns * 1e-6 <<
+            " ms" << (tag >= 0 ? ", tag " + std::to_string(tag) : std::string()) << ELL;
+    }
+}
+
+void Stage_Timing::set_log_slow_ms(const double ms) {
+    slow_ns.store(ms > 0. ? (uint64_t) (ms * 1e6) : 0, std::memory_order_relaxed);
+}
+
+double Stage_Timing::get_log_slow_ms() {
+    return slow_ns.load(std::memory_order_relaxed) * 1e-6;
+}
+
+void Stage_Timing::collect(std::vector<Timing_Span>& spans) {
+    spans.clear();
+    Ring_Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (size_t r = 0; r < reg.rings.size(); r++) reg.rings[r]->read(spans);
+}
+
+void Stage_Timing::clear() {
+    Ring_Registry& reg = registry();
+    {
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        for (size_t r = 0; r < reg.rings.size(); r++) {
+            reg.rings[r]->first.store(reg.rings[r]->head.load());
+        }
+    }
+    for (size_t s = 0; s < N_TIMING_STAGES; s++) {
+        stage_count[s].store(0);
+        stage_total_ns[s].store(0);
+        stage_max_ns[s].store(0);
+    }
+}
+
+size_t Stage_Timing::get_count(const Timing_Stage stage) { return stage_count[stage].load(); }
+
+uint64_t Stage_Timing::get_total_ns(const Timing_Stage stage) {
+    return stage_total_ns[stage].load();
+}
+
+uint64_t Stage_Timing::get_max_ns(const Timing_Stage stage) { return stage_max_ns[stage].load(); }
+
+std::string Stage_Timing::prometheus_text(const std::string& prefix) {
+    std::ostringstream out;
+    out.precision(9);
+    out << "# HELP " << prefix << "_stage_calls_total Spans recorded per pipeline stage\n" <<
+        "# TYPE " << prefix << "_stage_calls_total counter\n";
+    for (size_t s = 0; s < N_TIMING_STAGES; s++) {
+        out << prefix << "_stage_calls_total{stage=\"" << TimingStageString[s] << "\"} " <<
+            stage_count[s].load() << "\n";
+    }
+    out << "# HELP " << prefix << "_stage_seconds_total Time spent per pipeline stage\n" <<
+        "# TYPE " << prefix << "_stage_seconds_total counter\n";
+    for (size_t s = 0; s < N_TIMING_STAGES; s++) {
+        out << prefix << "_stage_seconds_total{stage=\"" << TimingStageString[s] << "\"} " <<
+            stage_total_ns[s].load() * 1e-9 << "\n";
+    }
+    out << "# HELP " << prefix << "_stage_max_seconds Longest span per pipeline stage\n" <<
+        "# TYPE " << prefix << "_stage_max_seconds gauge\n";
+    for (size_t s = 0; s < N_TIMING_STAGES; s++) {
+        out << prefix << "_stage_max_seconds{stage=\"" << TimingStageString[s] << "\"} " <<
+            stage_max_ns[s].load() * 1e-9 << "\n";
+    }
+    return out.str();
+}
+
+void Stage_Timing::log_summary() {
+    for (size_t s = 0; s < N_TIMING_STAGES; s++) {
+        const uint64_t count = stage_count[s].load();
+        if (count == 0) continue;
+        LOGI << "Stage_Timing: " << TimingStageString[s] << " " << count << " calls, mean " <<
+            stage_total_ns[s].load() * 1e-6 / count << " ms, max " <<
+            stage_max_ns[s].load() * 1e-6 << " ms" << ELL;
+    }
+}
+
+}; // end of FiniteFault namespace
+
+// end of file: finder_timing.cpp
@@ -0,0 +1,121 @@
+//
+//      Per-stage latency spans of the processing pipeline
+//
+//      Finder::process only reports its timing as LOGV text through DEBUG_TRACE. A Stage_Timer
+//      measures one stage of the pipeline, from construction to destruction, with the steady
+//      clock. The span goes into a ring buffer of the thread that ran it. Each ring has one
+//      writer, so recording is two clock reads and a few relaxed stores, without a lock. A
+//      reader copies the rings with a per-slot sequence number and skips any slot that was
+//      being overwritten meanwhile. Per-stage call counts, total and maximum durations are kept
+//      for all spans, also those the rings have dropped, in the Prometheus text format by
+//      prometheus_text. A span longer than log_slow_ms is logged at once with LOGI, so through
+//      SeisComP logging when built with plog2sclog_wrapper.h.
+//
+//      The stages inside Finder::process (reject_data_by_percentile, strike_estimate, ...) run
+//      in libFinder and are timed as a whole by STAGE_PROCESS. The other stages are the calls
+//      the extension makes itself: Scan_Data, the gridding, the template matching.
+//
+//      Timing is off until enable(true); a Stage_Timer then costs one relaxed load.
+//
+
+#ifndef __finder_timing_h__
+#define __finder_timing_h__
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace FiniteFault {
+
+/** Timed pipeline stage
+ * */
+enum Timing_Stage {
+    STAGE_PROCESS, /**< Finder::process, one event update */
+    STAGE_SCAN, /**< Finder::Scan_Data, triggering */
+    STAGE_ASSOCIATE, /**< Finder::Associate_Time */
+    STAGE_INGEST, /**< fill_pga_data_list from column arrays */
+    STAGE_GRIDDING, /**< Image_Gridder::grid, the prepImage / gmtImage counterpart */
+    STAGE_THRESHOLD, /**< Image_Gridder::threshold */
+    STAGE_SEARCH, /**< Template_Search of one PGA threshold */
+    STAGE_MASK_UPDATE, /**< Mask_Store::update */
+    N_TIMING_STAGES
+};
+
+const std::string TimingStageString[] = { "process", "scan", "associate", "ingest", "gridding",
+    "threshold", "search", "mask_update" };
+
+const size_t TIMING_RING_SPANS = 4096; /**< spans kept per thread */
+
+/** One timed stage
+ * */
+struct Timing_Span {
+    uint64_t start_ns; /**< steady clock at the start */
+    uint64_t duration_ns; /**< time spent in the stage */
+    uint32_t stage; /**< Timing_Stage */
+    uint32_t thread; /**< ring of the thread, numbered in order of first span */
+    int64_t tag; /**< e.g. the event id or threshold index; -1 if none */
+};
+
+/** \class Stage_Timing
+ * \brief Switch, rings and per-stage totals of the Stage_Timer spans.
+ * */
+class Stage_Timing {
+  public:
+    static void enable(const bool on) { enabled.store(on, std::memory_order_relaxed); }
+    static bool is_enabled() { return enabled.load(std::memory_order_relaxed); }
+    // spans over log_slow_ms are logged as they end, 0 for none
+    static void set_log_slow_ms(const double ms);
+    static double get_log_slow_ms();
+
+    // the spans still in the rings, oldest first per thread
+    static void collect(std::vector<Timing_Span>& spans);
+    // forget the spans and totals
+    static void clear();
+
+    static size_t get_count(const Timing_Stage stage);
+    static uint64_t get_total_ns(const Timing_Stage stage);
+    static uint64_t get_max_ns(const Timing_Stage stage);
+    // counters and totals of every stage, as finder_stage_calls_total{stage="..."} and so on
+    static std::string prometheus_text(const std::string& prefix = "finder");
+    // one LOGI line per stage with its calls, mean and maximum
+    static void log_summary();
+
+    // steady clock in ns
+    static uint64_t now_ns();
+    // add a span ended now
+    static void record(const Timing_Stage stage, const uint64_t start_ns, const int64_t tag);
+
+  private:
+    static std::atomic<bool> enabled; /**< spans are recorded */
+}; // class Stage_Timing
+
+/** \class Stage_Timer
+ * \brief Records the span of one stage, from construction to stop or destruction.
+ * */
+class Stage_Timer {
+  public:
+    explicit Stage_Timer(const Timing_Stage stage, const int64_t tag = -1) :
+        stage(stage), tag(tag), start_ns(Stage_Timing::is_enabled() ? Stage_Timing::now_ns() : 0) {}
+    ~Stage_Timer() { stop(); }
+
+    void stop() {
+        if (start_ns == 0) return;
+        Stage_Timing::record(stage, start_ns, tag);
+        start_ns = 0;
+    }
+
+  private:
+    Stage_Timer(const Stage_Timer&);
+    Stage_Timer& operator=(const Stage_Timer&);
+
+    Timing_Stage stage; /**< stage timed */
+    int64_t tag; /**< tag of the span */
+    uint64_t start_ns; /**< start of the span, 0 if timing was off */
+}; // class Stage_Timer
+
+}; // end of FiniteFault namespace
+
+#endif // __finder_timing_h__
+
+// end of file: finder_timing.h
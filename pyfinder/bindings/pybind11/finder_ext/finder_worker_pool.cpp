@@ -0,0 +1,223 @@
+//
+//      Persistent work-stealing thread pool for FinDer processing
+//
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <sstream>
+
+#include "finder_worker_pool.h"
+#include "../finder_headers/finder_globals.h" // logging macros
+
+namespace FiniteFault {
+
+const std::string WORKER_THREADS_KEY = "worker_threads"; /**< optional config file key */
+
+namespace {
+    thread_local Worker_Pool* tl_pool = NULL; /**< pool owning the current thread, if any */
+    thread_local size_t tl_index = 0; /**< index of the current worker in tl_pool */
+
+    std::mutex instance_lock;
+    std::shared_ptr<Worker_Pool> shared_pool;
+    // pools replaced by configure that searches or schedulers may still hold
+    std::vector<std::shared_ptr<Worker_Pool> > retired_pools;
+}
+
+Worker_Pool::Worker_Pool(const size_t n_threads) : queued(0), next_queue(0), stopping(false) {
+    size_t n = n_threads;
+    if (n == 0) n = std::thread::hardware_concurrency();
+    if (n == 0) n = 1;
+    for (size_t i = 0; i < n; i++) {
+        queues.push_back(new Worker_Queue());
+    }
+    for (size_t i = 0; i < n; i++) {
+        workers.push_back(std::thread(&Worker_Pool::worker_loop, this, i));
+    }
+}
+
+Worker_Pool::~Worker_Pool() {
+    {
+        std::lock_guard<std::mutex> lk(sleep_lock);
+        stopping.store(true);
+    }
+    wake.notify_all();
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+    for (size_t i = 0; i < queues.size(); i++) {
+        delete queues[i];
+    }
+}
+
+void Worker_Pool::submit(const Task& task, Task_Group* group) {
+    if (group != NULL) group->pending.fetch_add(1, std::memory_order_acq_rel);
+    Queued_Task queued_task = { task, group };
+
+    // workers push onto their own deque, everybody else round robin
+    const size_t target = (tl_pool == this) ? tl_index :
+        next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+    {
+        std::lock_guard<std::mutex> lk(queues[target]->lock);
+        queues[target]->tasks.push_back(queued_task);
+    }
+    queued.fetch_add(1, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lk(sleep_lock);
+    }
+    wake.notify_one();
+}
+
+bool Worker_Pool::pop_task(const size_t index, Queued_Task& out) {
+    Worker_Queue* q = queues[index];
+    std::lock_guard<std::mutex> lk(q->lock);
+    if (q->tasks.empty()) return false;
+    out = q->tasks.back();
+    q->tasks.pop_back();
+    return true;
+}
+
+bool Worker_Pool::steal_task(const size_t thief, Queued_Task& out) {
+    for (size_t n = 1; n <= queues.size(); n++) {
+        Worker_Queue* q = queues[(thief + n) % queues.size()];
+        std::lock_guard<std::mutex> lk(q->lock);
+        if (!q->tasks.empty()) {
+            out = q->tasks.front();
+            q->tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void Worker_Pool::run(Queued_Task& queued_task) {
+    queued.fetch_sub(1, std::memory_order_acq_rel);
+    Task_Group* group = queued_task.group;
+    try {
+        queued_task.task();
+    } catch (...) {
+        if (group != NULL) {
+            // the waiter rethrows it
+            std::lock_guard<std::mutex> lk(group->error_lock);
+            if (!group->error) group->error = std::current_exception();
+        } else {
+            try {
+                throw;
+            } catch (const std::exception& e) {
+                LOGE << "Worker_Pool: task failed: " << e.what() << ELL;
+            } catch (...) {
+                LOGE << "Worker_Pool: task failed with an unknown exception" << ELL;
+            }
+        }
+    }
+    if (group != NULL && group->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        std::lock_guard<std::mutex> lk(sleep_lock);
+        finished.notify_all();
+    }
+}
+
+bool Worker_Pool::try_run_one(const size_t index) {
+    Queued_Task queued_task;
+    const bool own = (tl_pool == this);
+    if ((own && pop_task(index, queued_task)) || steal_task(index, queued_task)) {
+        run(queued_task);
+        return true;
+    }
+    return false;
+}
+
+void Worker_Pool::worker_loop(const size_t index) {
+    tl_pool = this;
+    tl_index = index;
+    while (!stopping.load()) {
+        if (try_run_one(index)) continue;
+        std::unique_lock<std::mutex> lk(sleep_lock);
+        wake.wait(lk, [this] { return stopping.load() || queued.load() > 0; });
+    }
+}
+
+void Worker_Pool::wait(Task_Group& group) {
+    const size_t index = (tl_pool == this) ? tl_index : 0;
+    while (!group.done()) {
+        if (try_run_one(index)) continue;
+        // the remaining tasks are running on other threads
+        std::unique_lock<std::mutex> lk(sleep_lock);
+        finished.wait_for(lk, std::chrono::milliseconds(1), [&group] { return group.done(); });
+    }
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lk(group.error_lock);
+        std::swap(error, group.error);
+    }
+    if (error) std::rethrow_exception(error);
+}
+
+void Worker_Pool::parallel_for(const size_t begin, const size_t end,
+        const std::function<void(size_t)>& fn) {
+    if (end <= begin) return;
+    const size_t n = end - begin;
+    if (n == 1) {
+        fn(begin);
+        return;
+    }
+    // a few chunks per thread keeps the stealing balanced without one task per index
+    const size_t chunk = std::max<size_t>(1, n / (4 * size()));
+    Task_Group group;
+    for (size_t start = begin; start < end; start += chunk) {
+        const size_t stop = std::min(end, start + chunk);
+        submit([&fn, start, stop] {
+            for (size_t i = start; i < stop; i++) fn(i);
+        }, &group);
+    }
+    wait(group);
+}
+
+std::shared_ptr<Worker_Pool> Worker_Pool::instance() {
+    std::lock_guard<std::mutex> lk(instance_lock);
+    if (!shared_pool) {
+        shared_pool = std::make_shared<Worker_Pool>();
+    }
+    return shared_pool;
+}
+
+void Worker_Pool::configure(const size_t n_threads) {
+    std::vector<std::shared_ptr<Worker_Pool> > unused;
+    {
+        std::lock_guard<std::mutex> lk(instance_lock);
+        const size_t n = (n_threads != 0) ? n_threads : std::thread::hardware_concurrency();
+        if (shared_pool && shared_pool->size() == n) return;
+        if (shared_pool) retired_pools.push_back(shared_pool);
+        shared_pool = std::make_shared<Worker_Pool>(n_threads);
+        LOGI << "Worker_Pool: running with " << shared_pool->size() << " threads" << ELL;
+        // only the list holds these, and instance no longer hands them out
+        for (size_t i = 0; i < retired_pools.size(); ) {
+            if (retired_pools[i].use_count() == 1) {
+                unused.push_back(retired_pools[i]);
+                retired_pools.erase(retired_pools.begin() + i);
+            } else {
+                i++;
+            }
+        }
+    }
+    // joined outside the lock, and not from a worker of these pools: configure is not a task
+}
+
+size_t Worker_Pool::threads_from_config(const std::string& config_file) {
+    std::ifstream in(config_file.c_str());
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream ss(line);
+        std::string key;
+        long value = 0;
+        if (ss >> key >> value && key == WORKER_THREADS_KEY && value > 0) {
+            return (size_t) value;
+        }
+    }
+    return 0;
+}
+
+}; // end of FiniteFault namespace
+
+// end of file: finder_worker_pool.cpp
@@ -0,0 +1,118 @@
+//
+//      Persistent work-stealing thread pool for FinDer processing
+//
+//      The threads are created once (at Finder::Init time through the bindings) and reused by
+//      every timestep, instead of starting a thread per template set on each process_image.
+//      Each worker owns a task deque: it pops its own tasks LIFO and steals FIFO from the other
+//      workers when it runs dry. A thread waiting on a Task_Group keeps executing queued tasks, so
+//      groups can be nested (template sets -> PGA thresholds -> strikes) without deadlock. An
+//      exception thrown by a task of a group is passed to the thread waiting on the group.
+//
+//      The shared pool is handed out as a shared_ptr. configure puts a new pool in its place and
+//      retires the old one, which stays alive as long as a search or scheduler holds it, so that
+//      their tasks still run after set_worker_threads or Finder.Init. A retired pool is destroyed
+//      by a later configure or at exit once nothing else holds it, never by one of its own
+//      workers.
+//
+
+#ifndef __finder_worker_pool_h__
+#define __finder_worker_pool_h__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace FiniteFault {
+
+class Worker_Pool;
+
+/** \class Task_Group
+ * \brief Counts the outstanding tasks of one batch so that the submitter can wait for them.
+ * */
+class Task_Group {
+  public:
+    Task_Group() : pending(0) {}
+    bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+
+  private:
+    friend class Worker_Pool;
+    std::atomic<size_t> pending; /**< tasks submitted but not finished */
+    std::mutex error_lock; /**< guards error */
+    std::exception_ptr error; /**< first exception thrown by a task of the group */
+}; // class Task_Group
+
+/** \class Worker_Pool
+ * \brief Fixed-size pool of worker threads with per-worker deques and work stealing.
+ * */
+class Worker_Pool {
+  public:
+    typedef std::function<void()> Task;
+
+    explicit Worker_Pool(const size_t n_threads = 0);
+    ~Worker_Pool();
+
+    size_t size() const { return workers.size(); }
+
+    // queue a task; it is counted in group if one is given
+    void submit(const Task& task, Task_Group* group = NULL);
+
+    // block until all tasks of the group finished, running queued tasks meanwhile; rethrows
+    // the first exception a task of the group threw
+    void wait(Task_Group& group);
+
+    // run fn(i) for i in [begin, end) across the pool and return when all are done, rethrows
+    // the first exception of fn
+    void parallel_for(const size_t begin, const size_t end,
+        const std::function<void(size_t)>& fn);
+
+    // pool shared by all FinDer processing in this process; holders keep it alive across
+    // configure
+    static std::shared_ptr<Worker_Pool> instance();
+    // replace the shared pool by one of n_threads, 0 means one thread per hardware thread
+    static void configure(const size_t n_threads);
+    // worker_threads value from a FinDer config file, 0 if it is not set
+    static size_t threads_from_config(const std::string& config_file);
+
+  private:
+    Worker_Pool(const Worker_Pool&);
+    Worker_Pool& operator=(const Worker_Pool&);
+
+    struct Queued_Task {
+        Task task;
+        Task_Group* group;
+    };
+
+    struct Worker_Queue {
+        std::mutex lock;
+        std::deque<Queued_Task> tasks;
+    };
+
+    void worker_loop(const size_t index);
+    bool pop_task(const size_t index, Queued_Task& out);
+    bool steal_task(const size_t thief, Queued_Task& out);
+    bool try_run_one(const size_t index);
+    void run(Queued_Task& queued);
+
+    std::vector<std::thread> workers; /**< worker threads */
+    std::vector<Worker_Queue*> queues; /**< one deque per worker */
+    std::atomic<size_t> queued; /**< tasks sitting in any deque */
+    std::atomic<size_t> next_queue; /**< round robin target for external submits */
+    std::atomic<bool> stopping; /**< set by the destructor */
+    std::mutex sleep_lock; /**< protects the idle wait */
+    std::condition_variable wake; /**< signals new tasks or stop */
+    std::condition_variable finished; /**< signals finished tasks to waiters */
+}; // class Worker_Pool
+
+}; // end of FiniteFault namespace
+
+#endif // __finder_worker_pool_h__
+
+// end of file: finder_worker_pool.h
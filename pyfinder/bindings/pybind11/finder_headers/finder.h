@@ -166,6 +166,21 @@ class Finder {
     Finder_Length_LLK_List get_finder_length_llk_list() const { return this->f_data.get_finder_length_llk_list(); }
     LogLikelihood2D_List get_centroid_lat_pdf() const { return this->f_data.get_centroid_lat_pdf(); }
     LogLikelihood2D_List get_centroid_lon_pdf() const { return this->f_data.get_centroid_lon_pdf(); }
+    // by reference, valid until the next process()
+    const Finder_Rupture_List& get_finder_rupture_list_ref() const
+        { return this->f_data.get_finder_rupture_list_ref(); }
+    const Finder_Azimuth_List& get_finder_azimuth_list_ref() const
+        { return this->f_data.get_finder_azimuth_list_ref(); }
+    const Finder_Length_List& get_finder_length_list_ref() const
+        { return this->f_data.get_finder_length_list_ref(); }
+    const Finder_Azimuth_LLK_List& get_finder_azimuth_llk_list_ref() const
+        { return this->f_data.get_finder_azimuth_llk_list_ref(); }
+    const Finder_Length_LLK_List& get_finder_length_llk_list_ref() const
+        { return this->f_data.get_finder_length_llk_list_ref(); }
+    const LogLikelihood2D_List& get_centroid_lat_pdf_ref() const
+        { return this->f_data.get_centroid_lat_pdf_ref(); }
+    const LogLikelihood2D_List& get_centroid_lon_pdf_ref() const
+        { return this->f_data.get_centroid_lon_pdf_ref(); }
 
     long get_last_message_time() const { return this->last_message_time; }
     long get_start_time() const { return this->start_time; }
@@ -177,6 +192,9 @@ class Finder {
     PGA_Data_List get_rejected_stations() const
         { return this->rejected_stations; }
     PGA_Data_List get_pga_above_min_thresh() const { return this->pga_above_min_thresh; }
+    const PGA_Data_List& get_pga_data_list_ref() const { return this->pga_data_list; }
+    const PGA_Data_List& get_rejected_stations_ref() const { return this->rejected_stations; }
+    const PGA_Data_List& get_pga_above_min_thresh_ref() const { return this->pga_above_min_thresh; }
     static Finder_Config* get_finder_config() { return &Finder_config; };
     static Finder_Parameters* get_finder_parameters() { return &Finder_parameters; };
     std::vector<Finder_Parameters*> get_finder_parameters_list() { return fparam_list; };
@@ -190,12 +208,18 @@ class Finder {
         { this->finder_flags = finder_flags_new; }
     void set_hold_time(const long hold_time) 
         { this->hold_time = hold_time; }
-    void set_rejected_stations(const PGA_Data_List rejected_stations) 
+    void set_rejected_stations(const PGA_Data_List& rejected_stations)
         { this->rejected_stations = rejected_stations; }
-    void set_pga_data_list(const PGA_Data_List pga_data_list_new) 
+    void set_rejected_stations(PGA_Data_List&& rejected_stations)
+        { this->rejected_stations = std::move(rejected_stations); }
+    void set_pga_data_list(const PGA_Data_List& pga_data_list_new)
         { this->pga_data_list = pga_data_list_new; }
-    void set_pga_above_min_thresh(const PGA_Data_List pga_above_min_thresh_new) 
+    void set_pga_data_list(PGA_Data_List&& pga_data_list_new)
+        { this->pga_data_list = std::move(pga_data_list_new); }
+    void set_pga_above_min_thresh(const PGA_Data_List& pga_above_min_thresh_new)
         { this->pga_above_min_thresh = pga_above_min_thresh_new; }
+    void set_pga_above_min_thresh(PGA_Data_List&& pga_above_min_thresh_new)
+        { this->pga_above_min_thresh = std::move(pga_above_min_thresh_new); }
 
     // variables to be taken from core_info and inserted into Befores
     Finder_Data f_data; /**< Pointer to internal Finder_Data structure */
@@ -204,6 +228,8 @@ class Finder {
     std::vector<Finder_Parameters*> fparam_list;
 
   private:
+    // keeps the static state of inactive configurations, see finder_ext/finder_engine.h
+    friend class Finder_Engine;
 
     static Finder_Config Finder_config;
     static Finder_Parameters Finder_parameters;
@@ -53,18 +53,19 @@
     #include "plog/Log.h"
     #define ELL ""
 #endif
-#ifdef ENABLE_SCLOG 
+#ifdef ENABLE_SCLOG // a message ends with its statement, ELL only ends a line
     #include "plog2sclog_wrapper.h"
-    #define ELL "ELL"
+    #define ELL std::endl
 #endif
-#ifndef LOGV
-    #define LOGV std::cout
-    #define LOGD std::cout 
-    #define LOGI std::cout 
-    #define LOGW std::cout
-    #define LOGE std::cout
-    #define LOGF std::cout
-    #define LOGN std::cout
+#ifndef LOGV // level-filtered, see finder_ext/finder_log.h
+    #include "../finder_ext/finder_log.h"
+    #define LOGV FINDER_LOG(FiniteFault::LOG_VERBOSE)
+    #define LOGD FINDER_LOG(FiniteFault::LOG_DEBUG)
+    #define LOGI FINDER_LOG(FiniteFault::LOG_INFO)
+    #define LOGW FINDER_LOG(FiniteFault::LOG_WARNING)
+    #define LOGE FINDER_LOG(FiniteFault::LOG_ERROR)
+    #define LOGF FINDER_LOG(FiniteFault::LOG_FATAL)
+    #define LOGN FINDER_LOG(FiniteFault::LOG_INFO)
     #define ELL std::endl
 #endif 
 
@@ -53,6 +53,10 @@
 #ifndef __finder_opencv_h__
 #define __finder_opencv_h__
 
+#include <map>
+#include <memory>
+#include <mutex>
+
 #include "opencv2/highgui/highgui.hpp"
 #include "opencv2/imgproc/imgproc.hpp"
 
@@ -67,6 +71,11 @@ namespace FiniteFault { // retain the scope of these functions to namespace Fini
  * Matrix2d contains a pointer to a Mat structure, and provides access functions based on 
  * indices and index arithmetic. Note that standard operations have had to be overloaded to
  * allow valid use of this class for example in = and push_back to vector. 
+ * Copies are deep, except for Mats marked with share(): those are immutable from then on and
+ * copies reference the same pixels. The registry of shared pixels holds each buffer, the
+ * OpenCV allocation or the owner given to share(), so that the address it is keyed by cannot
+ * be freed and handed to another allocation while it is registered. Moves transfer the Mat
+ * array.
  */
 class Matrix2d {
   public:
@@ -88,20 +97,20 @@ class Matrix2d {
         }
     }
 
-    Matrix2d(const Matrix2d & in) {
-        if (this != &in) {
-            Mat* new_matdata = new Mat[in.Ndata];
-            for (size_t i=0; i<in.Ndata; i++) {
-                in.Matdata[i].copyTo(new_matdata[i]);
-            }
-            Matdata = new_matdata;
-            d1 = in.d1;
-            d2 = in.d2;
-            Ndata = in.Ndata;
-        }
+    Matrix2d(const Matrix2d & in) : d1(in.d1), d2(in.d2), Ndata(in.Ndata), Matdata(NULL) {
+        Matdata = copy_data(in);
+    }
+
+    Matrix2d(Matrix2d && in) noexcept : d1(in.d1), d2(in.d2), Ndata(in.Ndata),
+            Matdata(in.Matdata) {
+        in.d1 = 0;
+        in.d2 = 0;
+        in.Ndata = 0;
+        in.Matdata = NULL;
     }
 
     Mat * assign_size(size_t d1_new, size_t d2_new) {
+        delete [] Matdata;
         d1 = d1_new; d2 = d2_new;
         Ndata = d1*d2;
         return this->Matdata = new Mat[Ndata];
@@ -119,10 +128,8 @@ class Matrix2d {
 
     Matrix2d & operator=(const Matrix2d& in) {
         if (this != &in) {
-            Mat* new_matdata = new Mat[in.Ndata];
-            for (size_t i=0; i<in.Ndata; i++) {
-                in.Matdata[i].copyTo(new_matdata[i]);
-            }
+            Mat* new_matdata = copy_data(in);
+            delete [] Matdata;
             Matdata = new_matdata;
             d1 = in.d1;
             d2 = in.d2;
@@ -131,10 +138,61 @@ class Matrix2d {
         return *this;
     }
 
+    Matrix2d & operator=(Matrix2d&& in) noexcept {
+        if (this != &in) {
+            delete [] Matdata;
+            Matdata = in.Matdata;
+            d1 = in.d1;
+            d2 = in.d2;
+            Ndata = in.Ndata;
+            in.Matdata = NULL;
+            in.d1 = 0;
+            in.d2 = 0;
+            in.Ndata = 0;
+        }
+        return *this;
+    }
+
     size_t size() const { return Ndata; }
 
     size_t size() { return Ndata; }
 
+    // Mark the pixels of every Mat as immutable and shared: copies of this matrix, and of
+    // any matrix holding the same pixels, take a header instead of a deep copy. Without an
+    // owner, the pixels must be allocated by OpenCV and the header kept per buffer holds
+    // them. Pixels OpenCV does not own, e.g. mapped from a file, need the owner of their
+    // memory, which is held until unshare_all().
+    void share(const std::shared_ptr<const void>& owner = std::shared_ptr<const void>()) {
+        std::lock_guard<std::mutex> lk(shared_lock());
+        for (size_t i=0; i<Ndata; i++) {
+            if (Matdata[i].data != NULL) {
+                Shared_Buffer& buffer = shared_buffers()[Matdata[i].data];
+                buffer.header = Matdata[i];
+                buffer.owner = owner;
+            }
+        }
+    }
+
+    bool is_shared() const {
+        std::lock_guard<std::mutex> lk(shared_lock());
+        for (size_t i=0; i<Ndata; i++) {
+            if (Matdata[i].data != NULL && shared_buffers().count(Matdata[i].data) == 0) {
+                return false;
+            }
+        }
+        return Ndata > 0;
+    }
+
+    // Forget all shared pixels, e.g. before the templates are reloaded. Matrices that share
+    // pixels allocated by OpenCV keep them; their copies are deep again. Pixels of an owner
+    // stay valid while that owner is held elsewhere.
+    static void unshare_all() {
+        // freed after the lock is released
+        std::map<const uchar*, Shared_Buffer> released;
+        std::lock_guard<std::mutex> lk(shared_lock());
+        released.swap(shared_buffers());
+    }
+
     friend ostream& operator<< (ostream& os, const Matrix2d& f) {
         os << std::endl << 
         "Ndata: " << f.Ndata << std::endl <<
@@ -148,6 +206,36 @@ class Matrix2d {
     }
 
   private:
+    /** Pixels registered by share() */
+    struct Shared_Buffer {
+        Mat header; /**< holds pixels allocated by OpenCV */
+        std::shared_ptr<const void> owner; /**< holds other pixels, e.g. a file mapping */
+    };
+
+    Mat* copy_data(const Matrix2d& in) const {
+        Mat* new_matdata = new Mat[in.Ndata];
+        std::lock_guard<std::mutex> lk(shared_lock());
+        const std::map<const uchar*, Shared_Buffer>& shared = shared_buffers();
+        for (size_t i=0; i<in.Ndata; i++) {
+            if (in.Matdata[i].data != NULL && shared.count(in.Matdata[i].data) > 0) {
+                new_matdata[i] = in.Matdata[i];
+            } else {
+                in.Matdata[i].copyTo(new_matdata[i]);
+            }
+        }
+        return new_matdata;
+    }
+
+    static std::map<const uchar*, Shared_Buffer>& shared_buffers() {
+        static std::map<const uchar*, Shared_Buffer> buffers;
+        return buffers;
+    }
+
+    static std::mutex& shared_lock() {
+        static std::mutex lock;
+        return lock;
+    }
+
     size_t d1,d2, Ndata;
     Mat* Matdata;
 };
@@ -366,6 +366,7 @@ class PGA_Data {
         bool get_include() const { return this->include; }
         bool get_trigger_flag() const { return this->trigger_flag; }
         TemplateCollection<long> get_event_id_list() const { return this->event_id_list; }
+        const TemplateCollection<long>& get_event_id_list_ref() const { return this->event_id_list; }
 
         void update_value(const double value, const double timestamp)
         {
@@ -682,24 +683,30 @@ class Finder_Info : public Core_Info {
 
 		void set_template_id(const string template_id) { this->template_id = template_id; }
 		void set_finder_centroid(const Finder_Centroid finder_centroid) { this->finder_centroid = finder_centroid; }
-		void set_finder_rupture_list(const Finder_Rupture_List finder_rupture_list) { 
-            this->finder_rupture_list.resize(0);
-            this->finder_rupture_list = finder_rupture_list; 
-        }
-		void set_finder_length_list(const Finder_Length_List finder_length_list) { 
-            this->finder_length_list.resize(0);
-            this->finder_length_list = finder_length_list; 
-        }
-		void set_finder_azimuth_list(const Finder_Azimuth_List finder_azimuth_list) { 
-            this->finder_azimuth_list.resize(0);
-            this->finder_azimuth_list = finder_azimuth_list; 
-        }
+		void set_finder_rupture_list(const Finder_Rupture_List& finder_rupture_list)
+			{ this->finder_rupture_list = finder_rupture_list; }
+		void set_finder_rupture_list(Finder_Rupture_List&& finder_rupture_list)
+			{ this->finder_rupture_list = std::move(finder_rupture_list); }
+		void set_finder_length_list(const Finder_Length_List& finder_length_list)
+			{ this->finder_length_list = finder_length_list; }
+		void set_finder_length_list(Finder_Length_List&& finder_length_list)
+			{ this->finder_length_list = std::move(finder_length_list); }
+		void set_finder_azimuth_list(const Finder_Azimuth_List& finder_azimuth_list)
+			{ this->finder_azimuth_list = finder_azimuth_list; }
+		void set_finder_azimuth_list(Finder_Azimuth_List&& finder_azimuth_list)
+			{ this->finder_azimuth_list = std::move(finder_azimuth_list); }
 
 		std::string get_template_id() const { return this->template_id; }
 		Finder_Centroid get_finder_centroid() const { return this->finder_centroid; }
 		Finder_Rupture_List get_finder_rupture_list() const { return this->finder_rupture_list; }
 		Finder_Length_List get_finder_length_list() const { return this->finder_length_list; }
 		Finder_Azimuth_List get_finder_azimuth_list() const { return this->finder_azimuth_list; }
+		const Finder_Rupture_List& get_finder_rupture_list_ref() const
+			{ return this->finder_rupture_list; }
+		const Finder_Length_List& get_finder_length_list_ref() const
+			{ return this->finder_length_list; }
+		const Finder_Azimuth_List& get_finder_azimuth_list_ref() const
+			{ return this->finder_azimuth_list; }
 
        friend std::ostream& operator<< (std::ostream& os, const Finder_Info& in) {
             os << (Core_Info&)in << std::endl;
@@ -939,6 +946,7 @@ class Finder_Internal {
     double get_origin_time() const { return this->origin_time; }
     double get_likelihood_estimate() const { return this->likelihood_estimate; }
     double get_misfit(size_t i) const { return this->misfit[i]; }
+    size_t get_misfit_size() const { return this->misfit.size(); }
     double get_rupture_length() const { return this->rupture_length; }
     double get_rupture_azimuth() const { return this->rupture_azimuth; }
     double get_azimuth_uncer() const { return this->azimuth_uncer; }
@@ -953,6 +961,19 @@ class Finder_Internal {
         { return this->finder_length_llk_list; }
     LogLikelihood2D_List get_centroid_lat_pdf() const { return this->centroid_lat_pdf; }
     LogLikelihood2D_List get_centroid_lon_pdf() const { return this->centroid_lon_pdf; }
+    // the lists by reference, valid as long as this object is and until the next update
+    const Finder_Rupture_List& get_finder_rupture_list_ref() const
+        { return this->finder_rupture_list; }
+    const Finder_Azimuth_List& get_finder_azimuth_list_ref() const
+        { return this->finder_azimuth_list; }
+    const Finder_Length_List& get_finder_length_list_ref() const
+        { return this->finder_length_list; }
+    const Finder_Azimuth_LLK_List& get_finder_azimuth_llk_list_ref() const
+        { return this->finder_azimuth_llk_list; }
+    const Finder_Length_LLK_List& get_finder_length_llk_list_ref() const
+        { return this->finder_length_llk_list; }
+    const LogLikelihood2D_List& get_centroid_lat_pdf_ref() const { return this->centroid_lat_pdf; }
+    const LogLikelihood2D_List& get_centroid_lon_pdf_ref() const { return this->centroid_lon_pdf; }
 
     void set_template_id(const std::string template_id) { this->template_id = template_id; }
     void set_Nstat_used(const size_t Nstat_used) { this->Nstat_used = Nstat_used; }
@@ -980,34 +1001,20 @@ class Finder_Internal {
         { this->finder_centroid = Finder_Centroid(lat, lon); }
     void set_finder_centroid_uncer(const double lat, const double lon)
         { this->finder_centroid_uncer = Finder_Centroid(lat, lon); }
-    void set_finder_rupture_list(const Finder_Rupture_List finder_rupture_list_new) {
-        this->finder_rupture_list.resize(0);
-        this->finder_rupture_list = finder_rupture_list_new; 
-    }
-    void set_finder_azimuth_list(const Finder_Azimuth_List finder_azimuth_list_new) { 
-        this->finder_azimuth_list.resize(0);
-        this->finder_azimuth_list = finder_azimuth_list_new; 
-    }
-    void set_finder_length_list(const Finder_Length_List finder_length_list_new) {
-        this->finder_length_list.resize(0);
-        this->finder_length_list = finder_length_list_new; 
-    }
-    void set_finder_azimuth_llk_list(const Finder_Azimuth_LLK_List finder_azimuth_llk_list_new) {
-        this->finder_azimuth_llk_list.resize(0);
-        this->finder_azimuth_llk_list = finder_azimuth_llk_list_new; 
-    }
-    void set_finder_length_llk_list(const Finder_Length_LLK_List finder_length_llk_list_new) {
-        this->finder_length_llk_list.resize(0);
-        this->finder_length_llk_list = finder_length_llk_list_new; 
-    }
-    void set_centroid_lat_pdf(const LogLikelihood2D_List centroid_lat_pdf) { 
-        this->centroid_lat_pdf.resize(0);
-        this->centroid_lat_pdf = centroid_lat_pdf; 
-    }
-    void set_centroid_lon_pdf(const LogLikelihood2D_List centroid_lon_pdf) { 
-        this->centroid_lon_pdf.resize(0);
-        this->centroid_lon_pdf = centroid_lon_pdf; 
-    }
+    void set_finder_rupture_list(const Finder_Rupture_List& finder_rupture_list_new) { this->finder_rupture_list = finder_rupture_list_new; }
+    void set_finder_rupture_list(Finder_Rupture_List&& finder_rupture_list_new) { this->finder_rupture_list = std::move(finder_rupture_list_new); }
+    void set_finder_azimuth_list(const Finder_Azimuth_List& finder_azimuth_list_new) { this->finder_azimuth_list = finder_azimuth_list_new; }
+    void set_finder_azimuth_list(Finder_Azimuth_List&& finder_azimuth_list_new) { this->finder_azimuth_list = std::move(finder_azimuth_list_new); }
+    void set_finder_length_list(const Finder_Length_List& finder_length_list_new) { this->finder_length_list = finder_length_list_new; }
+    void set_finder_length_list(Finder_Length_List&& finder_length_list_new) { this->finder_length_list = std::move(finder_length_list_new); }
+    void set_finder_azimuth_llk_list(const Finder_Azimuth_LLK_List& finder_azimuth_llk_list_new) { this->finder_azimuth_llk_list = finder_azimuth_llk_list_new; }
+    void set_finder_azimuth_llk_list(Finder_Azimuth_LLK_List&& finder_azimuth_llk_list_new) { this->finder_azimuth_llk_list = std::move(finder_azimuth_llk_list_new); }
+    void set_finder_length_llk_list(const Finder_Length_LLK_List& finder_length_llk_list_new) { this->finder_length_llk_list = finder_length_llk_list_new; }
+    void set_finder_length_llk_list(Finder_Length_LLK_List&& finder_length_llk_list_new) { this->finder_length_llk_list = std::move(finder_length_llk_list_new); }
+    void set_centroid_lat_pdf(const LogLikelihood2D_List& centroid_lat_pdf) { this->centroid_lat_pdf = centroid_lat_pdf; }
+    void set_centroid_lat_pdf(LogLikelihood2D_List&& centroid_lat_pdf) { this->centroid_lat_pdf = std::move(centroid_lat_pdf); }
+    void set_centroid_lon_pdf(const LogLikelihood2D_List& centroid_lon_pdf) { this->centroid_lon_pdf = centroid_lon_pdf; }
+    void set_centroid_lon_pdf(LogLikelihood2D_List&& centroid_lon_pdf) { this->centroid_lon_pdf = std::move(centroid_lon_pdf); }
 
     void resize_rupture_list(int size) { finder_rupture_list.resize(size); }
     void resize_azimuth_list(int size) { finder_azimuth_list.resize(size); }
@@ -28,7 +28,9 @@
 
 #include <seiscomp/logging/log.h>
 #include <algorithm>
-#include <sstream>
+#include <string>
+
+#include "../finder_ext/finder_log.h"
 
 namespace sclogwrap {
 enum Log_Level {
@@ -38,80 +40,39 @@ enum Log_Level {
   DEBUG
 }; // log level to pass to sclog
 
-class Record {
-  private:
-    Log_Level m_severity;
-    std::stringstream m_message;
-    std::string m_ell;
-
-  public:
-    Record(Log_Level severity) : m_severity(severity) {
-      m_ell = "ELL";
-    }
-
-    //Templated operator>> that uses the std::ostream: Everything that has defined
-    //an operator<< for the std::ostream (Everithing "printable" with std::cout
-    //and its colleages) can use this function.
-
-    void sclog() {
-        std::string str = m_message.str();
-        str.erase(std::remove(str.begin(), str.end(), '\n'), str.end());
-        switch(m_severity) {
-          case 0:
-            SEISCOMP_ERROR("%s",str.c_str());
-            break;
-          case 1:
-            SEISCOMP_WARNING("%s",str.c_str());
-            break;
-          case 2:
-            SEISCOMP_INFO("%s",str.c_str());
-            break;
-          case 3:
-            SEISCOMP_DEBUG("%s",str.c_str());
-            break;
-          default:
-            SEISCOMP_DEBUG("%s",str.c_str());
-            break;
-        }
-        m_message.clear();
-        m_message.str(std::string());
-        return;
-    }
-
-    Record& operator<< (char data) {
-        char str[] = { data, 0 };
-        m_message << str;
-        return *this;
-    }
-
-    Record& operator<< (std::ostream& (*data)(std::ostream&)) {
-        m_message << data;
-        return *this;
+// Sink of the FinDer log messages: one SeisComP log line per message, without its newlines.
+// The message is formatted once, by FiniteFault::Log_Record, and only if its level is enabled.
+// finder_log.cpp installs it as the initial sink and lets every level through, so that the
+// SeisComP verbosity decides what is written.
+inline void sclog(const FiniteFault::Log_Level level, const char* message, const size_t length) {
+    thread_local std::string str;
+    str.assign(message, length);
+    str.erase(std::remove(str.begin(), str.end(), '\n'), str.end());
+    switch (level) {
+      case FiniteFault::LOG_FATAL:
+      case FiniteFault::LOG_ERROR:
+        SEISCOMP_ERROR("%s", str.c_str());
+        break;
+      case FiniteFault::LOG_WARNING:
+        SEISCOMP_WARNING("%s", str.c_str());
+        break;
+      case FiniteFault::LOG_INFO:
+        SEISCOMP_INFO("%s", str.c_str());
+        break;
+      default:
+        SEISCOMP_DEBUG("%s", str.c_str());
+        break;
     }
-
-    template<typename T>
-    Record& operator<< (const T& data) {
-        std::stringstream ss;
-        ss << data;
-        if (ss.str() == m_ell) {
-            if (m_message.str().length() > 0) {
-                sclog();
-            }
-        } else {
-            m_message << ss.str();
-        }
-        return *this;
-    }
-}; // class Record
+}
 }
 
-#define LOGF  sclogwrap::Record(sclogwrap::ERROR)
-#define LOGE  sclogwrap::Record(sclogwrap::ERROR)
-#define LOGW  sclogwrap::Record(sclogwrap::WARNING)
-#define LOGI  sclogwrap::Record(sclogwrap::INFO)
-#define LOGD  sclogwrap::Record(sclogwrap::DEBUG)
-#define LOGV  sclogwrap::Record(sclogwrap::DEBUG)
-#define LOGN  sclogwrap::Record(sclogwrap::DEBUG)
+#define LOGF  FINDER_LOG(FiniteFault::LOG_FATAL)
+#define LOGE  FINDER_LOG(FiniteFault::LOG_ERROR)
+#define LOGW  FINDER_LOG(FiniteFault::LOG_WARNING)
+#define LOGI  FINDER_LOG(FiniteFault::LOG_INFO)
+#define LOGD  FINDER_LOG(FiniteFault::LOG_DEBUG)
+#define LOGV  FINDER_LOG(FiniteFault::LOG_VERBOSE)
+#define LOGN  FINDER_LOG(FiniteFault::LOG_INFO)
 
 #endif // __plog2sclog_wrapper_h__
 
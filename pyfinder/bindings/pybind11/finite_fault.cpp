@@ -1,14 +1,46 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
+#include <pybind11/numpy.h>
+#include <cstring>
+#include <memory>
+#include <type_traits>
 #include "finder_headers/finite_fault.h"
 #include "finder_headers/finder.h"
+#include "finder_ext/finder_alloc_stats.h"
+#include "finder_ext/finder_engine.h"
+#include "finder_ext/finder_geodesy.h"
+#include "finder_ext/finder_gridding.h"
+#include "finder_ext/finder_log.h"
+#include "finder_ext/finder_mag_regression.h"
+#include "finder_ext/finder_mask_store.h"
+#include "finder_ext/finder_pga_array.h"
+#include "finder_ext/finder_pga_ingest.h"
+#include "finder_ext/finder_replay.h"
+#include "finder_ext/finder_result_writer.h"
+#include "finder_ext/finder_scheduler.h"
+#include "finder_ext/finder_scratch.h"
+#include "finder_ext/finder_snapshot.h"
+#include "finder_ext/finder_state_lock.h"
+#include "finder_ext/finder_station_index.h"
+#include "finder_ext/finder_worker_pool.h"
+#include "finder_ext/finder_popcount.h"
+#include "finder_ext/finder_template_cache.h"
+#include "finder_ext/finder_template_footprints.h"
+#include "finder_ext/finder_template_search.h"
+#include "finder_ext/finder_template_store.h"
+#include "finder_ext/finder_timing.h"
 
 namespace py = pybind11;
 
 // Forward declarations
-template <typename T> void bind_TemplateCollection(py::module &m, const std::string &typeName);
+template <typename T>
+py::class_<FiniteFault::TemplateCollection<T>> bind_TemplateCollection(py::module &m,
+                                                                const std::string &typeName);
 void init_finite_fault_bindings(py::module &ff);
 void init_finder_bindings(py::module &ff);
+void init_gridding_bindings(py::module &ff);
+void init_matching_bindings(py::module &ff);
+void init_ingest_bindings(py::module &ff);
 
 // Main bindings entry function for the FiniteFault namespace
 PYBIND11_MODULE(pylibfinder, m) {
@@ -22,14 +54,101 @@ PYBIND11_MODULE(pylibfinder, m) {
 
     // Bind Finder class within FiniteFault
     init_finder_bindings(ff);
+
+    // Bind the in-memory image gridding within FiniteFault
+    init_gridding_bindings(ff);
+
+    // Bind the cached template search within FiniteFault
+    init_matching_bindings(ff);
+
+    // Bind the bulk PGA input within FiniteFault
+    init_ingest_bindings(ff);
+}
+
+// Copy a single channel float image into a 2D numpy array of shape (rows, cols)
+py::array_t<float> mat_to_array(const cv::Mat &img) {
+    cv::Mat img32;
+    img.convertTo(img32, CV_32F);
+    py::array_t<float> arr({img32.rows, img32.cols});
+    for (int r = 0; r < img32.rows; r++) {
+        std::memcpy(arr.mutable_data(r, 0), img32.ptr<float>(r), img32.cols * sizeof(float));
+    }
+    return arr;
+}
+
+// Copy a 2D numpy array into a single channel float image
+cv::Mat array_to_mat(const py::array_t<float, py::array::c_style | py::array::forcecast> &arr) {
+    if (arr.ndim() != 2) {
+        throw std::runtime_error("Expected a 2D array");
+    }
+    cv::Mat img((int) arr.shape(0), (int) arr.shape(1), CV_32F);
+    for (int r = 0; r < img.rows; r++) {
+        std::memcpy(img.ptr<float>(r), arr.data(r, 0), img.cols * sizeof(float));
+    }
+    return img;
+}
+
+// Copy a (N_thresh, N_degrees, N_templ) result of Template_Search into a 3D numpy array
+template <typename T>
+py::array_t<T> vector3d_to_array(const FiniteFault::vector3d<T> &v,
+                                 const FiniteFault::Template_Cache &cache) {
+    const size_t d1 = cache.get_N_thresh(), d2 = cache.get_N_degrees(), d3 = cache.get_N_templ();
+    py::array_t<T> arr({d1, d2, d3});
+    T *out = arr.mutable_data();
+    for (size_t i = 0; i < d1; i++)
+        for (size_t j = 0; j < d2; j++)
+            for (size_t k = 0; k < d3; k++)
+                *out++ = v(i, j, k);
+    return arr;
+}
+
+// Fields of the records that list_arrays exports, in member order
+static const char *const COORDINATE_FIELDS[] = {"lat", "lon"};
+static const char *const RUPTURE_FIELDS[] = {"lat", "lon", "depth"};
+static const char *const MISFIT_FIELDS[] = {"value", "misf"};
+static const char *const LLK_FIELDS[] = {"value", "llk"};
+static const char *const LLK2D_FIELDS[] = {"lat", "lon", "llk"};
+
+// Read-only numpy views over a list of records of N doubles, one 1D array per field strided
+// over the records, in a dict by field name. The arrays keep owner alive and are valid until
+// the list is next resized or refilled.
+template <typename T, size_t N>
+py::dict list_arrays(const std::vector<T> &list, const char *const (&fields)[N], py::handle owner) {
+    static_assert(sizeof(T) == N * sizeof(double) && std::is_trivially_copyable<T>::value,
+                  "list_arrays needs records made of N doubles only");
+    const double *records = reinterpret_cast<const double*>(list.data());
+    py::dict arrays;
+    for (size_t f = 0; f < N; f++) {
+        py::array field(py::dtype::of<double>(), std::vector<size_t>{list.size()},
+                        std::vector<size_t>{sizeof(T)}, list.empty() ? nullptr : records + f,
+                        owner);
+        field.attr("setflags")(py::arg("write") = false);
+        arrays[fields[f]] = field;
+    }
+    return arrays;
+}
+
+// Adds as_arrays() to a bound list, the list_arrays views over it
+template <typename T, size_t N>
+void def_as_arrays(py::class_<FiniteFault::TemplateCollection<T>> &cls,
+                   const char *const (&fields)[N]) {
+    using Collection = FiniteFault::TemplateCollection<T>;
+    const char *const (*names)[N] = &fields;
+    cls.def("as_arrays", [names](py::object self) {
+            return list_arrays(self.cast<const Collection&>(), *names, self);
+        },
+        "Read-only arrays of each field by name, without a copy. They keep the list alive "
+        "and are valid until it is next modified.");
 }
 
 // Bind TemplateCollection class explicity to avoid issues with py::bind_vector
 template <typename T>
-void bind_TemplateCollection(py::module &m, const std::string &typeName) {
+py::class_<FiniteFault::TemplateCollection<T>> bind_TemplateCollection(py::module &m,
+                                                                const std::string &typeName) {
     using Collection = FiniteFault::TemplateCollection<T>;
 
-    py::class_<Collection>(m, typeName.c_str())
+    py::class_<Collection> cls(m, typeName.c_str());
+    cls
         .def(py::init<>())
         //.def("clear", &Collection::clear)
         .def("clear", [](Collection &c) { c.std::vector<T>::clear(); })
@@ -56,6 +175,7 @@ void bind_TemplateCollection(py::module &m, const std::string &typeName) {
         });
         
         // Add other std::vector methods and custom methods of TemplateCollection as needed
+    return cls;
 }
 
 
@@ -83,7 +203,8 @@ void init_finite_fault_bindings(py::module &ff){
 
     // Use an alias for CoordinateList since it is a specialization of TemplateCollection
     // ff.attr("Coordinate_List") = ff.attr("CoordinateCollection");
-    bind_TemplateCollection<FiniteFault::Coordinate>(ff, "Coordinate_List");
+    auto coordinate_list = bind_TemplateCollection<FiniteFault::Coordinate>(ff, "Coordinate_List");
+    def_as_arrays(coordinate_list, COORDINATE_FIELDS);
 
     // Bind PGA_Data class within FiniteFault
     py::class_<FiniteFault::PGA_Data>(ff, "PGA_Data")
@@ -137,7 +258,8 @@ void init_finite_fault_bindings(py::module &ff){
              });
 
     // Bind Finder_Rupture_List
-    bind_TemplateCollection<FiniteFault::Finder_Rupture>(ff, "Finder_Rupture_List");
+    auto finder_rupture_list = bind_TemplateCollection<FiniteFault::Finder_Rupture>(ff, "Finder_Rupture_List");
+    def_as_arrays(finder_rupture_list, RUPTURE_FIELDS);
     
     // Bind Misfit class within FiniteFault
     py::class_<FiniteFault::Misfit>(ff, "Misfit")
@@ -153,7 +275,8 @@ void init_finite_fault_bindings(py::module &ff){
              });
 
     // Bind Misfit_List as a vector of Misfit pointers withtin FiniteFault namespace
-    bind_TemplateCollection<FiniteFault::Misfit>(ff, "Misfit_List");
+    auto misfit_list = bind_TemplateCollection<FiniteFault::Misfit>(ff, "Misfit_List");
+    def_as_arrays(misfit_list, MISFIT_FIELDS);
 
     // Bind Finder_Azimuth which inherits from Misfit
     py::class_<FiniteFault::Finder_Azimuth, FiniteFault::Misfit>(ff, "Finder_Azimuth")
@@ -168,7 +291,8 @@ void init_finite_fault_bindings(py::module &ff){
              });
 
     // Bind Finder_Azimuth_List
-    bind_TemplateCollection<FiniteFault::Finder_Azimuth>(ff, "Finder_Azimuth_List");
+    auto finder_azimuth_list = bind_TemplateCollection<FiniteFault::Finder_Azimuth>(ff, "Finder_Azimuth_List");
+    def_as_arrays(finder_azimuth_list, MISFIT_FIELDS);
     
     // Bind Finder_Length, inheriting from Misfit
     py::class_<FiniteFault::Finder_Length, FiniteFault::Misfit>(ff, "Finder_Length")
@@ -183,7 +307,8 @@ void init_finite_fault_bindings(py::module &ff){
              });
 
     // Bind Finder_Length_List
-    bind_TemplateCollection<FiniteFault::Finder_Length>(ff, "Finder_Length_List");
+    auto finder_length_list = bind_TemplateCollection<FiniteFault::Finder_Length>(ff, "Finder_Length_List");
+    def_as_arrays(finder_length_list, MISFIT_FIELDS);
 
     
     // Bind LogLikelihood class within FiniteFault
@@ -198,7 +323,8 @@ void init_finite_fault_bindings(py::module &ff){
              });
 
     // Bind LogLikelihood_List as a vector of LogLikelihood pointers
-    bind_TemplateCollection<FiniteFault::LogLikelihood>(ff, "LogLikelihood_List");
+    auto loglikelihood_list = bind_TemplateCollection<FiniteFault::LogLikelihood>(ff, "LogLikelihood_List");
+    def_as_arrays(loglikelihood_list, LLK_FIELDS);
 
     // // Bind Finder_Azimuth_LLK, inheriting from LogLikelihood
     // py::class_<FiniteFault::Finder_Azimuth_LLK, FiniteFault::LogLikelihood>(ff, "FinderAzimuthLLK")
@@ -216,18 +342,263 @@ void init_finite_fault_bindings(py::module &ff){
 }
 
 
+// Station indices as an int64 numpy array
+py::array_t<int64_t> indices_to_array(const std::vector<size_t> &indices) {
+    py::array_t<int64_t> arr(indices.size());
+    int64_t *out = arr.mutable_data();
+    for (size_t n = 0; n < indices.size(); n++) out[n] = (int64_t) indices[n];
+    return arr;
+}
+
+// Station indices from a numpy array, each below size
+std::vector<size_t> array_to_indices(
+        const py::array_t<int64_t, py::array::c_style | py::array::forcecast> &arr, size_t size) {
+    std::vector<size_t> indices(arr.size());
+    const int64_t *in = arr.data();
+    for (size_t n = 0; n < indices.size(); n++) {
+        if (in[n] < 0 || (size_t) in[n] >= size) throw py::index_error("station index out of range");
+        indices[n] = (size_t) in[n];
+    }
+    return indices;
+}
+
+// Deletes a Finder with the state of its engine active, as the holder of the bound Finder
+struct Finder_Deleter {
+    void operator()(FiniteFault::Finder *finder) const {
+        FiniteFault::Finder_Engine::destroy_finder(finder);
+    }
+};
+
+// Finder::Scan_Data with the state of the engine active, which by default is the engine of
+// the finders. The finders and pga_data_list are claimed for the call.
+FiniteFault::Coordinate_List scan_data(FiniteFault::Finder_Engine *engine,
+                                       FiniteFault::PGA_Data_List &pga_data_list,
+                                       const std::vector<FiniteFault::Finder*> &finders,
+                                       bool offline_test) {
+    if (engine == NULL) {
+        engine = finders.empty() ? &FiniteFault::Finder_Engine::get_default()
+                                 : &FiniteFault::Finder_Engine::of(finders[0]);
+    }
+    for (size_t n = 0; n < finders.size(); n++) {
+        if (&FiniteFault::Finder_Engine::of(finders[n]) != engine) {
+            throw std::runtime_error("Scan_Data: the finders belong to another Finder_Engine");
+        }
+    }
+    FiniteFault::Finder_State_Lock lock(FiniteFault::Finder_State_Lock::SHARED, engine);
+    std::vector<std::unique_ptr<FiniteFault::Object_Claim> > claims;
+    claims.emplace_back(new FiniteFault::Object_Claim(&pga_data_list));
+    for (size_t n = 0; n < finders.size(); n++) {
+        claims.emplace_back(new FiniteFault::Object_Claim(finders[n]));
+    }
+    for (size_t n = 0; n < claims.size(); n++) {
+        if (!claims[n]->claimed()) {
+            throw std::runtime_error("Scan_Data: a Finder or the PGA_Data_List is in use by "
+                                     "another thread");
+        }
+    }
+    FiniteFault::Finder_List flist;
+    flist.assign(finders.begin(), finders.end());
+    FiniteFault::Temp_Files_Lock temp_files;
+    FiniteFault::Stage_Timer timer(FiniteFault::STAGE_SCAN);
+    return FiniteFault::Finder::Scan_Data(pga_data_list, flist, offline_test);
+}
+
+// Finder::Associate_Time with the state of the engine active
+FiniteFault::PGA_Data_List associate_time(FiniteFault::Finder_Engine &engine,
+                                          FiniteFault::PGA_Data_List &pga_data_list) {
+    FiniteFault::Finder_State_Lock lock(FiniteFault::Finder_State_Lock::SHARED, &engine);
+    FiniteFault::Object_Claim list_claim(&pga_data_list);
+    if (!list_claim.claimed()) {
+        throw std::runtime_error("Associate_Time: the PGA_Data_List is in use by another thread");
+    }
+    FiniteFault::Stage_Timer timer(FiniteFault::STAGE_ASSOCIATE);
+    return FiniteFault::Finder::Associate_Time(pga_data_list);
+}
+
+
 /**
  * Bindings for the Finder class from the finder.h header file. 
  */
 void init_finder_bindings(py::module &ff) {
+    // Persistent worker pool shared by the template matching
+    ff.def("set_worker_threads", [](size_t n_threads) {
+               // running solves hold tasks on the current pool
+               FiniteFault::Finder_State_Lock lock(FiniteFault::Finder_State_Lock::EXCLUSIVE);
+               FiniteFault::Worker_Pool::configure(n_threads);
+           },
+           py::arg("n_threads"), py::call_guard<py::gil_scoped_release>(),
+           "Resizes the worker pool, 0 means one thread per hardware thread. Waits for running "
+           "Finder calls to finish.");
+    ff.def("get_worker_threads", []() { return FiniteFault::Worker_Pool::instance()->size(); },
+           "Returns the number of threads in the worker pool.");
+
+    // Heap allocations of libFinder and the bindings, for the benchmarks
+    py::class_<FiniteFault::Allocation_Counter>(ff, "Allocation_Counter")
+        .def(py::init<>())
+        .def("start", &FiniteFault::Allocation_Counter::start)
+        .def("stop", &FiniteFault::Allocation_Counter::stop)
+        .def("is_running", &FiniteFault::Allocation_Counter::is_running)
+        .def("get_allocations", &FiniteFault::Allocation_Counter::get_allocations)
+        .def("get_bytes", &FiniteFault::Allocation_Counter::get_bytes)
+        .def("__enter__", [](FiniteFault::Allocation_Counter &c) -> FiniteFault::Allocation_Counter& {
+                 c.start();
+                 return c;
+             }, py::return_value_policy::reference)
+        .def("__exit__", [](FiniteFault::Allocation_Counter &c, py::object, py::object,
+                            py::object) { c.stop(); });
+
+    // Level filter and delivery of the LOG* output, see finder_ext/finder_log.h
+    py::enum_<FiniteFault::Log_Level>(ff, "Log_Level")
+        .value("FATAL", FiniteFault::LOG_FATAL)
+        .value("ERROR", FiniteFault::LOG_ERROR)
+        .value("WARNING", FiniteFault::LOG_WARNING)
+        .value("INFO", FiniteFault::LOG_INFO)
+        .value("DEBUG", FiniteFault::LOG_DEBUG)
+        .value("VERBOSE", FiniteFault::LOG_VERBOSE);
+    ff.def("set_log_level", &FiniteFault::Log::set_level, py::arg("level"),
+           "Messages above level are neither formatted nor written.");
+    ff.def("get_log_level", &FiniteFault::Log::get_level);
+    ff.def("is_log_enabled", &FiniteFault::Log::enabled, py::arg("level"));
+    ff.def("log",
+           [](FiniteFault::Log_Level level, const std::string &message) {
+               if (FiniteFault::Log::enabled(level)) {
+                   FiniteFault::Log::write(level, message.data(), message.size());
+               }
+           },
+           py::arg("level"), py::arg("message"),
+           "Writes message through the FinDer log, if level is enabled.");
+    ff.def("start_log_async", &FiniteFault::Log::start_async, py::arg("capacity") = 4096,
+           "Delivers the log messages from a background thread. The queue capacity is fixed "
+           "by the first call.");
+    ff.def("stop_log_async", &FiniteFault::Log::stop_async,
+           py::call_guard<py::gil_scoped_release>(),
+           "Delivers what is queued, then logs from the calling threads again.");
+    ff.def("is_log_async", &FiniteFault::Log::is_async);
+    ff.def("flush_log", &FiniteFault::Log::flush, py::call_guard<py::gil_scoped_release>(),
+           "Waits until the log messages queued so far are delivered.");
+    ff.def("get_log_dropped", &FiniteFault::Log::get_dropped,
+           "Log messages dropped because the async queue was full.");
+    ff.def("get_log_truncated", &FiniteFault::Log::get_truncated);
+
+    // Per-stage latency spans, see finder_ext/finder_timing.h
+    py::enum_<FiniteFault::Timing_Stage>(ff, "Timing_Stage")
+        .value("PROCESS", FiniteFault::STAGE_PROCESS)
+        .value("SCAN", FiniteFault::STAGE_SCAN)
+        .value("ASSOCIATE", FiniteFault::STAGE_ASSOCIATE)
+        .value("INGEST", FiniteFault::STAGE_INGEST)
+        .value("GRIDDING", FiniteFault::STAGE_GRIDDING)
+        .value("THRESHOLD", FiniteFault::STAGE_THRESHOLD)
+        .value("SEARCH", FiniteFault::STAGE_SEARCH)
+        .value("MASK_UPDATE", FiniteFault::STAGE_MASK_UPDATE);
+    ff.def("enable_timing", &FiniteFault::Stage_Timing::enable, py::arg("on") = true,
+           "Starts (or stops) recording the stage spans.");
+    ff.def("is_timing_enabled", &FiniteFault::Stage_Timing::is_enabled);
+    ff.def("set_timing_log_slow_ms", &FiniteFault::Stage_Timing::set_log_slow_ms, py::arg("ms"),
+           "Spans longer than ms are logged as they end, 0 for none.");
+    ff.def("clear_timing", &FiniteFault::Stage_Timing::clear,
+           "Forgets the recorded spans and the per-stage totals.");
+    ff.def("get_timing_spans", []() {
+               std::vector<FiniteFault::Timing_Span> spans;
+               {
+                   py::gil_scoped_release release;
+                   FiniteFault::Stage_Timing::collect(spans);
+               }
+               const size_t n = spans.size();
+               py::array_t<uint32_t> stage(n), thread(n);
+               py::array_t<uint64_t> start_ns(n), duration_ns(n);
+               py::array_t<int64_t> tag(n);
+               for (size_t k = 0; k < n; k++) {
+                   stage.mutable_data()[k] = spans[k].stage;
+                   thread.mutable_data()[k] = spans[k].thread;
+                   start_ns.mutable_data()[k] = spans[k].start_ns;
+                   duration_ns.mutable_data()[k] = spans[k].duration_ns;
+                   tag.mutable_data()[k] = spans[k].tag;
+               }
+               py::dict out;
+               out["stage"] = stage;
+               out["thread"] = thread;
+               out["start_ns"] = start_ns;
+               out["duration_ns"] = duration_ns;
+               out["tag"] = tag;
+               return out;
+           },
+           "Arrays stage, thread, start_ns, duration_ns and tag of the spans still held, oldest "
+           "first per thread.");
+    ff.def("get_stage_stats", []() {
+               py::dict out;
+               for (size_t s = 0; s < FiniteFault::N_TIMING_STAGES; s++) {
+                   const FiniteFault::Timing_Stage stage = (FiniteFault::Timing_Stage) s;
+                   out[py::str(FiniteFault::TimingStageString[s])] = py::make_tuple(
+                       FiniteFault::Stage_Timing::get_count(stage),
+                       FiniteFault::Stage_Timing::get_total_ns(stage) * 1e-9,
+                       FiniteFault::Stage_Timing::get_max_ns(stage) * 1e-9);
+               }
+               return out;
+           },
+           "(calls, total seconds, maximum seconds) of every stage, by stage name.");
+    ff.def("timing_prometheus", &FiniteFault::Stage_Timing::prometheus_text,
+           py::arg("prefix") = "finder",
+           "The per-stage totals in the Prometheus text exposition format.");
+    ff.def("log_timing_summary", &FiniteFault::Stage_Timing::log_summary,
+           "Logs the calls, mean and maximum of every stage.");
+
     // Binding the Finder class. All other classes should be already bound.
-    py::class_<FiniteFault::Finder>(ff, "Finder")
-        .def(py::init<const FiniteFault::Coordinate&, const FiniteFault::PGA_Data_List&, long, long>())
+    py::class_<FiniteFault::Finder, std::unique_ptr<FiniteFault::Finder, Finder_Deleter>>(
+        ff, "Finder")
+        .def(py::init([](const FiniteFault::Coordinate &epicenter,
+                         const FiniteFault::PGA_Data_List &pga_data_list, long event_id,
+                         long hold_time) {
+                 // the new Finder points into the template sets of the last Finder.Init
+                 return FiniteFault::Finder_Engine::get_default().create_finder(
+                     epicenter, pga_data_list, event_id, hold_time);
+             }),
+             py::arg("epicenter"), py::arg("pga_data_list"), py::arg("event_id"),
+             py::arg("hold_time"))
         .def_static("Set_Debug_Level", &FiniteFault::Finder::Set_Debug_Level)
         .def_static("Get_Debug_Level", &FiniteFault::Finder::Get_Debug_Level)
-        .def_static("Init", &FiniteFault::Finder::Init,
-            py::arg("config_file"), py::arg("station_coord_list"),
-            "Initializes the Finder with a configuration file and a list of station coordinates.")
+        .def_static("Init",
+            [](const char* config_file, const FiniteFault::Coordinate_List& station_coord_list,
+               size_t worker_threads, bool share_templates) {
+                // Init replaces the static state read by every Finder call, wait for them
+                FiniteFault::Finder_State_Lock lock(FiniteFault::Finder_State_Lock::EXCLUSIVE,
+                                                    &FiniteFault::Finder_Engine::get_default());
+                // Templates shared by a previous Init are released with their last user
+                FiniteFault::Matrix2d::unshare_all();
+                // and the template sets get back the mask arrays Init reads into
+                FiniteFault::Finder_Engine::get_default().release_mask();
+                {
+                    // Init computes the mask through temp/
+                    FiniteFault::Temp_Files_Lock temp_files;
+                    FiniteFault::Finder::Init(config_file, station_coord_list);
+                }
+                if (share_templates) {
+                    FiniteFault::Finder::get_finder_parameters()->templates.share();
+                }
+                // The worker pool is created once here and reused by every timestep. An explicit
+                // worker_threads wins over the config file, 0 means one per hardware thread.
+                if (worker_threads == 0) {
+                    worker_threads = FiniteFault::Worker_Pool::threads_from_config(config_file);
+                }
+                FiniteFault::Worker_Pool::configure(worker_threads);
+                // Grid over the stations for the neighbour and association queries
+                FiniteFault::Finder_Engine::get_default().index_stations(station_coord_list);
+                // Rotate the generic templates once for all strikes, Init reloads them
+                FiniteFault::Template_Cache::clear_all();
+                if (!FiniteFault::Template_Cache::for_parameters(
+                        FiniteFault::Finder::get_finder_parameters(),
+                        FiniteFault::Finder::get_finder_config()->resize_fraction)) {
+                    throw std::runtime_error("Finder.Init: cannot cache the templates of " +
+                                             std::string(config_file));
+                }
+            },
+            py::arg("config_file"), py::arg("station_coord_list"), py::arg("worker_threads") = 0,
+            py::arg("share_templates") = false, py::call_guard<py::gil_scoped_release>(),
+            "Initializes the Finder with a configuration file and a list of station coordinates, "
+            "sizes the worker pool used for template matching and caches the rotated templates, "
+            "raising RuntimeError if they cannot be cached. "
+            "With share_templates, copies of the template set share its pixels instead of "
+            "copying them; the templates must not be modified afterwards. Waits for running "
+            "Finder calls; Finder objects created before Init must not be used after it.")
 
         // Accessor methods to retrieve calculated values
         .def("get_event_id", &FiniteFault::Finder::get_event_id)
@@ -245,14 +616,1457 @@ void init_finder_bindings(py::module &ff) {
         .def("get_rupture_length", &FiniteFault::Finder::get_rupture_length)
         .def("get_rupture_azimuth", &FiniteFault::Finder::get_rupture_azimuth)
         .def("get_azimuth_uncer", &FiniteFault::Finder::get_azimuth_uncer)
+        .def("get_finder_rupture_list", &FiniteFault::Finder::get_finder_rupture_list,
+             "Copy of the rupture vertices.")
+        .def("get_finder_azimuth_list", &FiniteFault::Finder::get_finder_azimuth_list)
+        .def("get_finder_length_list", &FiniteFault::Finder::get_finder_length_list)
+        .def("get_pga_data_list", &FiniteFault::Finder::get_pga_data_list)
+        // Views into the Finder, valid until its next process call
+        .def("get_finder_rupture_list_ref", &FiniteFault::Finder::get_finder_rupture_list_ref,
+             py::return_value_policy::reference_internal,
+             "The rupture vertices without a copy, valid until the next process call.")
+        .def("get_finder_azimuth_list_ref", &FiniteFault::Finder::get_finder_azimuth_list_ref,
+             py::return_value_policy::reference_internal)
+        .def("get_finder_length_list_ref", &FiniteFault::Finder::get_finder_length_list_ref,
+             py::return_value_policy::reference_internal)
+        .def("get_pga_data_list_ref", &FiniteFault::Finder::get_pga_data_list_ref,
+             py::return_value_policy::reference_internal)
+        // Read-only numpy views of the results by field, valid until the next process call
+        .def("get_finder_rupture_arrays", [](py::object self) {
+                 return list_arrays(self.cast<const FiniteFault::Finder&>()
+                     .get_finder_rupture_list_ref(), RUPTURE_FIELDS, self);
+             },
+             "Arrays lat, lon and depth of the rupture vertices, without a copy.")
+        .def("get_finder_azimuth_arrays", [](py::object self) {
+                 return list_arrays(self.cast<const FiniteFault::Finder&>()
+                     .get_finder_azimuth_list_ref(), MISFIT_FIELDS, self);
+             },
+             "Arrays value (azimuth) and misf of the azimuths tested, without a copy.")
+        .def("get_finder_length_arrays", [](py::object self) {
+                 return list_arrays(self.cast<const FiniteFault::Finder&>()
+                     .get_finder_length_list_ref(), MISFIT_FIELDS, self);
+             },
+             "Arrays value (length) and misf of the lengths tested, without a copy.")
+        .def("get_finder_azimuth_llk_arrays", [](py::object self) {
+                 return list_arrays(self.cast<const FiniteFault::Finder&>()
+                     .get_finder_azimuth_llk_list_ref(), LLK_FIELDS, self);
+             },
+             "Arrays value (azimuth) and llk of the azimuth likelihood, without a copy.")
+        .def("get_finder_length_llk_arrays", [](py::object self) {
+                 return list_arrays(self.cast<const FiniteFault::Finder&>()
+                     .get_finder_length_llk_list_ref(), LLK_FIELDS, self);
+             },
+             "Arrays value (length) and llk of the length likelihood, without a copy.")
+        .def("get_centroid_lat_pdf_arrays", [](py::object self) {
+                 return list_arrays(self.cast<const FiniteFault::Finder&>()
+                     .get_centroid_lat_pdf_ref(), LLK2D_FIELDS, self);
+             },
+             "Arrays lat, lon and llk of the centroid latitude PDF, without a copy.")
+        .def("get_centroid_lon_pdf_arrays", [](py::object self) {
+                 return list_arrays(self.cast<const FiniteFault::Finder&>()
+                     .get_centroid_lon_pdf_ref(), LLK2D_FIELDS, self);
+             },
+             "Arrays lat, lon and llk of the centroid longitude PDF, without a copy.")
+
+        // Main process function, pga_data_list is updated in place. It runs without the GIL,
+        // but the library grids through fixed files in TEMP_DIR, so solves are serialised
+        // process-wide by Temp_Files_Lock.
+        .def("process",
+             [](FiniteFault::Finder &finder, double timestamp,
+                FiniteFault::PGA_Data_List &pga_data_list) {
+                 FiniteFault::Finder_State_Lock lock(FiniteFault::Finder_State_Lock::SHARED,
+                                                     &FiniteFault::Finder_Engine::of(&finder));
+                 FiniteFault::Object_Claim finder_claim(&finder), list_claim(&pga_data_list);
+                 if (!finder_claim.claimed() || !list_claim.claimed()) {
+                     throw std::runtime_error("Finder.process: the Finder or its PGA_Data_List "
+                                              "is in use by another thread");
+                 }
+                 FiniteFault::Temp_Files_Lock temp_files;
+                 FiniteFault::Stage_Timer timer(FiniteFault::STAGE_PROCESS,
+                                                finder.get_event_id());
+                 finder.process(timestamp, pga_data_list);
+             },
+             py::arg("timestamp"), py::arg("pga_data_list"),
+             py::call_guard<py::gil_scoped_release>(),
+             "Processes one update of the PGA data, the list is updated in place. Releases the "
+             "GIL, so other Python threads run meanwhile; process and Scan_Data calls of other "
+             "Finders wait, as libFinder solves through shared files in temp/.")
+        .def_static("Scan_Data",
+             [](FiniteFault::PGA_Data_List &pga_data_list,
+                const std::vector<FiniteFault::Finder*> &finders, bool offline_test) {
+                 return scan_data(NULL, pga_data_list, finders, offline_test);
+             },
+             py::arg("pga_data_list"), py::arg("finders"), py::arg("offline_test") = false,
+             py::call_guard<py::gil_scoped_release>(),
+             "Returns the epicentres of new events in pga_data_list, given the active finders, "
+             "with the configuration of their engine. Releases the GIL.")
+        .def_static("Associate_Time",
+             [](FiniteFault::PGA_Data_List &pga_data_list) {
+                 return associate_time(FiniteFault::Finder_Engine::get_default(), pga_data_list);
+             },
+             py::arg("pga_data_list"), py::call_guard<py::gil_scoped_release>(),
+             "Returns the PGA data of pga_data_list associated in time. Releases the GIL.")
+        .def_static("process_all",
+             [](double timestamp, const FiniteFault::PGA_Data_List &pga_data_list,
+                const std::vector<FiniteFault::Finder*> &finders,
+                FiniteFault::Result_Writer *writer) {
+                 FiniteFault::Event_Scheduler scheduler;
+                 scheduler.set_writer(writer);
+                 bool status;
+                 {
+                     py::gil_scoped_release release;
+                     status = scheduler.process_all(timestamp, pga_data_list, finders);
+                 }
+                 if (!status) {
+                     throw std::runtime_error("Finder.process_all: " +
+                         std::to_string(scheduler.get_failed()) + " of " +
+                         std::to_string(finders.size()) + " finders failed");
+                 }
+                 return scheduler.get_order();
+             },
+             py::arg("timestamp"), py::arg("pga_data_list"), py::arg("finders"),
+             py::arg("writer") = nullptr,
+             "Processes one update with every finder in turn, each on its own copy of "
+             "pga_data_list, largest magnitude first. The solutions are enqueued to writer if "
+             "one is given. Returns the indices of finders in the order they were processed. "
+             "Releases the GIL.")
         
         // Setter functions for controlling the behavior of Finder 
         .def("set_last_message_time", &FiniteFault::Finder::set_last_message_time)
         .def("set_start_time", &FiniteFault::Finder::set_start_time)
         .def("set_finder_flags", &FiniteFault::Finder::set_finder_flags)
         .def("set_hold_time", &FiniteFault::Finder::set_hold_time)
-        .def("set_rejected_stations", &FiniteFault::Finder::set_rejected_stations)
-        .def("set_pga_data_list", &FiniteFault::Finder::set_pga_data_list)
-        .def("set_pga_above_min_thresh", &FiniteFault::Finder::set_pga_above_min_thresh)
+        .def("set_rejected_stations", py::overload_cast<const FiniteFault::PGA_Data_List&>(
+            &FiniteFault::Finder::set_rejected_stations))
+        .def("set_pga_data_list", py::overload_cast<const FiniteFault::PGA_Data_List&>(
+            &FiniteFault::Finder::set_pga_data_list))
+        .def("set_pga_above_min_thresh", py::overload_cast<const FiniteFault::PGA_Data_List&>(
+            &FiniteFault::Finder::set_pga_above_min_thresh))
         ;
-}
\ No newline at end of file
+
+    // Grid over station coordinates for radius, nearest neighbour and connected group queries
+    py::class_<FiniteFault::Station_Index>(ff, "Station_Index")
+        .def(py::init<>())
+        .def("build", py::overload_cast<const FiniteFault::Coordinate_List&, const double>(
+                 &FiniteFault::Station_Index::build),
+             py::arg("stations"), py::arg("cell_km") = FiniteFault::STATION_INDEX_CELL_KM)
+        .def("build", py::overload_cast<const FiniteFault::PGA_Data_List&, const double>(
+                 &FiniteFault::Station_Index::build),
+             py::arg("stations"), py::arg("cell_km") = FiniteFault::STATION_INDEX_CELL_KM,
+             "Indexes the stations in list order, on grid cells of about cell_km.")
+        .def("clear", &FiniteFault::Station_Index::clear)
+        .def("size", &FiniteFault::Station_Index::size)
+        .def("__len__", &FiniteFault::Station_Index::size)
+        .def("get_cells", &FiniteFault::Station_Index::get_cells)
+        .def("within",
+             [](const FiniteFault::Station_Index &index, double lat, double lon, double radius_km) {
+                 std::vector<size_t> out;
+                 index.within(lat, lon, radius_km, out);
+                 return indices_to_array(out);
+             },
+             py::arg("lat"), py::arg("lon"), py::arg("radius_km"),
+             "Indices of the stations within radius_km of lat/lon, in index order.")
+        .def("nearest",
+             [](const FiniteFault::Station_Index &index, double lat, double lon, size_t k,
+                double max_km, py::object exclude) {
+                 std::vector<size_t> out;
+                 index.nearest(lat, lon, k, max_km, out,
+                               exclude.is_none() ? (size_t) -1 : exclude.cast<size_t>());
+                 return indices_to_array(out);
+             },
+             py::arg("lat"), py::arg("lon"), py::arg("k"), py::arg("max_km") = 1e9,
+             py::arg("exclude") = py::none(),
+             "Indices of up to k stations closest to lat/lon within max_km, closest first.")
+        .def("connected_groups",
+             [](const FiniteFault::Station_Index &index,
+                py::array_t<int64_t, py::array::c_style | py::array::forcecast> members,
+                double radius_km) {
+                 std::vector<size_t> labels;
+                 index.connected_groups(array_to_indices(members, index.size()), radius_km,
+                                        labels);
+                 return indices_to_array(labels);
+             },
+             py::arg("members"), py::arg("radius_km"),
+             "Group label of each member, members closer than radius_km share a group.")
+        .def("largest_group",
+             [](const FiniteFault::Station_Index &index,
+                py::array_t<int64_t, py::array::c_style | py::array::forcecast> members,
+                double radius_km) {
+                 return index.largest_group(array_to_indices(members, index.size()), radius_km);
+             },
+             py::arg("members"), py::arg("radius_km"),
+             "Size of the largest group of members linked by hops of at most radius_km, e.g. "
+             "to skip Scan_Data while no trigger_radius cluster has min_trigger_stations.");
+
+    // Points with precomputed trig terms for the batch dist_deg2km and loc2az
+    py::class_<FiniteFault::Geo_Points>(ff, "Geo_Points")
+        .def(py::init<>())
+        .def(py::init([](py::array_t<double, py::array::c_style | py::array::forcecast> lat,
+                         py::array_t<double, py::array::c_style | py::array::forcecast> lon) {
+                 if (lat.size() != lon.size()) {
+                     throw std::runtime_error("lat and lon differ in length");
+                 }
+                 return FiniteFault::Geo_Points(lat.data(), lon.data(), (size_t) lat.size());
+             }),
+             py::arg("lat"), py::arg("lon"))
+        .def("push_back", &FiniteFault::Geo_Points::push_back, py::arg("lat"), py::arg("lon"))
+        .def("clear", &FiniteFault::Geo_Points::clear)
+        .def("size", &FiniteFault::Geo_Points::size)
+        .def("__len__", &FiniteFault::Geo_Points::size);
+
+    ff.def("distances_km",
+           [](double lat, double lon, const FiniteFault::Geo_Points &points) {
+               py::array_t<double> out(points.size());
+               double *data = out.mutable_data();
+               py::gil_scoped_release release;
+               FiniteFault::distances_km(lat, lon, points, data);
+               return out;
+           },
+           py::arg("lat"), py::arg("lon"), py::arg("points"),
+           "dist_deg2km from lat/lon to each of the points.");
+    ff.def("distances_km",
+           [](const FiniteFault::Geo_Points &origins, const FiniteFault::Geo_Points &points) {
+               py::array_t<double> out({origins.size(), points.size()});
+               double *data = out.mutable_data();
+               py::gil_scoped_release release;
+               FiniteFault::distances_km(origins, points, data);
+               return out;
+           },
+           py::arg("origins"), py::arg("points"),
+           "dist_deg2km between each origin (rows) and each point (columns).");
+    ff.def("azimuths",
+           [](double lat, double lon, const FiniteFault::Geo_Points &points) {
+               py::array_t<double> out(points.size());
+               double *data = out.mutable_data();
+               py::gil_scoped_release release;
+               FiniteFault::azimuths(lat, lon, points, data);
+               return out;
+           },
+           py::arg("lat"), py::arg("lon"), py::arg("points"),
+           "loc2az from lat/lon to each of the points.");
+    ff.def("lat2km",
+           [](py::array_t<double, py::array::c_style | py::array::forcecast> length_lat) {
+               py::array_t<double> out(length_lat.size());
+               FiniteFault::lat2km(length_lat.data(), length_lat.size(), out.mutable_data());
+               return out;
+           },
+           py::arg("length_lat"));
+    ff.def("km2lat",
+           [](py::array_t<double, py::array::c_style | py::array::forcecast> length_km) {
+               py::array_t<double> out(length_km.size());
+               FiniteFault::km2lat(length_km.data(), length_km.size(), out.mutable_data());
+               return out;
+           },
+           py::arg("length_km"));
+    ff.def("lon2km",
+           [](py::array_t<double, py::array::c_style | py::array::forcecast> length_lon,
+              py::array_t<double, py::array::c_style | py::array::forcecast> avlat) {
+               if (length_lon.size() != avlat.size()) {
+                   throw std::runtime_error("length_lon and avlat differ in length");
+               }
+               py::array_t<double> out(length_lon.size());
+               FiniteFault::lon2km(length_lon.data(), avlat.data(), length_lon.size(),
+                                   out.mutable_data());
+               return out;
+           },
+           py::arg("length_lon"), py::arg("avlat"));
+    ff.def("km2lon",
+           [](py::array_t<double, py::array::c_style | py::array::forcecast> length_km,
+              py::array_t<double, py::array::c_style | py::array::forcecast> avlat) {
+               if (length_km.size() != avlat.size()) {
+                   throw std::runtime_error("length_km and avlat differ in length");
+               }
+               py::array_t<double> out(length_km.size());
+               FiniteFault::km2lon(length_km.data(), avlat.data(), length_km.size(),
+                                   out.mutable_data());
+               return out;
+           },
+           py::arg("length_km"), py::arg("avlat"));
+    ff.def("get_geodesy_kernel", &FiniteFault::get_geodesy_kernel,
+           "Name of the kernel used by the batch distances and azimuths.");
+    ff.def("get_geodesy_kernels", &FiniteFault::get_geodesy_kernels,
+           "Geodesy kernels usable on this CPU and library, fastest first.");
+    ff.def("set_geodesy_kernel",
+           [](const std::string &name) {
+               if (!FiniteFault::set_geodesy_kernel(name)) {
+                   throw std::runtime_error("Geodesy kernel " + name + " is not available");
+               }
+           },
+           py::arg("name"));
+
+    // GMPE of the form in finder_mag_regression.h and the magnitude regression over it
+    py::class_<FiniteFault::GMPE_Coefficients>(ff, "GMPE_Coefficients")
+        .def(py::init<>())
+        .def(py::init([](double c0, double c1, double c2, double c3, double c4, double c5,
+                         double h) {
+                 FiniteFault::GMPE_Coefficients c;
+                 c.c0 = c0; c.c1 = c1; c.c2 = c2; c.c3 = c3; c.c4 = c4; c.c5 = c5; c.h = h;
+                 return c;
+             }),
+             py::arg("c0"), py::arg("c1"), py::arg("c2") = 0., py::arg("c3") = 0.,
+             py::arg("c4") = 0., py::arg("c5") = 0., py::arg("h") = 0.)
+        .def_readwrite("c0", &FiniteFault::GMPE_Coefficients::c0)
+        .def_readwrite("c1", &FiniteFault::GMPE_Coefficients::c1)
+        .def_readwrite("c2", &FiniteFault::GMPE_Coefficients::c2)
+        .def_readwrite("c3", &FiniteFault::GMPE_Coefficients::c3)
+        .def_readwrite("c4", &FiniteFault::GMPE_Coefficients::c4)
+        .def_readwrite("c5", &FiniteFault::GMPE_Coefficients::c5)
+        .def_readwrite("h", &FiniteFault::GMPE_Coefficients::h);
+
+    py::class_<FiniteFault::Mag_Regression_Params>(ff, "Mag_Regression_Params")
+        .def(py::init<>())
+        .def_readwrite("s_weight", &FiniteFault::Mag_Regression_Params::s_weight)
+        .def_readwrite("min_s_stations", &FiniteFault::Mag_Regression_Params::min_s_stations)
+        .def_readwrite("min_mag", &FiniteFault::Mag_Regression_Params::min_mag)
+        .def_readwrite("max_mag", &FiniteFault::Mag_Regression_Params::max_mag)
+        .def_readwrite("mag_step", &FiniteFault::Mag_Regression_Params::mag_step)
+        .def_readwrite("s_only_thresh", &FiniteFault::Mag_Regression_Params::s_only_thresh);
+
+    py::class_<FiniteFault::Mag_Regression_Result>(ff, "Mag_Regression_Result")
+        .def_readonly("magnitude", &FiniteFault::Mag_Regression_Result::magnitude)
+        .def_readonly("grid_magnitude", &FiniteFault::Mag_Regression_Result::grid_magnitude)
+        .def_readonly("misfit", &FiniteFault::Mag_Regression_Result::misfit)
+        .def_readonly("N_P", &FiniteFault::Mag_Regression_Result::N_P)
+        .def_readonly("N_S", &FiniteFault::Mag_Regression_Result::N_S)
+        .def_readonly("iterations", &FiniteFault::Mag_Regression_Result::iterations);
+
+    py::class_<FiniteFault::GMPE_Batch>(ff, "GMPE_Batch")
+        .def(py::init([](py::array_t<double, py::array::c_style | py::array::forcecast> dist_km,
+                         py::array_t<uint8_t, py::array::c_style | py::array::forcecast> is_s,
+                         const FiniteFault::GMPE_Coefficients &p,
+                         const FiniteFault::GMPE_Coefficients &s) {
+                 if (dist_km.size() != is_s.size()) {
+                     throw std::runtime_error("dist_km and is_s differ in length");
+                 }
+                 FiniteFault::GMPE_Batch batch;
+                 batch.assign(dist_km.data(), is_s.data(), (size_t) dist_km.size(), p, s);
+                 return batch;
+             }),
+             py::arg("dist_km"), py::arg("is_s"), py::arg("p"), py::arg("s"))
+        .def("evaluate",
+             [](const FiniteFault::GMPE_Batch &batch, double mag) {
+                 py::array_t<double> out(batch.size());
+                 batch.evaluate(mag, out.mutable_data());
+                 return out;
+             },
+             py::arg("mag"), "log10 PGA of each station at mag.")
+        .def("evaluate",
+             [](const FiniteFault::GMPE_Batch &batch,
+                py::array_t<double, py::array::c_style | py::array::forcecast> mags) {
+                 py::array_t<double> out({(size_t) mags.size(), batch.size()});
+                 batch.evaluate(mags.data(), mags.size(), out.mutable_data());
+                 return out;
+             },
+             py::arg("mags"), "log10 PGA at each of mags (rows) and station (columns).")
+        .def("__len__", &FiniteFault::GMPE_Batch::size);
+
+    py::class_<FiniteFault::Mag_Regression>(ff, "Mag_Regression")
+        .def(py::init<const FiniteFault::GMPE_Coefficients &,
+                      const FiniteFault::GMPE_Coefficients &,
+                      const FiniteFault::Mag_Regression_Params &>(),
+             py::arg("p"), py::arg("s"),
+             py::arg("params") = FiniteFault::Mag_Regression_Params())
+        .def("regress",
+             [](FiniteFault::Mag_Regression &regression,
+                py::array_t<double, py::array::c_style | py::array::forcecast> dist_km,
+                py::array_t<double, py::array::c_style | py::array::forcecast> log10_pga,
+                py::array_t<uint8_t, py::array::c_style | py::array::forcecast> is_s,
+                bool s_only) {
+                 if (dist_km.size() != log10_pga.size() || dist_km.size() != is_s.size()) {
+                     throw std::runtime_error("dist_km, log10_pga and is_s differ in length");
+                 }
+                 py::gil_scoped_release release;
+                 return s_only ?
+                     regression.regress_s_only(dist_km.data(), log10_pga.data(), is_s.data(),
+                                               (size_t) dist_km.size()) :
+                     regression.regress(dist_km.data(), log10_pga.data(), is_s.data(),
+                                        (size_t) dist_km.size());
+             },
+             py::arg("dist_km"), py::arg("log10_pga"), py::arg("is_s"),
+             py::arg("s_only") = false,
+             "Magnitude minimising the weighted log10 PGA misfit, as mag_regression or, with "
+             "s_only, mag_regression_Sonly.")
+        .def("misfit",
+             py::overload_cast<double>(&FiniteFault::Mag_Regression::misfit, py::const_),
+             py::arg("mag"), "Misfit of the last regression at mag.")
+        .def("misfit",
+             [](const FiniteFault::Mag_Regression &regression,
+                py::array_t<double, py::array::c_style | py::array::forcecast> mags) {
+                 py::array_t<double> out(mags.size());
+                 regression.misfit(mags.data(), mags.size(), out.mutable_data());
+                 return out;
+             },
+             py::arg("mags"))
+        .def("get_params", &FiniteFault::Mag_Regression::get_params);
+
+    // A configuration with its own template sets, Finder objects of several engines can be
+    // processed in one process
+    py::class_<FiniteFault::Finder_Engine>(ff, "Finder_Engine")
+        .def(py::init<>())
+        .def("load",
+             [](FiniteFault::Finder_Engine &engine, const std::string &config_file,
+                const FiniteFault::Coordinate_List &station_coord_list,
+                const std::string &template_store) {
+                 if (!engine.load(config_file, station_coord_list, template_store)) {
+                     throw std::runtime_error("Finder_Engine.load: cannot load " + config_file);
+                 }
+             },
+             py::arg("config_file"), py::arg("station_coord_list"),
+             py::arg("template_store") = "", py::call_guard<py::gil_scoped_release>(),
+             "Finder.Init into this engine. With template_store, the generic templates are "
+             "mapped from that store file, and engines using the same store share its pages. "
+             "Init still reads the template files first, so loading takes as long as without "
+             "a store. Waits for running Finder calls.")
+        .def("is_loaded", &FiniteFault::Finder_Engine::is_loaded)
+        .def("get_config_file", &FiniteFault::Finder_Engine::get_config_file)
+        .def("is_active", [](const FiniteFault::Finder_Engine &engine) {
+                 return FiniteFault::Finder_State_Lock::get_active() == &engine;
+             },
+             "True if the state of this engine is the one in the FinDer statics.")
+        .def("get_template_cache", [](const FiniteFault::Finder_Engine &engine) {
+                 return std::const_pointer_cast<FiniteFault::Template_Cache>(
+                     engine.get_template_cache());
+             })
+        .def("get_station_index", &FiniteFault::Finder_Engine::get_station_index,
+             py::return_value_policy::reference_internal,
+             "Grid over the stations the engine was loaded with.")
+        .def("attach_mask",
+             [](FiniteFault::Finder_Engine &engine, const std::string &path) {
+                 if (!engine.attach_mask(path)) {
+                     throw std::runtime_error("Finder_Engine.attach_mask: no mask to attach, "
+                                              "or it differs from the mask of the library");
+                 }
+             },
+             py::arg("path") = "", py::call_guard<py::gil_scoped_release>(),
+             "Shares one station mask among the template sets, mapped from path when it holds "
+             "a mask of the same points and built otherwise. The library mask is kept if the "
+             "two disagree on a point.")
+        .def("update_stations", &FiniteFault::Finder_Engine::update_stations,
+             py::arg("station_coord_list"), py::call_guard<py::gil_scoped_release>(),
+             "Indexes a new station list and updates the shared mask around the stations "
+             "added or removed. Returns the number of mask points that changed.")
+        .def("get_mask_store", [](const FiniteFault::Finder_Engine &engine) {
+                 return std::const_pointer_cast<FiniteFault::Mask_Store>(
+                     engine.get_mask_store());
+             })
+        .def("set_offline_notime_test", &FiniteFault::Finder_Engine::set_offline_notime_test,
+             py::arg("on"), py::call_guard<py::gil_scoped_release>(),
+             "Disables (or enables) the real time checks of all template sets. Returns the "
+             "previous setting.")
+        .def("create_finder", &FiniteFault::Finder_Engine::create_finder,
+             py::arg("epicenter"), py::arg("pga_data_list"), py::arg("event_id"),
+             py::arg("hold_time"), py::return_value_policy::take_ownership,
+             py::keep_alive<0, 1>(),
+             "A Finder using the configuration and templates of this engine, which it keeps "
+             "alive.")
+        .def("scan_data",
+             [](FiniteFault::Finder_Engine &engine, FiniteFault::PGA_Data_List &pga_data_list,
+                const std::vector<FiniteFault::Finder*> &finders, bool offline_test) {
+                 return scan_data(&engine, pga_data_list, finders, offline_test);
+             },
+             py::arg("pga_data_list"), py::arg("finders"), py::arg("offline_test") = false,
+             py::call_guard<py::gil_scoped_release>(),
+             "Finder.Scan_Data with this configuration, the finders must be of this engine.")
+        .def("associate_time", &associate_time, py::arg("pga_data_list"),
+             py::call_guard<py::gil_scoped_release>(),
+             "Finder.Associate_Time with this configuration.")
+        .def_static("get_default", &FiniteFault::Finder_Engine::get_default,
+                    py::return_value_policy::reference,
+                    "The engine that Finder.Init loads and Finder() uses.");
+
+    // Solutions written by a background thread, see finder_ext/finder_result_writer.h
+    py::enum_<FiniteFault::Result_Format>(ff, "Result_Format")
+        .value("TEXT", FiniteFault::RESULT_TEXT)
+        .value("BINARY", FiniteFault::RESULT_BINARY);
+
+    py::class_<FiniteFault::Result_Record>(ff, "Result_Record")
+        .def(py::init([]() {
+            FiniteFault::Result_Record record;
+            std::memset(&record, 0, sizeof(record));
+            return record;
+        }))
+        .def_readwrite("timestamp", &FiniteFault::Result_Record::timestamp)
+        .def_readwrite("event_id", &FiniteFault::Result_Record::event_id)
+        .def_readwrite("version", &FiniteFault::Result_Record::version)
+        .def_readwrite("mag", &FiniteFault::Result_Record::mag)
+        .def_readwrite("mag_FD", &FiniteFault::Result_Record::mag_FD)
+        .def_readwrite("mag_reg", &FiniteFault::Result_Record::mag_reg)
+        .def_readwrite("mag_uncer", &FiniteFault::Result_Record::mag_uncer)
+        .def_readwrite("epicenter_lat", &FiniteFault::Result_Record::epicenter_lat)
+        .def_readwrite("epicenter_lon", &FiniteFault::Result_Record::epicenter_lon)
+        .def_readwrite("depth", &FiniteFault::Result_Record::depth)
+        .def_readwrite("origin_time", &FiniteFault::Result_Record::origin_time)
+        .def_readwrite("likelihood", &FiniteFault::Result_Record::likelihood)
+        .def_readwrite("rupture_length", &FiniteFault::Result_Record::rupture_length)
+        .def_readwrite("rupture_azimuth", &FiniteFault::Result_Record::rupture_azimuth)
+        .def_readwrite("Nstat_used", &FiniteFault::Result_Record::Nstat_used)
+        .def_readonly("N_rupture", &FiniteFault::Result_Record::N_rupture);
+
+    py::class_<FiniteFault::Result_Snapshot>(ff, "Result_Snapshot")
+        .def(py::init([]() {
+            FiniteFault::Result_Snapshot snapshot;
+            std::memset(&snapshot.record, 0, sizeof(snapshot.record));
+            return snapshot;
+        }))
+        .def_static("take",
+             [](const FiniteFault::Finder &finder, double timestamp) {
+                 FiniteFault::Finder_State_Lock lock(FiniteFault::Finder_State_Lock::SHARED,
+                                                     &FiniteFault::Finder_Engine::of(&finder));
+                 FiniteFault::Object_Claim finder_claim(&finder);
+                 if (!finder_claim.claimed()) {
+                     throw std::runtime_error("Result_Snapshot.take: the Finder is in use by "
+                                              "another thread");
+                 }
+                 FiniteFault::Result_Snapshot snapshot;
+                 FiniteFault::Result_Snapshot::take(finder, timestamp, snapshot);
+                 return snapshot;
+             },
+             py::arg("finder"), py::arg("timestamp"))
+        .def_readwrite("record", &FiniteFault::Result_Snapshot::record)
+        .def_property("rupture",
+             [](const FiniteFault::Result_Snapshot &snapshot) {
+                 py::array_t<double> out({snapshot.rupture.size() / 3, (size_t) 3});
+                 std::copy(snapshot.rupture.begin(), snapshot.rupture.end(),
+                           out.mutable_data());
+                 return out;
+             },
+             [](FiniteFault::Result_Snapshot &snapshot,
+                py::array_t<double, py::array::c_style | py::array::forcecast> points) {
+                 if (points.ndim() != 2 || points.shape(1) != 3) {
+                     throw std::runtime_error("rupture takes (N, 3) lat, lon, depth points");
+                 }
+                 snapshot.rupture.assign(points.data(), points.data() + points.size());
+                 snapshot.record.N_rupture = points.shape(0);
+             },
+             "Rupture points as an (N, 3) array of lat, lon, depth.");
+
+    ff.def("read_results",
+           [](const std::string &path) {
+               std::vector<FiniteFault::Result_Snapshot> snapshots;
+               if (!FiniteFault::read_results(path, snapshots)) {
+                   throw std::runtime_error(path + " is not a binary result file");
+               }
+               return snapshots;
+           },
+           py::arg("path"), "Snapshots of a binary Result_Writer file.");
+
+    py::class_<FiniteFault::Result_Writer>(ff, "Result_Writer")
+        .def(py::init<const std::string &, FiniteFault::Result_Format, size_t>(),
+             py::arg("path"), py::arg("format") = FiniteFault::RESULT_TEXT,
+             py::arg("capacity") = 1024)
+        .def("is_open", &FiniteFault::Result_Writer::is_open)
+        .def("enqueue",
+             [](FiniteFault::Result_Writer &writer, const FiniteFault::Result_Snapshot &snapshot) {
+                 FiniteFault::Result_Snapshot copy(snapshot);
+                 return writer.enqueue(copy);
+             },
+             py::arg("snapshot"),
+             "Hands a copy of snapshot to the writer thread, False if it was dropped.")
+        .def("enqueue",
+             [](FiniteFault::Result_Writer &writer, const FiniteFault::Finder &finder,
+                double timestamp) {
+                 FiniteFault::Finder_State_Lock lock(FiniteFault::Finder_State_Lock::SHARED,
+                                                     &FiniteFault::Finder_Engine::of(&finder));
+                 FiniteFault::Object_Claim finder_claim(&finder);
+                 if (!finder_claim.claimed()) {
+                     throw std::runtime_error("Result_Writer.enqueue: the Finder is in use by "
+                                              "another thread");
+                 }
+                 return writer.enqueue(finder, timestamp);
+             },
+             py::arg("finder"), py::arg("timestamp"),
+             "Hands the solution of finder to the writer thread, False if it was dropped.")
+        .def("flush", &FiniteFault::Result_Writer::flush,
+             py::call_guard<py::gil_scoped_release>(),
+             "Waits until everything enqueued so far is written.")
+        .def("close", &FiniteFault::Result_Writer::close,
+             py::call_guard<py::gil_scoped_release>())
+        .def("get_path", &FiniteFault::Result_Writer::get_path)
+        .def("get_capacity", &FiniteFault::Result_Writer::get_capacity)
+        .def("get_enqueued", &FiniteFault::Result_Writer::get_enqueued)
+        .def("get_written", &FiniteFault::Result_Writer::get_written)
+        .def("get_failed", &FiniteFault::Result_Writer::get_failed)
+        .def("get_dropped", &FiniteFault::Result_Writer::get_dropped);
+
+    py::class_<FiniteFault::Event_Scheduler>(ff, "Event_Scheduler")
+        .def(py::init<>())
+        .def("set_writer", &FiniteFault::Event_Scheduler::set_writer, py::arg("writer"),
+             py::keep_alive<1, 2>())
+        .def("set_step",
+             [](FiniteFault::Event_Scheduler &scheduler, py::function step) {
+                 scheduler.set_step([step](FiniteFault::Finder *finder, double timestamp,
+                                           FiniteFault::PGA_Data_List &) {
+                     py::gil_scoped_acquire acquire;
+                     step(finder->get_event_id(), timestamp);
+                 });
+             },
+             py::arg("step"),
+             "Calls step(event_id, timestamp) instead of Finder.process, with the locks of "
+             "the finder held; step must not call into the Finder bindings.")
+        .def("process_all", &FiniteFault::Event_Scheduler::process_all,
+             py::arg("timestamp"), py::arg("pga_data_list"), py::arg("finders"),
+             py::call_guard<py::gil_scoped_release>(),
+             "Processes one update with every finder, the most urgent first. False if one "
+             "failed. Releases the GIL.")
+        .def_static("priority_order",
+             [](const std::vector<FiniteFault::Finder*> &finders) {
+                 std::vector<size_t> order;
+                 FiniteFault::Event_Scheduler::priority_order(finders, order);
+                 return order;
+             },
+             py::arg("finders"),
+             "Indices of finders, largest magnitude first, then the earliest end of the hold "
+             "time, then the oldest.")
+        .def("get_order", &FiniteFault::Event_Scheduler::get_order)
+        .def("get_latency_ns", &FiniteFault::Event_Scheduler::get_latency_ns)
+        .def("get_failed", &FiniteFault::Event_Scheduler::get_failed);
+
+    // Offline replay for the end-to-end benchmarks, see benchmarks/bench_replay.py
+    py::class_<FiniteFault::Replay_Stats>(ff, "Replay_Stats")
+        .def_readonly("updates", &FiniteFault::Replay_Stats::updates)
+        .def_readonly("events", &FiniteFault::Replay_Stats::events)
+        .def_readonly("finder_updates", &FiniteFault::Replay_Stats::finder_updates)
+        .def_readonly("wall_seconds", &FiniteFault::Replay_Stats::wall_seconds)
+        .def_readonly("allocations", &FiniteFault::Replay_Stats::allocations)
+        .def_readonly("bytes", &FiniteFault::Replay_Stats::bytes)
+        .def_readonly("peak_rss_kb", &FiniteFault::Replay_Stats::peak_rss_kb)
+        .def("get_latency_ns", [](const FiniteFault::Replay_Stats &stats) {
+                 py::array_t<uint64_t> out(stats.latency_ns.size());
+                 std::copy(stats.latency_ns.begin(), stats.latency_ns.end(), out.mutable_data());
+                 return out;
+             })
+        .def("latency_ms", &FiniteFault::Replay_Stats::latency_ms, py::arg("pc"),
+             "Latency in ms not exceeded by pc percent of the updates.")
+        .def("updates_per_second", &FiniteFault::Replay_Stats::updates_per_second)
+        .def("events_per_second", &FiniteFault::Replay_Stats::events_per_second);
+
+    py::class_<FiniteFault::Finder_Replay>(ff, "Finder_Replay")
+        .def(py::init([](FiniteFault::Finder_Engine *engine, long hold_time) {
+                 return new FiniteFault::Finder_Replay(
+                     engine != NULL ? *engine : FiniteFault::Finder_Engine::get_default(),
+                     hold_time);
+             }),
+             py::arg("engine") = nullptr, py::arg("hold_time") = 0, py::keep_alive<1, 2>())
+        .def("run",
+             [](FiniteFault::Finder_Replay &replay,
+                const std::vector<std::pair<double, FiniteFault::PGA_Data_List>> &updates) {
+                 std::vector<FiniteFault::Replay_Update> steps(updates.size());
+                 for (size_t n = 0; n < updates.size(); n++) {
+                     steps[n].timestamp = updates[n].first;
+                     steps[n].pga_data_list = updates[n].second;
+                 }
+                 FiniteFault::Replay_Stats stats;
+                 bool status;
+                 {
+                     py::gil_scoped_release release;
+                     status = replay.run(steps, stats);
+                 }
+                 if (!status) throw std::runtime_error("Finder_Replay: an update failed");
+                 return stats;
+             },
+             py::arg("updates"),
+             "Replays (timestamp, PGA_Data_List) updates through Scan_Data, Finder creation "
+             "and process, without the real time checks. Returns the Replay_Stats.")
+        .def("clear", &FiniteFault::Finder_Replay::clear, py::call_guard<py::gil_scoped_release>(),
+             "Destroys the finders of earlier runs.")
+        .def("set_writer", &FiniteFault::Finder_Replay::set_writer, py::arg("writer"),
+             py::keep_alive<1, 2>(),
+             "Enqueues the solution of every finder update to writer, None for none.")
+        .def("get_active", &FiniteFault::Finder_Replay::get_active);
+
+    // Finder state for warm restarts and failover, see finder_ext/finder_snapshot.h
+    py::class_<FiniteFault::Finder_Snapshot, std::shared_ptr<FiniteFault::Finder_Snapshot>>(
+        ff, "Finder_Snapshot")
+        .def_static("save",
+             [](const std::string &path, FiniteFault::Finder_Engine &engine,
+                const std::vector<FiniteFault::Finder*> &finders, double timestamp) {
+                 std::vector<long> skipped;
+                 if (!FiniteFault::Finder_Snapshot::save(path, engine, finders, timestamp,
+                                                         &skipped)) {
+                     throw std::runtime_error("Finder_Snapshot.save: cannot save " + path);
+                 }
+                 return skipped;
+             },
+             py::arg("path"), py::arg("engine"), py::arg("finders"), py::arg("timestamp"),
+             py::call_guard<py::gil_scoped_release>(),
+             "Writes the state of the finders, all of engine, to path, replacing it atomically. "
+             "Finders being processed by another thread are left out; returns their event ids.")
+        .def_static("open",
+             [](const std::string &path) {
+                 std::shared_ptr<FiniteFault::Finder_Snapshot> snapshot =
+                     FiniteFault::Finder_Snapshot::open(path);
+                 if (!snapshot) throw std::runtime_error(path + " is not a valid snapshot");
+                 return snapshot;
+             },
+             py::arg("path"), "Maps a snapshot file.")
+        .def("get_path", &FiniteFault::Finder_Snapshot::get_path)
+        .def("get_timestamp", &FiniteFault::Finder_Snapshot::get_timestamp)
+        .def("size", &FiniteFault::Finder_Snapshot::size)
+        .def("__len__", &FiniteFault::Finder_Snapshot::size)
+        .def("get_file_bytes", &FiniteFault::Finder_Snapshot::get_file_bytes)
+        .def("get_event_ids", [](const FiniteFault::Finder_Snapshot &snapshot) {
+                 std::vector<long> ids(snapshot.size());
+                 for (size_t n = 0; n < ids.size(); n++) ids[n] = snapshot.get_event_id(n);
+                 return ids;
+             },
+             "Event ids of the finders, in the order saved.")
+        .def("get_config_file", &FiniteFault::Finder_Snapshot::get_config_file)
+        .def("get_template_store", &FiniteFault::Finder_Snapshot::get_template_store)
+        .def("get_mask_path", &FiniteFault::Finder_Snapshot::get_mask_path)
+        .def("get_stations", &FiniteFault::Finder_Snapshot::get_stations)
+        .def("load_engine",
+             [](const FiniteFault::Finder_Snapshot &snapshot, FiniteFault::Finder_Engine &engine) {
+                 if (!snapshot.load_engine(engine)) {
+                     throw std::runtime_error("Finder_Snapshot.load_engine: cannot load " +
+                                              snapshot.get_config_file());
+                 }
+             },
+             py::arg("engine"), py::call_guard<py::gil_scoped_release>(),
+             "Loads engine with the configuration, template store, stations and mask the "
+             "snapshot was taken with.")
+        .def("matches", &FiniteFault::Finder_Snapshot::matches, py::arg("engine"),
+             py::call_guard<py::gil_scoped_release>(),
+             "True if engine holds the template sets the snapshot was taken with.")
+        .def("restore",
+             [](const FiniteFault::Finder_Snapshot &snapshot, py::object engine_object) {
+                 FiniteFault::Finder_Engine &engine =
+                     engine_object.cast<FiniteFault::Finder_Engine&>();
+                 std::vector<FiniteFault::Finder*> finders;
+                 bool status;
+                 {
+                     py::gil_scoped_release release;
+                     status = snapshot.restore(engine, finders);
+                 }
+                 if (!status) {
+                     throw std::runtime_error("Finder_Snapshot.restore: cannot restore " +
+                                              snapshot.get_path());
+                 }
+                 py::list out;
+                 for (size_t n = 0; n < finders.size(); n++) {
+                     py::object finder = py::cast(finders[n],
+                                                  py::return_value_policy::take_ownership);
+                     // like create_finder, each finder keeps its engine alive
+                     py::detail::keep_alive_impl(finder, engine_object);
+                     out.append(finder);
+                 }
+                 return out;
+             },
+             py::arg("engine"),
+             "New finders of engine with the state of the snapshot, in the order saved.");
+}
+
+
+/**
+ * Bindings for the in-memory gridding from finder_ext/finder_gridding.h
+ */
+void init_gridding_bindings(py::module &ff) {
+    // Image extent and resolution, as used by Finder_Event_Process
+    py::class_<FiniteFault::ImageParams>(ff, "ImageParams")
+        .def(py::init([](double minLat, double minLon, double dLat, double dLon,
+                         size_t NLat, size_t NLon) {
+                 FiniteFault::ImageParams p;
+                 p.minLat = minLat; p.minLon = minLon;
+                 p.dLat = dLat; p.dLon = dLon;
+                 p.NLat = NLat; p.NLon = NLon;
+                 p.maxLat = minLat + (NLat - 1) * dLat;
+                 p.maxLon = minLon + (NLon - 1) * dLon;
+                 return p;
+             }),
+             py::arg("minLat"), py::arg("minLon"), py::arg("dLat"), py::arg("dLon"),
+             py::arg("NLat"), py::arg("NLon"))
+        .def_readwrite("minLat", &FiniteFault::ImageParams::minLat)
+        .def_readwrite("maxLat", &FiniteFault::ImageParams::maxLat)
+        .def_readwrite("minLon", &FiniteFault::ImageParams::minLon)
+        .def_readwrite("maxLon", &FiniteFault::ImageParams::maxLon)
+        .def_readwrite("dLat", &FiniteFault::ImageParams::dLat)
+        .def_readwrite("dLon", &FiniteFault::ImageParams::dLon)
+        .def_readwrite("NLat", &FiniteFault::ImageParams::NLat)
+        .def_readwrite("NLon", &FiniteFault::ImageParams::NLon);
+
+    py::enum_<FiniteFault::Gridding_Mode>(ff, "Gridding_Mode")
+        .value("GMT_FILES", FiniteFault::GRIDDING_GMT_FILES)
+        .value("GMT_MEMORY", FiniteFault::GRIDDING_GMT_MEMORY)
+        .value("NATIVE", FiniteFault::GRIDDING_NATIVE);
+
+    ff.def("gridding_mode_from_option", &FiniteFault::gridding_mode_from_option,
+           py::arg("gmt_api_option"),
+           "Returns the gridding backend selected by a gmt_api_option config value.");
+
+    py::class_<FiniteFault::Image_Gridder>(ff, "Image_Gridder")
+        .def(py::init<double, double, FiniteFault::Gridding_Mode>(),
+             py::arg("tension") = FiniteFault::TENSION,
+             py::arg("min_log10PGA") = FiniteFault::MIN_LOG10PGA,
+             py::arg("mode") = FiniteFault::GRIDDING_GMT_MEMORY)
+        .def("get_mode", &FiniteFault::Image_Gridder::get_mode)
+        .def("get_tension", &FiniteFault::Image_Gridder::get_tension)
+        .def("get_min_log10PGA", &FiniteFault::Image_Gridder::get_min_log10PGA)
+        .def("grid",
+             [](FiniteFault::Image_Gridder &g, const std::vector<double> &lat,
+                const std::vector<double> &lon, const std::vector<double> &log10PGA,
+                const FiniteFault::ImageParams &params) {
+                 cv::Mat raw_img;
+                 if (!g.grid(lat, lon, log10PGA, params, raw_img)) {
+                     throw std::runtime_error("Gridding of the PGA observations failed");
+                 }
+                 return mat_to_array(raw_img);
+             },
+             py::arg("lat"), py::arg("lon"), py::arg("log10PGA"), py::arg("params"),
+             "Grids log10(PGA) onto the image extent. Returns a (NLat, NLon) array, "
+             "row 0 at minLat.")
+        .def("grid_and_threshold",
+             [](FiniteFault::Image_Gridder &g, const std::vector<double> &lat,
+                const std::vector<double> &lon, const std::vector<double> &log10PGA,
+                const FiniteFault::ImageParams &params, const std::vector<double> &log10_thresh) {
+                 cv::Mat raw_img;
+                 if (!g.grid(lat, lon, log10PGA, params, raw_img)) {
+                     throw std::runtime_error("Gridding of the PGA observations failed");
+                 }
+                 std::vector<cv::Mat> img_list;
+                 std::vector<double> image_sum;
+                 FiniteFault::Image_Gridder::threshold(raw_img, log10_thresh, img_list, image_sum);
+                 return image_sum;
+             },
+             py::arg("lat"), py::arg("lon"), py::arg("log10PGA"), py::arg("params"),
+             py::arg("log10_thresh"),
+             "Grids and thresholds in one call, as done for every FinDer update. "
+             "Returns the pixel count above each threshold.");
+}
+
+
+/**
+ * Bindings for the rotated template cache and the template search of finder_ext.
+ */
+void init_matching_bindings(py::module &ff) {
+    // Bounding boxes and pixel counts of the rotated templates
+    py::class_<FiniteFault::Footprint_Table, std::shared_ptr<FiniteFault::Footprint_Table>>(
+            ff, "Footprint_Table")
+        .def_static("load",
+             [](const std::string &path) {
+                 auto table = std::make_shared<FiniteFault::Footprint_Table>();
+                 if (!table->load(path)) {
+                     throw std::runtime_error("Cannot read the footprint table " + path);
+                 }
+                 return table;
+             },
+             py::arg("path"))
+        .def("save",
+             [](const FiniteFault::Footprint_Table &t, const std::string &path) {
+                 if (!t.save(path)) throw std::runtime_error("Writing " + path + " failed");
+             },
+             py::arg("path"))
+        .def_static("side_path", &FiniteFault::Footprint_Table::side_path, py::arg("store_path"),
+             "File the footprints of a template store are kept in.")
+        .def("matches", &FiniteFault::Footprint_Table::matches, py::arg("N_thresh"),
+             py::arg("N_templ"), py::arg("degrees"), py::arg("resize_fraction"))
+        .def("get_N_thresh", &FiniteFault::Footprint_Table::get_N_thresh)
+        .def("get_N_degrees", &FiniteFault::Footprint_Table::get_N_degrees)
+        .def("get_N_templ", &FiniteFault::Footprint_Table::get_N_templ)
+        .def("get_resize_fraction", &FiniteFault::Footprint_Table::get_resize_fraction)
+        .def("get_degrees", &FiniteFault::Footprint_Table::get_degrees)
+        .def("get",
+             [](const FiniteFault::Footprint_Table &t, size_t i, size_t j, size_t k) {
+                 if (i >= t.get_N_thresh() || j >= t.get_N_degrees() || k >= t.get_N_templ()) {
+                     throw py::index_error();
+                 }
+                 const FiniteFault::Template_Footprint &f = t.get(i, j, k);
+                 py::dict out;
+                 out["rows"] = f.rows;
+                 out["cols"] = f.cols;
+                 out["x"] = f.x;
+                 out["y"] = f.y;
+                 out["width"] = f.width;
+                 out["height"] = f.height;
+                 out["pixel_count"] = f.pixel_count;
+                 return out;
+             },
+             py::arg("i"), py::arg("j"), py::arg("k"),
+             "Size of the rotated template, box x, y, width, height of its set pixels and "
+             "their pixel_count.")
+        .def("get_pixel_count",
+             [](const FiniteFault::Footprint_Table &t, size_t i, size_t j, size_t k) {
+                 if (i >= t.get_N_thresh() || j >= t.get_N_degrees() || k >= t.get_N_templ()) {
+                     throw py::index_error();
+                 }
+                 return t.get_pixel_count(i, j, k);
+             },
+             py::arg("i"), py::arg("j"), py::arg("k"))
+        .def("closest_length", &FiniteFault::Footprint_Table::closest_length, py::arg("i"),
+             py::arg("pixels"),
+             "Template at threshold i whose mean pixel count over the strikes is closest to "
+             "pixels.");
+
+    py::class_<FiniteFault::Template_Cache, std::shared_ptr<FiniteFault::Template_Cache>>(
+            ff, "Template_Cache")
+        .def(py::init([](const std::vector<std::vector<py::array_t<float,
+                            py::array::c_style | py::array::forcecast>>> &templates,
+                         const std::vector<double> &degrees, double resize_fraction,
+                         bool keep_pixels) {
+                 std::vector<std::vector<cv::Mat>> mats(templates.size());
+                 for (size_t i = 0; i < templates.size(); i++) {
+                     for (size_t k = 0; k < templates[i].size(); k++) {
+                         mats[i].push_back(array_to_mat(templates[i][k]));
+                     }
+                 }
+                 auto cache = std::make_shared<FiniteFault::Template_Cache>();
+                 cache->set_keep_pixels(keep_pixels);
+                 if (!cache->build(mats, degrees, resize_fraction)) {
+                     throw std::runtime_error("Template_Cache needs the same number of templates "
+                                              "at every threshold and at least one strike");
+                 }
+                 return cache;
+             }),
+             py::arg("templates"), py::arg("degrees"), py::arg("resize_fraction") = 1.0,
+             py::arg("keep_pixels") = true,
+             "Rotates templates[i][k] (PGA threshold i, template k) to every strike. Without "
+             "keep_pixels only the bit-packed templates are kept.")
+        .def("has_pixels", &FiniteFault::Template_Cache::has_pixels)
+        .def("get_N_thresh", &FiniteFault::Template_Cache::get_N_thresh)
+        .def("get_N_degrees", &FiniteFault::Template_Cache::get_N_degrees)
+        .def("get_N_templ", &FiniteFault::Template_Cache::get_N_templ)
+        .def("get_pixel_count", &FiniteFault::Template_Cache::get_pixel_count)
+        .def("get_template",
+             [](const FiniteFault::Template_Cache &c, size_t i, size_t j, size_t k) {
+                 if (i >= c.get_N_thresh() || j >= c.get_N_degrees() || k >= c.get_N_templ()) {
+                     throw py::index_error();
+                 }
+                 cv::Mat scratch;
+                 return mat_to_array(c.get_pixels(i, j, k, scratch));
+             },
+             py::arg("i"), py::arg("j"), py::arg("k"))
+        .def("get_footprints", [](const FiniteFault::Template_Cache &c) {
+                 return std::const_pointer_cast<FiniteFault::Footprint_Table>(c.get_footprints());
+             })
+        .def("memory_bytes", &FiniteFault::Template_Cache::memory_bytes)
+        .def("bits_memory_bytes", &FiniteFault::Template_Cache::bits_memory_bytes);
+
+    // Packed template sets, mapped instead of read template by template
+    py::class_<FiniteFault::Template_Store, std::shared_ptr<FiniteFault::Template_Store>>(
+            ff, "Template_Store")
+        .def_static("open",
+             [](const std::string &path) {
+                 auto store = FiniteFault::Template_Store::for_path(path);
+                 if (!store) {
+                     throw std::runtime_error("Cannot map the template store " + path);
+                 }
+                 return store;
+             },
+             py::arg("path"), "Maps a packed template set, once per process and path.")
+        .def_static("pack",
+             [](const std::string &path, const std::string &name, double dkm,
+                const std::vector<std::vector<py::array_t<float,
+                    py::array::c_style | py::array::forcecast>>> &templates,
+                const std::vector<double> &log10_thresh, const std::vector<double> &degrees) {
+                 std::vector<std::vector<cv::Mat>> mats(templates.size());
+                 for (size_t i = 0; i < templates.size(); i++) {
+                     for (size_t k = 0; k < templates[i].size(); k++) {
+                         cv::Mat templ8;
+                         array_to_mat(templates[i][k]).convertTo(templ8, CV_8U);
+                         mats[i].push_back(templ8);
+                     }
+                 }
+                 if (!FiniteFault::Template_Store::pack(path, name, dkm, mats, log10_thresh,
+                                                        degrees)) {
+                     throw std::runtime_error("Packing the templates into " + path + " failed");
+                 }
+             },
+             py::arg("path"), py::arg("name"), py::arg("dkm"), py::arg("templates"),
+             py::arg("log10_thresh"), py::arg("degrees"),
+             "Packs templates[i][k] (PGA threshold i, template k) into one store file.")
+        .def_static("pack_finder_templates",
+             [](const std::string &path) {
+                 if (!FiniteFault::Template_Store::pack(path,
+                         *FiniteFault::Finder::get_finder_parameters())) {
+                     throw std::runtime_error("Packing the templates into " + path + " failed");
+                 }
+             },
+             py::arg("path"), "Packs the generic template set loaded by Finder.Init.")
+        .def("get_path", &FiniteFault::Template_Store::get_path)
+        .def("get_name", &FiniteFault::Template_Store::get_name)
+        .def("get_dkm", &FiniteFault::Template_Store::get_dkm)
+        .def("get_N_thresh", &FiniteFault::Template_Store::get_N_thresh)
+        .def("get_N_templ", &FiniteFault::Template_Store::get_N_templ)
+        .def("get_N_degrees", &FiniteFault::Template_Store::get_N_degrees)
+        .def("get_file_bytes", &FiniteFault::Template_Store::get_file_bytes)
+        .def("get_log10_thresh", &FiniteFault::Template_Store::get_log10_thresh)
+        .def("get_degrees", &FiniteFault::Template_Store::get_degrees)
+        .def("get_pixel_count", &FiniteFault::Template_Store::get_pixel_count)
+        .def("get_template",
+             [](const FiniteFault::Template_Store &s, size_t i, size_t k) {
+                 if (i >= s.get_N_thresh() || k >= s.get_N_templ()) throw py::index_error();
+                 return mat_to_array(s.get(i, k));
+             },
+             py::arg("i"), py::arg("k"))
+        .def("build_cache",
+             [](const FiniteFault::Template_Store &s, double resize_fraction) {
+                 auto cache = std::make_shared<FiniteFault::Template_Cache>();
+                 if (!cache->build(s.get_templates(), s.get_degrees(), resize_fraction)) {
+                     throw std::runtime_error("The template store holds no templates");
+                 }
+                 return cache;
+             },
+             py::arg("resize_fraction") = 1.0,
+             "Rotates the stored templates to the stored strikes.")
+        .def("get_footprints",
+             [](const FiniteFault::Template_Store &s, double resize_fraction) {
+                 auto table = FiniteFault::Footprint_Table::for_store(s, resize_fraction);
+                 if (!table) throw std::runtime_error("The template store holds no templates");
+                 return std::const_pointer_cast<FiniteFault::Footprint_Table>(table);
+             },
+             py::arg("resize_fraction") = 1.0, py::call_guard<py::gil_scoped_release>(),
+             "Footprints of the stored templates at the stored strikes, read from side_path "
+             "or measured and saved there, once per process.");
+
+    // Station mask with per point station counts, updated around changed stations
+    py::class_<FiniteFault::Mask_Store, std::shared_ptr<FiniteFault::Mask_Store>>(
+            ff, "Mask_Store")
+        .def_static("build",
+             [](const std::vector<double> &lat, const std::vector<double> &lon,
+                const FiniteFault::Coordinate_List &stations, double radius_km) {
+                 if (lat.size() != lon.size()) {
+                     throw std::runtime_error("lat and lon differ in length");
+                 }
+                 return FiniteFault::Mask_Store::build(lat, lon, stations, radius_km);
+             },
+             py::arg("lat"), py::arg("lon"), py::arg("stations"), py::arg("radius_km"),
+             "Mask over the points lat/lon, inside where a station is within radius_km.")
+        .def_static("open",
+             [](const std::string &path) {
+                 auto store = FiniteFault::Mask_Store::open(path);
+                 if (!store) throw std::runtime_error("Cannot map the mask file " + path);
+                 return store;
+             },
+             py::arg("path"))
+        .def("save",
+             [](const FiniteFault::Mask_Store &store, const std::string &path) {
+                 if (!store.save(path)) throw std::runtime_error("Writing " + path + " failed");
+             },
+             py::arg("path"))
+        .def("update", &FiniteFault::Mask_Store::update, py::arg("stations"),
+             "Counts in new stations and counts out removed ones, returns the number of "
+             "points that changed.")
+        .def("size", &FiniteFault::Mask_Store::size)
+        .def("__len__", &FiniteFault::Mask_Store::size)
+        .def("get_N_stations", &FiniteFault::Mask_Store::get_N_stations)
+        .def("get_radius_km", &FiniteFault::Mask_Store::get_radius_km)
+        .def("get_inside", &FiniteFault::Mask_Store::get_inside)
+        .def("get_attached", &FiniteFault::Mask_Store::get_attached)
+        .def("differ",
+             [](const FiniteFault::Mask_Store &store,
+                py::array_t<double, py::array::c_style | py::array::forcecast> values) {
+                 if (values.ndim() != 1 || (size_t) values.shape(0) != store.size()) {
+                     throw std::runtime_error("differ takes one value per mask point");
+                 }
+                 return store.differ(values.data());
+             },
+             py::arg("values"),
+             "Points inside the mask but not in values, or the other way round.")
+        .def("get_lat", [](const FiniteFault::Mask_Store &s) {
+                 return py::array_t<double>(s.size(), s.get_lat());
+             })
+        .def("get_lon", [](const FiniteFault::Mask_Store &s) {
+                 return py::array_t<double>(s.size(), s.get_lon());
+             })
+        .def("get_values", [](const FiniteFault::Mask_Store &s) {
+                 return py::array_t<double>(s.size(), s.get_values());
+             })
+        .def("get_counts", [](const FiniteFault::Mask_Store &s) {
+                 return py::array_t<uint32_t>(s.size(), s.get_counts());
+             });
+
+    ff.def("get_popcount_kernel", &FiniteFault::get_popcount_kernel,
+           "Name of the popcount kernel used by the bit-packed matching.");
+    ff.def("get_popcount_kernels", &FiniteFault::get_popcount_kernels,
+           "Popcount kernels supported by this CPU, fastest first.");
+    ff.def("set_popcount_kernel",
+           [](const std::string &name) {
+               if (!FiniteFault::set_popcount_kernel(name)) {
+                   throw std::runtime_error("Popcount kernel " + name + " is not available");
+               }
+           },
+           py::arg("name"));
+
+    py::enum_<FiniteFault::Match_Mode>(ff, "Match_Mode")
+        .value("AUTO", FiniteFault::MATCH_AUTO)
+        .value("DIRECT", FiniteFault::MATCH_DIRECT)
+        .value("FFT", FiniteFault::MATCH_FFT)
+        .value("BITS", FiniteFault::MATCH_BITS);
+
+    py::class_<FiniteFault::Template_Search>(ff, "Template_Search")
+        .def(py::init([](std::shared_ptr<FiniteFault::Template_Cache> cache,
+                         const FiniteFault::ImageParams &params, FiniteFault::Match_Mode mode,
+                         bool incremental, double restart_pc, bool hierarchical,
+                         double prune_margin, bool count_bound) {
+                 auto search = new FiniteFault::Template_Search(cache, params);
+                 search->set_match_mode(mode);
+                 search->set_incremental(incremental);
+                 search->set_restart_pc(restart_pc);
+                 search->set_hierarchical(hierarchical);
+                 search->set_prune_margin(prune_margin);
+                 search->set_count_bound(count_bound);
+                 return search;
+             }),
+             py::arg("cache"), py::arg("params"), py::arg("mode") = FiniteFault::MATCH_AUTO,
+             py::arg("incremental") = false,
+             py::arg("restart_pc") = FiniteFault::INCREMENTAL_RESTART_PC,
+             py::arg("hierarchical") = false,
+             py::arg("prune_margin") = FiniteFault::PRUNE_MARGIN,
+             py::arg("count_bound") = false)
+        .def("set_match_mode", &FiniteFault::Template_Search::set_match_mode)
+        .def("get_match_mode", &FiniteFault::Template_Search::get_match_mode)
+        .def("get_fft_matches", &FiniteFault::Template_Search::get_fft_matches)
+        .def("get_direct_matches", &FiniteFault::Template_Search::get_direct_matches)
+        .def("get_bit_matches", &FiniteFault::Template_Search::get_bit_matches)
+        .def("get_spectrum_bytes", &FiniteFault::Template_Search::get_spectrum_bytes)
+        .def("set_incremental", &FiniteFault::Template_Search::set_incremental)
+        .def("get_incremental", &FiniteFault::Template_Search::get_incremental)
+        .def("set_restart_pc", &FiniteFault::Template_Search::set_restart_pc)
+        .def("get_restart_pc", &FiniteFault::Template_Search::get_restart_pc)
+        .def("get_incremental_levels", &FiniteFault::Template_Search::get_incremental_levels)
+        .def("get_full_levels", &FiniteFault::Template_Search::get_full_levels)
+        .def("get_rescored_templates", &FiniteFault::Template_Search::get_rescored_templates)
+        .def("set_hierarchical", &FiniteFault::Template_Search::set_hierarchical)
+        .def("get_hierarchical", &FiniteFault::Template_Search::get_hierarchical)
+        .def("set_coarse_factor", &FiniteFault::Template_Search::set_coarse_factor)
+        .def("get_coarse_factor", &FiniteFault::Template_Search::get_coarse_factor)
+        .def("set_prune_margin", &FiniteFault::Template_Search::set_prune_margin)
+        .def("get_prune_margin", &FiniteFault::Template_Search::get_prune_margin)
+        .def("get_coarse_matches", &FiniteFault::Template_Search::get_coarse_matches)
+        .def("get_pruned_templates", &FiniteFault::Template_Search::get_pruned_templates)
+        .def("set_count_bound", &FiniteFault::Template_Search::set_count_bound)
+        .def("get_count_bound", &FiniteFault::Template_Search::get_count_bound)
+        .def("get_count_pruned", &FiniteFault::Template_Search::get_count_pruned)
+        .def("get_minVal_min", &FiniteFault::Template_Search::get_minVal_min)
+        .def("get_computed_cells", &FiniteFault::Template_Search::get_computed_cells)
+        .def("get_pruned_cells", &FiniteFault::Template_Search::get_pruned_cells)
+        .def("reset", &FiniteFault::Template_Search::reset,
+             "Forgets the previous timestep, the next match is a full search.")
+        .def("match",
+             [](FiniteFault::Template_Search &s,
+                const std::vector<py::array_t<float, py::array::c_style | py::array::forcecast>> &images) {
+                 std::vector<cv::Mat> Image;
+                 for (size_t i = 0; i < images.size(); i++) {
+                     Image.push_back(array_to_mat(images[i]));
+                 }
+                 bool status;
+                 {
+                     // the images are copied, the search itself needs no Python objects
+                     py::gil_scoped_release release;
+                     status = s.template_match_image(Image);
+                 }
+                 if (!status) {
+                     throw std::runtime_error("Template matching failed");
+                 }
+             },
+             py::arg("images"),
+             "Matches all templates against images[i], the data image thresholded at level i. "
+             "Releases the GIL.")
+        .def("get_minVal_all", [](const FiniteFault::Template_Search &s) {
+                 return vector3d_to_array(s.minVal_all, s.get_cache());
+             })
+        .def("get_minLoc_lat", [](const FiniteFault::Template_Search &s) {
+                 return vector3d_to_array(s.minLoc_lat, s.get_cache());
+             })
+        .def("get_minLoc_lon", [](const FiniteFault::Template_Search &s) {
+                 return vector3d_to_array(s.minLoc_lon, s.get_cache());
+             })
+        .def("get_minCalc_all", [](const FiniteFault::Template_Search &s) {
+                 return vector3d_to_array(s.minCalc_all, s.get_cache());
+             },
+             "1 where the misfit was computed, 0 where minVal_all holds its lower bound.");
+    ff.def("get_scratch_growths", &FiniteFault::Scratch_Arena::growths,
+           "Reallocations of the per-thread scratch buffers of the template search so far; "
+           "constant once the image and template sizes have all been seen.");
+}
+
+
+// Columns over the numpy buffers, which must outlive them
+FiniteFault::PGA_Columns arrays_to_columns(const py::array_t<double> &lat,
+                                           const py::array_t<double> &lon,
+                                           const py::array_t<double> &value,
+                                           const py::array_t<double> &timestamp,
+                                           const py::array_t<int64_t> &station) {
+    const py::ssize_t n = lat.size();
+    if (lat.ndim() != 1 || lon.ndim() != 1 || value.ndim() != 1 || timestamp.ndim() != 1 ||
+        station.ndim() != 1) {
+        throw std::runtime_error("Expected 1D arrays");
+    }
+    if (lon.size() != n || value.size() != n || timestamp.size() != n || station.size() != n) {
+        throw std::runtime_error("lat, lon, value, timestamp and station differ in length");
+    }
+    FiniteFault::PGA_Columns columns;
+    columns.size = (size_t) n;
+    columns.lat = FiniteFault::Strided_Column<double>(lat.data(), lat.strides(0));
+    columns.lon = FiniteFault::Strided_Column<double>(lon.data(), lon.strides(0));
+    columns.value = FiniteFault::Strided_Column<double>(value.data(), value.strides(0));
+    columns.timestamp = FiniteFault::Strided_Column<double>(timestamp.data(),
+                                                            timestamp.strides(0));
+    columns.station = FiniteFault::Strided_Column<int64_t>(station.data(), station.strides(0));
+    return columns;
+}
+
+// Refill the PGA_Data_List out, or a new list if out is None
+py::object fill_list(const FiniteFault::Sncl_Table &table,
+                     const FiniteFault::PGA_Columns &columns, py::object out) {
+    std::string error;
+    if (out.is_none()) {
+        FiniteFault::PGA_Data_List list;
+        if (!FiniteFault::fill_pga_data_list(table, columns, list, error)) {
+            throw py::index_error(error);
+        }
+        return py::cast(std::move(list));
+    }
+    if (!FiniteFault::fill_pga_data_list(table, columns,
+                                         out.cast<FiniteFault::PGA_Data_List &>(), error)) {
+        throw py::index_error(error);
+    }
+    return out;
+}
+
+// Writable numpy view of a PGA_Array column, keeping the array alive; valid until it is
+// next resized
+template <typename T>
+py::array_t<T> column_view(std::vector<T> &column, py::handle owner) {
+    return py::array_t<T>(std::vector<size_t>{column.size()}, std::vector<size_t>{sizeof(T)},
+                          column.empty() ? nullptr : column.data(), owner);
+}
+
+/**
+ * Bindings for the bulk PGA input of finder_ext/finder_pga_ingest.h
+ */
+void init_ingest_bindings(py::module &ff) {
+    PYBIND11_NUMPY_DTYPE(FiniteFault::PGA_Record, lat, lon, value, timestamp, station);
+
+    py::class_<FiniteFault::Sncl_Table>(ff, "Sncl_Table")
+        .def(py::init<>())
+        .def("intern", &FiniteFault::Sncl_Table::intern, py::arg("network"),
+             py::arg("station"), py::arg("channel"), py::arg("location"),
+             "Index of the station code, added if new.")
+        .def("intern_many",
+             [](FiniteFault::Sncl_Table &t, const std::vector<std::string> &network,
+                const std::vector<std::string> &station, const std::vector<std::string> &channel,
+                const std::vector<std::string> &location) {
+                 const size_t n = network.size();
+                 if (station.size() != n || channel.size() != n || location.size() != n) {
+                     throw std::runtime_error("network, station, channel and location differ "
+                                              "in length");
+                 }
+                 py::array_t<int64_t> index(n);
+                 int64_t *out = index.mutable_data();
+                 for (size_t i = 0; i < n; i++) {
+                     out[i] = (int64_t) t.intern(network[i], station[i], channel[i], location[i]);
+                 }
+                 return index;
+             },
+             py::arg("network"), py::arg("station"), py::arg("channel"), py::arg("location"),
+             "Interns every code and returns their indices.")
+        .def("find",
+             [](const FiniteFault::Sncl_Table &t, const std::string &network,
+                const std::string &station, const std::string &channel,
+                const std::string &location) -> py::object {
+                 const size_t n = t.find(network, station, channel, location);
+                 if (n == t.size()) return py::none();
+                 return py::int_(n);
+             },
+             py::arg("network"), py::arg("station"), py::arg("channel"), py::arg("location"),
+             "Index of the station code, or None.")
+        .def("size", &FiniteFault::Sncl_Table::size)
+        .def("__len__", &FiniteFault::Sncl_Table::size)
+        .def("clear", &FiniteFault::Sncl_Table::clear)
+        .def("get_sncl",
+             [](const FiniteFault::Sncl_Table &t, size_t n) {
+                 if (n >= t.size()) throw py::index_error();
+                 return t.get_sncl(n);
+             },
+             py::arg("index"));
+
+    ff.def("pga_data_list_from_arrays",
+           [](const FiniteFault::Sncl_Table &table, const py::array_t<double> &lat,
+              const py::array_t<double> &lon, const py::array_t<double> &value,
+              const py::array_t<double> &timestamp, const py::array_t<int64_t> &station,
+              py::object out) {
+               return fill_list(table, arrays_to_columns(lat, lon, value, timestamp, station),
+                                out);
+           },
+           py::arg("table"), py::arg("lat"), py::arg("lon"), py::arg("value"),
+           py::arg("timestamp"), py::arg("station"), py::arg("out") = py::none(),
+           "Builds a PGA_Data_List from 1D arrays, station indexing table. float64 and int64 "
+           "arrays are read in place. With out, that list is refilled and returned.");
+
+    ff.def("pga_data_list_from_records",
+           [](const FiniteFault::Sncl_Table &table,
+              const py::array_t<FiniteFault::PGA_Record, py::array::c_style> &records,
+              py::object out) {
+               if (records.ndim() != 1) throw std::runtime_error("Expected a 1D array");
+               return fill_list(table, FiniteFault::PGA_Columns(records.data(),
+                                                                (size_t) records.size()), out);
+           },
+           py::arg("table"), py::arg("records"), py::arg("out") = py::none(),
+           "Same as pga_data_list_from_arrays for a structured array with the fields lat, lon, "
+           "value, timestamp (float64) and station (int64).");
+
+    ff.attr("PGA_RECORD_DTYPE") = py::dtype::of<FiniteFault::PGA_Record>();
+
+    // Delta updates into per-station rings, snapshots for Finder.process and Scan_Data
+    py::class_<FiniteFault::PGA_Stream>(ff, "PGA_Stream")
+        .def(py::init<const FiniteFault::Sncl_Table&, size_t, double, double>(),
+             py::arg("table"), py::arg("depth") = FiniteFault::PGA_STREAM_DEPTH,
+             py::arg("max_age") = 0.0, py::arg("peak_window") = 0.0, py::keep_alive<1, 2>())
+        .def("reserve", &FiniteFault::PGA_Stream::reserve, py::arg("n"),
+             "Preallocates the rings of the first n stations.")
+        .def("push",
+             [](FiniteFault::PGA_Stream &stream, const py::array_t<double> &lat,
+                const py::array_t<double> &lon, const py::array_t<double> &value,
+                const py::array_t<double> &timestamp, const py::array_t<int64_t> &station) {
+                 const FiniteFault::PGA_Columns columns =
+                     arrays_to_columns(lat, lon, value, timestamp, station);
+                 std::string error;
+                 bool status;
+                 {
+                     py::gil_scoped_release release;
+                     status = stream.push(columns, error);
+                 }
+                 if (!status) throw py::index_error(error);
+             },
+             py::arg("lat"), py::arg("lon"), py::arg("value"), py::arg("timestamp"),
+             py::arg("station"),
+             "Adds the samples of the stations that changed, as 1D arrays.")
+        .def("push_records",
+             [](FiniteFault::PGA_Stream &stream,
+                const py::array_t<FiniteFault::PGA_Record, py::array::c_style> &records) {
+                 if (records.ndim() != 1) throw std::runtime_error("Expected a 1D array");
+                 const FiniteFault::PGA_Columns columns(records.data(), (size_t) records.size());
+                 std::string error;
+                 bool status;
+                 {
+                     py::gil_scoped_release release;
+                     status = stream.push(columns, error);
+                 }
+                 if (!status) throw py::index_error(error);
+             },
+             py::arg("records"), "Same as push for a PGA_RECORD_DTYPE array.")
+        .def("snapshot",
+             [](FiniteFault::PGA_Stream &stream, py::object out, double now) {
+                 if (out.is_none()) out = py::cast(FiniteFault::PGA_Data_List());
+                 FiniteFault::PGA_Data_List &list = out.cast<FiniteFault::PGA_Data_List &>();
+                 {
+                     py::gil_scoped_release release;
+                     stream.snapshot(list, now);
+                 }
+                 return out;
+             },
+             py::arg("out") = py::none(), py::arg("now") = NAN,
+             "The PGA_Data_List of the active stations as of the pushes so far; with out, that "
+             "list is refilled and returned. Stations older than max_age before now, or before "
+             "the newest sample, are left out.")
+        .def("clear", &FiniteFault::PGA_Stream::clear)
+        .def("get_depth", &FiniteFault::PGA_Stream::get_depth)
+        .def("get_max_age", &FiniteFault::PGA_Stream::get_max_age)
+        .def("get_peak_window", &FiniteFault::PGA_Stream::get_peak_window)
+        .def("get_stations", &FiniteFault::PGA_Stream::get_stations)
+        .def("get_active", &FiniteFault::PGA_Stream::get_active)
+        .def("get_pending", &FiniteFault::PGA_Stream::get_pending,
+             "Stations pushed since the last snapshot.")
+        .def("get_samples",
+             [](const FiniteFault::PGA_Stream &stream, size_t station) {
+                 std::vector<double> timestamps, values;
+                 stream.get_samples(station, timestamps, values);
+                 return py::make_tuple(py::array_t<double>(timestamps.size(), timestamps.data()),
+                                       py::array_t<double>(values.size(), values.data()));
+             },
+             py::arg("station"), "(timestamps, values) of the ring of a station, oldest first.")
+        .def("peak", &FiniteFault::PGA_Stream::peak, py::arg("station"), py::arg("since"),
+             "Peak of the station's samples at or after since, NaN if none.");
+
+    // Struct-of-arrays observations, PGA_Data_List through from_list / to_list
+    py::class_<FiniteFault::PGA_Array>(ff, "PGA_Array")
+        .def(py::init<>())
+        .def(py::init([](const py::array_t<double> &lat, const py::array_t<double> &lon,
+                         const py::array_t<double> &value, const py::array_t<double> &timestamp,
+                         const py::array_t<int64_t> &station, py::object flags) {
+                 const FiniteFault::PGA_Columns columns =
+                     arrays_to_columns(lat, lon, value, timestamp, station);
+                 py::array_t<uint8_t, py::array::c_style | py::array::forcecast> flag_array;
+                 if (!flags.is_none()) {
+                     flag_array = flags;
+                     if (flag_array.ndim() != 1 || (size_t) flag_array.size() != columns.size) {
+                         throw std::runtime_error("flags differs in length");
+                     }
+                 }
+                 auto array = new FiniteFault::PGA_Array();
+                 array->reserve(columns.size);
+                 for (size_t n = 0; n < columns.size; n++) {
+                     array->push_back(columns.station[n], columns.lat[n], columns.lon[n],
+                                      columns.value[n], columns.timestamp[n],
+                                      flags.is_none() ? FiniteFault::PGA_INCLUDE
+                                                      : flag_array.data()[n]);
+                 }
+                 return array;
+             }),
+             py::arg("lat"), py::arg("lon"), py::arg("value"), py::arg("timestamp"),
+             py::arg("station"), py::arg("flags") = py::none())
+        .def_static("from_list",
+             [](const FiniteFault::PGA_Data_List &pga_data_list, FiniteFault::Sncl_Table &table) {
+                 FiniteFault::PGA_Array array;
+                 array.from_list(pga_data_list, table);
+                 return array;
+             },
+             py::arg("pga_data_list"), py::arg("table"),
+             "The observations of a PGA_Data_List, their codes interned into table.")
+        .def("to_list",
+             [](const FiniteFault::PGA_Array &array, const FiniteFault::Sncl_Table &table,
+                py::object out) {
+                 if (out.is_none()) out = py::cast(FiniteFault::PGA_Data_List());
+                 std::string error;
+                 if (!array.to_list(table, out.cast<FiniteFault::PGA_Data_List &>(), error)) {
+                     throw py::index_error(error);
+                 }
+                 return out;
+             },
+             py::arg("table"), py::arg("out") = py::none(),
+             "The observations as a PGA_Data_List; with out, that list is refilled and returned.")
+        .def("size", &FiniteFault::PGA_Array::size)
+        .def("__len__", &FiniteFault::PGA_Array::size)
+        .def("clear", &FiniteFault::PGA_Array::clear)
+        .def("push_back", &FiniteFault::PGA_Array::push_back, py::arg("station"), py::arg("lat"),
+             py::arg("lon"), py::arg("value"), py::arg("timestamp"),
+             py::arg("flags") = FiniteFault::PGA_INCLUDE)
+        .def("keep",
+             [](FiniteFault::PGA_Array &array,
+                py::array_t<bool, py::array::c_style | py::array::forcecast> mask) {
+                 if (mask.ndim() != 1 || (size_t) mask.size() != array.size()) {
+                     throw std::runtime_error("mask differs in length");
+                 }
+                 return array.keep(std::vector<char>(mask.data(), mask.data() + mask.size()));
+             },
+             py::arg("mask"), "Keeps the observations where mask is set. Returns the number kept.")
+        .def("keep_above", &FiniteFault::PGA_Array::keep_above, py::arg("min_value"))
+        .def("keep_window", &FiniteFault::PGA_Array::keep_window, py::arg("t_min"),
+             py::arg("t_max"))
+        .def("keep_latest", &FiniteFault::PGA_Array::keep_latest,
+             "Keeps the newest observation of each station.")
+        .def("count_above", &FiniteFault::PGA_Array::count_above, py::arg("min_value"),
+             "Included observations of at least min_value.")
+        .def("percentile", &FiniteFault::PGA_Array::percentile, py::arg("pc"),
+             "Value at percentile pc of the included observations, as numpy.percentile.")
+        // Writable views of the columns, valid until the array is next resized
+        .def_property_readonly("station", [](py::object self) {
+                 return column_view(self.cast<FiniteFault::PGA_Array&>().station, self);
+             })
+        .def_property_readonly("lat", [](py::object self) {
+                 return column_view(self.cast<FiniteFault::PGA_Array&>().lat, self);
+             })
+        .def_property_readonly("lon", [](py::object self) {
+                 return column_view(self.cast<FiniteFault::PGA_Array&>().lon, self);
+             })
+        .def_property_readonly("value", [](py::object self) {
+                 return column_view(self.cast<FiniteFault::PGA_Array&>().value, self);
+             })
+        .def_property_readonly("timestamp", [](py::object self) {
+                 return column_view(self.cast<FiniteFault::PGA_Array&>().timestamp, self);
+             })
+        .def_property_readonly("flags", [](py::object self) {
+                 return column_view(self.cast<FiniteFault::PGA_Array&>().flags, self);
+             });
+    ff.attr("PGA_INCLUDE") = FiniteFault::PGA_INCLUDE;
+    ff.attr("PGA_TRIGGER") = FiniteFault::PGA_TRIGGER;
+}
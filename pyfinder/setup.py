@@ -15,8 +15,33 @@ ext_modules = [
         # Module name in Python
         'pylibfinder',  
 
-        # Source files
-        ['bindings/pybind11/finite_fault.cpp'],  
+        # Source files. The finder_ext sources extend the FinDer library on the pyfinder side
+        ['bindings/pybind11/finite_fault.cpp',
+         'bindings/pybind11/finder_ext/finder_alloc_stats.cpp',
+         'bindings/pybind11/finder_ext/finder_engine.cpp',
+         'bindings/pybind11/finder_ext/finder_geodesy.cpp',
+         'bindings/pybind11/finder_ext/finder_gridding.cpp',
+         'bindings/pybind11/finder_ext/finder_log.cpp',
+         'bindings/pybind11/finder_ext/finder_mag_regression.cpp',
+         'bindings/pybind11/finder_ext/finder_mask_store.cpp',
+         'bindings/pybind11/finder_ext/finder_pga_array.cpp',
+         'bindings/pybind11/finder_ext/finder_pga_ingest.cpp',
+         'bindings/pybind11/finder_ext/finder_replay.cpp',
+         'bindings/pybind11/finder_ext/finder_result_writer.cpp',
+         'bindings/pybind11/finder_ext/finder_scratch.cpp',
+         'bindings/pybind11/finder_ext/finder_snapshot.cpp',
+         'bindings/pybind11/finder_ext/finder_spline.cpp',
+         'bindings/pybind11/finder_ext/finder_state_lock.cpp',
+         'bindings/pybind11/finder_ext/finder_station_index.cpp',
+         'bindings/pybind11/finder_ext/finder_worker_pool.cpp',
+         'bindings/pybind11/finder_ext/finder_scheduler.cpp',
+         'bindings/pybind11/finder_ext/finder_popcount.cpp',
+         'bindings/pybind11/finder_ext/finder_bitmatch.cpp',
+         'bindings/pybind11/finder_ext/finder_template_cache.cpp',
+         'bindings/pybind11/finder_ext/finder_template_footprints.cpp',
+         'bindings/pybind11/finder_ext/finder_template_search.cpp',
+         'bindings/pybind11/finder_ext/finder_template_store.cpp',
+         'bindings/pybind11/finder_ext/finder_timing.cpp'],
 
         # Include directories. gmt headers are needed by FinDer
         include_dirs=[
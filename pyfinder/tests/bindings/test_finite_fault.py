@@ -1,11 +1,14 @@
 import unittest
+from concurrent.futures import ThreadPoolExecutor
 from pylibfinder.FiniteFault import (Coordinate, Coordinate_List, 
                                      PGA_Data, PGA_Data_List, Finder_Centroid,
                                      Finder_Rupture, Finder_Rupture_List,
                                      Misfit, Misfit_List,
                                      Finder_Azimuth, Finder_Azimuth_List,
                                      Finder_Length, Finder_Length_List,
-                                     LogLikelihood, LogLikelihood_List,)
+                                     LogLikelihood, LogLikelihood_List,
+                                     set_worker_threads, get_worker_threads,
+                                     Allocation_Counter, Finder, Finder_Engine)
 
 class TestFinderBindings(unittest.TestCase):
     def test_LogLikelihood(self):
@@ -229,3 +232,80 @@ class TestFinderBindings(unittest.TestCase):
         # Check clear method
         rupture_list.clear()
         self.assertEqual(rupture_list.size(), 0)
+
+    def test_WorkerPool(self):
+        # The shared pool is replaced and keeps its size until reconfigured
+        set_worker_threads(3)
+        self.assertEqual(get_worker_threads(), 3)
+        set_worker_threads(1)
+        self.assertEqual(get_worker_threads(), 1)
+
+        # Zero falls back to one thread per hardware thread
+        set_worker_threads(0)
+        self.assertGreaterEqual(get_worker_threads(), 1)
+
+    def test_WorkerPoolThreads(self):
+        # Resizing runs without the GIL and waits for the other resizes
+        with ThreadPoolExecutor(max_workers=4) as executor:
+            list(executor.map(set_worker_threads, [1, 2, 3, 4] * 4))
+        self.assertIn(get_worker_threads(), [1, 2, 3, 4])
+        set_worker_threads(1)
+        self.assertEqual(get_worker_threads(), 1)
+
+    def test_AllocationCounter(self):
+        # Growing a C++ list allocates, the count is frozen once stopped
+        rupture_list = Finder_Rupture_List()
+        with Allocation_Counter() as counter:
+            self.assertTrue(counter.is_running())
+            for _ in range(100):
+                rupture_list.push_back(Finder_Rupture(lat=10, lon=20, depth=30))
+        self.assertFalse(counter.is_running())
+        self.assertGreater(counter.get_allocations(), 0)
+        self.assertGreaterEqual(counter.get_bytes(), 100 * 24)
+        allocations = counter.get_allocations()
+        rupture_list.clear()
+        self.assertEqual(counter.get_allocations(), allocations)
+
+    def test_FinderEngine(self):
+        # The default engine holds the state of Finder.Init and is active until another
+        # engine is used
+        default = Finder_Engine.get_default()
+        self.assertTrue(default.is_active())
+        engine = Finder_Engine()
+        self.assertFalse(engine.is_loaded())
+        self.assertFalse(engine.is_active())
+        self.assertIsNone(engine.get_template_cache())
+        del engine
+        self.assertTrue(Finder_Engine.get_default().is_active())
+
+    def test_ProcessAll(self):
+        # Nothing to process, nothing to order
+        self.assertEqual(Finder.process_all(0.0, PGA_Data_List(), []), [])
+
+    def test_ListArrays(self):
+        # Field views over the list, without a copy
+        rupture_list = Finder_Rupture_List()
+        for n in range(5):
+            rupture_list.push_back(Finder_Rupture(lat=10 + n, lon=20 - n, depth=n))
+        arrays = rupture_list.as_arrays()
+        self.assertEqual(sorted(arrays.keys()), ["depth", "lat", "lon"])
+        for n, rupture in enumerate(rupture_list):
+            self.assertEqual(arrays["lat"][n], rupture.get_lat())
+            self.assertEqual(arrays["lon"][n], rupture.get_lon())
+            self.assertEqual(arrays["depth"][n], rupture.get_depth())
+
+        # Read only, and the list is kept alive by its views
+        with self.assertRaises(ValueError):
+            arrays["lat"][0] = 0.0
+        lat = arrays["lat"]
+        del rupture_list, arrays
+        self.assertEqual(list(lat), [10, 11, 12, 13, 14])
+
+        azimuth_list = Finder_Azimuth_List()
+        azimuth_list.push_back(Finder_Azimuth(azimuth=45, misf=0.25))
+        arrays = azimuth_list.as_arrays()
+        self.assertEqual(arrays["value"][0], 45)
+        self.assertEqual(arrays["misf"][0], 0.25)
+
+        # Empty lists give empty arrays
+        self.assertEqual(len(LogLikelihood_List().as_arrays()["llk"]), 0)
@@ -0,0 +1,65 @@
+import unittest
+import numpy as np
+from pylibfinder.FiniteFault import (Geo_Points, distances_km, azimuths, lat2km, km2lat,
+                                     lon2km, km2lon, get_geodesy_kernel, get_geodesy_kernels,
+                                     set_geodesy_kernel)
+
+
+def haversine_km(lat1, lon1, lat2, lon2):
+    p1, p2 = np.radians(lat1), np.radians(lat2)
+    a = (np.sin((p2 - p1) / 2.0) ** 2 +
+         np.cos(p1) * np.cos(p2) * np.sin(np.radians(lon2 - lon1) / 2.0) ** 2)
+    return 2.0 * 6371.0 * np.arcsin(np.sqrt(np.minimum(a, 1.0)))
+
+
+class TestGeodesy(unittest.TestCase):
+    def setUp(self):
+        rng = np.random.default_rng(2)
+        self.lat = rng.uniform(-89.0, 89.0, 1001)
+        self.lon = rng.uniform(-180.0, 180.0, 1001)
+        self.points = Geo_Points(self.lat, self.lon)
+        self.kernel = get_geodesy_kernel()
+
+    def tearDown(self):
+        set_geodesy_kernel(self.kernel)
+
+    def test_kernels_agree(self):
+        kernels = get_geodesy_kernels()
+        self.assertIn('library', kernels)
+        set_geodesy_kernel('library')
+        dist = distances_km(46.0, 8.0, self.points)
+        az = azimuths(46.0, 8.0, self.points)
+        # within a few percent of a 6371 km sphere, whatever radius the library uses
+        np.testing.assert_allclose(dist, haversine_km(46.0, 8.0, self.lat, self.lon),
+                                   rtol=0.01, atol=1.0)
+        for kernel in kernels:
+            set_geodesy_kernel(kernel)
+            np.testing.assert_allclose(distances_km(46.0, 8.0, self.points), dist,
+                                       rtol=1e-9, atol=1e-6)
+            turn = np.abs(azimuths(46.0, 8.0, self.points) - az)
+            self.assertLess(np.max(np.minimum(turn, np.abs(turn - 360.0))), 1e-6)
+        with self.assertRaises(RuntimeError):
+            set_geodesy_kernel('none')
+
+    def test_matrix(self):
+        origins = Geo_Points(self.lat[:7], self.lon[:7])
+        matrix = distances_km(origins, self.points)
+        self.assertEqual(matrix.shape, (7, 1001))
+        for i in range(7):
+            np.testing.assert_allclose(matrix[i], distances_km(self.lat[i], self.lon[i],
+                                                               self.points), rtol=1e-12)
+        self.assertAlmostEqual(matrix[3, 3], 0.0, places=6)
+
+    def test_linear(self):
+        x = np.array([0.0, 0.37, -2.5, 10.0])
+        avlat = np.array([0.0, 30.0, 45.0, -60.0])
+        np.testing.assert_allclose(km2lat(lat2km(x)), x, atol=1e-12)
+        np.testing.assert_allclose(km2lon(lon2km(x, avlat), avlat), x, atol=1e-12)
+        np.testing.assert_allclose(lon2km(x, avlat), lat2km(x) * np.cos(np.radians(avlat)),
+                                   rtol=1e-6)
+        with self.assertRaises(RuntimeError):
+            lon2km(x, avlat[:2])
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,99 @@
+import unittest
+import numpy as np
+from pylibfinder.FiniteFault import (ImageParams, Image_Gridder, Gridding_Mode,
+                                     gridding_mode_from_option)
+
+
+def synthetic_event(n_stations=40, seed=0):
+    """ Stations around a point source at 46N/8E with an attenuating
+    log10(PGA) field. """
+    rng = np.random.default_rng(seed)
+    lat = 46.0 + rng.uniform(-1.0, 1.0, n_stations)
+    lon = 8.0 + rng.uniform(-1.5, 1.5, n_stations)
+    dist = np.hypot(lat - 46.0, (lon - 8.0) * np.cos(np.radians(46.0))) * 111.19
+    log10pga = 2.5 - 1.5 * np.log10(dist + 10.0)
+    return list(lat), list(lon), list(log10pga)
+
+
+class TestGridding(unittest.TestCase):
+    def setUp(self):
+        self.params = ImageParams(minLat=44.5, minLon=6.0, dLat=0.05, dLon=0.05,
+                                  NLat=61, NLon=81)
+        self.lat, self.lon, self.log10pga = synthetic_event()
+
+    def test_mode_from_option(self):
+        self.assertEqual(gridding_mode_from_option("memory"), Gridding_Mode.GMT_MEMORY)
+        self.assertEqual(gridding_mode_from_option("native"), Gridding_Mode.NATIVE)
+        self.assertEqual(gridding_mode_from_option("yes"), Gridding_Mode.GMT_FILES)
+        self.assertEqual(gridding_mode_from_option(""), Gridding_Mode.GMT_FILES)
+
+    def test_image_params(self):
+        self.assertAlmostEqual(self.params.maxLat, 47.5)
+        self.assertAlmostEqual(self.params.maxLon, 10.0)
+
+    def test_memory_grid_shape(self):
+        gridder = Image_Gridder(tension=0.6, mode=Gridding_Mode.GMT_MEMORY)
+        img = gridder.grid(self.lat, self.lon, self.log10pga, self.params)
+        self.assertEqual(img.shape, (self.params.NLat, self.params.NLon))
+
+        # The strongest shaking should be gridded near the source
+        row, col = np.unravel_index(np.argmax(img), img.shape)
+        self.assertAlmostEqual(self.params.minLat + row * self.params.dLat, 46.0, delta=0.3)
+        self.assertAlmostEqual(self.params.minLon + col * self.params.dLon, 8.0, delta=0.3)
+
+    def test_memory_matches_files(self):
+        # The in-memory path must reproduce the temp file path
+        memory = Image_Gridder(mode=Gridding_Mode.GMT_MEMORY)
+        files = Image_Gridder(mode=Gridding_Mode.GMT_FILES)
+        img_memory = memory.grid(self.lat, self.lon, self.log10pga, self.params)
+        img_files = files.grid(self.lat, self.lon, self.log10pga, self.params)
+        np.testing.assert_allclose(img_memory, img_files, atol=1e-4)
+
+    def test_native_matches_gmt(self):
+        # Regression check of the native tension spline against GMT surface
+        native = Image_Gridder(tension=0.6, mode=Gridding_Mode.NATIVE)
+        gmt = Image_Gridder(tension=0.6, mode=Gridding_Mode.GMT_MEMORY)
+        img_native = native.grid(self.lat, self.lon, self.log10pga, self.params)
+        img_gmt = gmt.grid(self.lat, self.lon, self.log10pga, self.params)
+        self.assertEqual(img_native.shape, img_gmt.shape)
+        self.assertLess(np.sqrt(np.mean((img_native - img_gmt) ** 2)), 0.15)
+
+        # The thresholded footprints are what the template matching sees
+        for thresh in (-1.0, -0.5, 0.0):
+            a, b = img_native >= thresh, img_gmt >= thresh
+            union = np.logical_or(a, b).sum()
+            if union > 0:
+                self.assertGreater(np.logical_and(a, b).sum() / union, 0.85)
+
+    def test_native_non_square_grid(self):
+        # Twice the spacing in longitude must give about every second column of the square
+        # grid. With tension 1 the surface is harmonic, which does not depend on the spacing.
+        gridder = Image_Gridder(tension=1.0, mode=Gridding_Mode.NATIVE)
+        square = ImageParams(minLat=44.5, minLon=6.0, dLat=0.025, dLon=0.025,
+                             NLat=121, NLon=161)
+        wide = ImageParams(minLat=44.5, minLon=6.0, dLat=0.025, dLon=0.05, NLat=121, NLon=81)
+        img_square = gridder.grid(self.lat, self.lon, self.log10pga, square)
+        img_wide = gridder.grid(self.lat, self.lon, self.log10pga, wide)
+        self.assertEqual(img_wide.shape, (121, 81))
+        # a stencil taking the nodes as square is off by about 0.03
+        self.assertLess(np.sqrt(np.mean((img_wide - img_square[:, ::2]) ** 2)), 0.015)
+
+    def test_native_without_gmt(self):
+        gridder = Image_Gridder(mode=Gridding_Mode.NATIVE)
+        image_sum = gridder.grid_and_threshold(self.lat, self.lon, self.log10pga,
+                                               self.params, [-1.0, 0.0])
+        self.assertGreater(image_sum[0], 0)
+
+    def test_threshold_counts(self):
+        gridder = Image_Gridder(mode=Gridding_Mode.GMT_MEMORY)
+        image_sum = gridder.grid_and_threshold(self.lat, self.lon, self.log10pga,
+                                               self.params, [-1.0, 0.0, 1.0])
+        self.assertEqual(len(image_sum), 3)
+        # Higher thresholds can only select fewer pixels
+        self.assertGreaterEqual(image_sum[0], image_sum[1])
+        self.assertGreaterEqual(image_sum[1], image_sum[2])
+
+    def test_mismatched_input(self):
+        gridder = Image_Gridder()
+        with self.assertRaises(RuntimeError):
+            gridder.grid(self.lat, self.lon[:-1], self.log10pga, self.params)
@@ -0,0 +1,70 @@
+import os
+import sys
+import tempfile
+import unittest
+from pylibfinder.FiniteFault import (Log_Level, set_log_level, get_log_level, is_log_enabled,
+                                     log, start_log_async, stop_log_async, is_log_async,
+                                     flush_log, get_log_dropped)
+
+
+class CapturedStdout(object):
+    """Redirects file descriptor 1, which the native log writes to."""
+    def __enter__(self):
+        sys.stdout.flush()
+        self.file = tempfile.TemporaryFile(mode='w+')
+        self.saved = os.dup(1)
+        os.dup2(self.file.fileno(), 1)
+        return self
+
+    def __exit__(self, *args):
+        flush_log()
+        os.dup2(self.saved, 1)
+        os.close(self.saved)
+        self.file.seek(0)
+        self.lines = self.file.read().splitlines()
+        self.file.close()
+
+
+class TestLog(unittest.TestCase):
+    def setUp(self):
+        self.level = get_log_level()
+
+    def tearDown(self):
+        stop_log_async()
+        set_log_level(self.level)
+
+    def test_level_filter(self):
+        set_log_level(Log_Level.INFO)
+        self.assertEqual(get_log_level(), Log_Level.INFO)
+        self.assertTrue(is_log_enabled(Log_Level.ERROR))
+        self.assertTrue(is_log_enabled(Log_Level.INFO))
+        self.assertFalse(is_log_enabled(Log_Level.DEBUG))
+        self.assertFalse(is_log_enabled(Log_Level.VERBOSE))
+        with CapturedStdout() as out:
+            log(Log_Level.VERBOSE, "hidden")
+            log(Log_Level.INFO, "shown")
+        self.assertEqual(out.lines, ["shown"])
+
+        set_log_level(Log_Level.VERBOSE)
+        with CapturedStdout() as out:
+            log(Log_Level.VERBOSE, "trace")
+        self.assertEqual(out.lines, ["trace"])
+
+    def test_async(self):
+        set_log_level(Log_Level.DEBUG)
+        start_log_async()
+        self.assertTrue(is_log_async())
+        dropped = get_log_dropped()
+        with CapturedStdout() as out:
+            for n in range(100):
+                log(Log_Level.DEBUG, "message %d" % n)
+        delivered = ["message %d" % n for n in range(100)]
+        # in order, apart from what a full queue dropped
+        self.assertEqual(len(out.lines) + get_log_dropped() - dropped, 100)
+        self.assertEqual(out.lines, [m for m in delivered if m in out.lines])
+        stop_log_async()
+        self.assertFalse(is_log_async())
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,83 @@
+import unittest
+import numpy as np
+from pylibfinder.FiniteFault import (GMPE_Coefficients, GMPE_Batch, Mag_Regression,
+                                     Mag_Regression_Params)
+
+
+def gmpe(coeff, mag, dist):
+    r = np.sqrt(dist ** 2 + coeff.h ** 2)
+    return (coeff.c0 + coeff.c1 * mag + coeff.c2 * mag ** 2 +
+            (coeff.c3 + coeff.c4 * mag) * np.log10(r) + coeff.c5 * r)
+
+
+class TestMagRegression(unittest.TestCase):
+    def setUp(self):
+        self.p = GMPE_Coefficients(-1.2, 0.9, -0.03, -1.6, 0.1, -0.002, 5.0)
+        self.s = GMPE_Coefficients(-0.8, 0.9, -0.03, -1.6, 0.1, -0.002, 5.0)
+        rng = np.random.default_rng(4)
+        self.dist = rng.uniform(5.0, 250.0, 40)
+        self.is_s = (np.arange(40) % 3 == 0).astype(np.uint8)
+        self.noise = rng.normal(0.0, 0.1, 40)
+
+    def observed(self, mag):
+        return np.where(self.is_s, gmpe(self.s, mag, self.dist),
+                        gmpe(self.p, mag, self.dist)) + self.noise
+
+    def test_batch_matches_gmpe(self):
+        batch = GMPE_Batch(self.dist, self.is_s, self.p, self.s)
+        mags = np.array([2.0, 4.5, 7.25])
+        table = batch.evaluate(mags)
+        self.assertEqual(table.shape, (3, 40))
+        for k, mag in enumerate(mags):
+            expected = np.where(self.is_s, gmpe(self.s, mag, self.dist),
+                                gmpe(self.p, mag, self.dist))
+            np.testing.assert_allclose(table[k], expected, rtol=1e-12, atol=1e-12)
+            np.testing.assert_allclose(batch.evaluate(mag), expected, rtol=1e-12, atol=1e-12)
+
+    def test_refines_grid_sweep(self):
+        params = Mag_Regression_Params()
+        params.s_weight = 0.5
+        params.s_only_thresh = 100
+        regression = Mag_Regression(self.p, self.s, params)
+        result = regression.regress(self.dist, self.observed(5.43), self.is_s)
+        self.assertEqual((result.N_P, result.N_S), (26, 14))
+
+        # the brute-force sweep of mag_regression on a fine grid, misfit evaluated directly
+        mags = np.arange(params.min_mag, params.max_mag + 1e-9, 1e-4)
+        w = np.where(self.is_s, params.s_weight, 1.0)
+        y = self.observed(5.43)
+        misfit = np.array([np.sum(w * (y - np.where(self.is_s, gmpe(self.s, m, self.dist),
+                                                    gmpe(self.p, m, self.dist))) ** 2)
+                           for m in mags]) / np.sum(w)
+        self.assertAlmostEqual(result.magnitude, mags[np.argmin(misfit)], delta=1e-4)
+        self.assertAlmostEqual(result.misfit, np.min(misfit), delta=1e-7)
+        np.testing.assert_allclose(regression.misfit(mags), misfit, rtol=1e-9, atol=1e-12)
+        self.assertLessEqual(abs(result.magnitude - result.grid_magnitude), params.mag_step)
+
+    def test_phase_selection(self):
+        params = Mag_Regression_Params()
+        params.s_only_thresh = 5
+        regression = Mag_Regression(self.p, self.s, params)
+        y = self.observed(4.0)
+        result = regression.regress(self.dist, y, self.is_s)
+        self.assertEqual((result.N_P, result.N_S), (0, 14))
+        self.assertAlmostEqual(result.magnitude,
+                               regression.regress(self.dist, y, self.is_s, True).magnitude)
+
+        params.min_s_stations = 20
+        regression = Mag_Regression(self.p, self.s, params)
+        self.assertEqual(regression.regress(self.dist, y, self.is_s).N_S, 0)
+        self.assertTrue(np.isnan(regression.regress(self.dist, y, self.is_s, True).magnitude))
+
+    def test_range_limits(self):
+        y = self.observed(9.6)
+        y[0] = np.nan
+        params = Mag_Regression_Params()
+        params.s_only_thresh = 100
+        result = Mag_Regression(self.p, self.s, params).regress(self.dist, y, self.is_s)
+        self.assertAlmostEqual(result.magnitude, params.max_mag)
+        self.assertEqual((result.N_P, result.N_S), (26, 13))
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,113 @@
+import os
+import struct
+import tempfile
+import unittest
+import numpy as np
+from pylibfinder.FiniteFault import Coordinate, Coordinate_List, Mask_Store
+
+
+def haversine_km(lat1, lon1, lat2, lon2):
+    p1, p2 = np.radians(lat1), np.radians(lat2)
+    a = (np.sin((p2 - p1) / 2.0) ** 2 +
+         np.cos(p1) * np.cos(p2) * np.sin(np.radians(lon2 - lon1) / 2.0) ** 2)
+    return 2.0 * 6371.0 * np.arcsin(np.sqrt(np.minimum(a, 1.0)))
+
+
+def station_list(coords):
+    stations = Coordinate_List()
+    for lat, lon in coords:
+        stations.push_back(Coordinate(lat, lon))
+    return stations
+
+
+class TestMaskStore(unittest.TestCase):
+    def setUp(self):
+        lat, lon = np.meshgrid(np.arange(44.0, 48.0, 0.05), np.arange(5.0, 11.0, 0.05),
+                               indexing='ij')
+        self.lat, self.lon = lat.ravel(), lon.ravel()
+        rng = np.random.default_rng(4)
+        self.coords = list(zip(rng.uniform(44.5, 47.5, 40), rng.uniform(5.5, 10.5, 40)))
+        handle, self.path = tempfile.mkstemp(suffix=".fdmk")
+        os.close(handle)
+
+    def tearDown(self):
+        os.remove(self.path)
+
+    def expected_counts(self, coords, radius_km):
+        counts = np.zeros(len(self.lat), dtype=np.int64)
+        for slat, slon in coords:
+            # leave out points on the edge, where the earth radius matters
+            counts += haversine_km(slat, slon, self.lat, self.lon) < radius_km
+        return counts
+
+    def test_build(self):
+        store = Mask_Store.build(self.lat, self.lon, station_list(self.coords), 30.0)
+        self.assertEqual(len(store), len(self.lat))
+        self.assertEqual(store.get_N_stations(), 40)
+        counts = store.get_counts()
+        self.assertTrue(np.all(counts >= self.expected_counts(self.coords, 29.9)))
+        self.assertTrue(np.all(counts <= self.expected_counts(self.coords, 30.1)))
+        np.testing.assert_array_equal(store.get_values(), (counts > 0).astype(float))
+        self.assertEqual(store.get_inside(), np.count_nonzero(counts))
+
+    def test_update_matches_rebuild(self):
+        store = Mask_Store.build(self.lat, self.lon, station_list(self.coords), 30.0)
+        # drop five stations and add three
+        coords = self.coords[5:] + [(45.0, 6.0), (46.0, 9.5), (47.9, 10.9)]
+        changed = store.update(station_list(coords))
+        rebuilt = Mask_Store.build(self.lat, self.lon, station_list(coords), 30.0)
+        np.testing.assert_array_equal(store.get_counts(), rebuilt.get_counts())
+        np.testing.assert_array_equal(store.get_values(), rebuilt.get_values())
+        self.assertGreater(changed, 0)
+        # the same list again changes nothing
+        self.assertEqual(store.update(station_list(coords)), 0)
+
+    def test_save_open(self):
+        store = Mask_Store.build(self.lat, self.lon, station_list(self.coords), 30.0)
+        store.save(self.path)
+        mapped = Mask_Store.open(self.path)
+        self.assertEqual(mapped.get_radius_km(), 30.0)
+        self.assertEqual(mapped.get_N_stations(), 40)
+        np.testing.assert_array_equal(mapped.get_lat(), self.lat)
+        np.testing.assert_array_equal(mapped.get_counts(), store.get_counts())
+        # updates of a mapped mask stay private to it until saved
+        mapped.update(station_list(self.coords[:10]))
+        np.testing.assert_array_equal(Mask_Store.open(self.path).get_counts(),
+                                      store.get_counts())
+        with open(self.path, 'wb') as out:
+            out.write(b'not a mask file')
+        with self.assertRaises(RuntimeError):
+            Mask_Store.open(self.path)
+
+    def test_differ(self):
+        store = Mask_Store.build(self.lat, self.lon, station_list(self.coords), 30.0)
+        values = store.get_values().copy()
+        self.assertEqual(store.differ(values), 0)
+        # a library mask taken with another radius, or another station list, disagrees
+        wider = Mask_Store.build(self.lat, self.lon, station_list(self.coords), 60.0)
+        expected = np.count_nonzero((wider.get_values() > 0) != (values > 0))
+        self.assertGreater(expected, 0)
+        self.assertEqual(store.differ(wider.get_values()), expected)
+        # only inside against outside counts, not the value itself
+        values[values > 0] = 3.0
+        values[0] = 1.0 - values[0]
+        self.assertEqual(store.differ(values), 1)
+        with self.assertRaises(RuntimeError):
+            store.differ(values[:-1])
+
+    def test_wrapping_counts(self):
+        Mask_Store.build(self.lat, self.lon, station_list(self.coords), 30.0).save(self.path)
+        with open(self.path, 'rb') as f:
+            data = f.read()
+        # Mask_Header: N_points at 16, N_stations at 24. These counts wrap the offsets computed
+        # from them back to the values stored in the header.
+        n_points, n_stations = struct.unpack_from("=QQ", data, 16)
+        for offset, value in ((16, n_points + 2 ** 62), (24, n_stations + 2 ** 60)):
+            with open(self.path, 'wb') as out:
+                out.write(data[:offset] + struct.pack("=Q", value) + data[offset + 8:])
+            with self.assertRaises(RuntimeError):
+                Mask_Store.open(self.path)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,185 @@
+import threading
+import unittest
+import numpy as np
+from pylibfinder.FiniteFault import (Sncl_Table, PGA_Array, PGA_Data_List, PGA_RECORD_DTYPE,
+                                     PGA_INCLUDE, PGA_Stream, pga_data_list_from_arrays,
+                                     pga_data_list_from_records)
+
+
+class TestPgaIngest(unittest.TestCase):
+    def setUp(self):
+        self.table = Sncl_Table()
+        self.index = self.table.intern_many(["CH", "CH", "IV"], ["DAVOX", "SLE", "ACER"],
+                                            ["HGZ", "HGZ", "HNZ"], ["", "", "00"])
+        self.lat = np.array([46.78, 47.77, 40.79])
+        self.lon = np.array([9.88, 8.49, 15.94])
+        self.value = np.array([1.5, 0.2, 12.0])
+        self.timestamp = np.array([100.0, 100.5, 101.0])
+
+    def test_table(self):
+        np.testing.assert_array_equal(self.index, [0, 1, 2])
+        self.assertEqual(len(self.table), 3)
+        # Interning is idempotent
+        self.assertEqual(self.table.intern("CH", "SLE", "HGZ", ""), 1)
+        self.assertEqual(self.table.find("IV", "ACER", "HNZ", "00"), 2)
+        self.assertIsNone(self.table.find("IV", "ACER", "HNZ", "01"))
+        self.assertEqual(self.table.get_sncl(2), "IV.ACER.00.HNZ")
+
+    def check_list(self, pga_list, order):
+        self.assertEqual(pga_list.size(), len(order))
+        for pga, n in zip(pga_list, order):
+            self.assertEqual(pga.get_network(), self.table.get_sncl(n).split(".")[0])
+            self.assertEqual(pga.get_name(), self.table.get_sncl(n).split(".")[1])
+            self.assertEqual(pga.get_location().get_lat(), self.lat[n])
+            self.assertEqual(pga.get_location().get_lon(), self.lon[n])
+            self.assertEqual(pga.get_value(), self.value[n])
+            self.assertEqual(pga.get_timestamp(), self.timestamp[n])
+            self.assertTrue(pga.get_include())
+
+    def test_from_arrays(self):
+        order = [2, 0, 1]
+        pga_list = pga_data_list_from_arrays(self.table, self.lat[order], self.lon[order],
+                                             self.value[order], self.timestamp[order],
+                                             np.array(order, dtype=np.int64))
+        self.check_list(pga_list, order)
+
+        # Strided views and other dtypes are accepted too
+        wide = np.zeros((3, 2))
+        wide[:, 0] = self.value
+        pga_list = pga_data_list_from_arrays(self.table, self.lat, self.lon, wide[:, 0],
+                                             self.timestamp, [0, 1, 2])
+        self.check_list(pga_list, [0, 1, 2])
+
+    def test_from_records(self):
+        records = np.zeros(3, dtype=PGA_RECORD_DTYPE)
+        records["lat"], records["lon"] = self.lat, self.lon
+        records["value"], records["timestamp"] = self.value, self.timestamp
+        records["station"] = [0, 1, 2]
+        out = PGA_Data_List()
+        self.assertIs(pga_data_list_from_records(self.table, records, out=out), out)
+        self.check_list(out, [0, 1, 2])
+
+        # Refilling replaces the previous contents
+        pga_data_list_from_records(self.table, records[1:], out=out)
+        self.check_list(out, [1, 2])
+
+    def test_unknown_station(self):
+        out = PGA_Data_List()
+        pga_data_list_from_arrays(self.table, self.lat, self.lon, self.value, self.timestamp,
+                                  [0, 1, 2], out=out)
+        with self.assertRaises(IndexError):
+            pga_data_list_from_arrays(self.table, self.lat, self.lon, self.value,
+                                      self.timestamp, [0, 1, 3], out=out)
+        # The list is untouched on failure
+        self.assertEqual(out.size(), 3)
+        with self.assertRaises(RuntimeError):
+            pga_data_list_from_arrays(self.table, self.lat, self.lon[:2], self.value,
+                                      self.timestamp, [0, 1, 2])
+
+    def test_stream_deltas(self):
+        stream = PGA_Stream(self.table, depth=4)
+        stream.push(self.lat, self.lon, self.value, self.timestamp, [0, 1, 2])
+        self.assertEqual(stream.get_pending(), 3)
+        out = PGA_Data_List()
+        self.assertIs(stream.snapshot(out=out), out)
+        self.check_list(out, [0, 1, 2])
+        self.assertEqual(stream.get_pending(), 0)
+
+        # Only SLE reports, the other stations keep their values
+        stream.push(self.lat[1:2], self.lon[1:2], [3.5], [102.0], [1])
+        self.assertEqual(stream.get_pending(), 1)
+        self.value[1], self.timestamp[1] = 3.5, 102.0
+        self.check_list(stream.snapshot(), [0, 1, 2])
+
+        # The ring keeps the last depth samples
+        for k in range(6):
+            stream.push(self.lat[:1], self.lon[:1], [float(k)], [110.0 + k], [0])
+        times, values = stream.get_samples(0)
+        np.testing.assert_array_equal(times, [112.0, 113.0, 114.0, 115.0])
+        np.testing.assert_array_equal(values, [2.0, 3.0, 4.0, 5.0])
+        self.assertEqual(stream.peak(0, 113.5), 5.0)
+        with self.assertRaises(IndexError):
+            stream.push(self.lat[:1], self.lon[:1], [1.0], [120.0], [3])
+
+    def test_stream_expiry_and_peak(self):
+        stream = PGA_Stream(self.table, max_age=5.0, peak_window=10.0)
+        stream.push(self.lat, self.lon, self.value, self.timestamp, [0, 1, 2])
+        self.assertEqual(stream.snapshot().size(), 3)
+        # DAVOX reports a smaller value later, its peak stays
+        stream.push(self.lat[:1], self.lon[:1], [0.5], [104.0], [0])
+        pga_list = stream.snapshot()
+        self.assertEqual(pga_list.size(), 3)
+        self.assertEqual([p.get_value() for p in pga_list if p.get_name() == "DAVOX"], [1.5])
+        # 5 s after the last ACER sample, only DAVOX is still reporting
+        pga_list = stream.snapshot(now=106.5)
+        self.assertEqual([p.get_name() for p in pga_list], ["DAVOX"])
+        self.assertEqual(stream.get_active(), 1)
+
+    def test_stream_peak_while_growing(self):
+        # peak runs while pushes of new stations regrow the rings
+        stream = PGA_Stream(self.table, depth=2)
+        stream.push(self.lat[:1], self.lon[:1], [1.5], [100.0], [0])
+        n = 2000
+        index = self.table.intern_many(["XX"] * n, ["S%04d" % k for k in range(n)],
+                                       ["HGZ"] * n, [""] * n)
+
+        def push():
+            for k in index:
+                stream.push([45.0], [8.0], [0.1], [100.0], [int(k)])
+        thread = threading.Thread(target=push)
+        thread.start()
+        while thread.is_alive():
+            self.assertEqual(stream.peak(0, 0.0), 1.5)
+        thread.join()
+        self.assertGreaterEqual(stream.get_stations(), n + 3)
+
+    def test_array_round_trip(self):
+        array = PGA_Array(self.lat, self.lon, self.value, self.timestamp, [0, 1, 2])
+        self.assertEqual(len(array), 3)
+        self.check_list(array.to_list(self.table), [0, 1, 2])
+        # from_list interns into another table, same SNCLs in list order
+        table = Sncl_Table()
+        array = PGA_Array.from_list(pga_data_list_from_arrays(
+            self.table, self.lat[[2, 0]], self.lon[[2, 0]], self.value[[2, 0]],
+            self.timestamp[[2, 0]], [2, 0]), table)
+        np.testing.assert_array_equal(array.station, [0, 1])
+        self.assertEqual(table.get_sncl(0), "IV.ACER.00.HNZ")
+        np.testing.assert_array_equal(array.value, self.value[[2, 0]])
+        np.testing.assert_array_equal(array.flags, [PGA_INCLUDE, PGA_INCLUDE])
+        # Excluded observations stay excluded
+        array.flags[1] = 0
+        self.assertEqual([p.get_include() for p in array.to_list(table)], [True, False])
+        with self.assertRaises(IndexError):
+            array.to_list(Sncl_Table())
+
+    def test_array_filters(self):
+        array = PGA_Array(np.tile(self.lat, 2), np.tile(self.lon, 2),
+                          np.array([1.5, 0.2, 12.0, 2.5, 0.1, 8.0]),
+                          np.array([100.0, 100.5, 101.0, 103.0, 99.0, 101.0]),
+                          np.tile([0, 1, 2], 2))
+        self.assertEqual(array.count_above(1.0), 4)
+        # Newest per station, the first of equal timestamps
+        latest = PGA_Array(array.lat, array.lon, array.value, array.timestamp, array.station)
+        self.assertEqual(latest.keep_latest(), 3)
+        np.testing.assert_array_equal(latest.station, [1, 2, 0])
+        np.testing.assert_array_equal(latest.value, [0.2, 12.0, 2.5])
+        self.assertEqual(array.keep_window(100.0, 102.0), 4)
+        self.assertEqual(array.keep_above(1.0), 3)
+        np.testing.assert_array_equal(array.value, [1.5, 12.0, 8.0])
+        self.assertEqual(array.keep(np.array([True, False, True])), 2)
+        np.testing.assert_array_equal(array.station, [0, 2])
+
+    def test_array_percentile(self):
+        values = np.random.default_rng(0).lognormal(0.0, 1.0, 101)
+        array = PGA_Array(np.zeros(101), np.zeros(101), values, np.zeros(101),
+                          np.zeros(101, dtype=np.int64))
+        for pc in (0.0, 10.0, 50.0, 95.0, 100.0):
+            self.assertAlmostEqual(array.percentile(pc), np.percentile(values, pc))
+        # Only included observations count
+        array.flags[values > np.median(values)] = 0
+        self.assertAlmostEqual(array.percentile(100.0), np.median(values))
+        self.assertTrue(np.isnan(PGA_Array().percentile(50.0)))
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,111 @@
+import os
+import tempfile
+import threading
+import unittest
+import numpy as np
+from pylibfinder.FiniteFault import (Result_Format, Result_Snapshot, Result_Writer,
+                                     read_results)
+
+
+def snapshot(event_id, mag, points):
+    s = Result_Snapshot()
+    s.record.timestamp = 1000.0 + event_id
+    s.record.event_id = event_id
+    s.record.mag = mag
+    s.rupture = points
+    return s
+
+
+class TestResultWriter(unittest.TestCase):
+    def setUp(self):
+        handle, self.path = tempfile.mkstemp(suffix=".res")
+        os.close(handle)
+
+    def tearDown(self):
+        os.remove(self.path)
+
+    def test_binary_round_trip(self):
+        writer = Result_Writer(self.path, Result_Format.BINARY)
+        self.assertTrue(writer.is_open())
+        points = np.array([[46.0, 8.0, 0.0], [46.1, 8.2, 5.0], [46.2, 8.4, 10.0]])
+        for n in range(5):
+            self.assertTrue(writer.enqueue(snapshot(n, 4.0 + n, points[:n % 4])))
+        writer.flush()
+        self.assertEqual((writer.get_written(), writer.get_dropped()), (5, 0))
+        writer.close()
+
+        snapshots = read_results(self.path)
+        self.assertEqual(len(snapshots), 5)
+        for n, s in enumerate(snapshots):
+            self.assertEqual(s.record.event_id, n)
+            self.assertAlmostEqual(s.record.mag, 4.0 + n)
+            self.assertEqual(s.record.N_rupture, n % 4)
+            np.testing.assert_array_equal(s.rupture, points[:n % 4])
+
+    def test_text(self):
+        writer = Result_Writer(self.path)
+        writer.enqueue(snapshot(7, 6.25, np.array([[46.0, 8.0, 0.0], [46.5, 8.5, 2.0]])))
+        writer.close()
+        with open(self.path) as f:
+            lines = f.read().splitlines()
+        self.assertEqual(len(lines), 3)
+        self.assertTrue(lines[0].startswith("# 1007.000 event 7 "))
+        self.assertIn(" mag 6.25 ", lines[0])
+        self.assertTrue(lines[0].endswith(" N 2"))
+        self.assertEqual(lines[1:], ["46.000 8.000 0.000", "46.500 8.500 2.000"])
+        with self.assertRaises(RuntimeError):
+            read_results(self.path)
+
+    def test_full_queue_drops(self):
+        writer = Result_Writer(self.path, Result_Format.BINARY, 4)
+        self.assertEqual(writer.get_capacity(), 4)
+        points = np.zeros((50, 3))
+
+        def produce():
+            for n in range(2000):
+                writer.enqueue(snapshot(n, 5.0, points))
+
+        threads = [threading.Thread(target=produce) for _ in range(4)]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        writer.flush()
+        # nothing is lost without being counted
+        self.assertEqual(writer.get_enqueued() + writer.get_dropped(), 8000)
+        self.assertEqual(writer.get_written(), writer.get_enqueued())
+        writer.close()
+        self.assertFalse(writer.enqueue(snapshot(0, 5.0, points)))
+        self.assertEqual(len(read_results(self.path)), writer.get_written())
+
+    def test_close_while_enqueueing(self):
+        writer = Result_Writer(self.path, Result_Format.BINARY, 64)
+        points = np.zeros((1, 3))
+        started = threading.Event()
+
+        def produce():
+            started.set()
+            for n in range(5000):
+                writer.enqueue(snapshot(n, 5.0, points))
+
+        threads = [threading.Thread(target=produce) for _ in range(2)]
+        for t in threads:
+            t.start()
+        started.wait()
+        writer.close()
+        for t in threads:
+            t.join()
+        # whatever was accepted is in the file, even when accepted while close ran
+        self.assertEqual(writer.get_enqueued() + writer.get_dropped(), 10000)
+        self.assertEqual(len(read_results(self.path)), writer.get_enqueued())
+
+    def test_unwritable_path(self):
+        writer = Result_Writer(os.path.join(self.path, "no_such_dir", "out.res"))
+        self.assertFalse(writer.is_open())
+        self.assertFalse(writer.enqueue(snapshot(0, 5.0, np.zeros((0, 3)))))
+        writer.flush()
+        self.assertEqual(writer.get_dropped(), 1)
+
+
+if __name__ == '__main__':
+    unittest.main()
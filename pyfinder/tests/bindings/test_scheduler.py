@@ -0,0 +1,75 @@
+import os
+import tempfile
+import time
+import unittest
+from pylibfinder.FiniteFault import Event_Scheduler, Finder_Engine, Finder_Snapshot, PGA_Data_List
+from test_snapshot import put_finder, save_with_finders
+
+
+class TestEventScheduler(unittest.TestCase):
+    def setUp(self):
+        handle, self.path = tempfile.mkstemp(suffix=".snap")
+        os.close(handle)
+        self.engine = Finder_Engine()
+
+    def tearDown(self):
+        os.remove(self.path)
+
+    def finders(self, mags):
+        """Restored finders with a solution of each magnitude, event ids from 1"""
+        save_with_finders(self.path, self.engine,
+                          [put_finder(n + 1, mag=m) for n, m in enumerate(mags)])
+        return Finder_Snapshot.open(self.path).restore(self.engine)
+
+    def test_priority_order(self):
+        finders = self.finders([5.0, 6.5, 5.0, 5.0, 5.0])
+        # 2 and 3 were last heard of at the same time; the hold time of 3 runs out first
+        for finder, last, hold, start in zip(finders, (990, 998, 995, 995, 995),
+                                             (60, 60, 60, 30, 30), (900, 990, 950, 960, 950)):
+            finder.set_last_message_time(last)
+            finder.set_hold_time(hold)
+            finder.set_start_time(start)
+        # largest magnitude, then the earliest end of the hold time, then the oldest
+        self.assertEqual(Event_Scheduler.priority_order(finders), [1, 4, 3, 0, 2])
+        self.assertEqual(Event_Scheduler.priority_order([]), [])
+
+    def test_latency(self):
+        finders = self.finders([4.0, 6.0, 5.0])
+        processed = []
+
+        def step(event_id, timestamp):
+            processed.append((event_id, timestamp))
+            time.sleep(0.02)
+
+        scheduler = Event_Scheduler()
+        scheduler.set_step(step)
+        self.assertTrue(scheduler.process_all(1000.0, PGA_Data_List(), finders))
+        order = scheduler.get_order()
+        self.assertEqual(order, [1, 2, 0])
+        self.assertEqual(processed, [(2, 1000.0), (3, 1000.0), (1, 1000.0)])
+        self.assertEqual(scheduler.get_failed(), 0)
+        # each finder waits for those before it in the order, and only for those
+        latency = scheduler.get_latency_ns()
+        self.assertEqual(len(latency), 3)
+        for k, n in enumerate(order):
+            self.assertGreaterEqual(latency[n], (k + 1) * 20000000)
+        self.assertLess(latency[order[0]], latency[order[1]])
+        self.assertLess(latency[order[1]], latency[order[2]])
+
+    def test_failed_step(self):
+        finders = self.finders([4.0, 6.0])
+
+        def step(event_id, timestamp):
+            if event_id == 2:
+                raise ValueError("no solution")
+
+        scheduler = Event_Scheduler()
+        scheduler.set_step(step)
+        # the other finder is processed regardless
+        self.assertFalse(scheduler.process_all(1000.0, PGA_Data_List(), finders))
+        self.assertEqual(scheduler.get_failed(), 1)
+        self.assertEqual(scheduler.get_order(), [1, 0])
+
+
+if __name__ == '__main__':
+    unittest.main()
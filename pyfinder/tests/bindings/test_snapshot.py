@@ -0,0 +1,138 @@
+import os
+import struct
+import tempfile
+import unittest
+from pylibfinder.FiniteFault import Finder_Engine, Finder_Snapshot
+
+# Snapshot_Header and Snapshot_Finder of finder_snapshot.h, native byte order, no padding
+HEADER = struct.Struct("=8sIIdQQQQ")
+FINDER = struct.Struct("=QqQqqq4BBB2x2d4dqq")
+
+
+def put_string(text):
+    return struct.pack("=Q", len(text)) + text
+
+
+def put_values(fmt, items):
+    return struct.pack("=Q", len(items)) + b"".join(struct.pack(fmt, *i) for i in items)
+
+
+def put_internal(template_id, mag):
+    """A Finder_Internal with a two-point rupture and a centroid PDF"""
+    scalars = (mag, mag, mag - 0.1, 0.2, 46.0, 8.0, 0.1, 0.1, 1000.0, -12.5, 30.0, 45.0, 5.0,
+               46.05, 8.05, 0.05, 0.05)
+    return (put_string(template_id) + struct.pack("=Q", 12) + struct.pack("=17d", *scalars) +
+            put_values("=d", [(0.1,), (0.3,)]) + put_values("=d", [(1.5,)]) +
+            put_values("=3d", [(46.0, 8.0, 0.0), (46.2, 8.3, 10.0)]) +
+            put_values("=2d", [(45.0, 0.5)]) + put_values("=2d", [(30.0, 0.4)]) +
+            put_values("=2d", [(45.0, -1.0)]) + put_values("=2d", [(30.0, -2.0)]) +
+            put_values("=3d", [(46.0, 8.0, -3.0)]) + put_values("=3d", [(46.1, 8.1, -4.0)]))
+
+
+def put_pga_list(stations, event_id):
+    out = struct.pack("=Q", len(stations))
+    for n, name in enumerate(stations):
+        out += (put_string(name) + put_string(b"CH") + put_string(b"HGZ") + put_string(b"") +
+                struct.pack("=4dBB", 46.0 + n, 8.0 + n, -1.0 - n, 999.0, 1, 1) +
+                struct.pack("=Qq", 1, event_id))
+    return out
+
+
+def put_finder(event_id, finder_parameters=-1, mag=6.5):
+    """A Finder record with a solution and PGA lists, no template sets"""
+    body = (struct.pack("=Q", 0) + put_internal(b"generic", mag) + put_internal(b"", 6.3) +
+            struct.pack("=Q", 0) + put_pga_list([b"AAA", b"BBB"], event_id) +
+            put_pga_list([b"AAA"], event_id) + put_pga_list([], event_id))
+    head = FINDER.pack(FINDER.size + len(body), event_id, 3, 990, 998, 60, 1, 1, 0, 1, 0, 1,
+                       46.0, 8.0, 0.5, 8.0, 2.0, 40.0, finder_parameters, -1)
+    return head + body
+
+
+def save_with_finders(path, engine, records):
+    """The snapshot of an empty list at path with records appended"""
+    Finder_Snapshot.save(path, engine, [], 1234.5)
+    with open(path, "rb") as f:
+        data = f.read()
+    fields = list(HEADER.unpack_from(data))
+    data += b"".join(records)
+    fields[4] = len(records)
+    fields[7] = len(data)
+    data = HEADER.pack(*fields) + data[HEADER.size:]
+    with open(path, "wb") as f:
+        f.write(data)
+    return data
+
+
+class TestSnapshot(unittest.TestCase):
+    def setUp(self):
+        handle, self.path = tempfile.mkstemp(suffix=".snap")
+        os.close(handle)
+        self.engine = Finder_Engine()
+
+    def tearDown(self):
+        os.remove(self.path)
+
+    def with_finders(self, records):
+        return save_with_finders(self.path, self.engine, records)
+
+    def test_round_trip(self):
+        self.assertEqual(Finder_Snapshot.save(self.path, self.engine, [], 1234.5), [])
+        self.assertFalse(os.path.exists(self.path + ".tmp"))
+        snapshot = Finder_Snapshot.open(self.path)
+        self.assertEqual(len(snapshot), 0)
+        self.assertEqual(snapshot.get_timestamp(), 1234.5)
+        self.assertEqual(snapshot.get_event_ids(), [])
+        self.assertEqual(snapshot.get_config_file(), self.engine.get_config_file())
+        self.assertEqual(snapshot.get_template_store(), "")
+        self.assertEqual(snapshot.get_file_bytes(), os.path.getsize(self.path))
+        self.assertTrue(snapshot.matches(self.engine))
+        self.assertEqual(snapshot.restore(self.engine), [])
+
+    def test_replaced_atomically(self):
+        Finder_Snapshot.save(self.path, self.engine, [], 1.0)
+        first = Finder_Snapshot.open(self.path)
+        Finder_Snapshot.save(self.path, self.engine, [], 2.0)
+        # the open snapshot keeps the pages of the file it mapped
+        self.assertEqual(first.get_timestamp(), 1.0)
+        self.assertEqual(Finder_Snapshot.open(self.path).get_timestamp(), 2.0)
+
+    def test_invalid_files(self):
+        Finder_Snapshot.save(self.path, self.engine, [], 1.0)
+        with open(self.path, "rb") as f:
+            data = f.read()
+        for bad in (b"", data[:len(data) - 1], data + b"\0", b"X" + data[1:]):
+            with open(self.path, "wb") as f:
+                f.write(bad)
+            with self.assertRaises(RuntimeError):
+                Finder_Snapshot.open(self.path)
+        with self.assertRaises(RuntimeError):
+            Finder_Snapshot.open(os.path.join(self.path, "no_such_file"))
+
+    def test_populated_round_trip(self):
+        data = self.with_finders([put_finder(7), put_finder(9)])
+        snapshot = Finder_Snapshot.open(self.path)
+        self.assertEqual(len(snapshot), 2)
+        self.assertEqual(snapshot.get_event_ids(), [7, 9])
+        finders = snapshot.restore(self.engine)
+        self.assertEqual([f.get_event_id() for f in finders], [7, 9])
+        self.assertAlmostEqual(finders[0].get_mag(), 6.5)
+        # saving the restored finders writes the same records again
+        self.assertEqual(Finder_Snapshot.save(self.path, self.engine, finders, 1234.5), [])
+        with open(self.path, "rb") as f:
+            self.assertEqual(f.read(), data)
+
+    def test_corrupt_record(self):
+        record = put_finder(7)
+        # template set 5 does not exist, and a PGA list count runs past the record
+        overrun = record[:-8] + struct.pack("=Q", 2 ** 40)
+        for bad in (put_finder(7, finder_parameters=5), overrun):
+            self.with_finders([put_finder(3), bad])
+            # the records are indexed by open and read by restore
+            snapshot = Finder_Snapshot.open(self.path)
+            self.assertEqual(snapshot.get_event_ids(), [3, 7])
+            with self.assertRaises(RuntimeError):
+                snapshot.restore(self.engine)
+
+
+if __name__ == '__main__':
+    unittest.main()
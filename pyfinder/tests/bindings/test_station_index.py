@@ -0,0 +1,60 @@
+import unittest
+import numpy as np
+from pylibfinder.FiniteFault import Coordinate, Coordinate_List, Station_Index
+
+
+def haversine_km(lat1, lon1, lat2, lon2):
+    p1, p2 = np.radians(lat1), np.radians(lat2)
+    a = (np.sin((p2 - p1) / 2.0) ** 2 +
+         np.cos(p1) * np.cos(p2) * np.sin(np.radians(lon2 - lon1) / 2.0) ** 2)
+    return 2.0 * 6371.0 * np.arcsin(np.sqrt(np.minimum(a, 1.0)))
+
+
+class TestStationIndex(unittest.TestCase):
+    def setUp(self):
+        rng = np.random.default_rng(1)
+        self.lat = rng.uniform(35.0, 70.0, 2000)
+        self.lon = rng.uniform(-12.0, 40.0, 2000)
+        stations = Coordinate_List()
+        for lat, lon in zip(self.lat, self.lon):
+            stations.push_back(Coordinate(lat, lon))
+        self.index = Station_Index()
+        self.index.build(stations, cell_km=20.0)
+
+    def test_within(self):
+        self.assertEqual(len(self.index), 2000)
+        for qlat, qlon in [(46.0, 8.0), (60.0, 30.0), (35.0, -12.0)]:
+            found = set(self.index.within(qlat, qlon, 150.0))
+            dist = haversine_km(qlat, qlon, self.lat, self.lon)
+            # leave out stations on the edge, where the earth radius matters
+            self.assertTrue(set(np.where(dist < 149.0)[0]) <= found)
+            self.assertFalse(set(np.where(dist > 151.0)[0]) & found)
+
+    def test_nearest(self):
+        nearest = self.index.nearest(self.lat[0], self.lon[0], 5, exclude=0)
+        self.assertEqual(len(nearest), 5)
+        self.assertNotIn(0, nearest)
+        dist = haversine_km(self.lat[0], self.lon[0], self.lat, self.lon)
+        dist[0] = np.inf
+        np.testing.assert_array_equal(nearest, np.argsort(dist)[:5])
+        # nothing within a metre
+        self.assertEqual(len(self.index.nearest(0.0, 0.0, 5, max_km=0.001)), 0)
+
+    def test_connected_groups(self):
+        stations = Coordinate_List()
+        # two clusters 10 km wide, 100 km apart, and a lone station
+        for lat, lon in [(46.0, 8.0), (46.05, 8.05), (46.1, 8.0), (46.9, 8.0), (46.95, 8.0),
+                         (48.0, 8.0)]:
+            stations.push_back(Coordinate(lat, lon))
+        index = Station_Index()
+        index.build(stations)
+        labels = index.connected_groups(np.arange(6), 15.0)
+        np.testing.assert_array_equal(labels, [0, 0, 0, 1, 1, 2])
+        self.assertEqual(index.largest_group(np.arange(6), 15.0), 3)
+        self.assertEqual(index.largest_group([3, 4, 5], 15.0), 2)
+        with self.assertRaises(IndexError):
+            index.largest_group([6], 15.0)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,281 @@
+import unittest
+import numpy as np
+from pylibfinder.FiniteFault import (ImageParams, Template_Cache, Template_Search, Match_Mode,
+                                     get_popcount_kernel, get_popcount_kernels,
+                                     get_scratch_growths, get_worker_threads,
+                                     set_popcount_kernel, set_worker_threads)
+
+
+def bar_templates(lengths, width=3, n_thresh=2):
+    """ North-south rupture templates of the given lengths in pixels,
+    the same at every threshold. """
+    return [[np.ones((length, width), dtype=np.float32) for length in lengths]
+            for _ in range(n_thresh)]
+
+
+class TestTemplateSearch(unittest.TestCase):
+    def setUp(self):
+        self.params = ImageParams(minLat=44.5, minLon=6.0, dLat=0.05, dLon=0.05,
+                                  NLat=61, NLon=81)
+        self.degrees = [0.0, 45.0, 90.0, 135.0]
+        self.lengths = [5, 9, 15, 31]
+        self.cache = Template_Cache(bar_templates(self.lengths), self.degrees)
+
+        # A 15 pixel north-south rupture centred on row 27, column 39
+        image = np.zeros((self.params.NLat, self.params.NLon), dtype=np.float32)
+        image[20:35, 38:41] = 1.0
+        self.images = [image, image]
+
+    def test_cache(self):
+        self.assertEqual(self.cache.get_N_thresh(), 2)
+        self.assertEqual(self.cache.get_N_degrees(), 4)
+        self.assertEqual(self.cache.get_N_templ(), 4)
+        # A right angle rotation swaps the template axes and keeps every pixel
+        self.assertEqual(self.cache.get_template(0, 2, 3).shape, (3, 31))
+        self.assertEqual(self.cache.get_pixel_count(0, 2, 3), 93)
+        self.assertEqual(self.cache.get_pixel_count(0, 0, 0), 15)
+
+    def test_best_match(self):
+        search = Template_Search(self.cache, self.params, Match_Mode.DIRECT)
+        search.match(self.images)
+        misfit = search.get_minVal_all()
+        self.assertEqual(misfit.shape, (2, 4, 4))
+        j, k = np.unravel_index(np.argmin(misfit[0]), misfit[0].shape)
+        self.assertEqual((j, k), (0, 2))
+        self.assertAlmostEqual(misfit[0, 0, 2], 0.0)
+        self.assertAlmostEqual(search.get_minLoc_lat()[0, 0, 2], 44.5 + 27 * 0.05)
+        self.assertAlmostEqual(search.get_minLoc_lon()[0, 0, 2], 6.0 + 39 * 0.05)
+
+    def test_search_survives_resize(self):
+        # a search keeps the pool it was made with after the shared pool is replaced
+        threads = get_worker_threads()
+        search = Template_Search(self.cache, self.params, Match_Mode.DIRECT)
+        search.match(self.images)
+        before = search.get_minVal_all()
+        set_worker_threads(threads + 1)
+        set_worker_threads(threads + 2)
+        search.match(self.images)
+        np.testing.assert_array_equal(search.get_minVal_all(), before)
+        set_worker_threads(threads)
+
+    def test_fft_matches_direct(self):
+        direct = Template_Search(self.cache, self.params, Match_Mode.DIRECT)
+        fft = Template_Search(self.cache, self.params, Match_Mode.FFT)
+        direct.match(self.images)
+        fft.match(self.images)
+        self.assertEqual(fft.get_direct_matches(), 0)
+        self.assertGreater(fft.get_fft_matches(), 0)
+        np.testing.assert_allclose(fft.get_minVal_all(), direct.get_minVal_all(), atol=1e-9)
+        np.testing.assert_allclose(fft.get_minLoc_lat(), direct.get_minLoc_lat())
+        np.testing.assert_allclose(fft.get_minLoc_lon(), direct.get_minLoc_lon())
+
+        # The template spectra are kept for the next update
+        self.assertGreater(fft.get_spectrum_bytes(), 0)
+        fft.match(self.images)
+        np.testing.assert_allclose(fft.get_minVal_all(), direct.get_minVal_all(), atol=1e-9)
+
+    def test_auto_mode(self):
+        search = Template_Search(self.cache, self.params)
+        self.assertEqual(search.get_match_mode(), Match_Mode.AUTO)
+        search.match(self.images)
+        self.assertEqual(search.get_fft_matches() + search.get_direct_matches() +
+                         search.get_bit_matches(), 2 * 4 * 4)
+
+    def test_bits_match_direct(self):
+        direct = Template_Search(self.cache, self.params, Match_Mode.DIRECT)
+        direct.match(self.images)
+        default = get_popcount_kernel()
+        try:
+            for kernel in get_popcount_kernels():
+                set_popcount_kernel(kernel)
+                bits = Template_Search(self.cache, self.params, Match_Mode.BITS)
+                bits.match(self.images)
+                self.assertEqual(bits.get_bit_matches(), 2 * 4 * 4)
+                self.assertEqual(bits.get_direct_matches(), 0)
+                np.testing.assert_allclose(bits.get_minVal_all(), direct.get_minVal_all())
+                np.testing.assert_allclose(bits.get_minLoc_lat(), direct.get_minLoc_lat())
+                np.testing.assert_allclose(bits.get_minLoc_lon(), direct.get_minLoc_lon())
+        finally:
+            set_popcount_kernel(default)
+        with self.assertRaises(RuntimeError):
+            set_popcount_kernel("no such kernel")
+
+    def test_bits_only_cache(self):
+        bits_only = Template_Cache(bar_templates(self.lengths), self.degrees, keep_pixels=False)
+        self.assertFalse(bits_only.has_pixels())
+        self.assertLess(bits_only.memory_bytes(), self.cache.memory_bytes())
+        self.assertEqual(bits_only.memory_bytes(), bits_only.bits_memory_bytes())
+        # A byte per pixel becomes a bit, less so for templates a few pixels wide
+        square = [[np.ones((128, 128), dtype=np.float32)]]
+        pixels = Template_Cache(square, [0.0])
+        self.assertEqual(pixels.memory_bytes() - pixels.bits_memory_bytes(), 8 * 128 * 16)
+        self.assertEqual(pixels.bits_memory_bytes(), 128 * 16)
+        # The pixels are unpacked on request
+        np.testing.assert_array_equal(bits_only.get_template(0, 1, 3),
+                                      self.cache.get_template(0, 1, 3))
+        # Direct and FFT matching unpack the templates they need
+        for mode in (Match_Mode.DIRECT, Match_Mode.FFT, Match_Mode.BITS):
+            direct = Template_Search(self.cache, self.params, mode)
+            search = Template_Search(bits_only, self.params, mode)
+            direct.match(self.images)
+            search.match(self.images)
+            np.testing.assert_allclose(search.get_minVal_all(), direct.get_minVal_all(),
+                                       atol=1e-9)
+
+    def test_incremental_matches_full(self):
+        incremental = Template_Search(self.cache, self.params, Match_Mode.DIRECT,
+                                      incremental=True, restart_pc=50.0)
+        full = Template_Search(self.cache, self.params, Match_Mode.DIRECT)
+        incremental.match(self.images)
+        self.assertEqual(incremental.get_full_levels(), 2)
+
+        # The rupture grows by a few pixels to the north
+        grown = self.images[0].copy()
+        grown[35:39, 38:41] = 1.0
+        incremental.match([grown, grown])
+        full.match([grown, grown])
+        self.assertEqual(incremental.get_incremental_levels(), 2)
+        np.testing.assert_allclose(incremental.get_minVal_all(), full.get_minVal_all(),
+                                   atol=1e-12)
+
+        # Nothing changed, nothing is correlated again
+        rescored = incremental.get_rescored_templates()
+        incremental.match([grown, grown])
+        self.assertEqual(incremental.get_rescored_templates(), rescored)
+        np.testing.assert_allclose(incremental.get_minVal_all(), full.get_minVal_all(),
+                                   atol=1e-12)
+
+    def test_incremental_restart(self):
+        search = Template_Search(self.cache, self.params, Match_Mode.DIRECT,
+                                 incremental=True, restart_pc=10.0)
+        search.match(self.images)
+        # A second rupture doubles the image, beyond restart_pc
+        image = self.images[0].copy()
+        image[40:55, 10:13] = 1.0
+        search.match([image, image])
+        self.assertEqual(search.get_incremental_levels(), 0)
+        self.assertEqual(search.get_full_levels(), 4)
+
+    def test_toggle_forgets_previous(self):
+        full = Template_Search(self.cache, self.params, Match_Mode.DIRECT)
+        full.match(self.images)
+        expected = full.get_minVal_all()
+
+        search = Template_Search(self.cache, self.params, Match_Mode.DIRECT,
+                                 incremental=True, prune_margin=0.0)
+        search.match(self.images)
+        # a pruned step keeps only bounds of the pruned templates
+        search.set_hierarchical(True)
+        search.match(self.images)
+        self.assertGreater(search.get_pruned_templates(), 0)
+        self.assertEqual(search.get_full_levels(), 4)
+        # which the incremental step after switching back must not reuse
+        search.set_hierarchical(False)
+        search.match(self.images)
+        self.assertEqual((search.get_incremental_levels(), search.get_full_levels()), (0, 6))
+        np.testing.assert_allclose(search.get_minVal_all(), expected, atol=1e-12)
+
+        # the same setting again keeps the previous step
+        search.set_hierarchical(False)
+        search.set_incremental(True)
+        search.match(self.images)
+        self.assertEqual((search.get_incremental_levels(), search.get_full_levels()), (2, 6))
+        # count_bound on and off, incremental off and on: each step a full search
+        for set_mode, value in ((search.set_count_bound, True), (search.set_count_bound, False),
+                                (search.set_incremental, False), (search.set_incremental, True)):
+            set_mode(value)
+            search.match(self.images)
+        self.assertEqual((search.get_incremental_levels(), search.get_full_levels()), (2, 14))
+        np.testing.assert_allclose(search.get_minVal_all(), expected, atol=1e-12)
+
+    def test_hierarchical_matches_full(self):
+        full = Template_Search(self.cache, self.params, Match_Mode.DIRECT)
+        full.match(self.images)
+        expected = full.get_minVal_all()
+
+        search = Template_Search(self.cache, self.params, Match_Mode.DIRECT,
+                                 hierarchical=True, prune_margin=0.0)
+        search.match(self.images)
+        misfit, computed = search.get_minVal_all(), search.get_minCalc_all()
+        self.assertGreater(search.get_coarse_matches(), 0)
+        self.assertGreater(search.get_pruned_templates(), 0)
+        self.assertEqual(search.get_pruned_templates(), np.count_nonzero(computed == 0))
+        for i in range(2):
+            self.assertEqual(np.unravel_index(np.argmin(misfit[i]), misfit[i].shape),
+                             np.unravel_index(np.argmin(expected[i]), expected[i].shape))
+            self.assertAlmostEqual(misfit[i].min(), expected[i].min())
+        # a pruned template keeps a lower bound of its misfit
+        np.testing.assert_allclose(misfit[computed == 1], expected[computed == 1], atol=1e-12)
+        self.assertTrue(np.all(misfit <= expected + 1e-12))
+
+        # a wide margin scores everything
+        wide = Template_Search(self.cache, self.params, Match_Mode.DIRECT,
+                               hierarchical=True, prune_margin=1e9)
+        wide.match(self.images)
+        self.assertEqual(wide.get_pruned_templates(), 0)
+        np.testing.assert_allclose(wide.get_minVal_all(), expected, atol=1e-12)
+
+    def test_count_bound(self):
+        full = Template_Search(self.cache, self.params, Match_Mode.DIRECT)
+        full.match(self.images)
+        expected = full.get_minVal_all()
+
+        search = Template_Search(self.cache, self.params, Match_Mode.DIRECT,
+                                 prune_margin=0.0, count_bound=True)
+        search.match(self.images)
+        misfit, computed = search.get_minVal_all(), search.get_minCalc_all()
+        self.assertAlmostEqual(search.get_minVal_min(), expected.min())
+        # the second threshold starts from the perfect match of the first
+        self.assertGreater(search.get_count_pruned(), 0)
+        self.assertEqual(search.get_pruned_cells(), np.count_nonzero(computed == 0))
+        self.assertEqual(search.get_computed_cells() + search.get_pruned_cells(), misfit.size)
+        np.testing.assert_allclose(misfit[computed == 1], expected[computed == 1], atol=1e-12)
+        self.assertTrue(np.all(misfit <= expected + 1e-12))
+        for i in range(2):
+            self.assertEqual(np.unravel_index(np.argmin(misfit[i]), misfit[i].shape),
+                             np.unravel_index(np.argmin(expected[i]), expected[i].shape))
+
+        # the count bound |I - T| / (I + T) of the 31 pixel bars against the 15 pixel rupture
+        pruned = computed[1, 0, 3] == 0
+        self.assertTrue(pruned)
+        self.assertAlmostEqual(misfit[1, 0, 3], (93 - 45) / (93 + 45))
+
+    def test_buffers_reused(self):
+        # A 9 pixel east-west rupture elsewhere, after the north-south one
+        image = np.zeros((self.params.NLat, self.params.NLon), dtype=np.float32)
+        image[44:47, 16:25] = 1.0
+        moved = [image, image]
+        for mode, hierarchical in ((Match_Mode.DIRECT, False), (Match_Mode.FFT, False),
+                                   (Match_Mode.BITS, False), (Match_Mode.DIRECT, True)):
+            fresh = Template_Search(self.cache, self.params, mode, hierarchical=hierarchical)
+            fresh.match(moved)
+            search = Template_Search(self.cache, self.params, mode, hierarchical=hierarchical)
+            search.match(self.images)
+            search.match(moved)
+            np.testing.assert_allclose(search.get_minVal_all(), fresh.get_minVal_all(),
+                                       atol=1e-9)
+            np.testing.assert_allclose(search.get_minLoc_lat(), fresh.get_minLoc_lat())
+            np.testing.assert_allclose(search.get_minLoc_lon(), fresh.get_minLoc_lon())
+
+        # Once every thread has seen every size, the buffers stop growing
+        threads = get_worker_threads()
+        set_worker_threads(1)
+        try:
+            search = Template_Search(self.cache, self.params, Match_Mode.FFT)
+            for images in (self.images, moved) * 3:
+                search.match(images)
+            growths = get_scratch_growths()
+            for images in (self.images, moved) * 2:
+                search.match(images)
+            self.assertEqual(get_scratch_growths(), growths)
+        finally:
+            set_worker_threads(threads)
+
+    def test_missing_threshold(self):
+        search = Template_Search(self.cache, self.params)
+        with self.assertRaises(RuntimeError):
+            search.match(self.images[:1])
+
+
+if __name__ == '__main__':
+    unittest.main()
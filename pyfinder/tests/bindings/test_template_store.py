@@ -0,0 +1,126 @@
+import os
+import struct
+import tempfile
+import unittest
+import numpy as np
+from pylibfinder.FiniteFault import Footprint_Table, Template_Store, Template_Cache
+
+
+class TestTemplateStore(unittest.TestCase):
+    def setUp(self):
+        rng = np.random.default_rng(0)
+        self.log10_thresh = [0.5, 1.0, 1.5]
+        self.degrees = [0.0, 30.0, 60.0]
+        self.templates = [[(rng.uniform(size=(5 + 4 * k, 3 + k)) > 0.3 - 0.1 * i)
+                           .astype(np.float32) for k in range(4)]
+                          for i in range(len(self.log10_thresh))]
+        handle, self.path = tempfile.mkstemp(suffix=".fdts")
+        os.close(handle)
+        Template_Store.pack(self.path, "test_set", 2.0, self.templates,
+                            self.log10_thresh, self.degrees)
+
+    def tearDown(self):
+        os.remove(self.path)
+        if os.path.exists(Footprint_Table.side_path(self.path)):
+            os.remove(Footprint_Table.side_path(self.path))
+
+    def test_round_trip(self):
+        store = Template_Store.open(self.path)
+        self.assertEqual(store.get_name(), "test_set")
+        self.assertAlmostEqual(store.get_dkm(), 2.0)
+        self.assertEqual((store.get_N_thresh(), store.get_N_templ(), store.get_N_degrees()),
+                         (3, 4, 3))
+        self.assertEqual(store.get_log10_thresh(), self.log10_thresh)
+        self.assertEqual(store.get_degrees(), self.degrees)
+        for i in range(3):
+            for k in range(4):
+                np.testing.assert_array_equal(store.get_template(i, k), self.templates[i][k])
+                self.assertEqual(store.get_pixel_count(i, k),
+                                 int(np.count_nonzero(self.templates[i][k])))
+
+    def test_shared_mapping(self):
+        # The same file is mapped once per process
+        store = Template_Store.open(self.path)
+        self.assertIs(Template_Store.open(self.path), store)
+        # Data is page aligned behind the header and tables
+        self.assertEqual(store.get_file_bytes() % 64, 0)
+
+    def test_cache_from_store(self):
+        store = Template_Store.open(self.path)
+        cache = store.build_cache()
+        direct = Template_Cache(self.templates, self.degrees)
+        for j in range(3):
+            np.testing.assert_array_equal(cache.get_template(2, j, 3),
+                                          direct.get_template(2, j, 3))
+
+    def test_footprints(self):
+        cache = Template_Cache(self.templates, self.degrees)
+        footprints = cache.get_footprints()
+        self.assertEqual((footprints.get_N_thresh(), footprints.get_N_degrees(),
+                          footprints.get_N_templ()), (3, 3, 4))
+        for i in range(3):
+            for j in range(3):
+                for k in range(4):
+                    rotated = cache.get_template(i, j, k)
+                    rows, cols = np.nonzero(rotated)
+                    f = footprints.get(i, j, k)
+                    self.assertEqual((f["rows"], f["cols"]), rotated.shape)
+                    self.assertEqual((f["x"], f["y"]), (cols.min(), rows.min()))
+                    self.assertEqual((f["width"], f["height"]),
+                                     (cols.max() - cols.min() + 1, rows.max() - rows.min() + 1))
+                    self.assertEqual(f["pixel_count"], len(rows))
+                    self.assertEqual(cache.get_pixel_count(i, j, k), len(rows))
+        # The longest template covers the most pixels
+        self.assertEqual(footprints.closest_length(0, 1e6), 3)
+        self.assertEqual(footprints.closest_length(0, 0), 0)
+
+    def test_footprints_from_store(self):
+        # Measured without a cache and saved next to the store
+        store = Template_Store.open(self.path)
+        footprints = store.get_footprints()
+        self.assertIs(store.get_footprints(), footprints)
+        self.assertTrue(os.path.exists(Footprint_Table.side_path(self.path)))
+        cached = Template_Cache(self.templates, self.degrees).get_footprints()
+        for i in range(3):
+            for j in range(3):
+                for k in range(4):
+                    self.assertEqual(footprints.get(i, j, k), cached.get(i, j, k))
+
+        # The saved table reads back the same, for the same strikes only
+        table = Footprint_Table.load(Footprint_Table.side_path(self.path))
+        self.assertTrue(table.matches(3, 4, self.degrees, 1.0))
+        self.assertFalse(table.matches(3, 4, self.degrees, 0.5))
+        self.assertFalse(table.matches(3, 4, [0.0, 45.0, 90.0], 1.0))
+        self.assertEqual(table.get(2, 1, 3), footprints.get(2, 1, 3))
+        with self.assertRaises(IndexError):
+            table.get(3, 0, 0)
+
+    def test_invalid_file(self):
+        handle, path = tempfile.mkstemp()
+        os.write(handle, b"not a template store" * 10)
+        os.close(handle)
+        try:
+            with self.assertRaises(RuntimeError):
+                Template_Store.open(path)
+        finally:
+            os.remove(path)
+
+    def test_corrupt_fields(self):
+        with open(self.path, "rb") as f:
+            data = f.read()
+        # Store_Header: N_templ at 24, data_offset at 40, then the first Store_Entry at 128
+        # with its step at 128 + 24 and offset at 128 + 16
+        for offset, value in ((24, 2 ** 62), (40, len(data) + 1), (128 + 24, 0),
+                              (128 + 16, 2 ** 64 - 8)):
+            handle, path = tempfile.mkstemp(suffix=".fdts")
+            os.write(handle, data[:offset] + struct.pack("=Q", value) + data[offset + 8:])
+            os.close(handle)
+            try:
+                with self.assertRaises(RuntimeError):
+                    Template_Store.open(path)
+            finally:
+                os.remove(path)
+
+
+if __name__ == '__main__':
+    unittest.main()
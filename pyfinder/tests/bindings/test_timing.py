@@ -0,0 +1,57 @@
+import unittest
+import numpy as np
+from pylibfinder.FiniteFault import (ImageParams, Template_Cache, Template_Search, Timing_Stage,
+                                     clear_timing, enable_timing, get_stage_stats,
+                                     get_timing_spans, is_timing_enabled, timing_prometheus)
+
+
+class TestTiming(unittest.TestCase):
+    def setUp(self):
+        self.params = ImageParams(minLat=44.5, minLon=6.0, dLat=0.05, dLon=0.05,
+                                  NLat=61, NLon=81)
+        templates = [[np.ones((length, 3), dtype=np.float32) for length in (5, 15)]
+                     for _ in range(2)]
+        self.cache = Template_Cache(templates, [0.0, 90.0])
+        image = np.zeros((self.params.NLat, self.params.NLon), dtype=np.float32)
+        image[20:35, 38:41] = 1.0
+        self.images = [image, image]
+        clear_timing()
+
+    def tearDown(self):
+        enable_timing(False)
+        clear_timing()
+
+    def test_off_by_default(self):
+        self.assertFalse(is_timing_enabled())
+        Template_Search(self.cache, self.params).match(self.images)
+        self.assertEqual(len(get_timing_spans()["stage"]), 0)
+        self.assertEqual(get_stage_stats()["search"][0], 0)
+
+    def test_spans(self):
+        enable_timing()
+        search = Template_Search(self.cache, self.params)
+        search.match(self.images)
+        search.match(self.images)
+        spans = get_timing_spans()
+        searches = spans["stage"] == int(Timing_Stage.SEARCH)
+        self.assertEqual(np.count_nonzero(searches), 4)
+        # tagged with the threshold index
+        self.assertEqual(sorted(spans["tag"][searches]), [0, 0, 1, 1])
+        self.assertTrue(np.all(spans["duration_ns"][searches] > 0))
+
+        calls, total, longest = get_stage_stats()["search"]
+        self.assertEqual(calls, 4)
+        self.assertAlmostEqual(total, spans["duration_ns"][searches].sum() * 1e-9)
+        self.assertAlmostEqual(longest, spans["duration_ns"][searches].max() * 1e-9)
+
+        text = timing_prometheus()
+        self.assertIn('finder_stage_calls_total{stage="search"} 4', text)
+        self.assertIn("# TYPE finder_stage_seconds_total counter", text)
+
+        clear_timing()
+        self.assertEqual(len(get_timing_spans()["stage"]), 0)
+        self.assertEqual(get_stage_stats()["search"][0], 0)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,33 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Offline packer for the FinDer template store. Loads the generic template
+set of a FinDer configuration the usual way and writes it into one
+memory-mappable file, which Template_Store.open maps at start up instead
+of reading every template file again.
+
+Run after building the bindings:
+python3 utils/template_packer.py --config finder.config --output generic.fdts
+"""
+import argparse
+from pylibfinder.FiniteFault import Finder, Coordinate_List, Template_Store
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--config", required=True, help="FinDer configuration file")
+    parser.add_argument("--output", required=True, help="template store to write")
+    args = parser.parse_args()
+
+    Finder.Init(args.config, Coordinate_List())
+    Template_Store.pack_finder_templates(args.output)
+
+    store = Template_Store.open(args.output)
+    print("Packed {} ({} thresholds x {} templates, {} strikes) into {}, {:.1f} MB".format(
+        store.get_name(), store.get_N_thresh(), store.get_N_templ(), store.get_N_degrees(),
+        args.output, store.get_file_bytes() / 1048576.0))
+
+
+if __name__ == "__main__":
+    main()